@@ -0,0 +1,820 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#if !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <nvsg/nvsg.h>
+#include <nvsg/GeoNode.h>
+#include <nvsg/Group.h>
+#include <nvsg/Primitive.h>
+#include <nvsg/VertexAttributeSet.h>
+#include <nvmath/nvmath.h>
+#include <nvutil/Timer.h>
+
+#include "BufferArray.h"
+#include "MeshBatch.h"
+#include "MeshCache.h"
+#include "MeshGenerator.h"
+#include "MeshletBuilder.h"
+#include "ParametricKernel.h"
+#include "PatchTessellator.h"
+
+#include <QtCore/QDir>
+#include <QtGui/QImage>
+
+#include <nvutil/DbgNew.h>  // enable leak detection
+
+using namespace nvmath;
+using namespace nvsg;
+using namespace nvutil;
+
+namespace
+{
+//! The attribute arrays of a rotational surface, as filled by createSphere and createTorus
+struct SurfaceAttributes
+{
+    std::vector<Vec3f> vertices;
+    std::vector<Vec3f> normals;
+    std::vector<Vec3f> tangents;
+    std::vector<Vec3f> binormals;
+    std::vector<Vec2f> texcoords;
+};
+
+// Per vertex sinf/cosf and push_back, the way createSphere filled its attributes before the ring kernel
+void referenceSphere( unsigned int m, unsigned int n, float radius, SurfaceAttributes &attr )
+{
+    const unsigned int size_v = ( m + 1 ) * n;
+    attr.vertices.clear();  attr.vertices.reserve( size_v );
+    attr.normals.clear();   attr.normals.reserve( size_v );
+    attr.tangents.clear();  attr.tangents.reserve( size_v );
+    attr.binormals.clear(); attr.binormals.reserve( size_v );
+    attr.texcoords.clear(); attr.texcoords.reserve( size_v );
+
+    float phi_step = 2.0f * PI / (float) m;
+    float theta_step = PI / (float) (n - 1);
+
+    for( unsigned int latitude = 0 ; latitude < n ; latitude++ )
+    {
+        float theta = (float) latitude * theta_step;
+        float sinTheta = sinf( theta );
+        float cosTheta = cosf( theta );
+        float texv = (float) latitude / (float) (n - 1);
+
+        for( unsigned int longitude = 0 ; longitude <= m ; longitude++ )
+        {
+            float phi = (float) longitude * phi_step;
+            float sinPhi = sinf( phi );
+            float cosPhi = cosf( phi );
+            float texu = (float) longitude / (float) m;
+
+            Vec3f v = Vec3f( cosPhi * sinTheta, -cosTheta, -sinPhi * sinTheta );
+
+            attr.vertices.push_back( v * radius );
+            attr.texcoords.push_back( Vec2f( texu , texv ) );
+            attr.normals.push_back( v );
+            attr.tangents.push_back( Vec3f( -sinPhi, 0.0f, -cosPhi ) );
+            attr.binormals.push_back( Vec3f( cosTheta * cosPhi, sinTheta, cosTheta * -sinPhi ) );
+        }
+    }
+}
+
+// The same attributes filled with the ring table and the row kernel
+void kernelSphere( unsigned int m, unsigned int n, float radius, SurfaceAttributes &attr )
+{
+    const unsigned int size_v = ( m + 1 ) * n;
+    attr.vertices.resize( size_v );
+    attr.normals.resize( size_v );
+    attr.tangents.resize( size_v );
+    attr.binormals.resize( size_v );
+    attr.texcoords.resize( size_v );
+
+    float phi_step = 2.0f * PI / (float) m;
+    float theta_step = PI / (float) (n - 1);
+
+    RingTable ring;
+    computeRingTable( m + 1, 0.0f, phi_step, 1.0f / ( 2.0f * PI ), ring );
+
+    for( unsigned int latitude = 0 ; latitude < n ; latitude++ )
+    {
+        float theta = (float) latitude * theta_step;
+        float sinTheta = sinf( theta );
+        float cosTheta = cosf( theta );
+        unsigned int first = latitude * ( m + 1 );
+
+        evaluateRingRow( ring, sinTheta, 0.0f, -cosTheta, 0.0f, -sinTheta, &attr.normals[first] );
+        evaluateRingRow( ring, radius * sinTheta, 0.0f, -radius * cosTheta, 0.0f, -radius * sinTheta, &attr.vertices[first] );
+        evaluateRingRow( ring, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, &attr.tangents[first] );
+        evaluateRingRow( ring, cosTheta, 0.0f, sinTheta, 0.0f, -cosTheta, &attr.binormals[first] );
+        evaluateRingTexCoords( ring, (float) latitude / (float) (n - 1), &attr.texcoords[first] );
+    }
+}
+
+typedef void (*SphereFill)( unsigned int m, unsigned int n, float radius, SurfaceAttributes &attr );
+
+//! Run \a fill \a repeats times and return the achieved vertices per second
+double measureFill( SphereFill fill, unsigned int m, unsigned int n, unsigned int repeats )
+{
+    SurfaceAttributes attr;
+    fill( m, n, 1.0f, attr );   // warm up, allocate once
+
+    Timer timer;
+    timer.start();
+    for ( unsigned int i = 0; i < repeats; ++i )
+    {
+        fill( m, n, 1.0f, attr );
+    }
+    double seconds = timer.getTime();
+    return seconds > 0.0 ? double( repeats ) * double( attr.vertices.size() ) / seconds : 0.0;
+}
+
+//! Measure the complete createSphere call, including the creation of the SceniX objects
+double measureCreateSphere( unsigned int m, unsigned int n, unsigned int repeats )
+{
+    Timer timer;
+    timer.start();
+    for ( unsigned int i = 0; i < repeats; ++i )
+    {
+        DrawableSharedPtr drawable = createSphere( m, n );
+    }
+    double seconds = timer.getTime();
+    return seconds > 0.0 ? double( repeats ) * double( ( m + 1 ) * n ) / seconds : 0.0;
+}
+
+//! Set up \a count x \a count bicubic patches of a wavy surface
+void setupWavePatches( unsigned int count, std::vector<Vec3f> &controlPoints )
+{
+    controlPoints.clear();
+    controlPoints.reserve( count * count * 16 );
+    for ( unsigned int py = 0; py < count; ++py )
+    {
+        for ( unsigned int px = 0; px < count; ++px )
+        {
+            for ( unsigned int j = 0; j < 4; ++j )
+            {
+                for ( unsigned int i = 0; i < 4; ++i )
+                {
+                    float x = (float) px + (float) i / 3.0f;
+                    float y = (float) py + (float) j / 3.0f;
+                    controlPoints.push_back( Vec3f( x, y, 0.25f * sinf( x ) * cosf( y ) ) );
+                }
+            }
+        }
+    }
+}
+
+//! Measure tessellateQuadPatches4x4 at the fixed \a level and return the achieved vertices per second
+double measurePatches( const std::vector<Vec3f> &controlPoints, unsigned int level, bool multithreaded, unsigned int repeats )
+{
+    PatchTessellationParameters parameters;
+    parameters.minLevel = level;
+    parameters.maxLevel = level;
+    parameters.multithreaded = multithreaded;
+
+    Timer timer;
+    timer.start();
+    for ( unsigned int i = 0; i < repeats; ++i )
+    {
+        PrimitiveSharedPtr primitive = tessellateQuadPatches4x4( controlPoints, parameters );
+    }
+    double seconds = timer.getTime();
+    double vertices = double( controlPoints.size() / 16 ) * double( ( level + 1 ) * ( level + 1 ) );
+    return seconds > 0.0 ? double( repeats ) * vertices / seconds : 0.0;
+}
+
+//! Set up \a count specs cycling through spheres, cylinders and tori of \a resolution segments around
+void setupBatchSpecs( unsigned int count, unsigned int resolution, std::vector<MeshSpec> &specs )
+{
+    specs.clear();
+    specs.reserve( count );
+    for ( unsigned int i = 0; i < count; ++i )
+    {
+        switch( i % 3 )
+        {
+        case 0:
+            specs.push_back( MeshSpec::sphere( resolution, resolution / 2 ) );
+            break;
+        case 1:
+            specs.push_back( MeshSpec::cylinder( 1.0f, 2.0f, resolution / 4, resolution ) );
+            break;
+        default:
+            specs.push_back( MeshSpec::torus( resolution, resolution / 2 ) );
+            break;
+        }
+    }
+}
+
+//! Measure createMeshBatch and return the achieved drawables per second
+double measureBatch( const std::vector<MeshSpec> &specs, bool multithreaded, unsigned int repeats )
+{
+    std::vector<DrawableSharedPtr> drawables;
+    Timer timer;
+    timer.start();
+    for ( unsigned int i = 0; i < repeats; ++i )
+    {
+        createMeshBatch( specs, drawables, multithreaded );
+    }
+    double seconds = timer.getTime();
+    return seconds > 0.0 ? double( repeats ) * double( specs.size() ) / seconds : 0.0;
+}
+
+//! Write \a count different images of \a size x \a size texels as PNG files to \a directory, their names go to \a files
+void writeBenchTextures( const QDir &directory, unsigned int count, unsigned int size, std::vector<std::string> &files )
+{
+    for ( unsigned int i = 0; i < count; ++i )
+    {
+        QImage image( size, size, QImage::Format_ARGB32 );
+        for ( unsigned int y = 0; y < size; ++y )
+        {
+            QRgb *line = reinterpret_cast<QRgb *>( image.scanLine( y ) );
+            for ( unsigned int x = 0; x < size; ++x )
+            {
+                line[x] = qRgba( ( x * ( i + 1 ) ) & 0xff, ( y * ( i + 3 ) ) & 0xff, ( ( x ^ y ) + 17 * i ) & 0xff, 255 );
+            }
+        }
+
+        QString name = QString( "meshbench%1.png" ).arg( i );
+        if ( image.save( directory.filePath( name ), "PNG" ) )
+        {
+            files.push_back( name.toStdString() );
+        }
+    }
+}
+
+//! Decode \a files found in \a searchPaths with \a parameters into an empty texture cache, returns the seconds taken
+double measureTextureDecode( const std::vector<std::string> &files, const std::vector<std::string> &searchPaths
+                           , const TextureDecodeParameters &parameters )
+{
+    releaseTextureCache();
+    Timer timer;
+    timer.start();
+    std::vector<StateSetSharedPtr> stateSets = createTexturesFromFiles( files, searchPaths, parameters );
+    return( timer.getTime() );
+}
+
+//! The objects created by one call of a BenchCase, kept until the next call so their destruction is timed as well
+struct BenchObjects
+{
+    DrawableSharedPtr drawable;
+    NodeSharedPtr     node;
+    StateSetSharedPtr stateSet;
+    ObjectSharedPtr   object;           // anything else, only timed
+    size_t            textureBytes;     // image bytes of the procedural textures
+};
+
+typedef void (*BenchFunction)( unsigned int size, BenchObjects &objects );
+
+//! One create* function of MeshGenerator.h, called with each of the non-zero \a sizes
+struct BenchCase
+{
+    const char   *name;
+    const char   *parameter;            // how size maps to the parameters of the function
+    BenchFunction function;
+    unsigned int  sizes[4];
+};
+
+//! The result of one BenchCase at one size
+struct BenchResult
+{
+    std::string  name;
+    std::string  parameter;
+    unsigned int size;
+    unsigned int calls;
+    double       seconds;               // per call
+    size_t       vertices;              // per call, summed over all drawables, so over all levels of a LOD
+    size_t       dataBytes;             // size of the vertex, index and image data of one call's result, not the bytes allocated
+    size_t       processPeakRSS;        // peak resident set size of the whole process so far, includes all earlier cases
+};
+
+float benchTerrainHeight( float u, float v, void * )
+{
+    return( sinf( 7.0f * u ) * cosf( 5.0f * v ) );
+}
+
+StateSetSharedPtr benchStateSet()
+{
+    return( getSharedDefaultMaterial( Vec3f( 0.8f, 0.8f, 0.8f ) ) );
+}
+
+//! Helper class to add MESH_FORMAT_TRIANGLE_STRIPS to the mesh format for the lifetime of the object
+class TriangleStripFormat
+{
+public:
+    TriangleStripFormat()
+        : m_format( getMeshFormat() )
+    {
+        setMeshFormat( m_format | MESH_FORMAT_TRIANGLE_STRIPS );
+    }
+
+    ~TriangleStripFormat()
+    {
+        setMeshFormat( m_format );
+    }
+
+private:
+    unsigned int m_format;
+};
+
+void benchQuadSet( unsigned int s, BenchObjects &o )                { o.drawable = createQuadSet( s, s ); }
+void benchQuadSetChunked( unsigned int s, BenchObjects &o )         { o.node = createQuadSetChunked( s, s, benchStateSet() ); }
+void benchQuadStrip( unsigned int s, BenchObjects &o )              { o.drawable = createQuadStrip( s ); }
+void benchTriSet( unsigned int s, BenchObjects &o )                 { o.drawable = createTriSet( s, s ); }
+void benchTriSetChunked( unsigned int s, BenchObjects &o )          { o.node = createTriSetChunked( s, s, benchStateSet() ); }
+void benchTriFan( unsigned int s, BenchObjects &o )                 { o.drawable = createTriFan( s ); }
+void benchTriStrip( unsigned int s, BenchObjects &o )               { o.drawable = createTriStrip( s, s ); }
+void benchTriPatches4( unsigned int s, BenchObjects &o )            { o.node = createTriPatches4( std::vector<std::string>(), s, s ); }
+void benchQuadPatches4x4( unsigned int s, BenchObjects &o )         { o.node = createQuadPatches4x4( std::vector<std::string>(), s, s ); }
+void benchCube( unsigned int, BenchObjects &o )                     { o.drawable = createCube(); }
+void benchTetrahedron( unsigned int, BenchObjects &o )              { o.drawable = createTetrahedron(); }
+void benchOctahedron( unsigned int, BenchObjects &o )               { o.drawable = createOctahedron(); }
+void benchDodecahedron( unsigned int, BenchObjects &o )             { o.drawable = createDodecahedron(); }
+void benchIcosahedron( unsigned int, BenchObjects &o )              { o.drawable = createIcosahedron(); }
+void benchIcoSphere( unsigned int s, BenchObjects &o )              { o.drawable = createIcoSphere( s ); }
+void benchSphere( unsigned int s, BenchObjects &o )                 { o.drawable = createSphere( s, s / 2 ); }
+void benchCylinder( unsigned int s, BenchObjects &o )               { o.drawable = createCylinder( 1.0f, 2.0f, s / 4, s ); }
+void benchTorus( unsigned int s, BenchObjects &o )                  { o.drawable = createTorus( s, s / 2 ); }
+void benchTessellatedPlane( unsigned int s, BenchObjects &o )       { o.drawable = createTessellatedPlane( s ); }
+void benchTessellatedPlaneChunked( unsigned int s, BenchObjects &o ){ o.node = createTessellatedPlaneChunked( s, benchStateSet() ); }
+void benchPlane( unsigned int, BenchObjects &o )                    { o.drawable = createPlane( 0.0f, 0.0f, 640.0f, 480.0f ); }
+void benchTessellatedBox( unsigned int s, BenchObjects &o )         { o.drawable = createTessellatedBox( s ); }
+void benchSphereLOD( unsigned int s, BenchObjects &o )              { o.node = createSphereLOD( s, s / 2, benchStateSet() ); }
+void benchCylinderLOD( unsigned int s, BenchObjects &o )            { o.node = createCylinderLOD( 1.0f, 2.0f, s / 4, s, benchStateSet() ); }
+void benchTorusLOD( unsigned int s, BenchObjects &o )               { o.node = createTorusLOD( s, s / 2, benchStateSet() ); }
+void benchTessellatedBoxLOD( unsigned int s, BenchObjects &o )      { o.node = createTessellatedBoxLOD( s, benchStateSet() ); }
+void benchTerrain( unsigned int s, BenchObjects &o )                { o.node = createTerrain( &benchTerrainHeight, 0, Vec2f( 100.0f, 100.0f ), s, benchStateSet() ); }
+void benchSphereStrips( unsigned int s, BenchObjects &o )           { TriangleStripFormat strips; benchSphere( s, o ); }
+void benchTorusStrips( unsigned int s, BenchObjects &o )            { TriangleStripFormat strips; benchTorus( s, o ); }
+void benchTessellatedPlaneStrips( unsigned int s, BenchObjects &o ) { TriangleStripFormat strips; benchTessellatedPlane( s, o ); }
+void benchDefaultMaterial( unsigned int, BenchObjects &o )          { o.stateSet = createDefaultMaterial( Vec3f( 0.8f, 0.2f, 0.2f ) ); }
+void benchGeoNode( unsigned int, BenchObjects &o )                  { o.node = createGeoNode( getSharedPolyhedron( POLYHEDRON_CUBE ), benchStateSet() ); }
+void benchTransform( unsigned int, BenchObjects &o )                { o.node = createTransform( createGeoNode( getSharedPolyhedron( POLYHEDRON_CUBE ), benchStateSet() ) ); }
+void benchDirectedLight( unsigned int, BenchObjects &o )            { o.object = createDirectedLight(); }
+
+void benchDefinedMaterial( unsigned int, BenchObjects &o )
+{
+    o.stateSet = createDefinedMaterial( Vec3f( 0.1f, 0.1f, 0.1f ), Vec3f( 0.8f, 0.2f, 0.2f ), Vec3f( 1.0f, 1.0f, 1.0f ), 40.0f, Vec3f( 0.0f, 0.0f, 0.0f ) );
+}
+
+void benchStressScene( unsigned int s, BenchObjects &o )
+{
+    StressSceneParameters parameters;
+    parameters.countX = parameters.countY = parameters.countZ = s;
+    o.node = createStressScene( parameters );
+}
+
+void benchTexture( unsigned int, BenchObjects &o )
+{
+    o.stateSet = createTexture();
+    o.textureBytes = 8 * 8 * 4;
+}
+
+void benchAlphaTexture( unsigned int s, BenchObjects &o )
+{
+    o.stateSet = createAlphaTexture( s );
+    o.textureBytes = s * s * 4;
+}
+
+void benchAlphaTextureMipmaps( unsigned int s, BenchObjects &o )
+{
+    ProceduralTextureParameters parameters;
+    parameters.mipmaps = true;
+    o.stateSet = createAlphaTexture( s, parameters );
+    o.textureBytes = 0;
+    for ( unsigned int w = s; ; w = std::max( 1u, w / 2 ) )
+    {
+        o.textureBytes += w * w * 4;
+        if ( w == 1 )
+        {
+            break;
+        }
+    }
+}
+
+//! The sweeps over all create* functions, createTextureFromFile is left out as it depends on the files around
+const BenchCase benchCases[] =
+{
+    { "createQuadSet",                  "m = n",            &benchQuadSet,                  { 16, 64, 256, 1024 } },
+    { "createQuadSetChunked",           "m = n",            &benchQuadSetChunked,           { 16, 64, 256, 1024 } },
+    { "createQuadStrip",                "n",                &benchQuadStrip,                { 64, 1024, 16384, 262144 } },
+    { "createTriSet",                   "m = n",            &benchTriSet,                   { 16, 64, 256, 1024 } },
+    { "createTriSetChunked",            "m = n",            &benchTriSetChunked,            { 16, 64, 256, 1024 } },
+    { "createTriFan",                   "n",                &benchTriFan,                   { 64, 1024, 16384, 262144 } },
+    { "createTriStrip",                 "rows = columns",   &benchTriStrip,                 { 16, 64, 256, 1024 } },
+    { "createTriPatches4",              "n = m",            &benchTriPatches4,              { 4, 16, 64, 0 } },
+    { "createQuadPatches4x4",           "n = m",            &benchQuadPatches4x4,           { 4, 16, 64, 0 } },
+    { "createCube",                     "-",                &benchCube,                     { 1, 0, 0, 0 } },
+    { "createTetrahedron",              "-",                &benchTetrahedron,              { 1, 0, 0, 0 } },
+    { "createOctahedron",               "-",                &benchOctahedron,               { 1, 0, 0, 0 } },
+    { "createDodecahedron",             "-",                &benchDodecahedron,             { 1, 0, 0, 0 } },
+    { "createIcosahedron",              "-",                &benchIcosahedron,              { 1, 0, 0, 0 } },
+    { "createIcoSphere",                "level",            &benchIcoSphere,                { 1, 3, 5, 7 } },
+    { "createSphere",                   "m = 2n",           &benchSphere,                   { 32, 128, 512, 2048 } },
+    { "createCylinder",                 "thdivs = 4hdivs",  &benchCylinder,                 { 32, 128, 512, 2048 } },
+    { "createTorus",                    "m = 2n",           &benchTorus,                    { 32, 128, 512, 2048 } },
+    { "createTessellatedPlane",         "subdiv",           &benchTessellatedPlane,         { 16, 64, 256, 1024 } },
+    { "createTessellatedPlaneChunked",  "subdiv",           &benchTessellatedPlaneChunked,  { 16, 64, 256, 1024 } },
+    { "createPlane",                    "-",                &benchPlane,                    { 1, 0, 0, 0 } },
+    { "createTessellatedBox",           "subdiv",           &benchTessellatedBox,           { 16, 64, 256, 0 } },
+    { "createSphereLOD",                "m = 2n",           &benchSphereLOD,                { 32, 128, 512, 0 } },
+    { "createCylinderLOD",              "thdivs = 4hdivs",  &benchCylinderLOD,              { 32, 128, 512, 0 } },
+    { "createTorusLOD",                 "m = 2n",           &benchTorusLOD,                 { 32, 128, 512, 0 } },
+    { "createTessellatedBoxLOD",        "subdiv",           &benchTessellatedBoxLOD,        { 16, 64, 256, 0 } },
+    { "createSphere strips",            "m = 2n",           &benchSphereStrips,             { 32, 128, 512, 2048 } },
+    { "createTorus strips",             "m = 2n",           &benchTorusStrips,              { 32, 128, 512, 2048 } },
+    { "createTessellatedPlane strips",  "subdiv",           &benchTessellatedPlaneStrips,   { 16, 64, 256, 1024 } },
+    { "createTerrain",                  "chunkResolution",  &benchTerrain,                  { 8, 16, 32, 64 } },
+    { "createStressScene",              "countX = Y = Z",   &benchStressScene,              { 4, 8, 16, 32 } },
+    { "createDefaultMaterial",          "-",                &benchDefaultMaterial,          { 1, 0, 0, 0 } },
+    { "createDefinedMaterial",          "-",                &benchDefinedMaterial,          { 1, 0, 0, 0 } },
+    { "createGeoNode",                  "-",                &benchGeoNode,                  { 1, 0, 0, 0 } },
+    { "createTransform",                "-",                &benchTransform,                { 1, 0, 0, 0 } },
+    { "createDirectedLight",            "-",                &benchDirectedLight,            { 1, 0, 0, 0 } },
+    { "createTexture",                  "-",                &benchTexture,                  { 1, 0, 0, 0 } },
+    { "createAlphaTexture",             "n",                &benchAlphaTexture,             { 64, 256, 1024, 4096 } },
+    { "createAlphaTexture mipmaps",     "n",                &benchAlphaTextureMipmaps,      { 64, 256, 1024, 4096 } }
+};
+
+//! Get the peak resident set size of the process in bytes, 0 if unknown
+size_t getPeakRSS()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if ( GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof(counters) ) )
+    {
+        return( counters.PeakWorkingSetSize );
+    }
+    return( 0 );
+#else
+    struct rusage usage;
+    if ( getrusage( RUSAGE_SELF, &usage ) != 0 )
+    {
+        return( 0 );
+    }
+#if defined(__APPLE__)
+    return( size_t( usage.ru_maxrss ) );
+#else
+    return( size_t( usage.ru_maxrss ) * 1024 );
+#endif
+#endif
+}
+
+//! Get the number of vertices of \a drawable
+size_t getVertexCount( const DrawableSharedPtr &drawable )
+{
+    if ( drawable && isPtrTo<Primitive>( drawable ) )
+    {
+        PrimitiveReadLock primitive( sharedPtr_cast<Primitive>( drawable ) );
+        if ( primitive->getVertexAttributeSet() )
+        {
+            return( VertexAttributeSetReadLock( primitive->getVertexAttributeSet() )->getNumberOfVertexData( VertexAttributeSet::NVSG_POSITION ) );
+        }
+    }
+    return( 0 );
+}
+
+//! Add the vertices and data bytes of the drawables below \a node, counting shared drawables once
+void measureNode( const NodeSharedPtr &node, std::set<const void *> &visited, size_t &vertices, size_t &bytes )
+{
+    if ( !node || !visited.insert( node.get() ).second )
+    {
+        return;
+    }
+
+    if ( isPtrTo<GeoNode>( node ) )
+    {
+        GeoNodeReadLock geoNode( sharedPtr_cast<GeoNode>( node ) );
+        for ( GeoNode::StateSetConstIterator gnssci = geoNode->beginStateSets() ; gnssci != geoNode->endStateSets() ; ++gnssci )
+        {
+            for ( GeoNode::DrawableConstIterator gndci = geoNode->beginDrawables( gnssci ) ; gndci != geoNode->endDrawables( gnssci ) ; ++gndci )
+            {
+                if ( visited.insert( (*gndci).get() ).second )
+                {
+                    vertices += getVertexCount( *gndci );
+                    bytes += getDrawableDataSize( *gndci );
+                }
+            }
+        }
+    }
+    else if ( isPtrTo<Group>( node ) )
+    {
+        GroupReadLock group( sharedPtr_cast<Group>( node ) );
+        for ( Group::ChildrenConstIterator gcci = group->beginChildren() ; gcci != group->endChildren() ; ++gcci )
+        {
+            measureNode( *gcci, visited, vertices, bytes );
+        }
+    }
+}
+
+//! Call \a function at \a size up to \a repeats times, but stop after half a second, and measure the last objects
+BenchResult runBenchCase( const BenchCase &benchCase, unsigned int size, unsigned int repeats )
+{
+    BenchResult result;
+    result.name = benchCase.name;
+    result.parameter = benchCase.parameter;
+    result.size = size;
+    result.calls = 0;
+    result.vertices = 0;
+    result.dataBytes = 0;
+
+    BenchObjects objects;
+    objects.textureBytes = 0;
+
+    Timer timer;
+    timer.start();
+    double seconds = 0.0;
+    do
+    {
+        benchCase.function( size, objects );
+        ++result.calls;
+        seconds = timer.getTime();
+    } while ( ( result.calls < repeats ) && ( seconds < 0.5 ) );
+    result.seconds = seconds / double( result.calls );
+
+    std::set<const void *> visited;
+    if ( objects.drawable )
+    {
+        result.vertices = getVertexCount( objects.drawable );
+        result.dataBytes = getDrawableDataSize( objects.drawable );
+    }
+    measureNode( objects.node, visited, result.vertices, result.dataBytes );
+    result.dataBytes += objects.textureBytes;
+    result.processPeakRSS = getPeakRSS();
+    return( result );
+}
+
+//! Write \a results as a JSON document to \a fileName
+bool writeBenchJSON( const std::string &fileName, const std::vector<BenchResult> &results, unsigned int repeats )
+{
+    std::ofstream out( fileName.c_str() );
+    if ( !out )
+    {
+        return( false );
+    }
+
+    out << "{" << std::endl
+        << "  \"ringKernel\": \"" << ( isRingKernelVectorized() ? "SSE" : "scalar" ) << "\"," << std::endl
+        << "  \"patchTessellator\": \"" << ( isPatchTessellatorVectorized() ? "SSE" : "scalar" ) << "\"," << std::endl
+        << "  \"repeats\": " << repeats << "," << std::endl
+        << "  \"results\": [" << std::endl;
+    out << std::setprecision( 9 );
+    for ( size_t i = 0; i < results.size(); ++i )
+    {
+        const BenchResult &r = results[i];
+        out << "    { \"function\": \"" << r.name << "\""
+            << ", \"parameter\": \"" << r.parameter << "\""
+            << ", \"size\": " << r.size
+            << ", \"calls\": " << r.calls
+            << ", \"secondsPerCall\": " << r.seconds
+            << ", \"vertices\": " << r.vertices
+            << ", \"verticesPerSecond\": " << ( r.seconds > 0.0 ? double( r.vertices ) / r.seconds : 0.0 )
+            << ", \"dataBytes\": " << r.dataBytes
+            << ", \"processPeakRSS\": " << r.processPeakRSS
+            << " }" << ( ( i + 1 < results.size() ) ? "," : "" ) << std::endl;
+    }
+    out << "  ]" << std::endl
+        << "}" << std::endl;
+    return( !!out );
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    nvsgInitialize( );
+
+    std::cout << "Usage: meshbench [--repeats <n>] [--json <file>]" << std::endl;
+    std::cout << "Ring kernel: " << ( isRingKernelVectorized() ? "SSE" : "scalar" ) << std::endl;
+    std::cout << "Patch tessellator: " << ( isPatchTessellatorVectorized() ? "SSE" : "scalar" ) << std::endl;
+
+    unsigned int repeats = 20;
+    std::string jsonFile;
+    for ( int arg = 0; arg < argc; ++arg )
+    {
+        if ( strcmp( "--repeats", argv[arg] ) == 0 && arg + 1 < argc )
+        {
+            repeats = (unsigned int) atoi( argv[++arg] );
+        }
+        else if ( strcmp( "--json", argv[arg] ) == 0 && arg + 1 < argc )
+        {
+            jsonFile = argv[++arg];
+        }
+    }
+    repeats = std::max( 1u, repeats );
+
+    static const unsigned int resolutions[][2] =
+    {
+        {   32,   16 },
+        {  128,   64 },
+        {  512,  256 },
+        { 2048, 1024 }
+    };
+
+    std::cout << std::setw( 12 ) << "sphere"
+              << std::setw( 18 ) << "reference Mv/s"
+              << std::setw( 18 ) << "kernel Mv/s"
+              << std::setw( 10 ) << "gain"
+              << std::setw( 20 ) << "createSphere Mv/s" << std::endl;
+
+    for ( unsigned int i = 0; i < sizeof(resolutions) / sizeof(resolutions[0]); ++i )
+    {
+        unsigned int m = resolutions[i][0];
+        unsigned int n = resolutions[i][1];
+
+        double reference = measureFill( &referenceSphere, m, n, repeats );
+        double kernel    = measureFill( &kernelSphere, m, n, repeats );
+        double create    = measureCreateSphere( m, n, repeats );
+
+        std::ostringstream name;
+        name << m << "x" << n;
+        std::cout << std::setw( 12 ) << name.str()
+                  << std::setw( 18 ) << std::fixed << std::setprecision( 2 ) << reference * 1e-6
+                  << std::setw( 18 ) << kernel * 1e-6
+                  << std::setw( 9 ) << ( reference > 0.0 ? kernel / reference : 0.0 ) << "x"
+                  << std::setw( 20 ) << create * 1e-6 << std::endl;
+    }
+
+    std::vector<Vec3f> controlPoints;
+    setupWavePatches( 32, controlPoints );
+
+    std::cout << std::endl
+              << std::setw( 12 ) << "patch level"
+              << std::setw( 18 ) << "1 thread Mv/s"
+              << std::setw( 18 ) << "threaded Mv/s" << std::endl;
+
+    static const unsigned int levels[] = { 4, 8, 16, 32 };
+    for ( unsigned int i = 0; i < sizeof(levels) / sizeof(levels[0]); ++i )
+    {
+        double serial   = measurePatches( controlPoints, levels[i], false, repeats );
+        double threaded = measurePatches( controlPoints, levels[i], true, repeats );
+        std::cout << std::setw( 12 ) << levels[i]
+                  << std::setw( 18 ) << std::fixed << std::setprecision( 2 ) << serial * 1e-6
+                  << std::setw( 18 ) << threaded * 1e-6 << std::endl;
+    }
+
+    std::cout << std::endl
+              << std::setw( 12 ) << "batch"
+              << std::setw( 18 ) << "1 thread d/s"
+              << std::setw( 18 ) << "threaded d/s"
+              << std::setw( 10 ) << "gain" << std::endl;
+
+    static const unsigned int batchResolutions[] = { 16, 64, 256 };
+    for ( unsigned int i = 0; i < sizeof(batchResolutions) / sizeof(batchResolutions[0]); ++i )
+    {
+        std::vector<MeshSpec> specs;
+        setupBatchSpecs( 1000, batchResolutions[i], specs );
+
+        double serial   = measureBatch( specs, false, 1 );
+        double threaded = measureBatch( specs, true, 1 );
+        std::ostringstream name;
+        name << "1000 x " << batchResolutions[i];
+        std::cout << std::setw( 12 ) << name.str()
+                  << std::setw( 18 ) << std::fixed << std::setprecision( 0 ) << serial
+                  << std::setw( 18 ) << threaded
+                  << std::setw( 9 ) << std::setprecision( 2 ) << ( serial > 0.0 ? threaded / serial : 0.0 ) << "x" << std::endl;
+    }
+
+    // Distinct texture files through createTexturesFromFiles, on one thread and with the default parameters, which
+    // decode concurrently as far as the locks of the loader plug-ins allow
+    {
+        QDir textureDirectory( QDir::temp().filePath( "meshbench_textures" ) );
+        QDir().mkpath( textureDirectory.absolutePath() );
+        std::vector<std::string> textureFiles;
+        writeBenchTextures( textureDirectory, 16, 512, textureFiles );
+        std::vector<std::string> textureSearchPaths( 1, QDir::toNativeSeparators( textureDirectory.absolutePath() ).toStdString() );
+
+        TextureDecodeParameters serialDecode;
+        serialDecode.maxThreads = 1;
+        double serial = measureTextureDecode( textureFiles, textureSearchPaths, serialDecode );
+        double concurrent = measureTextureDecode( textureFiles, textureSearchPaths, TextureDecodeParameters() );
+
+        std::cout << std::endl
+                  << std::setw( 12 ) << "textures"
+                  << std::setw( 18 ) << "1 thread ms"
+                  << std::setw( 18 ) << "default ms"
+                  << std::setw( 14 ) << "decoded MB" << std::endl;
+        std::ostringstream name;
+        name << textureFiles.size() << " x 512";
+        std::cout << std::setw( 12 ) << name.str()
+                  << std::setw( 18 ) << std::fixed << std::setprecision( 2 ) << serial * 1e3
+                  << std::setw( 18 ) << concurrent * 1e3
+                  << std::setw( 14 ) << double( getTextureCacheStatistics().bytes ) / ( 1024.0 * 1024.0 ) << std::endl;
+
+        releaseTextureCache();
+        for ( size_t i = 0; i < textureFiles.size(); ++i )
+        {
+            textureDirectory.remove( QString::fromStdString( textureFiles[i] ) );
+        }
+        QDir().rmdir( textureDirectory.absolutePath() );
+    }
+
+    // Meshlets of spheres seen from outside, only the cone test
+    std::cout << std::endl
+              << std::setw( 12 ) << "meshlets"
+              << std::setw( 12 ) << "count"
+              << std::setw( 14 ) << "build ms"
+              << std::setw( 14 ) << "cull us"
+              << std::setw( 14 ) << "culled %" << std::endl;
+
+    for ( unsigned int i = 0; i < sizeof(resolutions) / sizeof(resolutions[0]); ++i )
+    {
+        unsigned int m = resolutions[i][0];
+        unsigned int n = resolutions[i][1];
+        PrimitiveSharedPtr sphere = sharedPtr_cast<Primitive>( createSphere( m, n ) );
+
+        MeshletSet meshlets;
+        Timer timer;
+        timer.start();
+        buildMeshlets( sphere, meshlets );
+        double build = timer.getTime();
+
+        std::vector<unsigned int> visible;
+        Timer cullTimer;
+        cullTimer.start();
+        for ( unsigned int r = 0; r < repeats; ++r )
+        {
+            cullMeshlets( meshlets, Vec3f( 0.0f, 0.0f, 4.0f ), std::vector<Vec4f>(), visible );
+        }
+        double cull = repeats ? cullTimer.getTime() / repeats : 0.0;
+
+        size_t triangles = meshlets.localIndices.size() / 3;
+        size_t visibleTriangles = 0;
+        for ( size_t j = 0; j < visible.size(); ++j )
+        {
+            visibleTriangles += meshlets.meshlets[visible[j]].triangleCount;
+        }
+
+        std::ostringstream name;
+        name << m << "x" << n;
+        std::cout << std::setw( 12 ) << name.str()
+                  << std::setw( 12 ) << meshlets.meshlets.size()
+                  << std::setw( 14 ) << std::fixed << std::setprecision( 2 ) << build * 1e3
+                  << std::setw( 14 ) << cull * 1e6
+                  << std::setw( 14 ) << ( triangles ? 100.0 * double( triangles - visibleTriangles ) / double( triangles ) : 0.0 ) << std::endl;
+    }
+
+    // Every create* function over its parameter sweep, write the JSON to compare builds
+    std::cout << std::endl
+              << std::setw( 30 ) << "function"
+              << std::setw( 10 ) << "size"
+              << std::setw( 8 ) << "calls"
+              << std::setw( 14 ) << "ms/call"
+              << std::setw( 12 ) << "vertices"
+              << std::setw( 10 ) << "Mv/s"
+              << std::setw( 14 ) << "data bytes"
+              << std::setw( 16 ) << "proc. peak MB" << std::endl;
+
+    std::vector<BenchResult> results;
+    for ( unsigned int i = 0; i < sizeof(benchCases) / sizeof(benchCases[0]); ++i )
+    {
+        for ( unsigned int j = 0; j < 4 && benchCases[i].sizes[j]; ++j )
+        {
+            results.push_back( runBenchCase( benchCases[i], benchCases[i].sizes[j], repeats ) );
+            const BenchResult &r = results.back();
+            std::cout << std::setw( 30 ) << r.name
+                      << std::setw( 10 ) << r.size
+                      << std::setw( 8 ) << r.calls
+                      << std::setw( 14 ) << std::fixed << std::setprecision( 3 ) << r.seconds * 1e3
+                      << std::setw( 12 ) << r.vertices
+                      << std::setw( 10 ) << std::setprecision( 2 ) << ( r.seconds > 0.0 ? double( r.vertices ) / r.seconds * 1e-6 : 0.0 )
+                      << std::setw( 14 ) << r.dataBytes
+                      << std::setw( 16 ) << std::setprecision( 1 ) << double( r.processPeakRSS ) / ( 1024.0 * 1024.0 ) << std::endl;
+        }
+    }
+
+    if ( !jsonFile.empty() )
+    {
+        if ( writeBenchJSON( jsonFile, results, repeats ) )
+        {
+            std::cout << "Results written to " << jsonFile << std::endl;
+        }
+        else
+        {
+            std::cerr << "Failed to write " << jsonFile << std::endl;
+        }
+    }
+
+    releaseSharedPolyhedra();
+    releaseGeneratedBounds();
+    releaseTextureCache();
+    releaseSharedMaterials();
+
+    nvsgTerminate();
+
+    return 0;
+}
@@ -0,0 +1,47 @@
+#-------------------------------------------------
+#
+# Benchmark for the MeshGenerator functions
+#
+#-------------------------------------------------
+
+# gui for QImage and QImageReader, the texture decode benchmark writes its files and reads their headers
+QT       += core        \
+            gui
+
+TARGET = meshbench
+TEMPLATE = app
+CONFIG += console
+
+include(../../defines.pri)
+include(../../includepath.pri)
+include(../../libpath.pri)
+
+win32-msvc* {
+QMAKE_CXXFLAGS += /wd4100 /wd4101 /wd4102 /wd4189 /wd4996
+}
+
+# GetProcessMemoryInfo for the peak working set
+win32:LIBS += -lpsapi
+
+SOURCES += main.cpp\
+    ../../common/src/MeshGenerator.cpp \
+    ../../common/src/ParametricKernel.cpp \
+    ../../common/src/PatchTessellator.cpp \
+    ../../common/src/MeshletBuilder.cpp \
+    ../../common/src/MeshBatch.cpp \
+    ../../common/src/MeshCache.cpp \
+    ../../common/src/BufferArray.cpp \
+    ../../common/src/SceneFunctions.cpp \
+    ../../common/src/SceneCache.cpp
+
+
+HEADERS  += \
+    ../../common/inc/MeshGenerator.h \
+    ../../common/inc/ParametricKernel.h \
+    ../../common/inc/BufferArray.h \
+    ../../common/inc/PatchTessellator.h \
+    ../../common/inc/MeshletBuilder.h \
+    ../../common/inc/MeshBatch.h \
+    ../../common/inc/MeshCache.h \
+    ../../common/inc/SceneFunctions.h \
+    ../../common/inc/SceneCache.h
@@ -1,15 +1,23 @@
 #include <iostream>
+#include <math.h>
+#include <stdlib.h>
 
 #include <QApplication>
 #include <QKeyEvent>
 #include <QTime>
+#include <QTimerEvent>
 #include <QMessageBox>
 
 #include <nvsg/nvsg.h>
+#include <nvsg/PlugInterfaceID.h>
 #include <nvrt/RTInit.h>
 
+#include "MeshGenerator.h"
+#include "SceneCache.h"
 #include "SceneFunctions.h"
+#include "ScenePager.h"
 #include "SimpleScene.h"
+#include "TextureAtlas.h"
 #include <nvsg/Scene.h>
 #include <nvsg/ViewState.h>
 
@@ -20,6 +28,7 @@
 #include "SceniXQGLSceneRendererWidget.h"
 
 #include "ui/TrackballCameraManipulatorHIDSync.h"
+#include "ui/WalkCameraManipulatorHIDSync.h"
 
 #include "nvtraverser/CombineTraverser.h"
 #include "nvtraverser/EliminateTraverser.h"
@@ -38,35 +47,115 @@ using namespace nvtraverser;
 class QtMinimalWidget : public SceniXQGLSceneRendererWidget
 {
 public:
-    QtMinimalWidget( const RenderContextGLFormat &format );
+    QtMinimalWidget( const RenderContextGLFormat &format, bool walk );
     virtual ~QtMinimalWidget();
 
     void keyPressEvent( QKeyEvent *event);
     void screenshot();
 
+    // show the scene of load once it is done, until then the current scene stays, takes ownership of load
+    void setSceneLoad( SceneLoad *load, bool headlight, bool atlas );
+
+    // page the scene of the next load from directory, split it into chunks first if it was loaded from splitSource
+    void setScenePaging( const std::string &directory, size_t maxResidentBytes, const std::string &splitSource );
+
+protected:
+    virtual void timerEvent( QTimerEvent *event );
+
+    void startScenePaging( const ViewStateSharedPtr &viewState );
+
 protected:
     TrackballCameraManipulatorHIDSync *m_trackballHIDSync;
+    WalkCameraManipulatorHIDSync      *m_walkHIDSync;
 
     QTime           m_time;
+
+    SceneLoad        *m_sceneLoad;
+    SceneLoad::Stage  m_sceneLoadStage;
+    int               m_sceneLoadTimerID;
+    bool              m_sceneLoadHeadlight;
+    bool              m_sceneLoadAtlas;
+
+    std::string       m_pageDirectory;
+    size_t            m_pageBudget;
+    std::string       m_pageSplitSource;
+    ScenePager       *m_scenePager;
+    int               m_scenePagerTimerID;
 };
 
-QtMinimalWidget::QtMinimalWidget( const RenderContextGLFormat &format )
+// Setup the camera and the options of a new viewState
+void prepareViewState( const ViewStateSharedPtr &viewStateHandle, bool headlight, bool atlas )
+{
+    setupDefaultViewState( viewStateHandle );
+    if ( atlas )
+    {
+        TextureAtlasStatistics atlasStatistics;
+        buildTextureAtlas( ViewStateReadLock( viewStateHandle )->getScene(), atlasStatistics );
+        std::cout << "Texture atlas: " << atlasStatistics.packedTextures << " textures in " << atlasStatistics.pages << " pages, "
+                  << "textures " << atlasStatistics.texturesBefore << " -> " << atlasStatistics.texturesAfter << ", "
+                  << "textured StateSets " << atlasStatistics.stateSetsBefore << " -> " << atlasStatistics.stateSetsAfter << std::endl;
+    }
+    if ( headlight )
+    {
+        ViewStateReadLock vs(viewStateHandle);
+        if ( vs && vs->getScene() && !SceneReadLock( vs->getScene() )->containsLight()
+             && vs->getCamera() && ( CameraReadLock( vs->getCamera() )->getNumberOfHeadLights() == 0 ) )
+        {
+            createDefaultHeadLight( vs->getCamera() );
+        }
+    }
+}
+
+QtMinimalWidget::QtMinimalWidget( const RenderContextGLFormat &format, bool walk )
     : SceniXQGLSceneRendererWidget(0, format )
+    , m_trackballHIDSync( 0 )
+    , m_walkHIDSync( 0 )
+    , m_sceneLoad( 0 )
+    , m_sceneLoadStage( SceneLoad::STAGE_QUEUED )
+    , m_sceneLoadTimerID( -1 )
+    , m_sceneLoadHeadlight( false )
+    , m_sceneLoadAtlas( false )
+    , m_pageBudget( 0 )
+    , m_scenePager( 0 )
+    , m_scenePagerTimerID( -1 )
 {
-    m_trackballHIDSync = new TrackballCameraManipulatorHIDSync( );
-    m_trackballHIDSync->setHID( this );
-    m_trackballHIDSync->setRenderTarget( getRenderTarget() );
-    setManipulator( m_trackballHIDSync );
+    if ( walk )
+    {
+        m_walkHIDSync = new WalkCameraManipulatorHIDSync( );
+        m_walkHIDSync->setHID( this );
+        m_walkHIDSync->setRenderTarget( getRenderTarget() );
+        setManipulator( m_walkHIDSync );
+    }
+    else
+    {
+        m_trackballHIDSync = new TrackballCameraManipulatorHIDSync( );
+        m_trackballHIDSync->setHID( this );
+        m_trackballHIDSync->setRenderTarget( getRenderTarget() );
+        setManipulator( m_trackballHIDSync );
+    }
 }
 
 QtMinimalWidget::~QtMinimalWidget()
 {
+    // Cancel a pending load and wait for it
+    delete m_sceneLoad;
+
+    if ( m_scenePager )
+    {
+        ScenePager::Statistics statistics = m_scenePager->getStatistics();
+        std::cout << "Scene paging: " << statistics.residentChunks << " of " << statistics.chunks << " chunks resident, "
+                  << statistics.residentBytes / ( 1024 * 1024 ) << " MB, " << statistics.pageIns << " page-ins, "
+                  << statistics.evictions << " evictions, " << statistics.stalls << " stalls" << std::endl;
+        delete m_scenePager;
+    }
+
     // Delete SceneRenderer here to cleanup resources before the OpenGL context dies
     setSceneRenderer( 0 );
 
     // Reset Manipulator
     setManipulator( 0 );
     delete m_trackballHIDSync;
+    delete m_walkHIDSync;
 }
 
 void QtMinimalWidget::keyPressEvent( QKeyEvent *event )
@@ -78,6 +167,11 @@ void QtMinimalWidget::keyPressEvent( QKeyEvent *event )
         screenshot();
     }
 
+    if ( ( event->text().compare( "c" ) == 0 ) && m_sceneLoad )
+    {
+        m_sceneLoad->cancel();
+    }
+
     if ( event->text().compare( "o" ) == 0 )
     {
         optimizeScene( ViewStateReadLock( getViewState() )->getScene(), true, true, CombineTraverser::CT_ALL_TARGETS_MASK
@@ -98,7 +192,104 @@ void QtMinimalWidget::screenshot()
     saveTextureHost( filename, getRenderTarget()->getTextureHost( ) );
 }
 
-int runApp( int argc, char *argv[], const std::string &filename, bool stereo, bool raytracing, bool continuous, GLObjectRenderer::CacheMode cacheMode, bool headlight )
+void QtMinimalWidget::setSceneLoad( SceneLoad *load, bool headlight, bool atlas )
+{
+    delete m_sceneLoad;
+    m_sceneLoad = load;
+    m_sceneLoadStage = SceneLoad::STAGE_QUEUED;
+    m_sceneLoadHeadlight = headlight;
+    m_sceneLoadAtlas = atlas;
+    if ( m_sceneLoadTimerID == -1 )
+    {
+        m_sceneLoadTimerID = startTimer( 100 );
+    }
+}
+
+void QtMinimalWidget::setScenePaging( const std::string &directory, size_t maxResidentBytes, const std::string &splitSource )
+{
+    m_pageDirectory = directory;
+    m_pageBudget = maxResidentBytes;
+    m_pageSplitSource = splitSource;
+}
+
+void QtMinimalWidget::startScenePaging( const ViewStateSharedPtr &viewState )
+{
+    if ( !m_pageSplitSource.empty() )
+    {
+        unsigned int chunks = splitScene( viewState, m_pageDirectory, m_pageSplitSource );
+        std::cout << "Scene paging: " << chunks << " chunks written to " << m_pageDirectory << std::endl;
+    }
+
+    delete m_scenePager;
+    m_scenePager = new ScenePager( viewState, m_pageDirectory, m_pageBudget );
+    if ( m_scenePagerTimerID == -1 )
+    {
+        m_scenePagerTimerID = startTimer( 100 );
+    }
+}
+
+void QtMinimalWidget::timerEvent( QTimerEvent *event )
+{
+    if ( event->timerId() == m_scenePagerTimerID )
+    {
+        if ( m_scenePager->update( height() ) )
+        {
+            triggerRepaint();
+        }
+        return;
+    }
+
+    if ( event->timerId() != m_sceneLoadTimerID )
+    {
+        // the timers of the base classes, e.g. the one of the manipulators
+        SceniXQGLSceneRendererWidget::timerEvent( event );
+        return;
+    }
+
+    SceneLoad::Stage stage = m_sceneLoad->getStage();
+    if ( stage != m_sceneLoadStage )
+    {
+        static const char *stageNames[] = { "queued", "finding loader", "loading", "finished", "failed", "canceled" };
+        std::cout << "Scene load: " << stageNames[stage] << " (" << (int)( 100.0f * m_sceneLoad->getProgress() ) << "%)" << std::endl;
+        m_sceneLoadStage = stage;
+    }
+
+    if ( m_sceneLoad->isDone() )
+    {
+        ViewStateSharedPtr viewState = m_sceneLoad->getViewState();
+        if ( viewState )
+        {
+            // keep the renderer options of the placeholder
+            RendererOptionsSharedPtr ro = ViewStateReadLock( getViewState() )->getRendererOptions();
+            if ( ro )
+            {
+                ViewStateWriteLock( viewState )->setRendererOptions( ro );
+            }
+            prepareViewState( viewState, m_sceneLoadHeadlight, m_sceneLoadAtlas );
+            if ( !m_pageDirectory.empty() )
+            {
+                startScenePaging( viewState );
+            }
+            setViewState( viewState );
+            triggerRepaint();
+        }
+
+        killTimer( m_sceneLoadTimerID );
+        m_sceneLoadTimerID = -1;
+        delete m_sceneLoad;
+        m_sceneLoad = 0;
+    }
+}
+
+// rolling hills with some ridges, for walkthroughs over a terrain
+float terrainHeight( float u, float v, void * )
+{
+    return( sinf( 7.0f * u ) * cosf( 5.0f * v ) + 0.25f * sinf( 31.0f * u + 17.0f * v ) );
+}
+
+int runApp( int argc, char *argv[], const std::string &filename, const StressSceneParameters *stress, float terrainSize, unsigned int terrainResolution
+          , bool stereo, bool raytracing, bool continuous, GLObjectRenderer::CacheMode cacheMode, bool headlight, bool atlas
+          , const std::string &pageDirectory, size_t pageBudget )
 {
     QApplication app( argc, argv );
 
@@ -112,26 +303,44 @@ int runApp( int argc, char *argv[], const std::string &filename, bool stereo, bo
     // Setup viewstate for the simple scene
     ViewStateSharedPtr viewStateHandle;
     SceneSharedPtr scene = simpleScene.m_sceneHandle;
-    if ( !filename.empty() )
+    if ( stress )
     {
-        viewStateHandle = loadScene( filename );
+        scene = Scene::create();
+        SceneWriteLock( scene )->setRootNode( createStressScene( *stress ) );
+        headlight = true;
     }
-    if (!viewStateHandle)
+    if ( terrainResolution )
     {
-        viewStateHandle  = ViewState::create();
-        ViewStateWriteLock(viewStateHandle)->setScene( scene );
+        TerrainParameters terrainParameters;
+        terrainParameters.heightScale = 0.05f * terrainSize;
+
+        scene = Scene::create();
+        SceneWriteLock( scene )->setRootNode( createTerrain( &terrainHeight, 0, nvmath::Vec2f( terrainSize, terrainSize ), terrainResolution
+                                                           , getSharedDefaultMaterial( nvmath::Vec3f( 0.4f, 0.6f, 0.3f ) ), terrainParameters ) );
+        headlight = true;
+        continuous = true;
     }
-    setupDefaultViewState( viewStateHandle );
-    if ( headlight )
+    if ( stress || terrainResolution )
     {
-        ViewStateReadLock vs(viewStateHandle);
-        if ( vs && vs->getScene() && !SceneReadLock( vs->getScene() )->containsLight()
-             && vs->getCamera() && ( CameraReadLock( vs->getCamera() )->getNumberOfHeadLights() == 0 ) )
-        {
-            createDefaultHeadLight( vs->getCamera() );
-        }
+        std::cout << "Unique StateSets: " << getUniqueStateSetCount( SceneReadLock( scene )->getRootNode() ) << std::endl;
+    }
+    // A scene split for paging before is loaded as its skeleton, if it was split from this version of filename. The
+    // skeleton is an NBF file, the scene cache leaves it alone, so its placeholders survive --cacheoptimize.
+    std::string loadFile = filename;
+    std::string pageSplitSource = pageDirectory.empty() ? std::string() : filename;
+    if ( !pageDirectory.empty() && isPagedSceneOf( pageDirectory, filename ) )
+    {
+        loadFile = getPagedSceneFile( pageDirectory );
+        pageSplitSource.clear();
     }
 
+    // A file is loaded in the background, the scene above is shown until it is done
+    SceneLoad *sceneLoad = loadFile.empty() ? 0 : loadSceneAsync( loadFile );
+
+    viewStateHandle  = ViewState::create();
+    ViewStateWriteLock(viewStateHandle)->setScene( scene );
+    prepareViewState( viewStateHandle, headlight, atlas );
+
     if ( !raytracing )
     {
         RendererOptionsSharedPtr ro = RendererOptions::create();
@@ -148,7 +357,7 @@ int runApp( int argc, char *argv[], const std::string &filename, bool stereo, bo
     bool avail = format.isAvailable();
 
     // create a widget which shows the scene
-    QtMinimalWidget w( format );
+    QtMinimalWidget w( format, terrainResolution != 0 );
 
     avail = format.isAvailable();
     if(w.getFormat().isAvailable())
@@ -168,6 +377,14 @@ int runApp( int argc, char *argv[], const std::string &filename, bool stereo, bo
 
     w.setViewState( viewStateHandle );
     w.setSceneRenderer( renderer );
+    if ( sceneLoad )
+    {
+        if ( !pageDirectory.empty() )
+        {
+            w.setScenePaging( pageDirectory, pageBudget, pageSplitSource );
+        }
+        w.setSceneLoad( sceneLoad, headlight, atlas );
+    }
     w.setContinuousUpdate( continuous );
     w.resize( 640, 480 );
     w.show();
@@ -206,8 +423,14 @@ int main(int argc, char *argv[])
 #endif
     RTInit();
 
+    // find the screenshot savers once at startup, not on the first 's'
+    hasPlugInInterface( "mono.png", UPITID_TEXTURE_SAVER );
+    hasPlugInInterface( "stereo.pns", UPITID_TEXTURE_SAVER );
+
     std::cout << "Usage: QtMinimal [--filename <filename>] [--stereo] [--raytracing] [--cachemode none|vbo|dl] [--continuous] [--headlight]" << std::endl;
-    std::cout << "During execution hit 's' for screenshot and 'x' to toggle stereo" << std::endl;
+    std::cout << "                 [--stress <x> <y> <z>] [--seed <n>] [--terrain <size> <chunkResolution>] [--strips] [--atlas]" << std::endl;
+    std::cout << "                 [--cache <directory>] [--cacheoptimize] [--page <directory> <budgetMB>]" << std::endl;
+    std::cout << "During execution hit 's' for screenshot, 'x' to toggle stereo and 'c' to cancel loading the file" << std::endl;
     std::cout << "Stereo screenshots will be saved as side/side png with filename 'stereo.pns'." << std::endl;
     std::cout << "They can be viewed with the 3D Vision Photo Viewer." << std::endl;
 
@@ -215,8 +438,19 @@ int main(int argc, char *argv[])
     bool raytracing = false;
     bool continuous = false;
     bool headlight = false;
+    bool atlas = false;
     std::string filename;
+    bool stress = false;
+    StressSceneParameters stressParameters;
+    stressParameters.randomRotation = true;
+    stressParameters.minScale = 0.5f;
+    stressParameters.maxScale = 1.0f;
+    float terrainSize = 0.0f;
+    unsigned int terrainResolution = 0;
     GLObjectRenderer::CacheMode cacheMode = GLObjectRenderer::CACHEMODE_VBO;
+    SceneCacheParameters sceneCacheParameters;
+    std::string pageDirectory;
+    size_t pageBudget = 0;
 
     for (int arg = 0;arg < argc;++arg)
     {
@@ -262,10 +496,67 @@ int main(int argc, char *argv[])
         {
             headlight = true;
         }
+
+        if ( strcmp( "--stress", argv[arg] ) == 0 && arg + 3 < argc )
+        {
+            stress = true;
+            stressParameters.countX = (unsigned int) atoi( argv[++arg] );
+            stressParameters.countY = (unsigned int) atoi( argv[++arg] );
+            stressParameters.countZ = (unsigned int) atoi( argv[++arg] );
+        }
+        if ( strcmp( "--seed", argv[arg] ) == 0 && arg + 1 < argc )
+        {
+            stressParameters.seed = (unsigned int) atoi( argv[++arg] );
+        }
+        if ( strcmp( "--terrain", argv[arg] ) == 0 && arg + 2 < argc )
+        {
+            terrainSize = (float) atof( argv[++arg] );
+            terrainResolution = (unsigned int) atoi( argv[++arg] );
+        }
+        if ( strcmp( "--strips", argv[arg] ) == 0 )
+        {
+            setMeshFormat( getMeshFormat() | MESH_FORMAT_TRIANGLE_STRIPS );
+        }
+        if ( strcmp( "--atlas", argv[arg] ) == 0 )
+        {
+            atlas = true;
+        }
+        if ( strcmp( "--cache", argv[arg] ) == 0 && arg + 1 < argc )
+        {
+            sceneCacheParameters.directory = argv[++arg];
+        }
+        if ( strcmp( "--cacheoptimize", argv[arg] ) == 0 )
+        {
+            // cache the scene as the 'o' key optimizes it
+            sceneCacheParameters.optimize = true;
+        }
+        if ( strcmp( "--page", argv[arg] ) == 0 && arg + 2 < argc )
+        {
+            pageDirectory = argv[++arg];
+            pageBudget = size_t( atoi( argv[++arg] ) ) * 1024 * 1024;
+        }
+    }
+    setSceneCacheParameters( sceneCacheParameters );
+
+    int result = runApp( argc, argv, filename, stress ? &stressParameters : 0, terrainSize, terrainResolution, stereo, raytracing, continuous, cacheMode, headlight, atlas
+                       , pageDirectory, pageBudget );
+
+    if ( !sceneCacheParameters.directory.empty() )
+    {
+        SceneCacheStatistics cacheStatistics = getSceneCacheStatistics();
+        std::cout << "Scene cache: " << cacheStatistics.hits << " hits, " << cacheStatistics.misses << " misses, "
+                  << cacheStatistics.stores << " stores, " << cacheStatistics.failures << " failures" << std::endl;
     }
 
-    int result = runApp( argc, argv, filename, stereo, raytracing, continuous, cacheMode, headlight );
+    PlugInRegistryStatistics plugInStatistics = getPlugInRegistryStatistics();
+    std::cout << "Plug-in registry: " << plugInStatistics.lookups << " lookups, " << plugInStatistics.probes << " probes in "
+              << plugInStatistics.probeSeconds * 1000.0 << " ms" << std::endl;
 
+    releaseSharedPolyhedra();
+    releaseGeneratedBounds();
+    releaseTextureCache();
+    releaseSharedMaterials();
+    releasePlugInInterfaces();
     RTShutdown();
     nvsgTerminate();
 
@@ -43,7 +43,16 @@ SOURCES += main.cpp\
     ../../common/src/SimpleScene.cpp \
     ../../common/src/SceniXWidget.cpp \
     ../../common/src/SceneFunctions.cpp \
-    ../../common/src/MeshGenerator.cpp
+    ../../common/src/MeshGenerator.cpp \
+    ../../common/src/ParametricKernel.cpp \
+    ../../common/src/MeshCache.cpp \
+    ../../common/src/BufferArray.cpp \
+    ../../common/src/PatchTessellator.cpp \
+    ../../common/src/MeshletBuilder.cpp \
+    ../../common/src/MeshBatch.cpp \
+    ../../common/src/TextureAtlas.cpp \
+    ../../common/src/SceneCache.cpp \
+    ../../common/src/ScenePager.cpp
 
 
 HEADERS  += mainwindow.h \
@@ -64,6 +73,15 @@ HEADERS  += mainwindow.h \
     ../../common/inc/SceniXWidget.h \
     ../../common/inc/SceneFunctions.h \
     ../../common/inc/MeshGenerator.h \
+    ../../common/inc/ParametricKernel.h \
+    ../../common/inc/MeshCache.h \
+    ../../common/inc/BufferArray.h \
+    ../../common/inc/PatchTessellator.h \
+    ../../common/inc/MeshletBuilder.h \
+    ../../common/inc/MeshBatch.h \
+    ../../common/inc/TextureAtlas.h \
+    ../../common/inc/SceneCache.h \
+    ../../common/inc/ScenePager.h \
     ../../common/Qt4/inc/SceniXQtUtil.h \
     ../../common/Qt4/inc/SceniXQGLWidget.h \
     ../../common/Qt4/inc/SceniXQGLSceneRendererWidget.h \
@@ -0,0 +1,453 @@
+/*
+\brief Helpers to write generated vertex and index data directly into SceniX buffers in the layout of a MeshFormat, and to measure that data
+*/
+
+#pragma once
+
+#include <nvsg/CoreTypes.h>
+#include <nvsg/Buffer.h>
+#include <nvsg/BufferHost.h>
+#include <nvsg/IndexSet.h>
+#include <nvsg/VertexAttributeSet.h>
+#include <nvutil/Tools.h>
+
+#include "MeshGenerator.h"
+
+#include <vector>
+
+#include <string.h>
+
+namespace nvutil
+{
+//! Helper class to write the generated data directly into the storage of a BufferHost.
+// The buffer is attached to the VertexAttributeSet or IndexSet as is, so there is no temporary array to copy from.
+template <typename T>
+class BufferArray
+{
+public:
+    explicit BufferArray( size_t count )
+        : m_buffer( nvsg::BufferHost::create() )
+        , m_lock( 0 )
+        , m_ptr( 0 )
+        , m_count( count )
+    {
+        nvsg::BufferHostWriteLock( m_buffer )->setSize( count * sizeof(T) );
+        m_lock = new nvsg::Buffer::DataWriteLock( m_buffer, nvsg::Buffer::MAP_WRITE );
+        m_ptr = m_lock->getPtr<T>();
+    }
+
+    ~BufferArray()
+    {
+        delete m_lock;
+    }
+
+    T & operator[]( size_t i )
+    {
+        NVSG_ASSERT( i < m_count );
+        return m_ptr[i];
+    }
+
+    size_t size() const
+    {
+        return m_count;
+    }
+
+    //! Finish writing and get the buffer to attach
+    nvsg::BufferSharedPtr unmap()
+    {
+        delete m_lock;
+        m_lock = 0;
+        m_ptr = 0;
+        return m_buffer;
+    }
+
+private:
+    BufferArray( const BufferArray & );
+    BufferArray & operator=( const BufferArray & );
+
+private:
+    nvsg::BufferHostSharedPtr    m_buffer;
+    nvsg::Buffer::DataWriteLock *m_lock;
+    T                           *m_ptr;
+    size_t                       m_count;
+};
+
+//! Helper function to attach the float vectors in \a data as vertex attribute \a attrib
+template <typename T>
+void setVertexData( nvsg::VertexAttributeSetWriteLock &vas, unsigned int attrib, BufferArray<T> &data )
+{
+    vas->setVertexData( attrib, sizeof(T) / sizeof(float), nvsg::NVSG_FLOAT, data.unmap(), 0, sizeof(T), checked_cast<unsigned int>( data.size() ) );
+}
+
+//! Helper function to create an IndexSet using the indices in \a data
+inline nvsg::IndexSetSharedPtr createIndexSet( BufferArray<unsigned int> &indices )
+{
+    nvsg::IndexSetSharedPtr indexSet( nvsg::IndexSet::create() );
+    nvsg::IndexSetWriteLock( indexSet )->setData( indices.unmap(), checked_cast<unsigned int>( indices.size() ), nvsg::NVSG_UNSIGNED_INT );
+    return indexSet;
+}
+
+//! Get the size in bytes of one value of the SceniX data type \a dataType, like NVSG_FLOAT or NVSG_HALF
+size_t getTypeSize( unsigned int dataType );
+
+/*! \brief Get the number of bytes of vertex and index data of the drawable \a drawable.
+ *  \remarks Only Primitives are measured, other drawables report 0. */
+size_t getDrawableDataSize( const nvsg::DrawableSharedPtr &drawable );
+
+//! The primitive restart index between the strips of MESH_FORMAT_TRIANGLE_STRIPS, written as 0xffff by MeshIndices with 16-bit indices
+const unsigned int primitiveRestartIndex = ~0u;
+
+//! Convert \a f to a half float, rounding to nearest
+unsigned short floatToHalf( float f );
+
+//! Map the unit vector \a n onto the octahedron and store it as two normalized shorts in \a out
+void encodeOctahedral( const float *n, short *out );
+
+//! Layout of one vertex attribute in a MeshFormat
+struct AttributeLayout
+{
+    unsigned int attrib;
+    unsigned int size;          // number of components
+    unsigned int type;
+    unsigned int bytes;         // per vertex, padded to four bytes
+    bool         normalized;
+};
+
+//! Get the layout of the float vertex attribute \a attrib with \a size components in the MeshFormat \a format
+AttributeLayout getAttributeLayout( unsigned int attrib, unsigned int size, unsigned int format );
+
+//! Write the \a srcSize floats of \a value as one vertex of \a layout to \a dst
+void encodeAttribute( const AttributeLayout &layout, unsigned int srcSize, const float *value, char *dst );
+
+//! Helper class to write the vertex attributes of a generated mesh directly in the layout of a MeshFormat.
+// The attributes are declared by the VertexStreams on it. The first write allocates the final storage, one interleaved
+// buffer or one buffer per attribute, and each value is encoded as it is written, so there is no float copy to convert.
+class MeshVertices
+{
+public:
+    MeshVertices( unsigned int format, unsigned int count )
+        : m_format( format )
+        , m_count( count )
+        , m_mapped( false )
+    {
+        memset( m_attributes, 0, sizeof(m_attributes) );
+    }
+
+    ~MeshVertices()
+    {
+        for ( size_t i = 0; i < m_buffers.size(); ++i )
+        {
+            delete m_buffers[i];
+        }
+    }
+
+    //! Declare the float attribute \a attrib with \a size components, before the first write
+    void addAttribute( unsigned int attrib, unsigned int size )
+    {
+        NVSG_ASSERT( !m_mapped && ( attrib < nvsg::VertexAttributeSet::NVSG_VERTEX_ATTRIB_COUNT ) );
+        m_attributes[attrib].size = size;
+        m_attributes[attrib].layout = getAttributeLayout( attrib, size, m_format );
+    }
+
+    //! Write the floats of \a value as vertex \a i of the attribute \a attrib
+    void write( unsigned int attrib, unsigned int i, const float *value )
+    {
+        NVSG_ASSERT( i < m_count );
+        Attribute &a = getAttribute( attrib );
+        encodeAttribute( a.layout, a.size, value, a.data + i * a.stride );
+    }
+
+    //! Write the \a count packed float values \a values as the vertices from \a first on of the attribute \a attrib
+    void writeRow( unsigned int attrib, unsigned int first, const float *values, unsigned int count )
+    {
+        NVSG_ASSERT( first + count <= m_count );
+        Attribute &a = getAttribute( attrib );
+        char *dst = a.data + first * a.stride;
+        for ( unsigned int i = 0; i < count; ++i, values += a.size, dst += a.stride )
+        {
+            encodeAttribute( a.layout, a.size, values, dst );
+        }
+    }
+
+    //! Read vertex \a i of the float attribute \a attrib back to \a value
+    void read( unsigned int attrib, unsigned int i, float *value )
+    {
+        NVSG_ASSERT( i < m_count );
+        Attribute &a = getAttribute( attrib );
+        NVSG_ASSERT( a.layout.type == nvsg::NVSG_FLOAT );
+        memcpy( value, a.data + i * a.stride, a.size * sizeof(float) );
+    }
+
+    //! Get the storage of the vertices from \a first on of the attribute \a attrib if it is packed floats, or 0 if it is not
+    float * getPackedFloats( unsigned int attrib, unsigned int first )
+    {
+        Attribute &a = getAttribute( attrib );
+        return( ( ( a.layout.type == nvsg::NVSG_FLOAT ) && ( a.stride == a.size * sizeof(float) ) )
+                ? reinterpret_cast<float *>( a.data + first * a.stride ) : 0 );
+    }
+
+    //! Copy all attributes of vertex \a src to vertex \a dst
+    void copyVertex( unsigned int dst, unsigned int src )
+    {
+        NVSG_ASSERT( ( dst < m_count ) && ( src < m_count ) );
+        map();
+        for ( unsigned int i = 0; i < nvsg::VertexAttributeSet::NVSG_VERTEX_ATTRIB_COUNT; ++i )
+        {
+            if ( m_attributes[i].size )
+            {
+                memcpy( m_attributes[i].data + dst * m_attributes[i].stride, m_attributes[i].data + src * m_attributes[i].stride, m_attributes[i].layout.bytes );
+            }
+        }
+    }
+
+    //! Finish writing and create the VertexAttributeSet with all declared attributes
+    nvsg::VertexAttributeSetSharedPtr createVertexAttributeSet()
+    {
+        map();
+
+        nvsg::VertexAttributeSetSharedPtr vasPtr = nvsg::VertexAttributeSet::create();
+        nvsg::VertexAttributeSetWriteLock vas( vasPtr );
+
+        std::vector<nvsg::BufferSharedPtr> buffers( m_buffers.size() );
+        for ( size_t i = 0; i < m_buffers.size(); ++i )
+        {
+            buffers[i] = m_buffers[i]->unmap();
+        }
+        for ( unsigned int i = 0; i < nvsg::VertexAttributeSet::NVSG_VERTEX_ATTRIB_COUNT; ++i )
+        {
+            const Attribute &a = m_attributes[i];
+            if ( a.size )
+            {
+                vas->setVertexData( i, a.layout.size, a.layout.type, buffers[a.buffer], a.offset, a.stride, m_count );
+                vas->setNormalizeEnabled( i, a.layout.normalized );
+            }
+        }
+        return( vasPtr );
+    }
+
+private:
+    struct Attribute
+    {
+        unsigned int    size;       // number of float components written, 0 if the attribute is not used
+        AttributeLayout layout;
+        unsigned int    buffer;
+        unsigned int    offset;
+        unsigned int    stride;
+        char          * data;       // vertex 0 of the attribute in the mapped buffer
+    };
+
+    Attribute & getAttribute( unsigned int attrib )
+    {
+        NVSG_ASSERT( ( attrib < nvsg::VertexAttributeSet::NVSG_VERTEX_ATTRIB_COUNT ) && m_attributes[attrib].size );
+        map();
+        return( m_attributes[attrib] );
+    }
+
+    //! Allocate the buffers of the declared attributes, in the order of the attribute indices
+    void map()
+    {
+        if ( m_mapped )
+        {
+            return;
+        }
+        m_mapped = true;
+
+        unsigned int stride = 0;
+        for ( unsigned int i = 0; i < nvsg::VertexAttributeSet::NVSG_VERTEX_ATTRIB_COUNT; ++i )
+        {
+            if ( m_attributes[i].size )
+            {
+                stride += m_attributes[i].layout.bytes;
+            }
+        }
+
+        unsigned int offset = 0;
+        for ( unsigned int i = 0; i < nvsg::VertexAttributeSet::NVSG_VERTEX_ATTRIB_COUNT; ++i )
+        {
+            Attribute &a = m_attributes[i];
+            if ( !a.size )
+            {
+                continue;
+            }
+            if ( m_format & MESH_FORMAT_INTERLEAVED )
+            {
+                if ( m_buffers.empty() )
+                {
+                    m_buffers.push_back( new BufferArray<char>( m_count * stride ) );
+                }
+                a.buffer = 0;
+                a.offset = offset;
+                a.stride = stride;
+                offset += a.layout.bytes;
+            }
+            else
+            {
+                a.buffer = checked_cast<unsigned int>( m_buffers.size() );
+                a.offset = 0;
+                a.stride = a.layout.bytes;
+                m_buffers.push_back( new BufferArray<char>( m_count * a.stride ) );
+            }
+            a.data = m_count ? &(*m_buffers[a.buffer])[a.offset] : 0;
+        }
+    }
+
+private:
+    MeshVertices( const MeshVertices & );
+    MeshVertices & operator=( const MeshVertices & );
+
+private:
+    unsigned int                  m_format;
+    unsigned int                  m_count;
+    bool                          m_mapped;
+    Attribute                     m_attributes[nvsg::VertexAttributeSet::NVSG_VERTEX_ATTRIB_COUNT];
+    std::vector<BufferArray<char> *> m_buffers;
+};
+
+//! Helper class to write one float vector attribute of a MeshVertices with the array syntax of the generators
+template <typename T>
+class VertexStream
+{
+public:
+    //! The vertex \a i of the stream, encoded when assigned to
+    class Reference
+    {
+    public:
+        Reference( MeshVertices &vertices, unsigned int attrib, unsigned int i )
+            : m_vertices( vertices )
+            , m_attrib( attrib )
+            , m_i( i )
+        {
+        }
+
+        Reference & operator=( const T &value )
+        {
+            m_vertices.write( m_attrib, m_i, &value[0] );
+            return( *this );
+        }
+
+        //! Read the value back, only for attributes kept as floats like the positions
+        operator T() const
+        {
+            T value;
+            m_vertices.read( m_attrib, m_i, &value[0] );
+            return( value );
+        }
+
+    private:
+        MeshVertices &m_vertices;
+        unsigned int  m_attrib;
+        unsigned int  m_i;
+    };
+
+public:
+    VertexStream( MeshVertices &vertices, unsigned int attrib )
+        : m_vertices( vertices )
+        , m_attrib( attrib )
+    {
+        m_vertices.addAttribute( attrib, sizeof(T) / sizeof(float) );
+    }
+
+    Reference operator[]( unsigned int i )
+    {
+        return( Reference( m_vertices, m_attrib, i ) );
+    }
+
+    //! Write the \a count values \a values as the vertices from \a first on
+    void writeRow( unsigned int first, const T *values, unsigned int count )
+    {
+        m_vertices.writeRow( m_attrib, first, reinterpret_cast<const float *>( values ), count );
+    }
+
+    //! Get the storage of the vertices from \a first on if the stream is packed floats, or 0 if it is encoded or interleaved
+    T * getPackedValues( unsigned int first )
+    {
+        return( reinterpret_cast<T *>( m_vertices.getPackedFloats( m_attrib, first ) ) );
+    }
+
+private:
+    MeshVertices &m_vertices;
+    unsigned int  m_attrib;
+};
+
+//! Helper class to write the indices of a generated mesh directly as 16-bit indices if the MeshFormat asks for them and
+//all vertices fit, or as 32-bit indices otherwise. 0xffff is kept free for the primitive restart index.
+class MeshIndices
+{
+public:
+    //! The index \a i, stored when assigned to
+    class Reference
+    {
+    public:
+        Reference( MeshIndices &indices, unsigned int i )
+            : m_indices( indices )
+            , m_i( i )
+        {
+        }
+
+        Reference & operator=( unsigned int value )
+        {
+            m_indices.set( m_i, value );
+            return( *this );
+        }
+
+    private:
+        MeshIndices  &m_indices;
+        unsigned int  m_i;
+    };
+
+public:
+    MeshIndices( unsigned int format, unsigned int vertexCount, unsigned int count )
+        : m_short( ( format & MESH_FORMAT_SHORT_INDICES ) && ( vertexCount <= 0xffff ) )
+        , m_data( count * ( m_short ? sizeof(unsigned short) : sizeof(unsigned int) ) )
+        , m_count( count )
+    {
+    }
+
+    Reference operator[]( unsigned int i )
+    {
+        return( Reference( *this, i ) );
+    }
+
+    //! Set index \a i to \a value, primitiveRestartIndex is mapped to the restart index of the index type
+    void set( unsigned int i, unsigned int value )
+    {
+        NVSG_ASSERT( i < m_count );
+        if ( m_short )
+        {
+            NVSG_ASSERT( ( value == primitiveRestartIndex ) || ( value < 0xffff ) );
+            reinterpret_cast<unsigned short *>( &m_data[0] )[i] = ( value == primitiveRestartIndex ) ? 0xffff : (unsigned short)value;
+        }
+        else
+        {
+            reinterpret_cast<unsigned int *>( &m_data[0] )[i] = value;
+        }
+    }
+
+    unsigned int size() const
+    {
+        return( m_count );
+    }
+
+    //! Finish writing and create the IndexSet, with the primitive restart index set if \a strips
+    nvsg::IndexSetSharedPtr createIndexSet( bool strips )
+    {
+        nvsg::IndexSetSharedPtr indexSet( nvsg::IndexSet::create() );
+        nvsg::IndexSetWriteLock dst( indexSet );
+        dst->setData( m_data.unmap(), m_count, m_short ? nvsg::NVSG_UNSIGNED_SHORT : nvsg::NVSG_UNSIGNED_INT );
+        if ( strips )
+        {
+            dst->setPrimitiveRestartIndex( m_short ? 0xffff : primitiveRestartIndex );
+        }
+        return( indexSet );
+    }
+
+private:
+    MeshIndices( const MeshIndices & );
+    MeshIndices & operator=( const MeshIndices & );
+
+private:
+    bool              m_short;
+    BufferArray<char> m_data;
+    unsigned int      m_count;
+};
+} // namespace nvutil
@@ -0,0 +1,66 @@
+/*
+\brief Generate many MeshGenerator drawables at once, distributed over the cores
+*/
+
+#pragma once
+
+#include <nvsg/CoreTypes.h>
+#include <nvmath/nvmath.h>
+#include <nvmath/Vecnt.h>
+#include <nvmath/Quatt.h>
+
+#include <vector>
+
+namespace nvutil
+{
+//! Description of one drawable of a batch, the static functions mirror the generator functions of MeshGenerator.h
+struct MeshSpec
+{
+    enum Generator
+    {
+        MESH_SPHERE,
+        MESH_ICOSPHERE,
+        MESH_CYLINDER,
+        MESH_TORUS,
+        MESH_TESSELLATED_PLANE,
+        MESH_TESSELLATED_BOX,
+        MESH_QUAD_SET,
+        MESH_TRI_SET
+    };
+
+    MeshSpec();
+
+    static MeshSpec sphere( unsigned int m, unsigned int n, float radius = 1.0f );
+    static MeshSpec icoSphere( unsigned int level, float radius = 1.0f );
+    static MeshSpec cylinder( float r, float h, unsigned int hdivs, unsigned int thdivs, bool bOuter = true
+                            , float thstart = 0.0f, float thend = 2.0f*nvmath::PI );
+    static MeshSpec torus( unsigned int m, unsigned int n, float innerRadius = 1.0f, float outerRadius = 0.5f );
+    static MeshSpec tessellatedPlane( unsigned int subdiv );
+    static MeshSpec tessellatedBox( unsigned int subdiv );
+    static MeshSpec quadSet( unsigned int m, unsigned int n, float size = 1.0f, float gap = 0.5f );
+    static MeshSpec triSet( unsigned int m, unsigned int n, float size = 1.0f, float gap = 0.5f );
+
+    Generator               generator;
+    unsigned int            counts[2];      //!< the integral parameters of the generator
+    float                   params[4];      //!< the floating point parameters of the generator
+    bool                    outer;          //!< bOuter of createCylinder
+
+    nvsg::StateSetSharedPtr stateSet;       //!< StateSet of the GeoNode created by addMeshBatch
+    bool                    transform;      //!< let addMeshBatch put the GeoNode under a Transform, default false
+    nvmath::Vec3f           translation;    //!< the placement of that Transform, see createTransform
+    nvmath::Quatf           orientation;
+    nvmath::Vec3f           scaling;
+};
+
+/*! Generate the drawables of \a specs into \a drawables, in the order of \a specs. With \a multithreaded the specs are
+    split into ranges handled on the global QThreadPool. The generators only create new objects and keep their scratch
+    tables per thread, so the worker threads don't wait for each other.
+    \remarks Each drawable gets the MeshFormat current when its generator starts, change it only between batches to
+    get the same MeshFormat for all drawables of a batch. */
+void createMeshBatch( const std::vector<MeshSpec> &specs, std::vector<nvsg::DrawableSharedPtr> &drawables, bool multithreaded = true );
+
+/*! Generate the drawables of \a specs as in createMeshBatch, each in a GeoNode with the StateSet of its spec, under a
+    Transform if requested by the spec. The nodes are built on the worker threads as well. They are added to \a group
+    in the order of \a specs, under a single write lock after all of them are finished. */
+void addMeshBatch( const nvsg::GroupSharedPtr &group, const std::vector<MeshSpec> &specs, bool multithreaded = true );
+} // namespace nvutil
@@ -0,0 +1,125 @@
+/*
+\brief Cache in front of the MeshGenerator functions to share identical drawables
+*/
+
+#pragma once
+
+#include <nvsg/CoreTypes.h>
+#include <nvmath/Vecnt.h>
+#include <nvmath/Matnnt.h>
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace nvutil
+{
+/*! \brief Opt-in cache for the drawables created by the MeshGenerator functions.
+ *  The member functions mirror the free generator functions of MeshGenerator.h. The first call with a given set
+ *  of parameters creates the drawable, every further call with exactly the same parameters returns the very same
+ *  DrawableSharedPtr, so the scene and the renderer only hold one VertexAttributeSet and IndexSet for it.
+ *  \remarks The returned drawables are shared, don't modify them. Use the free generator functions to get a
+ *  private copy. The cache keeps its drawables alive until they are evicted or purge is called.
+ *  Entries are evicted least recently used first, as soon as the size or entry count bound is exceeded. */
+class MeshCache
+{
+public:
+    struct Statistics
+    {
+        unsigned int hits;          //!< number of requests served from the cache
+        unsigned int misses;        //!< number of requests that created a new drawable
+        unsigned int evictions;     //!< number of drawables dropped to stay within the bounds
+        unsigned int entries;       //!< number of drawables currently in the cache
+        size_t       bytes;         //!< vertex and index bytes of the drawables currently in the cache
+    };
+
+public:
+    MeshCache( size_t maxBytes = 256 * 1024 * 1024, unsigned int maxEntries = ~0u );
+    ~MeshCache();
+
+    //! Set the maximum number of vertex and index bytes held by the cache
+    void setMaximumBytes( size_t maxBytes );
+    size_t getMaximumBytes() const;
+
+    //! Set the maximum number of drawables held by the cache
+    void setMaximumEntries( unsigned int maxEntries );
+    unsigned int getMaximumEntries() const;
+
+    //! Drop all cached drawables. The statistics counters are kept, use resetStatistics to clear them
+    void purge();
+
+    const Statistics & getStatistics() const;
+    void resetStatistics();
+
+    nvsg::DrawableSharedPtr createQuadSet( unsigned int m, unsigned int n, const float size = 1.0f, const float gap = 0.5f );
+    nvsg::DrawableSharedPtr createQuadStrip( unsigned int n, float height = 1.0f, float radius = 1.0f );
+    nvsg::DrawableSharedPtr createTriSet( unsigned int m, unsigned int n, const float size = 1.0f, const float gap = 0.5f );
+    nvsg::DrawableSharedPtr createTriFan( unsigned int n, const float radius = 1.0f, const float elevation = 0.0f );
+    nvsg::DrawableSharedPtr createTriStrip( unsigned int rows, unsigned int columns, float width = 1.0f, float height = 1.0f );
+    nvsg::DrawableSharedPtr createCube();
+    nvsg::DrawableSharedPtr createTetrahedron();
+    nvsg::DrawableSharedPtr createOctahedron();
+    nvsg::DrawableSharedPtr createDodecahedron();
+    nvsg::DrawableSharedPtr createIcosahedron();
+    nvsg::DrawableSharedPtr createIcoSphere( unsigned int level, float radius = 1.0f );
+    nvsg::DrawableSharedPtr createSphere( unsigned int m, unsigned int n, float radius = 1.0f );
+    nvsg::DrawableSharedPtr createCylinder( float r, float h, unsigned int hdivs, unsigned int thdivs, bool bOuter = true, float thstart = 0.0f, float thend = 2.0f*nvmath::PI );
+    nvsg::DrawableSharedPtr createTorus( unsigned int m, unsigned int n, float innerRadius = 1.0f, float outerRadius = 0.5f );
+    nvsg::DrawableSharedPtr createTessellatedPlane( unsigned int subdiv, const nvmath::Mat44f &transf = nvmath::Mat44f( 1.0f, 0.0f, 0.0f, 0.0f,
+                                                                                                                    0.0f, 1.0f, 0.0f, 0.0f,
+                                                                                                                    0.0f, 0.0f, 1.0f, 0.0f,
+                                                                                                                    0.0f, 0.0f, 0.0f, 1.0f ) );
+    nvsg::DrawableSharedPtr createPlane( float x0, float y0, float width, float height, float wext = 1.0f, float hext = 1.0f );
+    nvsg::DrawableSharedPtr createTessellatedBox( unsigned int subdiv );
+
+private:
+    //! Identifies a generated drawable by the name of its generator, the exact parameters and the mesh format
+    struct Key
+    {
+        Key();
+
+        std::string               generator;
+        std::vector<unsigned int> counts;     //!< the integral parameters, kept apart to compare them exactly
+        std::vector<float>        params;     //!< compared by their bit patterns
+        unsigned int              format;     //!< the MeshFormat active when the drawable is requested, used to create it
+
+        bool operator<( const Key &rhs ) const;
+    };
+
+    struct Entry
+    {
+        nvsg::DrawableSharedPtr    drawable;
+        size_t                     bytes;
+        std::list<Key>::iterator   lru;
+    };
+
+    nvsg::DrawableSharedPtr find( const Key &key );
+    nvsg::DrawableSharedPtr insert( const Key &key, const nvsg::DrawableSharedPtr &drawable );
+    void evict();
+
+private:
+    typedef std::map<Key, Entry> EntryMap;
+
+    EntryMap        m_entries;
+    std::list<Key>  m_lru;          // most recently used first
+    size_t          m_maxBytes;
+    unsigned int    m_maxEntries;
+    Statistics      m_statistics;
+};
+
+inline size_t MeshCache::getMaximumBytes() const
+{
+    return m_maxBytes;
+}
+
+inline unsigned int MeshCache::getMaximumEntries() const
+{
+    return m_maxEntries;
+}
+
+inline const MeshCache::Statistics & MeshCache::getStatistics() const
+{
+    return m_statistics;
+}
+} // namespace nvutil
@@ -7,6 +7,8 @@
 #include <nvsg/CoreTypes.h>
 #include <nvmath/Vecnt.h>
 #include <nvmath/Quatt.h>
+#include <nvmath/Boxnt.h>
+#include <nvmath/Spherent.h>
 
 namespace nvutil
 {
@@ -14,6 +16,14 @@ namespace nvutil
 // supported attributes: vertex, normal
 nvsg::DrawableSharedPtr createQuadSet( unsigned int m, unsigned int n, const float size = 1.0f, const float gap  = 0.5f );
 
+/*! Generate the quads of createQuadSet in blocks of at most \a maxVertices vertices.
+    Each block is a Primitive in a GeoNode with the StateSet \a stateSet below the returned Group, so it has its own
+    bounding volume and can be culled on its own. Only the buffers of the current block are allocated during generation.
+    The default of 65535 vertices keeps the indices of every block within 16 bits. */
+// supported attributes: vertex, normal
+nvsg::GroupSharedPtr createQuadSetChunked( unsigned int m, unsigned int n, const nvsg::StateSetSharedPtr &stateSet, unsigned int maxVertices = 65535
+                                         , const float size = 1.0f, const float gap = 0.5f );
+
 //! Generate a quad strip with n quads
 // supported attributes: vertex, normal
 nvsg::DrawableSharedPtr createQuadStrip( unsigned int n, float height = 1.0f , float radius = 1.0f );
@@ -22,6 +32,11 @@ nvsg::DrawableSharedPtr createQuadStrip( unsigned int n, float height = 1.0f , f
 // supported attributes: vertex, normal
 nvsg::DrawableSharedPtr createTriSet( unsigned int m, unsigned int n, const float size = 1.0f, const float gap  = 0.5f );
 
+//! Generate the triangles of createTriSet in blocks of at most \a maxVertices vertices, see createQuadSetChunked
+// supported attributes: vertex, normal
+nvsg::GroupSharedPtr createTriSetChunked( unsigned int m, unsigned int n, const nvsg::StateSetSharedPtr &stateSet, unsigned int maxVertices = 65535
+                                        , const float size = 1.0f, const float gap = 0.5f );
+
 //! Generate a half-circle trifan with n segments
 // supported attributes: vertex, normal
 nvsg::DrawableSharedPtr createTriFan( unsigned int n, const float radius = 1.0f, const float elevation = 0.0f );
@@ -31,12 +46,14 @@ nvsg::DrawableSharedPtr createTriFan( unsigned int n, const float radius = 1.0f,
 nvsg::DrawableSharedPtr createTriStrip( unsigned int rows, unsigned int columns, float width = 1.0f, float height = 1.0f );
 
 //! Generate a GeoNode with a TriPatches4 with n x m triangles, m rows and n columns, each of size \a size, separated by \a offset
+// Without the tessellation effect in \a searchPaths, the patches are tessellated on the CPU, see tessellateTriPatches4
 nvsg::GeoNodeSharedPtr createTriPatches4( const std::vector<std::string> & searchPaths
                                           , unsigned int n, unsigned int m
                                           , const nvmath::Vec3f & size = nvmath::Vec3f( 4.0f, 4.0f, 4.0f )
         , const nvmath::Vec2f & offset = nvmath::Vec2f( 4.0f, 4.0f ) );
 
 //! Generate a GeoNode with a QuadPatches4x4 with n x m cylinders, seperated by \a offset
+// Without the tessellation effect in \a searchPaths, the patches are tessellated on the CPU, see tessellateQuadPatches4x4
 nvsg::GeoNodeSharedPtr createQuadPatches4x4( const std::vector<std::string> & searchPaths
                                              , unsigned int n, unsigned int m
                                              , const nvmath::Vec2f & offset = nvmath::Vec2f( 4.0f, 4.0f ) );
@@ -61,6 +78,33 @@ nvsg::DrawableSharedPtr createDodecahedron();
 // supported attributes: vertex, normal
 nvsg::DrawableSharedPtr createIcosahedron();
 
+//! The polyhedra offered as shared drawables
+enum Polyhedron
+{
+    POLYHEDRON_CUBE,
+    POLYHEDRON_TETRAHEDRON,
+    POLYHEDRON_OCTAHEDRON,
+    POLYHEDRON_DODECAHEDRON,
+    POLYHEDRON_ICOSAHEDRON,
+    POLYHEDRON_COUNT
+};
+
+/*! Get the drawable of \a polyhedron shared by all callers, as created by createCube, createTetrahedron,
+    createOctahedron, createDodecahedron or createIcosahedron. It is created on the first request for the current
+    mesh format, every further request returns the very same drawable, so any number of GeoNodes can reference one
+    VertexAttributeSet per polyhedron. This function is thread safe.
+    \remarks The shared drawables must not be modified. Call releaseSharedPolyhedra before nvsgTerminate. */
+nvsg::DrawableSharedPtr getSharedPolyhedron( Polyhedron polyhedron );
+
+//! Release the drawables handed out by getSharedPolyhedron. The scenes using them keep them alive as needed
+void releaseSharedPolyhedra();
+
+/*! Generate a geodesic sphere around (0,0,0) with a radius of \a radius by subdividing an icosahedron \a level times.
+    Vertices are shared between neighboring triangles, giving 10 * 4^level + 2 vertices and 20 * 4^level triangles
+    of nearly equal size, without the crowded poles of createSphere. \a level should be at most 12. */
+// supported attributes: vertex, normal
+nvsg::DrawableSharedPtr createIcoSphere( unsigned int level, float radius = 1.0f );
+
 //! Generate a sphere around (0,0,0) with a radius of \a radius, m edges in longitudinal and n edges in latitudinal direction, both m and n should be at least 3
 // supported attributes: vertex, normal, texcoord0 (2D)
 nvsg::DrawableSharedPtr createSphere( unsigned int m , unsigned int n , float radius = 1.0f );
@@ -80,6 +124,14 @@ nvsg::DrawableSharedPtr createTessellatedPlane( unsigned int subdiv, const nvmat
                                                                                                                     0.0f, 0.0f, 1.0f, 0.0f,
                                                                                                                     0.0f, 0.0f, 0.0f, 1.0f ) );
 
+//! Generate the tessellated plane of createTessellatedPlane in blocks of at most \a maxVertices vertices, see createQuadSetChunked
+// supported attributes: vertex, normal, texcoord0 (2D)
+nvsg::GroupSharedPtr createTessellatedPlaneChunked( unsigned int subdiv, const nvsg::StateSetSharedPtr &stateSet, unsigned int maxVertices = 65535
+                                                  , const nvmath::Mat44f &transf = nvmath::Mat44f( 1.0f, 0.0f, 0.0f, 0.0f,
+                                                                                                   0.0f, 1.0f, 0.0f, 0.0f,
+                                                                                                   0.0f, 0.0f, 1.0f, 0.0f,
+                                                                                                   0.0f, 0.0f, 0.0f, 1.0f ) );
+
 /*! Create an XY aligned plane that could conveniantly be used to make pixel-aligned rectangles: ( \a x0, \a y0 ) - the bottom left corner of the rect,
   and the width \a width in pixels, and the height \a height in pixels of the rect. \a wext and \a hext can be set to specify how far
   the texture coordinates extend at the top right corner of the rect*/
@@ -89,6 +141,157 @@ nvsg::DrawableSharedPtr createPlane( float x0, float y0, float width, float heig
 // supported attributes: vertex, normal, texcoord0 (2D)
 nvsg::DrawableSharedPtr createTessellatedBox( unsigned int subdiv );
 
+//! Parameters for the level of detail chains built by the create...LOD functions
+struct LODParameters
+{
+    LODParameters();
+
+    unsigned int levels;            //!< maximal number of levels, including the full resolution one, default 4
+    float        reduction;         //!< factor in (0,1) applied to the tessellation counts from one level to the next, default 0.5
+    float        pixelError;        //!< screen space error in pixels tolerated before switching to a finer level, default 1
+    float        viewportHeight;    //!< height of the viewport in pixels, default 1024
+    float        fieldOfView;       //!< vertical field of view of the camera in radians, default PI/4
+};
+
+/*! Generate a LOD node with progressively coarser tessellations of createSphere, each in a GeoNode with the StateSet \a stateSet.
+    The switch distances are chosen such that the geometric error of each level, the distance between the tessellated and the
+    true surface, is projected onto at most \a parameters.pixelError pixels. Levels that would not reduce the tessellation
+    any further are left out. */
+nvsg::LODSharedPtr createSphereLOD( unsigned int m, unsigned int n, const nvsg::StateSetSharedPtr &stateSet, float radius = 1.0f
+                                  , const LODParameters &parameters = LODParameters() );
+
+//! Generate a LOD node with progressively coarser tessellations of createCylinder, see createSphereLOD
+nvsg::LODSharedPtr createCylinderLOD( float r, float h, unsigned int hdivs, unsigned int thdivs, const nvsg::StateSetSharedPtr &stateSet
+                                    , bool bOuter = true, float thstart = 0.0f, float thend = 2.0f*nvmath::PI
+                                    , const LODParameters &parameters = LODParameters() );
+
+//! Generate a LOD node with progressively coarser tessellations of createTorus, see createSphereLOD
+nvsg::LODSharedPtr createTorusLOD( unsigned int m, unsigned int n, const nvsg::StateSetSharedPtr &stateSet
+                                 , float innerRadius = 1.0f, float outerRadius = 0.5f, const LODParameters &parameters = LODParameters() );
+
+/*! Generate a LOD node with progressively coarser tessellations of createTessellatedBox, see createSphereLOD.
+    The box is flat at every tessellation, so the cell size is used as error of the per vertex shading. */
+nvsg::LODSharedPtr createTessellatedBoxLOD( unsigned int subdiv, const nvsg::StateSetSharedPtr &stateSet
+                                          , const LODParameters &parameters = LODParameters() );
+
+//! Function type of the heights of createTerrain, called with ( \a u, \a v ) in [0,1]x[0,1] and the \a userData passed to createTerrain
+typedef float (*TerrainHeightFunction)( float u, float v, void *userData );
+
+//! Parameters of createTerrain
+struct TerrainParameters
+{
+    TerrainParameters();
+
+    unsigned int  chunks;           //!< number of chunks along each side, rounded up to a power of two, default 8
+    float         heightScale;      //!< factor applied to the heights, default 1
+    float         skirtDepth;       //!< how far the skirts reach below the chunk borders, 0 to derive it from the LOD errors, default 0
+    LODParameters lod;              //!< the resolutions of each chunk, levels and reduction apply to \a chunkResolution
+};
+
+/*! Generate a heightfield terrain of \a size[0] x \a size[1] in the XZ plane, centered at the origin, with the heights along
+    the y-axis as expected by the WalkCameraManipulator. u runs along x and v along -z, both also used as texcoord0.
+    The terrain is split into parameters.chunks x parameters.chunks chunks of \a chunkResolution x \a chunkResolution cells
+    at full resolution, grouped as a quadtree, so culling and picking skip whole quadrants by their bounding volumes.
+    Each chunk is a LOD node with coarser resolutions as in createSphereLOD, the switch distances derived from the measured
+    height error of each resolution. The chunks get skirts hanging down from their borders to cover the cracks between
+    neighbors of different resolutions. \a stateSet is used for all GeoNodes.
+    supported attributes: vertex, normal, texcoord0 (2D) */
+nvsg::GroupSharedPtr createTerrain( TerrainHeightFunction heightFunction, void *userData, const nvmath::Vec2f &size
+                                  , unsigned int chunkResolution, const nvsg::StateSetSharedPtr &stateSet
+                                  , const TerrainParameters &parameters = TerrainParameters() );
+
+/*! Generate a terrain as above, with the heights taken from the first component of the first image of \a heightImage,
+    normalized to [0,1] for integer types, and interpolated bilinearly. The first row of the image is at v = 0.
+    Returns a null pointer if the format or type of the image is not supported. */
+nvsg::GroupSharedPtr createTerrain( const nvsg::TextureHostSharedPtr &heightImage, const nvmath::Vec2f &size
+                                  , unsigned int chunkResolution, const nvsg::StateSetSharedPtr &stateSet
+                                  , const TerrainParameters &parameters = TerrainParameters() );
+
+//! Layout of the vertex and index data written by the drawable generators above, the flags can be combined
+enum MeshFormat
+{
+    MESH_FORMAT_FLOAT               = 0x00,   //!< one float array per attribute and 32-bit indices
+    MESH_FORMAT_SHORT_INDICES       = 0x01,   //!< 16-bit indices whenever the vertex count fits
+    MESH_FORMAT_INTERLEAVED         = 0x02,   //!< all attributes of a vertex next to each other in one buffer
+    MESH_FORMAT_OCTAHEDRAL_NORMALS  = 0x04,   //!< normals as two normalized 16-bit octahedral coordinates
+    MESH_FORMAT_HALF_TEXCOORDS      = 0x08,   //!< texture coordinates as half floats
+    MESH_FORMAT_COMPACT             = 0x0f,   //!< all of the above
+    MESH_FORMAT_TRIANGLE_STRIPS     = 0x10    //!< grid meshes as triangle strips per row, joined by primitive restart indices
+};
+
+/*! Set the layout used by all following calls of the drawable generators, a combination of MeshFormat flags.
+    The default is MESH_FORMAT_SHORT_INDICES. The generators write their vertices and indices in this layout directly,
+    each call reads the format once, so setMeshFormat may be called from any thread, but a call running at the same
+    time may still use the previous format. The chunked and terrain generators use one format for all their parts.
+    \remarks MESH_FORMAT_TRIANGLE_STRIPS changes the primitive type, so it is not part of MESH_FORMAT_COMPACT. It is used
+    by createSphere, createTorus and createTessellatedPlane, including their LOD and chunked variants.
+    The rows of the grids become PRIMITIVE_TRIANGLE_STRIP with the same triangles as the lists, about a third of the
+    indices of the triangle lists of createSphere and createTessellatedPlane and half of the quads of createTorus.
+    The strips are separated by the primitive restart index of the IndexSet, ~0 for 32-bit and 0xffff for 16-bit
+    indices. The separate quads of createQuadSet stay PRIMITIVE_QUADS, as strips they would need more indices.
+    \remarks Octahedral normals have only two components, they need to be decoded in the vertex shader:
+    n = ( x, y, 1 - |x| - |y| ); if ( n.z < 0 ) n.xy = ( 1 - |n.yx| ) * sign( n.xy ); n = normalize( n ) */
+void setMeshFormat( unsigned int format );
+unsigned int getMeshFormat();
+
+/*! \brief Use \a format for the drawable generators called by this thread while the ScopedMeshFormat lives, instead of
+    the format set by setMeshFormat. A caller that read the format before, like MeshCache for its key, gets a drawable
+    in exactly that format, even if another thread changes it meanwhile. Scopes nest. */
+class ScopedMeshFormat
+{
+public:
+    explicit ScopedMeshFormat( unsigned int format );
+    ~ScopedMeshFormat();
+
+private:
+    ScopedMeshFormat( const ScopedMeshFormat & );
+    ScopedMeshFormat & operator=( const ScopedMeshFormat & );
+
+private:
+    bool            m_scoped;       // an outer ScopedMeshFormat is active
+    unsigned int    m_previous;     // its format
+};
+
+/*! Convert the float vertex and 32-bit index data of the Primitive \a drawable in place to the layout \a format,
+    e.g. for drawables loaded from a file. The drawable generators don't need it, they already write \a format.
+    Returns \a drawable. Drawables other than Primitives are returned unchanged. MESH_FORMAT_TRIANGLE_STRIPS is
+    ignored here, the primitive type of an existing Primitive is kept. */
+nvsg::DrawableSharedPtr convertMeshFormat( const nvsg::DrawableSharedPtr &drawable, unsigned int format );
+
+//! The bounding volumes of a generated drawable, known in closed form from the generator parameters
+struct GeneratedBounds
+{
+    nvmath::Box3f    box;
+    nvmath::Sphere3f sphere;
+};
+
+/*! Get the bounds the drawable generators attached to \a drawable when creating it, without calculating them from its vertices.
+    Returns false if \a drawable was not created by a generator, or its position data has changed since. A change is
+    detected by the position buffer, its layout and a hash over a few sample positions, so a drawable whose positions are
+    edited in place has to get its bounds from SceniX.
+    \remarks The bounds are kept in a table beside the drawables, SceniX still calculates its own bounds from the vertices
+    when it needs them. The table doesn't hold the drawables, it keeps the bounds of the last 65536 attaches and drops
+    older ones, so the bounds of a drawable kept that long have to come from SceniX. */
+bool getGeneratedBounds( const nvsg::DrawableSharedPtr &drawable, GeneratedBounds &bounds );
+
+/*! Attach the box \a box and the sphere around it to \a drawable as its generated bounds, for drawables created outside
+    of this file like the tessellated patches. \a box has to hold all positions of \a drawable. Returns \a drawable.
+    \sa getGeneratedBounds */
+nvsg::DrawableSharedPtr setGeneratedBounds( const nvsg::DrawableSharedPtr &drawable, const nvmath::Box3f &box );
+
+//! Release the bounds table of getGeneratedBounds
+void releaseGeneratedBounds();
+
+/*! Get an upper bound of the factor by which \a matrix scales lengths, safe for rotations, scalings and shears.
+    Used to transform the radius of a bounding sphere. */
+float getMaximumScale( const nvmath::Mat44f &matrix );
+
+/*! Get the bounding sphere of the subtree \a node from the generated bounds of its drawables.
+    Returns false if the subtree holds a drawable without generated bounds or a node other than a Group, Transform or
+    GeoNode. Then the caller has to fall back to the bounding sphere calculated by SceniX.
+    \sa getGeneratedBounds */
+bool getGeneratedBoundingSphere( const nvsg::NodeSharedPtr &node, nvmath::Sphere3f &sphere );
+
 /*! Generate a default material with the diffuse color \a diffuseColor,
       an ambient color of (0.2f,0.2f,0.2f), a specular color of (0.0f,0.0f,0.0f), a specular exponent of 0.0f,
       an emissive color of (0.0f,0.0f,0.0f) and an opacity of 1.0f */
@@ -118,14 +321,95 @@ nvsg::MaterialSharedPtr createMaterialAttribute( const nvmath::Vec3f &ambientCol
                                                  const float reflectivity = 0.0f,
                                                  const float indexOfRefraction = 1.0f );
 
-//! Generate a texture from the given fileName
+/*! Get a StateSet as created by createDefaultMaterial, shared by all calls with identical parameters, so the renderer
+    can batch the GeoNodes using it. This function is thread safe.
+    \remarks The shared StateSets must not be modified, use createDefaultMaterial to get one to modify.
+    Call releaseSharedMaterials before nvsgTerminate. */
+nvsg::StateSetSharedPtr getSharedDefaultMaterial( const nvmath::Vec3f &diffuseColor );
+
+//! Get a StateSet as created by createDefinedMaterial, shared by all calls with identical parameters, see getSharedDefaultMaterial
+nvsg::StateSetSharedPtr getSharedDefinedMaterial( const nvmath::Vec3f &ambientColor,
+                                                  const nvmath::Vec3f &diffuseColor,
+                                                  const nvmath::Vec3f &specularColor,
+                                                  const float specularExponent,
+                                                  const nvmath::Vec3f &emissiveColor,
+                                                  const float opacity = 1.0f,
+                                                  const float reflectivity = 0.0f,
+                                                  const float indexOfRefraction = 1.0f );
+
+//! Get the number of different StateSets handed out by getSharedDefaultMaterial and getSharedDefinedMaterial
+unsigned int getSharedMaterialCount();
+
+//! Release the StateSets handed out by getSharedDefaultMaterial and getSharedDefinedMaterial. The scenes using them keep them alive as needed
+void releaseSharedMaterials();
+
+//! Get the number of different StateSet objects used by the GeoNodes below \a node
+unsigned int getUniqueStateSetCount( const nvsg::NodeSharedPtr &node );
+
+/*! Generate a texture from the given fileName
+    The file is looked up as given, then in \a searchPaths. Its TextureHost is cached by canonical path and shared by all
+    calls for the same file, until the modification time of the file changes. Each call gets its own StateSet and
+    TextureAttribute. The search paths are added to the plug-in search path once. This function is thread safe. */
 nvsg::StateSetSharedPtr createTextureFromFile(std::string &fileName, std::vector<std::string> &searchPaths);
 
-//! Generate a texture of size 8x8 with a colored checker pattern
-nvsg::StateSetSharedPtr createTexture();
+//! Statistics of the TextureHost cache of createTextureFromFile
+struct TextureCacheStatistics
+{
+    TextureCacheStatistics();
+
+    unsigned int hits;              //!< number of calls served with an already loaded TextureHost
+    unsigned int misses;            //!< number of calls that loaded the file
+    unsigned int entries;           //!< number of TextureHosts currently in the cache
+    size_t       bytes;             //!< image bytes of the TextureHosts currently in the cache
+    size_t       savedBytes;        //!< image bytes not loaded again because of the hits
+};
 
-//! Generate a texture of size n x n with grey and alpha values
-nvsg::StateSetSharedPtr createAlphaTexture( unsigned int n=64 );
+TextureCacheStatistics getTextureCacheStatistics();
+
+//! Release the TextureHosts cached by createTextureFromFile. The scenes using them keep them alive as needed
+void releaseTextureCache();
+
+//! Parameters of createTexturesFromFiles
+struct TextureDecodeParameters
+{
+    TextureDecodeParameters();
+
+    size_t       maxBytesInFlight;  //!< image bytes decoded ahead of the texture handed back next, default 256 MB
+    unsigned int maxThreads;        //!< maximal number of files decoded at the same time, 0 for one per core, default 0
+    bool         reentrantLoaders;  //!< the texture loader plug-ins can decode several files at the same time, default false
+};
+
+/*! Create the StateSets of the texture files \a fileNames like createTextureFromFile, but decode the files
+    concurrently on the global QThreadPool. The StateSets are returned in the order of \a fileNames, with a null
+    pointer for each file that could not be loaded. The TextureHosts go through the cache of createTextureFromFile,
+    so cached files are not decoded again, and a file listed several times is decoded once.
+    Decoding runs ahead of the texture handed back next as long as the images of the decodes started after it stay
+    within \a parameters.maxBytesInFlight; a decode still running counts with the size of its image as 8-bit RGBA,
+    read from the file header, or with four times its file size if Qt can't read the header.
+    \remarks A loader plug-in must not be used by two threads at the same time, so unless \a parameters.reentrantLoaders
+    is set, each decode holds the PlugInLock of the texture loader of its file extension: the files of one extension
+    are decoded one after the other, while files of different extensions are decoded concurrently.
+    createTextureFromFile and loadTextureHost hold the same lock. Set \a parameters.reentrantLoaders only if all
+    texture loader plug-ins used are known to be reentrant. */
+std::vector<nvsg::StateSetSharedPtr> createTexturesFromFiles( const std::vector<std::string> &fileNames, const std::vector<std::string> &searchPaths
+                                                            , const TextureDecodeParameters &parameters = TextureDecodeParameters() );
+
+//! Parameters of the procedural textures of createTexture and createAlphaTexture
+struct ProceduralTextureParameters
+{
+    ProceduralTextureParameters();
+
+    bool mipmaps;                   //!< build the full mip chain on the CPU and filter with it, default false
+    bool multithreaded;             //!< distribute the rows of the image and of each mipmap over the cores, default true
+    bool preserveHostCopy;          //!< keep the image data on the host after the upload, default true
+};
+
+/*! Generate a texture of size 8x8 with a colored checker pattern
+    The texels are written as 8-bit RGBA, 4 bytes each, see ProceduralTextureParameters for the mip chain and host copy. */
+nvsg::StateSetSharedPtr createTexture( const ProceduralTextureParameters &parameters = ProceduralTextureParameters() );
+
+//! Generate a texture of size n x n with grey and alpha values, as 8-bit RGBA, see createTexture
+nvsg::StateSetSharedPtr createAlphaTexture( unsigned int n=64, const ProceduralTextureParameters &parameters = ProceduralTextureParameters() );
 
 //! Generate a GeoNode from a shape \a drawable and a state set \a stateSet
 nvsg::GeoNodeSharedPtr createGeoNode( const nvsg::DrawableSharedPtr &drawable, const nvsg::StateSetSharedPtr &stateSet );
@@ -142,6 +426,29 @@ nvsg::TransformSharedPtr imitateRaster( const nvsg::NodeSharedPtr &node, unsigne
 //! Generate a transformation that maps x, y coordinates as if they are direct window space coordinates
 nvsg::TransformSharedPtr imitateRaster( unsigned int width, unsigned int height );
 
+//! Parameters of the scene built by createStressScene
+struct StressSceneParameters
+{
+    StressSceneParameters();
+
+    unsigned int countX;            //!< number of transforms along x, default 10
+    unsigned int countY;            //!< number of transforms along y, default 10
+    unsigned int countZ;            //!< number of transforms along z, default 10
+    float        spacing;           //!< distance between neighboring transforms, default 3
+    unsigned int drawables;         //!< number of different drawables shared by all transforms, default 4
+    unsigned int materials;         //!< number of different materials shared by all transforms, default 8
+    bool         randomRotation;    //!< rotate each transform randomly, default false
+    float        minScale;          //!< each transform is scaled uniformly by a random factor in [minScale, maxScale], default 1
+    float        maxScale;
+    unsigned int seed;              //!< the same seed gives the same scene on every platform, default 1
+};
+
+/*! Generate a grid of countX x countY x countZ transforms, each holding one of drawables x materials shared GeoNodes,
+    to measure how traversers and renderers scale with the number of nodes. The transforms are grouped per x and per
+    x/y column, so even a million transforms form a shallow hierarchy with useful bounding volumes.
+    The materials come from getSharedDefaultMaterial, so scenes built with the same seed share them. */
+nvsg::GroupSharedPtr createStressScene( const StressSceneParameters &parameters = StressSceneParameters() );
+
 //! Sets the point of view of the camera of the given view state
 void setCameraPOV(float x, float y, float z, nvsg::ViewStateSharedPtr viewState);
 
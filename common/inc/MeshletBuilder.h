@@ -0,0 +1,62 @@
+/*
+\brief Split triangle meshes into small clusters with bounding spheres and normal cones for CPU culling
+*/
+
+#pragma once
+
+#include <nvsg/CoreTypes.h>
+#include <nvmath/Vecnt.h>
+#include <nvmath/Spherent.h>
+
+#include <vector>
+
+namespace nvutil
+{
+//! Parameters of buildMeshlets
+struct MeshletParameters
+{
+    MeshletParameters();
+
+    unsigned int maxVertices;       //!< maximal number of vertices of a meshlet, at most 256, default 64
+    unsigned int maxTriangles;      //!< maximal number of triangles of a meshlet, default 124
+};
+
+//! A cluster of triangles of a Primitive
+struct Meshlet
+{
+    unsigned int        vertexOffset;       //!< first entry of the meshlet in MeshletSet::vertexIndices
+    unsigned int        vertexCount;
+    unsigned int        triangleOffset;     //!< first triangle of the meshlet in MeshletSet::localIndices, three entries each
+    unsigned int        triangleCount;
+    nvmath::Sphere3f    sphere;             //!< bounds of the vertices of the meshlet
+    nvmath::Vec3f       coneAxis;           //!< average direction of the face normals
+    float               coneCutoff;         //!< sine of the angle between coneAxis and the farthest face normal, 1 if the cone is useless
+};
+
+//! The meshlets of a Primitive, in the object space of the Primitive
+struct MeshletSet
+{
+    std::vector<Meshlet>        meshlets;
+    std::vector<unsigned int>   vertexIndices;  //!< per meshlet, the vertices of the Primitive used by it
+    std::vector<unsigned char>  localIndices;   //!< per meshlet, three indices into its vertexIndices per triangle
+};
+
+/*! Split the triangles of \a primitive into meshlets of at most \a parameters.maxVertices vertices and
+    \a parameters.maxTriangles triangles. The triangles are taken in the order of the index set, which keeps the
+    meshlets of the grid-like generated meshes compact. Positions are read as 3 floats, with or without IndexSet.
+    Returns false if \a primitive is not of type PRIMITIVE_TRIANGLES, has no positions, or has an index beyond its
+    positions, like a primitive restart index. */
+bool buildMeshlets( const nvsg::PrimitiveSharedPtr &primitive, MeshletSet &meshlets
+                  , const MeshletParameters &parameters = MeshletParameters() );
+
+/*! Cull the meshlets of \a meshlets for a camera at \a cameraPosition, given in the object space of the Primitive.
+    A meshlet is rejected if all its triangles face away from the camera, or if its sphere is outside any of the
+    \a planes, each given as ( nx, ny, nz, d ) with the inside at n * p + d >= 0. Pass no planes to only test the
+    normal cones. The indices of the remaining meshlets are returned in \a visible.
+    \return The number of visible meshlets. */
+unsigned int cullMeshlets( const MeshletSet &meshlets, const nvmath::Vec3f &cameraPosition
+                         , const std::vector<nvmath::Vec4f> &planes, std::vector<unsigned int> &visible );
+
+//! Append the triangles of the meshlets \a visible to \a indices, as indices into the vertices of the Primitive
+void getMeshletIndices( const MeshletSet &meshlets, const std::vector<unsigned int> &visible, std::vector<unsigned int> &indices );
+} // namespace nvutil
@@ -0,0 +1,35 @@
+/*
+\brief Vectorized evaluation kernels for the rotational surfaces built in MeshGenerator
+*/
+
+#pragma once
+
+#include <nvmath/Vecnt.h>
+
+#include <vector>
+
+namespace nvutil
+{
+//! Sines and cosines of \a count evenly spaced angles, computed once per generator call
+struct RingTable
+{
+    std::vector<float> cosines;
+    std::vector<float> sines;
+    std::vector<float> params;     //!< normalized parameter of each angle, (start + i * step) * paramScale
+};
+
+//! Fill \a table with the sines and cosines of the angles start + i * step, i in [0, count)
+// The per entry parameter is set to ( start + i * step ) * paramScale, e.g. to get texture coordinates along the ring.
+void computeRingTable( unsigned int count, float start, float step, float paramScale, RingTable &table );
+
+/*! Evaluate one row of a rotational surface: out[i] = ( a * cos[i] + b * sin[i], c, d * cos[i] + e * sin[i] ).
+    Vertices, normals, tangents and binormals of spheres, tori and cylinders all follow this pattern with
+    per row constant coefficients. \a out must hold ring.cosines.size() elements. */
+void evaluateRingRow( const RingTable &ring, float a, float b, float c, float d, float e, nvmath::Vec3f *out );
+
+//! Evaluate one row of texture coordinates: out[i] = ( ring.params[i], v )
+void evaluateRingTexCoords( const RingTable &ring, float v, nvmath::Vec2f *out );
+
+//! Returns true if the SSE path of the kernels is compiled in
+bool isRingKernelVectorized();
+} // namespace nvutil
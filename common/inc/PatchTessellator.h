@@ -0,0 +1,57 @@
+/*
+\brief CPU tessellation of the cubic Bezier patches of TriPatches4 and QuadPatches4x4
+*/
+
+#pragma once
+
+#include <nvsg/CoreTypes.h>
+#include <nvmath/Vecnt.h>
+
+#include <vector>
+
+namespace nvutil
+{
+//! Parameters of the CPU tessellation of Bezier patches
+struct PatchTessellationParameters
+{
+    PatchTessellationParameters();
+
+    unsigned int minLevel;          //!< minimal number of segments along a patch edge, default 1
+    unsigned int maxLevel;          //!< maximal number of segments along a patch edge, at most 64, default 32
+    float        tolerance;         //!< tolerated distance between the triangles and the patch in object space, default 0.01
+    bool         multithreaded;     //!< distribute the patches over the cores, default true
+};
+
+/*! Tessellate cubic Bezier triangles into an indexed triangle mesh with vertices and normals.
+    \a controlPoints holds 10 control points per patch in the order of TriPatches4:
+    \code
+      9
+      7 8
+      4 5 6
+      0 1 2 3
+    \endcode
+    Each patch gets its own level between minLevel and maxLevel, estimated from the second differences of its control
+    points such that the triangles stay within \a parameters.tolerance of the patch. The mesh is written in the layout of
+    getMeshFormat, with its bounding box attached as for the drawable generators, see getGeneratedBounds.
+    \remarks Patches sharing an edge but getting different levels show T-junctions along that edge. Set minLevel and
+    maxLevel to the same value to tessellate all patches uniformly. */
+nvsg::PrimitiveSharedPtr tessellateTriPatches4( const std::vector<nvmath::Vec3f> &controlPoints
+                                              , const PatchTessellationParameters &parameters = PatchTessellationParameters() );
+
+/*! Tessellate bicubic Bezier patches into an indexed triangle mesh with vertices and normals.
+    \a controlPoints holds 16 control points per patch in the order of QuadPatches4x4, row by row.
+    \sa tessellateTriPatches4 */
+nvsg::PrimitiveSharedPtr tessellateQuadPatches4x4( const std::vector<nvmath::Vec3f> &controlPoints
+                                                 , const PatchTessellationParameters &parameters = PatchTessellationParameters() );
+
+//! Tessellate the non-indexed patches of \a triPatches, see tessellateTriPatches4
+nvsg::PrimitiveSharedPtr tessellateTriPatches4( const nvsg::TriPatches4SharedPtr &triPatches
+                                              , const PatchTessellationParameters &parameters = PatchTessellationParameters() );
+
+//! Tessellate the non-indexed patches of \a quadPatches, see tessellateQuadPatches4x4
+nvsg::PrimitiveSharedPtr tessellateQuadPatches4x4( const nvsg::QuadPatches4x4SharedPtr &quadPatches
+                                                 , const PatchTessellationParameters &parameters = PatchTessellationParameters() );
+
+//! Returns true if the SSE path of the patch evaluation is compiled in
+bool isPatchTessellatorVectorized();
+} // namespace nvutil
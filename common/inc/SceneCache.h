@@ -0,0 +1,76 @@
+/*
+\brief Binary cache of loaded and optimized scenes, so loadScene can skip the source format's loader
+*/
+
+#pragma once
+
+#include <nvsg/CoreTypes.h>
+
+#include <string>
+#include <vector>
+
+namespace nvutil
+{
+//! Settings of the scene cache used by loadScene and loadSceneAsync, see setSceneCacheParameters
+struct SceneCacheParameters
+{
+    SceneCacheParameters();
+
+    std::string     directory;          //!< where the cache files are written, the cache is off if empty, default empty
+    bool            optimize;           //!< run optimizeScene with the settings below before a scene is cached, default false
+    bool            ignoreNames;        //!< see optimizeScene, default true
+    bool            identityToGroup;    //!< see optimizeScene, default true
+    unsigned int    combineFlags;       //!< see optimizeScene, default CombineTraverser::CT_ALL_TARGETS_MASK
+    unsigned int    eliminateFlags;     //!< see optimizeScene, default EliminateTraverser::ET_ALL_TARGETS_MASK
+    unsigned int    unifyFlags;         //!< see optimizeScene, default UnifyTraverser::UT_ALL_TARGETS_MASK
+    float           epsilon;            //!< see optimizeScene, default FLT_EPSILON
+};
+
+//! Counters of the scene cache
+struct SceneCacheStatistics
+{
+    SceneCacheStatistics();
+
+    unsigned int    hits;               //!< number of scenes loaded from the cache
+    unsigned int    misses;             //!< number of scenes without a cache file, loaded from their source
+    unsigned int    stores;             //!< number of cache files written
+    unsigned int    failures;           //!< number of cache files that could not be read or written
+    double          hashSeconds;        //!< time spent hashing the source files
+    double          loadSeconds;        //!< time spent loading cache files
+    double          storeSeconds;       //!< time spent optimizing and writing cache files
+};
+
+/*! Set the scene cache used by all following calls of loadScene and loadSceneAsync. A scene loaded from its source
+    file is optimized as requested by \a parameters and written as NBF file to \a parameters.directory. Its name is
+    the SHA-1 of the content of the source file, its extension, the optimizer settings, and the name, size and
+    modification time of its dependencies: the files in its directory with its base name, like the .mtl of an .obj,
+    the files in its directory it names, and the plug-ins next to the executable. So changing the source file, one of
+    these dependencies, a loader plug-in or the settings never hits an old entry. Later loads of the same content read
+    the NBF file, whose SceniX loader maps the file into memory instead of parsing a text format, and skip the
+    optimization.
+    \remarks Files the source references in other directories, e.g. through the search paths, or by names the
+    dependency scan doesn't recognize, like names with blanks, are not part of the name. Clear the cache after changing
+    them. The cache files reference the textures and effects of the source by name, so they are still found through
+    the search paths of the source file. Stale cache files are never deleted, clear the directory by hand. */
+void setSceneCacheParameters( const SceneCacheParameters &parameters );
+SceneCacheParameters getSceneCacheParameters();
+
+/*! Get the cache file of \a filename for \a parameters, an empty string if the cache is off, \a filename can't
+    be read, or is an NBF file itself, which is loaded as it is. This reads and hashes the whole file and lists its
+    directory. */
+std::string getSceneCacheFile( const std::string &filename, const SceneCacheParameters &parameters );
+
+/*! Load \a cacheFile as returned by getSceneCacheFile, using \a searchPaths for the resources of the scene.
+    \return The ViewState of the cached scene, a null pointer if \a cacheFile is empty or doesn't exist. */
+nvsg::ViewStateSharedPtr loadCachedScene( const std::string &cacheFile, const std::vector<std::string> &searchPaths );
+
+/*! Optimize the scene of \a viewState as requested by \a parameters and write it to \a cacheFile. The file is
+    written under a temporary name and then renamed, so concurrent loads never see a partial file.
+    \remarks The scene is optimized in place, not as a copy, so \a viewState holds the optimized scene afterwards, the
+    same scene a later load of \a cacheFile returns. loadScene hands it on to its caller like that.
+    \return true if the cache file was written. */
+bool storeCachedScene( const std::string &cacheFile, const nvsg::ViewStateSharedPtr &viewState
+                     , const SceneCacheParameters &parameters );
+
+SceneCacheStatistics getSceneCacheStatistics();
+} // namespace nvutil
@@ -14,19 +14,102 @@
 
 #include <nvsg/CoreTypes.h>
 #include <nvtraverser/RayIntersectTraverser.h>
+#include <nvutil/PlugInCallback.h>
+#include <nvutil/SmartPtr.h>
+
+class QMutex;
 
 namespace nvutil
 {
+class PlugIn;
+
 /*! \brief Load a scene, internally doing all the SceneLoader handling.
    *  \param filename The name of the file to load.
    *  \param searchPaths Optional array of search paths to find the file to load.
    *  \param callback Optional pointer to a callback used by the loader for the file to load.
    *  \return A ViewState containing loaded scene on success and a nullptr ViewState otherwise.
+   *  \remarks If the scene cache is on, the scene is read from its cache file if there is one, and written to it
+   *  otherwise, see setSceneCacheParameters. If the cache optimizes, the scene is optimized in place before it is
+   *  written, so the returned scene is the optimized one on the first load as well as on the cached loads.
    *  \sa saveScene */
 nvsg::ViewStateSharedPtr loadScene( const std::string & filename
                                     , const std::vector<std::string> &searchPaths = std::vector<std::string>()
         , PlugInCallback *callback = 0 );
 
+class SceneLoadCallback;
+
+/*! \brief A scene loaded on a worker thread, see loadSceneAsync.
+   *  \remarks The SceneLoader plug-ins don't report their progress while reading a file, so the progress advances
+   *  with the stages of the load, and a cancel takes effect between them. A load canceled while the SceneLoader reads
+   *  the file runs to its end, then the scene is dropped. Deleting the SceneLoad cancels it and waits for the worker
+   *  thread. All functions can be called from any thread. */
+class SceneLoad
+{
+public:
+    enum Stage
+    {
+        STAGE_QUEUED,           //!< waiting for a worker thread
+        STAGE_FINDING_LOADER,   //!< looking for the SceneLoader plug-in of the file extension
+        STAGE_LOADING,          //!< the SceneLoader reads the file
+        STAGE_FINISHED,         //!< the ViewState of the scene is available
+        STAGE_FAILED,           //!< there is no SceneLoader for the file, or it failed to load it
+        STAGE_CANCELED          //!< canceled before the load finished
+    };
+
+    ~SceneLoad();
+
+    Stage getStage() const;
+
+    //! The fraction of the load done, from 0 to 1
+    float getProgress() const;
+
+    //! Returns true if the load is finished, failed or canceled
+    bool isDone() const;
+
+    void cancel();
+
+    //! Block until the worker thread is done
+    void wait();
+
+    //! The loaded ViewState, a nullptr ViewState unless the stage is STAGE_FINISHED
+    nvsg::ViewStateSharedPtr getViewState() const;
+
+    //! The state shared with the worker thread
+    struct Data;
+
+private:
+    explicit SceneLoad( Data *data );
+    SceneLoad( const SceneLoad & );
+    SceneLoad & operator=( const SceneLoad & );
+
+    friend SceneLoad * loadSceneAsync( const std::string &, const std::vector<std::string> &, SceneLoadCallback * );
+
+private:
+    Data *m_data;
+};
+
+/*! \brief The PlugInCallback of loadSceneAsync, which also gets the progress of the load.
+   *  It is passed on to the SceneLoader, so it gets the errors and warnings of the loader as well.
+   *  \remarks All functions are called on the worker thread. */
+class SceneLoadCallback : public PlugInCallback
+{
+public:
+    //! Called when the load enters \a stage, with the fraction of the load done
+    virtual void onSceneLoadProgress( SceneLoad::Stage stage, float progress ) {}
+};
+
+/*! \brief Load a scene like loadScene, but on a worker thread.
+   *  \param filename The name of the file to load.
+   *  \param searchPaths Optional array of search paths to find the file to load.
+   *  \param callback Optional pointer to a callback that gets the progress and the messages of the loader. It has to
+   *  live until the SceneLoad is deleted.
+   *  \return The SceneLoad to poll for the ViewState, to be deleted by the caller.
+   *  \remarks Like with loadScene, a scene written to an optimizing scene cache is the optimized one.
+   *  \sa loadScene */
+SceneLoad * loadSceneAsync( const std::string & filename
+                            , const std::vector<std::string> &searchPaths = std::vector<std::string>()
+                            , SceneLoadCallback *callback = 0 );
+
 /*! \brief Save a scene, internally doing all the SceneSaver handling.
    *  \param filename The name of the file to save to.
    *  \param viewState The view state (holding the scene) to save.
@@ -110,4 +193,72 @@ bool saveTextureHost( const std::string & filename, const nvsg::TextureHostShare
    */
 bool loadTextureHost( const std::string & filename, nvsg::TextureHostSharedPtr & tih
                       , const std::vector<std::string> &searchPaths = std::vector<std::string>() );
+
+/*! \brief Statistics of the plug-in registry, see PlugInLock */
+struct PlugInRegistryStatistics
+{
+    PlugInRegistryStatistics();
+
+    unsigned int lookups;       //!< number of PlugInLocks created
+    unsigned int probes;        //!< number of searches through the file system, one per new extension and type, per miss searched in new paths, plus the rescans
+    unsigned int failures;      //!< number of probes without a plug-in
+    unsigned int rescans;       //!< number of calls of rescanPlugInInterfaces
+    unsigned int entries;       //!< number of extension and type pairs in the registry, including the ones without plug-in
+    double       probeSeconds;  //!< time spent in the probes
+};
+
+/*! \brief A plug-in interface of the process-wide plug-in registry, locked while the PlugInLock lives.
+   *  \remarks The registry searches the current directory and the directory of the executable, plus the search
+   *  paths, once per extension and type, and keeps the interface found until rescanPlugInInterfaces. A miss is kept
+   *  with the paths searched, a later lookup searches only the paths of its search paths not searched before.
+   *  The interface of an extension and type is shared by all threads, and a loader or saver must not be used by two
+   *  threads at the same time. So a PlugInLock holds the lock of the extension and type, and a reference that keeps
+   *  the interface alive through rescanPlugInInterfaces and releasePlugInInterfaces. The locks live as long as the
+   *  process. loadScene, loadSceneAsync, saveScene, loadTextureHost and saveTextureHost use their plug-ins this way,
+   *  and the texture decodes of createTextureFromFile and createTexturesFromFiles hold the lock of the texture loader
+   *  of the extension.
+   *  \sa hasPlugInInterface, rescanPlugInInterfaces, getPlugInRegistryStatistics */
+class PlugInLock
+{
+public:
+    /*! \brief Look up and lock the plug-in interface for the extension of \a filename.
+       *  \param filename A file name or just an extension, like "mono.png" or ".png"; only its extension is used.
+       *  \param pitType The plug-in interface type, UPITID_SCENE_LOADER, UPITID_SCENE_SAVER, UPITID_TEXTURE_LOADER or
+       *  UPITID_TEXTURE_SAVER.
+       *  \param searchPaths Additional paths to search for the plug-in, used when the extension and type are new, or
+       *  have no plug-in yet and some of these paths haven't been searched for them.
+       *  \param lock If \c false, the interface is only looked up, for plug-ins known to be reentrant.
+       *  \remarks This waits until no other PlugInLock holds the lock of the extension and type. */
+    PlugInLock( const std::string & filename, unsigned int pitType
+              , const std::vector<std::string> &searchPaths = std::vector<std::string>(), bool lock = true );
+    ~PlugInLock();
+
+    //! The plug-in interface, or a null pointer if there is none
+    PlugIn * get() const;
+
+private:
+    PlugInLock( const PlugInLock & );
+    PlugInLock & operator=( const PlugInLock & );
+
+private:
+    SmartPtr<PlugIn>  m_reference;  // keeps m_plugIn alive while the registry replaces or releases it
+    PlugIn           *m_plugIn;
+    QMutex           *m_mutex;
+};
+
+/*! \brief Check if the plug-in registry has an interface for the extension of \a filename and \a pitType, looking
+   *  it up like PlugInLock, but without taking its lock. */
+bool hasPlugInInterface( const std::string & filename, unsigned int pitType
+                       , const std::vector<std::string> &searchPaths = std::vector<std::string>() );
+
+/*! \brief Search all plug-ins of the registry again, for example after plug-ins were installed or the current
+   *  directory changed. The interfaces replaced are released when the last PlugInLock using them is gone. */
+void rescanPlugInInterfaces();
+
+/*! \brief Empty the plug-in registry and release its interfaces. Call it before nvsgTerminate, when no PlugInLock
+   *  lives anymore. */
+void releasePlugInInterfaces();
+
+/*! \brief Get the counters of the plug-in registry. */
+PlugInRegistryStatistics getPlugInRegistryStatistics();
 } // namespace nvutil
@@ -0,0 +1,94 @@
+/*
+\brief Out-of-core paging of the large subtrees of a scene, for scenes that don't fit into memory at once
+*/
+
+#pragma once
+
+#include <nvsg/CoreTypes.h>
+
+#include <string>
+
+namespace nvutil
+{
+//! Parameters of splitScene
+struct SceneSplitParameters
+{
+    SceneSplitParameters();
+
+    size_t minChunkBytes;           //!< subtrees with less vertex and index data stay in the skeleton, default 1 MB
+    size_t maxChunkBytes;           //!< Groups with more are split into their children instead, default 64 MB
+};
+
+/*! Move the large subtrees of the scene of \a viewState into chunk files in \a directory, so a ScenePager can load
+    them on demand. Each child of a Group or Transform with at least \a parameters.minChunkBytes of vertex and index
+    data is saved as NBF file of its own and replaced by an empty Group named after that file, its placeholder. Groups
+    with more than \a parameters.maxChunkBytes are split further. The children of Switches and LODs stay as they are.
+    A subtree instanced below several Groups is saved once, each of its instances gets a placeholder named after that
+    one file. A subtree sharing nodes or drawables with the rest of the scene stays in the skeleton, it would be
+    resident twice while loaded. The remaining scene, the skeleton, is saved to getPagedSceneFile( \a directory ), and
+    the world space bounding sphere and data size of each chunk to an index file next to it, headed by the size,
+    modification time and path of \a sourceFile, so later runs can load the skeleton instead of the whole scene if
+    isPagedSceneOf says it still matches. The chunk files of an earlier split into \a directory are removed.
+    \remarks StateSets shared between chunks are saved with each of them.
+    \return The number of chunks written. */
+unsigned int splitScene( const nvsg::ViewStateSharedPtr &viewState, const std::string &directory, const std::string &sourceFile
+                       , const SceneSplitParameters &parameters = SceneSplitParameters() );
+
+/*! Get the name of the skeleton file written by splitScene to \a directory
+    \remarks NBF files bypass the scene cache, see getSceneCacheFile, so loading the skeleton with loadSceneAsync
+    doesn't optimize its placeholders away. */
+std::string getPagedSceneFile( const std::string &directory );
+
+//! Check if \a directory holds a complete split of \a sourceFile, in its current version
+bool isPagedSceneOf( const std::string &directory, const std::string &sourceFile );
+
+/*! \brief Load and evict the chunks of a scene split by splitScene.
+ *  A pager thread loads the chunks requested by update and hands them back to it, which hangs them below their
+ *  placeholders. The chunks are requested by their size on the screen, largest first, as far as they fit into the
+ *  memory budget. Chunks smaller than the minimal screen size are not requested. Resident chunks that are not
+ *  requested anymore are evicted when the budget is exceeded, smallest on the screen first.
+ *  \remarks Only update modifies the scene, call it from the thread rendering it. The bounds of the chunks come from
+ *  the index file, the skeleton doesn't know them. */
+class ScenePager
+{
+public:
+    struct Statistics
+    {
+        unsigned int chunks;            //!< number of chunks of the scene
+        unsigned int residentChunks;    //!< number of chunks currently below their placeholders
+        size_t       residentBytes;     //!< vertex and index bytes of the resident chunks
+        unsigned int pageIns;           //!< number of chunks loaded and attached
+        unsigned int evictions;         //!< number of chunks detached to stay within the budget
+        unsigned int stalls;            //!< number of times update wanted a chunk not resident, once per chunk until it's attached
+        unsigned int failures;          //!< number of chunk files that could not be loaded
+    };
+
+public:
+    /*! Page the chunks written by splitScene to \a directory into the scene of \a viewState, which has to be the
+        skeleton, as left by splitScene or loaded from getPagedSceneFile( \a directory ). */
+    ScenePager( const nvsg::ViewStateSharedPtr &viewState, const std::string &directory, size_t maxResidentBytes = 512 * 1024 * 1024 );
+
+    //! Stop the pager thread, the resident chunks stay in the scene
+    ~ScenePager();
+
+    //! Set the memory budget for the vertex and index data of the resident chunks
+    void setMaximumResidentBytes( size_t maxResidentBytes );
+    size_t getMaximumResidentBytes() const;
+
+    //! Set the size in pixels of the bounding sphere of a chunk on the screen below which it is not loaded, default 8
+    void setMinimumScreenSize( float pixels );
+    float getMinimumScreenSize() const;
+
+    /*! Request the chunks for the camera of the ViewState seen in a viewport \a viewportHeight pixels high, attach
+        the chunks loaded meanwhile and evict chunks over budget.
+        \return true if the scene changed. */
+    bool update( unsigned int viewportHeight );
+
+    Statistics getStatistics() const;
+
+    struct Data;
+
+private:
+    Data *m_data;
+};
+} // namespace nvutil
@@ -0,0 +1,52 @@
+/*
+\brief Pack the small textures of a scene into shared atlas pages to reduce texture binds
+*/
+
+#pragma once
+
+#include <nvsg/CoreTypes.h>
+
+namespace nvutil
+{
+//! Parameters of buildTextureAtlas
+struct TextureAtlasParameters
+{
+    TextureAtlasParameters();
+
+    unsigned int maxTextureSize;    //!< only textures with width and height up to this size are packed, default 256
+    unsigned int pageSize;          //!< width and height of the atlas pages, a power of two, default 2048
+    unsigned int padding;           //!< texels repeated around each texture against filter bleeding, default 4
+    bool         mipmaps;           //!< pack the textures with a mipmapping min filter too, their pages get a mip chain, default true
+};
+
+//! What buildTextureAtlas did to a scene
+struct TextureAtlasStatistics
+{
+    TextureAtlasStatistics();
+
+    unsigned int packedTextures;    //!< number of textures moved into the atlas
+    unsigned int pages;             //!< number of atlas pages created
+    unsigned int texturesBefore;    //!< number of different TextureAttributes used by the scene before
+    unsigned int texturesAfter;     //!< number of different TextureAttributes used by the scene after
+    unsigned int stateSetsBefore;   //!< number of different StateSets with a TextureAttribute before, each one is a texture bind per frame
+    unsigned int stateSetsAfter;    //!< number of different StateSets with a TextureAttribute after
+};
+
+/*! Pack the small 2D textures of \a scene into atlas pages of 8-bit RGBA texels and rewrite the texture coordinates
+    of the drawables using them. A texture is packed if its StateSets bind nothing but it, on unit 0, it has 8-bit
+    texels and is not larger than \a parameters.maxTextureSize, and all drawables using it are Primitives with two
+    float texture coordinates 0 inside [0,1], whose VertexAttributeSets are used nowhere else in the scene, neither
+    with other textures nor without an atlas texture. VertexAttributeSets shared with other scenes must not be used
+    with packable textures, their texture coordinates are rewritten in place.
+    The TextureAttributes of the packed StateSets are replaced by the one of their page, then equivalent state
+    attributes and StateSets are unified, ignoring their names, so the CombineTraverser of optimizeScene can merge
+    their GeoNodes. No other objects of the scene are unified.
+    Each page holds textures of one filter and environment mode and uses them. Textures that wrap other than by
+    repeating or clamping to the edge, or blend with the environment color, stay as they are. Each texture is surrounded
+    by \a parameters.padding texels that repeat it or its border texels, as its wrap modes do, and the textures are
+    aligned to the padding rounded up to a power of two. The mip chain of a page ends at level log2 of that size, the
+    deeper levels would mix neighboring textures, so mipmapped textures are packed only with a padding of at least 2.
+    \return true if any texture was packed. */
+bool buildTextureAtlas( const nvsg::SceneSharedPtr &scene, TextureAtlasStatistics &statistics
+                      , const TextureAtlasParameters &parameters = TextureAtlasParameters() );
+} // namespace nvutil
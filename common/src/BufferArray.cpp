@@ -0,0 +1,163 @@
+#include "BufferArray.h"
+
+#include <nvsg/IndexSet.h>
+#include <nvsg/Primitive.h>
+#include <nvsg/VertexAttributeSet.h>
+#include <nvmath/nvmath.h>
+
+#include <math.h>
+
+#include "nvutil/DbgNew.h" // this must be the last include
+
+using namespace nvmath;
+using namespace nvsg;
+
+namespace nvutil
+{
+size_t getTypeSize( unsigned int dataType )
+{
+    switch( dataType )
+    {
+    case NVSG_BYTE:
+    case NVSG_UNSIGNED_BYTE:
+        return 1;
+    case NVSG_SHORT:
+    case NVSG_UNSIGNED_SHORT:
+    case NVSG_HALF:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+// ===========================================================================
+
+size_t getDrawableDataSize( const DrawableSharedPtr &drawable )
+{
+    size_t bytes = 0;
+    if ( drawable && isPtrTo<Primitive>( drawable ) )
+    {
+        PrimitiveReadLock primitive( sharedPtr_cast<Primitive>( drawable ) );
+        if ( primitive->getVertexAttributeSet() )
+        {
+            VertexAttributeSetReadLock vas( primitive->getVertexAttributeSet() );
+            for ( unsigned int i = 0; i < VertexAttributeSet::NVSG_VERTEX_ATTRIB_COUNT; ++i )
+            {
+                // don't use the stride, interleaved attributes share it
+                bytes += vas->getNumberOfVertexData( i ) * vas->getSizeOfVertexData( i ) * getTypeSize( vas->getTypeOfVertexData( i ) );
+            }
+        }
+        if ( primitive->getIndexSet() )
+        {
+            IndexSetReadLock indexSet( primitive->getIndexSet() );
+            bytes += indexSet->getNumberOfIndices() * getTypeSize( indexSet->getIndexDataType() );
+        }
+    }
+    return bytes;
+}
+
+// ===========================================================================
+
+unsigned short floatToHalf( float f )
+{
+    union
+    {
+        float        f;
+        unsigned int u;
+    } bits;
+    bits.f = f;
+
+    unsigned int sign = ( bits.u >> 16 ) & 0x8000;
+    int exponent = (int)( ( bits.u >> 23 ) & 0xff ) - 127 + 15;
+    unsigned int mantissa = bits.u & 0x007fffff;
+
+    if ( exponent <= 0 )
+    {
+        // too small for a normalized half, denormalize or flush to zero
+        if ( exponent < -10 )
+        {
+            return( (unsigned short)sign );
+        }
+        mantissa = ( mantissa | 0x00800000 ) >> ( 1 - exponent );
+        return( (unsigned short)( sign | ( ( mantissa + 0x00001000 ) >> 13 ) ) );
+    }
+    if ( 31 <= exponent )
+    {
+        // overflow, infinity or NaN
+        bool nan = ( ( bits.u & 0x7f800000 ) == 0x7f800000 ) && mantissa;
+        return( (unsigned short)( sign | 0x7c00 | ( nan ? 0x0200 : 0 ) ) );
+    }
+
+    // a carry out of the mantissa correctly increments the exponent
+    unsigned int half = sign | ( exponent << 10 ) | ( mantissa >> 13 );
+    half += ( mantissa >> 12 ) & 1;
+    return( (unsigned short)half );
+}
+
+// ===========================================================================
+
+void encodeOctahedral( const float *n, short *out )
+{
+    float l1 = fabsf( n[0] ) + fabsf( n[1] ) + fabsf( n[2] );
+    float x = ( 0.0f < l1 ) ? n[0] / l1 : 0.0f;
+    float y = ( 0.0f < l1 ) ? n[1] / l1 : 0.0f;
+    if ( n[2] < 0.0f )
+    {
+        // fold the lower hemisphere over the diagonals
+        float fx = ( 1.0f - fabsf( y ) ) * ( ( 0.0f <= x ) ? 1.0f : -1.0f );
+        float fy = ( 1.0f - fabsf( x ) ) * ( ( 0.0f <= y ) ? 1.0f : -1.0f );
+        x = fx;
+        y = fy;
+    }
+    out[0] = (short)floorf( clamp( x, -1.0f, 1.0f ) * 32767.0f + 0.5f );
+    out[1] = (short)floorf( clamp( y, -1.0f, 1.0f ) * 32767.0f + 0.5f );
+}
+
+// ===========================================================================
+
+AttributeLayout getAttributeLayout( unsigned int attrib, unsigned int size, unsigned int format )
+{
+    AttributeLayout layout;
+    layout.attrib = attrib;
+    layout.size = size;
+    layout.type = NVSG_FLOAT;
+    layout.normalized = false;
+
+    if ( ( format & MESH_FORMAT_OCTAHEDRAL_NORMALS ) && ( attrib == VertexAttributeSet::NVSG_NORMAL ) && ( size == 3 ) )
+    {
+        layout.size = 2;
+        layout.type = NVSG_SHORT;
+        layout.normalized = true;
+    }
+    else if (    ( format & MESH_FORMAT_HALF_TEXCOORDS )
+              && ( VertexAttributeSet::NVSG_TEXCOORD0 <= attrib ) && ( attrib <= VertexAttributeSet::NVSG_TEXCOORD7 )
+              && ( attrib != VertexAttributeSet::NVSG_TANGENT ) && ( attrib != VertexAttributeSet::NVSG_BINORMAL ) )
+    {
+        layout.type = NVSG_HALF;
+    }
+
+    layout.bytes = ( layout.size * checked_cast<unsigned int>( getTypeSize( layout.type ) ) + 3 ) & ~3;
+    return( layout );
+}
+
+// ===========================================================================
+
+void encodeAttribute( const AttributeLayout &layout, unsigned int srcSize, const float *value, char *dst )
+{
+    switch( layout.type )
+    {
+    case NVSG_SHORT:
+        encodeOctahedral( value, reinterpret_cast<short *>( dst ) );
+        break;
+    case NVSG_HALF:
+        for ( unsigned int c = 0; c < srcSize; ++c )
+        {
+            reinterpret_cast<unsigned short *>( dst )[c] = floatToHalf( value[c] );
+        }
+        break;
+    default:
+        memcpy( dst, value, srcSize * sizeof(float) );
+        break;
+    }
+}
+} // namespace nvutil
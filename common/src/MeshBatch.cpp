@@ -0,0 +1,248 @@
+#include "MeshBatch.h"
+#include "MeshGenerator.h"
+
+#include <nvsg/GeoNode.h>
+#include <nvsg/Group.h>
+#include <nvsg/Transform.h>
+#include <nvutil/Tools.h>
+
+#include <QtCore/QThread>
+#include <QtCore/QtConcurrentMap>
+
+#include <algorithm>
+
+#include "nvutil/DbgNew.h" // this must be the last include
+
+using namespace nvmath;
+using namespace nvsg;
+using namespace std;
+
+namespace nvutil
+{
+namespace
+{
+//! A range of specs handled by one task, writing to the corresponding range of the results
+struct MeshJob
+{
+    const MeshSpec    *specs;
+    unsigned int       begin;
+    unsigned int       end;
+    DrawableSharedPtr *drawables;
+    NodeSharedPtr     *nodes;       // 0 if only the drawables are requested
+};
+
+//! Helper function to run the generator of \a spec
+DrawableSharedPtr createSpecDrawable( const MeshSpec &spec )
+{
+    switch( spec.generator )
+    {
+    case MeshSpec::MESH_SPHERE:
+        return( createSphere( spec.counts[0], spec.counts[1], spec.params[0] ) );
+    case MeshSpec::MESH_ICOSPHERE:
+        return( createIcoSphere( spec.counts[0], spec.params[0] ) );
+    case MeshSpec::MESH_CYLINDER:
+        return( createCylinder( spec.params[0], spec.params[1], spec.counts[0], spec.counts[1], spec.outer, spec.params[2], spec.params[3] ) );
+    case MeshSpec::MESH_TORUS:
+        return( createTorus( spec.counts[0], spec.counts[1], spec.params[0], spec.params[1] ) );
+    case MeshSpec::MESH_TESSELLATED_PLANE:
+        return( createTessellatedPlane( spec.counts[0] ) );
+    case MeshSpec::MESH_TESSELLATED_BOX:
+        return( createTessellatedBox( spec.counts[0] ) );
+    case MeshSpec::MESH_QUAD_SET:
+        return( createQuadSet( spec.counts[0], spec.counts[1], spec.params[0], spec.params[1] ) );
+    case MeshSpec::MESH_TRI_SET:
+        return( createTriSet( spec.counts[0], spec.counts[1], spec.params[0], spec.params[1] ) );
+    default:
+        NVSG_ASSERT( !"createSpecDrawable(): unknown generator" );
+        return( DrawableSharedPtr() );
+    }
+}
+
+//! Helper function to generate the drawables, and the nodes if requested, of the specs of \a job
+void runMeshJob( const MeshJob &job )
+{
+    for ( unsigned int i = job.begin; i < job.end; ++i )
+    {
+        job.drawables[i] = createSpecDrawable( job.specs[i] );
+        if ( job.nodes )
+        {
+            const MeshSpec &spec = job.specs[i];
+            GeoNodeSharedPtr geoNode = createGeoNode( job.drawables[i], spec.stateSet );
+            if ( spec.transform )
+            {
+                job.nodes[i] = createTransform( geoNode, spec.translation, spec.orientation, spec.scaling );
+            }
+            else
+            {
+                job.nodes[i] = geoNode;
+            }
+        }
+    }
+}
+
+//! Helper function to run the specs on the global QThreadPool, or on the calling thread
+void runMeshBatch( const vector<MeshSpec> &specs, DrawableSharedPtr *drawables, NodeSharedPtr *nodes, bool multithreaded )
+{
+    if ( specs.empty() )
+    {
+        return;
+    }
+
+    // The costs of the specs differ a lot, several ranges per thread keep all threads busy until the end
+    unsigned int count = checked_cast<unsigned int>( specs.size() );
+    unsigned int threads = multithreaded ? (unsigned int)std::max( QThread::idealThreadCount(), 1 ) : 1;
+    unsigned int rangeSize = std::max( 1u, count / ( 8 * threads ) );
+
+    vector<MeshJob> jobs;
+    for ( unsigned int begin = 0; begin < count; begin += rangeSize )
+    {
+        MeshJob job;
+        job.specs = &specs[0];
+        job.begin = begin;
+        job.end = std::min( begin + rangeSize, count );
+        job.drawables = drawables;
+        job.nodes = nodes;
+        jobs.push_back( job );
+    }
+
+    if ( multithreaded && ( 1 < jobs.size() ) )
+    {
+        QtConcurrent::blockingMap( jobs, &runMeshJob );
+    }
+    else
+    {
+        for ( size_t i = 0; i < jobs.size(); ++i )
+        {
+            runMeshJob( jobs[i] );
+        }
+    }
+}
+}
+
+MeshSpec::MeshSpec()
+    : generator( MESH_SPHERE )
+    , outer( true )
+    , transform( false )
+    , translation( 0.0f, 0.0f, 0.0f )
+    , orientation( Vec3f( 0.0f, 1.0f, 0.0f ), 0.0f )
+    , scaling( 1.0f, 1.0f, 1.0f )
+{
+    counts[0] = counts[1] = 0;
+    params[0] = params[1] = params[2] = params[3] = 0.0f;
+}
+
+MeshSpec MeshSpec::sphere( unsigned int m, unsigned int n, float radius )
+{
+    MeshSpec spec;
+    spec.generator = MESH_SPHERE;
+    spec.counts[0] = m;
+    spec.counts[1] = n;
+    spec.params[0] = radius;
+    return( spec );
+}
+
+MeshSpec MeshSpec::icoSphere( unsigned int level, float radius )
+{
+    MeshSpec spec;
+    spec.generator = MESH_ICOSPHERE;
+    spec.counts[0] = level;
+    spec.params[0] = radius;
+    return( spec );
+}
+
+MeshSpec MeshSpec::cylinder( float r, float h, unsigned int hdivs, unsigned int thdivs, bool bOuter, float thstart, float thend )
+{
+    MeshSpec spec;
+    spec.generator = MESH_CYLINDER;
+    spec.counts[0] = hdivs;
+    spec.counts[1] = thdivs;
+    spec.params[0] = r;
+    spec.params[1] = h;
+    spec.params[2] = thstart;
+    spec.params[3] = thend;
+    spec.outer = bOuter;
+    return( spec );
+}
+
+MeshSpec MeshSpec::torus( unsigned int m, unsigned int n, float innerRadius, float outerRadius )
+{
+    MeshSpec spec;
+    spec.generator = MESH_TORUS;
+    spec.counts[0] = m;
+    spec.counts[1] = n;
+    spec.params[0] = innerRadius;
+    spec.params[1] = outerRadius;
+    return( spec );
+}
+
+MeshSpec MeshSpec::tessellatedPlane( unsigned int subdiv )
+{
+    MeshSpec spec;
+    spec.generator = MESH_TESSELLATED_PLANE;
+    spec.counts[0] = subdiv;
+    return( spec );
+}
+
+MeshSpec MeshSpec::tessellatedBox( unsigned int subdiv )
+{
+    MeshSpec spec;
+    spec.generator = MESH_TESSELLATED_BOX;
+    spec.counts[0] = subdiv;
+    return( spec );
+}
+
+MeshSpec MeshSpec::quadSet( unsigned int m, unsigned int n, float size, float gap )
+{
+    MeshSpec spec;
+    spec.generator = MESH_QUAD_SET;
+    spec.counts[0] = m;
+    spec.counts[1] = n;
+    spec.params[0] = size;
+    spec.params[1] = gap;
+    return( spec );
+}
+
+MeshSpec MeshSpec::triSet( unsigned int m, unsigned int n, float size, float gap )
+{
+    MeshSpec spec;
+    spec.generator = MESH_TRI_SET;
+    spec.counts[0] = m;
+    spec.counts[1] = n;
+    spec.params[0] = size;
+    spec.params[1] = gap;
+    return( spec );
+}
+
+// ===========================================================================
+
+void createMeshBatch( const vector<MeshSpec> &specs, vector<DrawableSharedPtr> &drawables, bool multithreaded )
+{
+    drawables.clear();
+    drawables.resize( specs.size() );
+    if ( !specs.empty() )
+    {
+        runMeshBatch( specs, &drawables[0], 0, multithreaded );
+    }
+}
+
+// ===========================================================================
+
+void addMeshBatch( const GroupSharedPtr &groupPtr, const vector<MeshSpec> &specs, bool multithreaded )
+{
+    if ( specs.empty() )
+    {
+        return;
+    }
+
+    vector<DrawableSharedPtr> drawables( specs.size() );
+    vector<NodeSharedPtr> nodes( specs.size() );
+    runMeshBatch( specs, &drawables[0], &nodes[0], multithreaded );
+
+    GroupWriteLock group( groupPtr );
+    for ( size_t i = 0; i < nodes.size(); ++i )
+    {
+        group->addChild( nodes[i] );
+    }
+}
+
+} // namespace nvutil
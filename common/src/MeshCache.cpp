@@ -0,0 +1,327 @@
+#include "MeshCache.h"
+#include "BufferArray.h"
+#include "MeshGenerator.h"
+
+#include <algorithm>
+
+#include <string.h>
+
+#include "nvutil/DbgNew.h" // this must be the last include
+
+using namespace nvmath;
+using namespace nvsg;
+using namespace std;
+
+namespace nvutil
+{
+namespace
+{
+//! Helper function to order the floats \a a and \a b by their bit patterns, so equal means identical and NaNs don't break the ordering
+bool isLessBitPattern( float a, float b )
+{
+    unsigned int aBits, bBits;
+    memcpy( &aBits, &a, sizeof(aBits) );
+    memcpy( &bBits, &b, sizeof(bBits) );
+    return( aBits < bBits );
+}
+}
+
+MeshCache::Key::Key()
+    : format( getMeshFormat() )
+{
+}
+
+bool MeshCache::Key::operator<( const Key &rhs ) const
+{
+    if ( generator != rhs.generator )
+    {
+        return generator < rhs.generator;
+    }
+    if ( format != rhs.format )
+    {
+        return format < rhs.format;
+    }
+    if ( counts != rhs.counts )
+    {
+        return counts < rhs.counts;
+    }
+    return std::lexicographical_compare( params.begin(), params.end(), rhs.params.begin(), rhs.params.end(), &isLessBitPattern );
+}
+
+MeshCache::MeshCache( size_t maxBytes, unsigned int maxEntries )
+    : m_maxBytes( maxBytes )
+    , m_maxEntries( maxEntries )
+{
+    resetStatistics();
+}
+
+MeshCache::~MeshCache()
+{
+}
+
+void MeshCache::setMaximumBytes( size_t maxBytes )
+{
+    m_maxBytes = maxBytes;
+    evict();
+}
+
+void MeshCache::setMaximumEntries( unsigned int maxEntries )
+{
+    m_maxEntries = maxEntries;
+    evict();
+}
+
+void MeshCache::purge()
+{
+    m_entries.clear();
+    m_lru.clear();
+    m_statistics.entries = 0;
+    m_statistics.bytes = 0;
+}
+
+void MeshCache::resetStatistics()
+{
+    m_statistics.hits = 0;
+    m_statistics.misses = 0;
+    m_statistics.evictions = 0;
+    m_statistics.entries = checked_cast<unsigned int>( m_entries.size() );
+
+    m_statistics.bytes = 0;
+    for ( EntryMap::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it )
+    {
+        m_statistics.bytes += it->second.bytes;
+    }
+}
+
+DrawableSharedPtr MeshCache::find( const Key &key )
+{
+    EntryMap::iterator it = m_entries.find( key );
+    if ( it == m_entries.end() )
+    {
+        m_statistics.misses++;
+        return DrawableSharedPtr();
+    }
+
+    // move to the front of the LRU list
+    m_lru.splice( m_lru.begin(), m_lru, it->second.lru );
+    m_statistics.hits++;
+    return it->second.drawable;
+}
+
+DrawableSharedPtr MeshCache::insert( const Key &key, const DrawableSharedPtr &drawable )
+{
+    NVSG_ASSERT( m_entries.find( key ) == m_entries.end() );
+
+    Entry entry;
+    entry.drawable = drawable;
+    entry.bytes = getDrawableDataSize( drawable );
+    entry.lru = m_lru.insert( m_lru.begin(), key );
+    m_entries[key] = entry;
+
+    m_statistics.entries++;
+    m_statistics.bytes += entry.bytes;
+
+    evict();
+    return drawable;
+}
+
+void MeshCache::evict()
+{
+    // Never evict the most recently used entry, it has just been handed out
+    while ( ( 1 < m_lru.size() ) && ( ( m_maxBytes < m_statistics.bytes ) || ( m_maxEntries < m_lru.size() ) ) )
+    {
+        EntryMap::iterator it = m_entries.find( m_lru.back() );
+        NVSG_ASSERT( it != m_entries.end() );
+
+        m_statistics.bytes -= it->second.bytes;
+        m_statistics.entries--;
+        m_statistics.evictions++;
+
+        m_entries.erase( it );
+        m_lru.pop_back();
+    }
+}
+
+// ===========================================================================
+
+// Look up the key, and on a miss call the generator with the format of the key and insert its result
+#define MESHCACHE_LOOKUP( GENERATOR_CALL )                  \
+    DrawableSharedPtr drawable = find( key );               \
+    if ( !drawable )                                        \
+    {                                                       \
+        ScopedMeshFormat keyFormat( key.format );           \
+        drawable = insert( key, nvutil::GENERATOR_CALL );   \
+    }                                                       \
+    return drawable;
+
+DrawableSharedPtr MeshCache::createQuadSet( unsigned int m, unsigned int n, const float size, const float gap )
+{
+    Key key;
+    key.generator = "QuadSet";
+    key.counts.push_back( m );
+    key.counts.push_back( n );
+    key.params.push_back( size );
+    key.params.push_back( gap );
+    MESHCACHE_LOOKUP( createQuadSet( m, n, size, gap ) );
+}
+
+DrawableSharedPtr MeshCache::createQuadStrip( unsigned int n, float height, float radius )
+{
+    Key key;
+    key.generator = "QuadStrip";
+    key.counts.push_back( n );
+    key.params.push_back( height );
+    key.params.push_back( radius );
+    MESHCACHE_LOOKUP( createQuadStrip( n, height, radius ) );
+}
+
+DrawableSharedPtr MeshCache::createTriSet( unsigned int m, unsigned int n, const float size, const float gap )
+{
+    Key key;
+    key.generator = "TriSet";
+    key.counts.push_back( m );
+    key.counts.push_back( n );
+    key.params.push_back( size );
+    key.params.push_back( gap );
+    MESHCACHE_LOOKUP( createTriSet( m, n, size, gap ) );
+}
+
+DrawableSharedPtr MeshCache::createTriFan( unsigned int n, const float radius, const float elevation )
+{
+    Key key;
+    key.generator = "TriFan";
+    key.counts.push_back( n );
+    key.params.push_back( radius );
+    key.params.push_back( elevation );
+    MESHCACHE_LOOKUP( createTriFan( n, radius, elevation ) );
+}
+
+DrawableSharedPtr MeshCache::createTriStrip( unsigned int rows, unsigned int columns, float width, float height )
+{
+    Key key;
+    key.generator = "TriStrip";
+    key.counts.push_back( rows );
+    key.counts.push_back( columns );
+    key.params.push_back( width );
+    key.params.push_back( height );
+    MESHCACHE_LOOKUP( createTriStrip( rows, columns, width, height ) );
+}
+
+DrawableSharedPtr MeshCache::createCube()
+{
+    Key key;
+    key.generator = "Cube";
+    MESHCACHE_LOOKUP( createCube() );
+}
+
+DrawableSharedPtr MeshCache::createTetrahedron()
+{
+    Key key;
+    key.generator = "Tetrahedron";
+    MESHCACHE_LOOKUP( createTetrahedron() );
+}
+
+DrawableSharedPtr MeshCache::createOctahedron()
+{
+    Key key;
+    key.generator = "Octahedron";
+    MESHCACHE_LOOKUP( createOctahedron() );
+}
+
+DrawableSharedPtr MeshCache::createDodecahedron()
+{
+    Key key;
+    key.generator = "Dodecahedron";
+    MESHCACHE_LOOKUP( createDodecahedron() );
+}
+
+DrawableSharedPtr MeshCache::createIcosahedron()
+{
+    Key key;
+    key.generator = "Icosahedron";
+    MESHCACHE_LOOKUP( createIcosahedron() );
+}
+
+DrawableSharedPtr MeshCache::createIcoSphere( unsigned int level, float radius )
+{
+    Key key;
+    key.generator = "IcoSphere";
+    key.counts.push_back( level );
+    key.params.push_back( radius );
+    MESHCACHE_LOOKUP( createIcoSphere( level, radius ) );
+}
+
+DrawableSharedPtr MeshCache::createSphere( unsigned int m, unsigned int n, float radius )
+{
+    Key key;
+    key.generator = "Sphere";
+    key.counts.push_back( m );
+    key.counts.push_back( n );
+    key.params.push_back( radius );
+    MESHCACHE_LOOKUP( createSphere( m, n, radius ) );
+}
+
+DrawableSharedPtr MeshCache::createCylinder( float r, float h, unsigned int hdivs, unsigned int thdivs, bool bOuter, float thstart, float thend )
+{
+    Key key;
+    key.generator = "Cylinder";
+    key.params.push_back( r );
+    key.params.push_back( h );
+    key.counts.push_back( hdivs );
+    key.counts.push_back( thdivs );
+    key.counts.push_back( bOuter ? 1 : 0 );
+    key.params.push_back( thstart );
+    key.params.push_back( thend );
+    MESHCACHE_LOOKUP( createCylinder( r, h, hdivs, thdivs, bOuter, thstart, thend ) );
+}
+
+DrawableSharedPtr MeshCache::createTorus( unsigned int m, unsigned int n, float innerRadius, float outerRadius )
+{
+    Key key;
+    key.generator = "Torus";
+    key.counts.push_back( m );
+    key.counts.push_back( n );
+    key.params.push_back( innerRadius );
+    key.params.push_back( outerRadius );
+    MESHCACHE_LOOKUP( createTorus( m, n, innerRadius, outerRadius ) );
+}
+
+DrawableSharedPtr MeshCache::createTessellatedPlane( unsigned int subdiv, const Mat44f &transf )
+{
+    Key key;
+    key.generator = "TessellatedPlane";
+    key.counts.push_back( subdiv );
+    for ( unsigned int i = 0; i < 4; ++i )
+    {
+        for ( unsigned int j = 0; j < 4; ++j )
+        {
+            key.params.push_back( transf[i][j] );
+        }
+    }
+    MESHCACHE_LOOKUP( createTessellatedPlane( subdiv, transf ) );
+}
+
+DrawableSharedPtr MeshCache::createPlane( float x0, float y0, float width, float height, float wext, float hext )
+{
+    Key key;
+    key.generator = "Plane";
+    key.params.push_back( x0 );
+    key.params.push_back( y0 );
+    key.params.push_back( width );
+    key.params.push_back( height );
+    key.params.push_back( wext );
+    key.params.push_back( hext );
+    MESHCACHE_LOOKUP( createPlane( x0, y0, width, height, wext, hext ) );
+}
+
+DrawableSharedPtr MeshCache::createTessellatedBox( unsigned int subdiv )
+{
+    Key key;
+    key.generator = "TessellatedBox";
+    key.counts.push_back( subdiv );
+    MESHCACHE_LOOKUP( createTessellatedBox( subdiv ) );
+}
+
+#undef MESHCACHE_LOOKUP
+
+} // namespace nvutil
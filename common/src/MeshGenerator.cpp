@@ -1,20 +1,26 @@
 #include "MeshGenerator.h"
 
 #include <nvmath/nvmath.h>
+#include <nvsg/Buffer.h>
 #include <nvsg/ViewState.h>
 #include <nvsg/Face.h>
 #include <nvsg/FaceAttribute.h>
 #include <nvsg/GeoNode.h>
+#include <nvsg/Group.h>
+#include <nvsg/IndexSet.h>
 #include <nvsg/LOD.h>
 #include <nvsg/Material.h>
 #include <nvsg/Node.h>
 #include <nvsg/PointLight.h>
+#include <nvsg/Primitive.h>
 #include <nvsg/SpotLight.h>
 #include <nvsg/StateSet.h>
 #include <nvsg/Switch.h>
 #include <nvsg/TextureAttribute.h>
+#include <nvsg/TextureHost.h>
 #include <nvsg/Transform.h>
 #include <nvsg/TriPatches4.h>
+#include <nvsg/VertexAttributeSet.h>
 #include <nvsg/QuadPatches4x4.h>
 #include <nvutil/Tools.h>
 #include <nvutil/PlugIn.h>
@@ -22,9 +28,30 @@
 #include <nvsg/PlugInterfaceID.h>
 
 #include "nvsg/DirectedLight.h"
-
+#include "BufferArray.h"
+#include "ParametricKernel.h"
+#include "PatchTessellator.h"
+#include "SceneFunctions.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QThreadStorage>
+#include <QtCore/QtConcurrentMap>
+#include <QtCore/QtConcurrentRun>
+#include <QtGui/QImageReader>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <set>
 #include <vector>
 
+#include <float.h>
+#include <string.h>
+
 #include "nvutil/DbgNew.h" // this must be the last include
 
 using namespace nvmath;
@@ -46,21 +73,76 @@ Vec3f calculateFaceNormal( const Vec3f &a, const Vec3f &b, const Vec3f &c )
     return n;
 }
 
-StateSetSharedPtr createPatchesStateSet( const std::string & tessFile, const std::vector<std::string> & searchPaths )
+//! The 12 vertices of an icosahedron on the unit sphere
+const float icoX = 0.525731112119133606f;
+const float icoZ = 0.850650808352039932f;
+
+const Vec3f icosahedronVertices[12] =
 {
-    // Create the tesselation shader first
-    CgFxSharedPtr tessCgFx = CgFx::create();
+    Vec3f( -icoX , 0.0f ,  icoZ ),
+    Vec3f(  icoX , 0.0f ,  icoZ ),
+    Vec3f( -icoX , 0.0f , -icoZ ),
+    Vec3f(  icoX , 0.0f , -icoZ ),
+    Vec3f( 0.0f ,  icoZ ,  icoX ),
+    Vec3f( 0.0f ,  icoZ , -icoX ),
+    Vec3f( 0.0f , -icoZ ,  icoX ),
+    Vec3f( 0.0f , -icoZ , -icoX ),
+    Vec3f(  icoZ ,  icoX , 0.0f ),
+    Vec3f( -icoZ ,  icoX , 0.0f ),
+    Vec3f(  icoZ , -icoX , 0.0f ),
+    Vec3f( -icoZ , -icoX , 0.0f )
+};
+
+//! The 20 faces of an icosahedron, counter-clockwise seen from outside
+const Face3 icosahedronFaces[20] =
+{
+    { 0,  1,  4}, //  0
+    { 0,  4,  9}, //  1
+    { 0,  9, 11}, //  2
+    { 0,  6,  1}, //  3
+    { 0, 11,  6}, //  4
+    { 1,  6, 10}, //  5
+    { 1, 10,  8}, //  6
+    { 1,  8,  4}, //  7
+    { 2,  3,  7}, //  8
+    { 2,  5,  3}, //  9
+    { 2,  9,  5}, // 10
+    { 2, 11,  9}, // 11
+    { 2,  7, 11}, // 12
+    { 3,  5,  8}, // 13
+    { 3,  8, 10}, // 14
+    { 3, 10,  7}, // 15
+    { 4,  5,  9}, // 16
+    { 4,  8,  5}, // 17
+    { 6,  7, 10}, // 18
+    { 6, 11,  7}  // 19
+};
+
+//! Helper function to get the index of the unit sphere point halfway between the points \a a and \a b.
+// Each edge is split only once, the point is looked up in \a midpoints when the neighboring face asks for it again.
+unsigned int getMidpoint( unsigned int a, unsigned int b,
+                          map< pair<unsigned int, unsigned int>, unsigned int > &midpoints,
+                          vector< Vec3f > &points )
+{
+    pair<unsigned int, unsigned int> edge( std::min( a, b ), std::max( a, b ) );
+    map< pair<unsigned int, unsigned int>, unsigned int >::const_iterator it = midpoints.find( edge );
+    if ( it != midpoints.end() )
     {
-        CgFxEffectWriteLock effect( CgFxReadLock( tessCgFx )->getEffect() );
-        std::string file;
-        std::string err;
-        if (   !FindFileFirst( tessFile, searchPaths, file )
-               || !effect->createFromFile( file, searchPaths, err ) )
-        {
-            return( StateSetSharedPtr() );
-        }
+        return it->second;
     }
 
+    Vec3f m = points[a] + points[b];
+    m.normalize();
+
+    unsigned int index = checked_cast<unsigned int>( points.size() );
+    points.push_back( m );
+    midpoints[edge] = index;
+    return index;
+}
+
+//! Helper function to create the StateSet of the patches, with just the material
+StateSetSharedPtr createPatchesMaterialStateSet()
+{
     // Create a Material
     MaterialSharedPtr material = Material::create();
     {
@@ -73,645 +155,321 @@ StateSetSharedPtr createPatchesStateSet( const std::string & tessFile, const std
         m->setOpacity( 1.0f );
     }
 
-    // Create a StateSet and attach material and shader
+    // Create a StateSet and attach the material
     StateSetSharedPtr stateSet = StateSet::create();
-    {
-        StateSetWriteLock ss( stateSet );
-        ss->addAttribute( material );
-        ss->addAttribute( tessCgFx );
-    }
+    StateSetWriteLock( stateSet )->addAttribute( material );
 
     return( stateSet );
 }
 
-//! Helper function to setup the faces, vertices, normals and texccords of a tessellated plane
-//with \a subdiv subdivisions and a transformation-matrix transf
-void setupTessellatedPlane( unsigned int subdiv, const Mat44f &transf,
-                            vector < Face3 > &faces, vector < Vec3f > &vertices,
-                            vector < Vec3f > &normals, vector < Vec2f > &texcoords,
-                            vector <unsigned int> &indices )
+//! Helper function to create the StateSet of the patches, with the material and the tessellation shader \a tessFile.
+//Returns a null StateSet if the shader can't be found or created.
+StateSetSharedPtr createPatchesStateSet( const std::string & tessFile, const std::vector<std::string> & searchPaths )
 {
-    float step = 2.0f/(float)(subdiv + 1);
-    unsigned int row = subdiv + 2;
-    unsigned int offset = checked_cast<unsigned int>(vertices.size());
-
-
-    // This is expensive do it once outside the loops!
-    Mat44f transfIT;
-    bool validInverse = invert( transf, transfIT );
-    if (validInverse)
-    {
-        transfIT = ~transfIT;
-    }
-
-    float y = -1.0f;
-    for ( unsigned int sY = 0; sY < row; sY++ )
+    // Create the tesselation shader first
+    CgFxSharedPtr tessCgFx = CgFx::create();
     {
-        float x = -1.0f;
-        for ( unsigned int sX = 0; sX < row; sX++ )
+        CgFxEffectWriteLock effect( CgFxReadLock( tessCgFx )->getEffect() );
+        std::string file;
+        std::string err;
+        if (   !FindFileFirst( tessFile, searchPaths, file )
+               || !effect->createFromFile( file, searchPaths, err ) )
         {
-            vertices.push_back( Vec3f(Vec4f( x, y, 0.0f, 1.0f ) * transf ) );
-            Vec3f normal(0.0f, 0.0f, 1.0f); // Initialize to some valid normal in case the transf matrix cannot be inverted.
-            if ( validInverse )
-            {
-                normal = Vec3f(Vec4f( 0.0f, 0.0f, 1.0f, 0.0f) * transfIT);
-                normal.normalize();
-            }
-            normals.push_back( normal );
-            texcoords.push_back( Vec2f( x * 0.5f + 0.5f, y * 0.5f + 0.5f ) );
-            x += step;
+            return( StateSetSharedPtr() );
         }
-        y += step;
     }
 
-    for ( unsigned int sY = 0; sY <= subdiv; sY++ )
-    {
-        for ( unsigned int sX = 0; sX <= subdiv; sX++ )
-        {
-            indices.push_back( offset + sX + sY * row );
-            indices.push_back( offset + sX + 1 + sY * row );
-            indices.push_back( offset + sX + 1 + (sY+1) * row );
+    StateSetSharedPtr stateSet = createPatchesMaterialStateSet();
+    StateSetWriteLock( stateSet )->addAttribute( tessCgFx );
 
-            indices.push_back( offset + sX + 1 + (sY+1) * row );
-            indices.push_back( offset + sX + (sY+1) * row );
-            indices.push_back( offset + sX + sY * row );
+    return( stateSet );
+}
 
-            Face3 f;
+//! The layout of the generated drawables, see setMeshFormat. The generators read it once per call with getMeshFormat,
+//so worker threads of createMeshBatch never see it half way through a change.
+unsigned int meshFormat = MESH_FORMAT_SHORT_INDICES;
+QMutex meshFormatMutex;
 
-            f[0] = offset + sX + sY * row;
-            f[1] = offset + sX + 1 + sY * row;
-            f[2] = offset + sX + 1 + (sY+1) * row;
-            faces.push_back( f );
+//! The format of the innermost ScopedMeshFormat of a thread, returned by getMeshFormat instead of meshFormat
+QThreadStorage<unsigned int *> scopedMeshFormat;
 
-            f[0] = offset + sX + 1 + (sY+1) * row;
-            f[1] = offset + sX + (sY+1) * row;
-            f[2] = offset + sX + sY * row;
-            faces.push_back( f );
-        }
-    }
-}
+//! Helper function to check if the grid generators should write triangle strips in the layout \a format
+bool useTriangleStrips( unsigned int format )
+{
+    return( ( format & MESH_FORMAT_TRIANGLE_STRIPS ) != 0 );
 }
 
-// ===========================================================================
-
-DrawableSharedPtr createQuadSet( unsigned int m, unsigned int n, const float size, const float gap )
+//! Helper function to get the number of indices of \a rows rows of \a columns cells as strips, see setupGridStrips
+unsigned int getGridStripIndexCount( unsigned int columns, unsigned int rows )
 {
-    NVSG_ASSERT( m >= 1 && n >= 1 && "createQuadSet(): m and n both have to be at least 1." );
-
-    // create pointer to return
-    DrawableSharedPtr drawablePtr;
-
-    // setup vertices, normals and faces for n X m tiles
-    vector<Vec3f> vertices;
-    vector<Vec3f> normals;
-    vector<unsigned int> indices;
-    vector<Face4> faces;
-
-    const int size_v = 4 * m * n;
-    vertices.reserve( size_v );
-    normals.reserve( size_v );
-    indices.reserve( size_v );
-    faces.reserve( m * n );
-
-    // lower-left corner of the current tile
-    float dy = 0.0f;
+    return( rows * 2 * ( columns + 1 ) + rows - 1 );
+}
 
-    // n tiles in x-direction
-    for( unsigned int i = 0; i < m; ++i )
+//! Helper function to write \a rows rows of \a columns cells as one triangle strip per row, joined by primitive restart indices,
+//starting at index \a k. The lower left vertex of cell ( x, y ) is offset + x + y * ( columns + 1 ). The triangles have the
+//orientation and the diagonals of the triangle lists of the grid generators.
+void setupGridStrips( unsigned int columns, unsigned int rows, unsigned int offset, MeshIndices &indices, unsigned int k )
+{
+    const unsigned int row = columns + 1;
+    for ( unsigned int y = 0; y < rows; ++y )
     {
-        // reset x-offset
-        float dx = 0.0f;
-
-        // n tiles in x-direction
-        for( unsigned int j = 0; j < n; ++j )
+        if ( y )
         {
-            // add 4 vertices
-            Vec3f a = Vec3f( dx       , dy       ,              0.0f );
-            Vec3f b = Vec3f( dx + size, dy       , (float)j/(float)n );
-            Vec3f c = Vec3f( dx + size, dy + size, (float)j/(float)n );
-            Vec3f d = Vec3f( dx       , dy + size,              0.0f );
-            vertices.push_back( a );
-            vertices.push_back( b );
-            vertices.push_back( c );
-            vertices.push_back( d );
-
-            unsigned int first_index = ( i * n + j ) * 4;
-            Vec3f n = calculateFaceNormal( a, b, d );
-
-            // Setup normals and faces
-            for( unsigned int k = 0; k < 4; ++k )
-            {
-                normals.push_back(n);
-                indices.push_back( first_index + k );
-            }
-
-            dx += size + gap;
+            indices[k++] = primitiveRestartIndex;
         }
-        dy += size + gap;
-    }
-
-    // Create a VertexAttributeSet with vertices and normals
-    VertexAttributeSetSharedPtr vasPtr = VertexAttributeSet::create();
-    {
-        VertexAttributeSetWriteLock vas( vasPtr );
-        vas->setVertices( &vertices[0], size_v );
-        vas->setNormals( &normals[0], size_v );
-    }
-
-    {
-        // Create a PrimitiveSet
-        IndexSetSharedPtr indexSet( IndexSet::create() );
-        IndexSetWriteLock(indexSet)->setData( &indices[0], checked_cast<unsigned int>(indices.size()) );
-
-        PrimitiveSharedPtr primitivePtr = Primitive::create();
+        for ( unsigned int x = 0; x <= columns; ++x )
         {
-            PrimitiveWriteLock primitive(primitivePtr);
-            primitive->setPrimitiveType( PRIMITIVE_QUADS );
-            primitive->setVertexAttributeSet( vasPtr );
-            primitive->setIndexSet( indexSet );
+            indices[k++] = offset + x + ( y + 1 ) * row;    // upper
+            indices[k++] = offset + x + y * row;            // lower
         }
-
-        drawablePtr = primitivePtr;
     }
-
-    return drawablePtr;
 }
 
-// ===========================================================================
-
-DrawableSharedPtr createQuadStrip( unsigned int n, float height, float radius )
+//! The per thread scratch of the rotational surfaces: the ring table, and a row to encode when the stream is not packed floats
+struct RingScratch
 {
-    NVSG_ASSERT( n >= 1 && "createQuadStrip(): n has to be at least 1." );
-
-    // create pointer to return
-    DrawableSharedPtr drawablePtr;
-
-    // setup vertices, normals and indices
-    vector<Vec3f> vertices;
-    vector<Vec3f> normals;
-    vector<unsigned int> indices;
+    RingTable           table;
+    std::vector<Vec3f>  row;
+    std::vector<Vec2f>  texRow;
+};
 
-    const int size_v = 2*(n+1);
-    vertices.reserve( size_v );
-    normals.reserve( size_v );
-    indices.reserve( size_v );
+// The ring scratch, kept per thread so batches of generator calls reuse their allocations
+QThreadStorage<RingScratch *> ringScratch;
 
-    // for n quads, we need 2*(n+1) vertices, so run to including n
-    for( unsigned int i = 0; i <= n; ++i )
+//! Helper function to get the RingScratch of the calling thread
+RingScratch & getRingScratch()
+{
+    if ( !ringScratch.hasLocalData() )
     {
-        float phi = PI * ( 1.0f - (float)i/(float)n );
-        float x = cos(phi);
-        float z = sin(phi);
-        Vec3f v( x, 0.0f, z );
-
-        normals.push_back( v );
-        normals.push_back( v );
-        vertices.push_back( v * radius + Vec3f( 0.0f, height, 0.0f ) );
-        vertices.push_back( v * radius );
-
-        indices.push_back( i * 2 );
-        indices.push_back( i * 2 + 1 );
-
+        ringScratch.setLocalData( new RingScratch );
     }
+    return( *ringScratch.localData() );
+}
 
-    // Create a VertexAttributeSet with vertices and normals
-    VertexAttributeSetSharedPtr vasPtr = VertexAttributeSet::create();
+//! Helper function to get the RingTable scratch of the calling thread
+RingTable & getRingTableScratch()
+{
+    return( getRingScratch().table );
+}
+
+//! Helper function to evaluate one row of a rotational surface into \a out from vertex \a first on, see evaluateRingRow.
+// Packed float streams are written in place by the vectorized kernel, other layouts are encoded from the row scratch.
+void writeRingRow( const RingTable &ring, float a, float b, float c, float d, float e, VertexStream<Vec3f> &out, unsigned int first )
+{
+    Vec3f *dst = out.getPackedValues( first );
+    if ( dst )
     {
-        VertexAttributeSetWriteLock vas(vasPtr);
-        vas->setVertices( &vertices[0], size_v );
-        vas->setNormals( &normals[0], size_v );
+        evaluateRingRow( ring, a, b, c, d, e, dst );
     }
-
+    else
     {
-        // Create a PrimitiveSet
-        IndexSetSharedPtr indexSet( IndexSet::create() );
-        IndexSetWriteLock(indexSet)->setData( &indices[0], checked_cast<unsigned int>(indices.size()) );
-
-        PrimitiveSharedPtr primitivePtr = Primitive::create();
-        {
-            PrimitiveWriteLock primitive(primitivePtr);
-            primitive->setPrimitiveType( PRIMITIVE_QUAD_STRIP );
-            primitive->setVertexAttributeSet( vasPtr );
-            primitive->setIndexSet( indexSet );
-        }
-
-        drawablePtr = primitivePtr;
+        std::vector<Vec3f> &row = getRingScratch().row;
+        row.resize( ring.cosines.size() );
+        evaluateRingRow( ring, a, b, c, d, e, &row[0] );
+        out.writeRow( first, &row[0], checked_cast<unsigned int>( row.size() ) );
     }
-
-    return drawablePtr;
 }
 
-// ===========================================================================
-
-DrawableSharedPtr createTriSet( unsigned int m, unsigned int n, const float size, const float gap )
+//! Helper function to evaluate one row of texture coordinates into \a out from vertex \a first on, see evaluateRingTexCoords
+void writeRingTexCoords( const RingTable &ring, float v, VertexStream<Vec2f> &out, unsigned int first )
 {
-    NVSG_ASSERT( m >= 1 && n >= 1 && "createTriSet(): m and n both have to be at least 1." );
-
-    // create pointer to return
-    DrawableSharedPtr drawablePtr;
-
-    // setup vertices, normals and faces for n X m tiles
-    vector<Vec3f> vertices;
-    vector<Vec3f> normals;
-    vector<unsigned int> indices;
-    vector<Face3> faces;
-
-    const int size_v = 3 * m * n;
-    vertices.reserve( size_v );
-    normals.reserve( size_v );
-    indices.reserve( size_v );
-    faces.reserve( m * n );
-
-    // lower-left corner of the current tile
-    float dy = 0.0f;
-
-    // m tiles in y-direction
-    for( unsigned int i = 0; i < m; ++i )
-    {
-        // reset x-offset
-        float dx = 0.0f;
-
-        // n tiles in x-direction
-        for( unsigned int j = 0; j < n; ++j )
-        {
-            // add 3 vertices
-            Vec3f a = Vec3f( dx       , dy       ,              0.0f );
-            Vec3f b = Vec3f( dx + size, dy       , (float)j/(float)n );
-            Vec3f c = Vec3f( dx       , dy + size,              0.0f );
-            vertices.push_back( a );
-            vertices.push_back( b );
-            vertices.push_back( c );
-
-            // Setup faces and normals
-            unsigned int first_index = ( i * n + j ) * 3;
-            Vec3f n = calculateFaceNormal( a, b, c );
-
-            for( unsigned int k = 0; k < 3; ++k )
-            {
-                normals.push_back(n);
-                indices.push_back( first_index + k );
-            }
-
-            dx += size + gap;
-        }
-        dy += size + gap;
-    }
-
-    // Create a VertexAttributeSet with vertices and normals
-    VertexAttributeSetSharedPtr vasPtr = VertexAttributeSet::create();
+    Vec2f *dst = out.getPackedValues( first );
+    if ( dst )
     {
-        VertexAttributeSetWriteLock vas(vasPtr);
-        vas->setVertices( &vertices[0], size_v );
-        vas->setNormals( &normals[0], size_v );
+        evaluateRingTexCoords( ring, v, dst );
     }
-
+    else
     {
-        // Create a PrimitiveSet
-        IndexSetSharedPtr indexSet( IndexSet::create() );
-        IndexSetWriteLock(indexSet)->setData( &indices[0], checked_cast<unsigned int>(indices.size()) );
-
-        PrimitiveSharedPtr primitivePtr = Primitive::create();
-        {
-            PrimitiveWriteLock primitive(primitivePtr);
-            primitive->setPrimitiveType( PRIMITIVE_TRIANGLES );
-            primitive->setVertexAttributeSet( vasPtr );
-            primitive->setIndexSet( indexSet );
-        }
-
-        drawablePtr = primitivePtr;
+        std::vector<Vec2f> &row = getRingScratch().texRow;
+        row.resize( ring.params.size() );
+        evaluateRingTexCoords( ring, v, &row[0] );
+        out.writeRow( first, &row[0], checked_cast<unsigned int>( row.size() ) );
     }
-
-    return drawablePtr;
 }
 
-// ===========================================================================
-
-DrawableSharedPtr createTriFan( unsigned int n, const float radius, const float elevation )
+//! The position data of a drawable, to detect changes of the vertices after its bounds were attached
+struct PositionStamp
 {
-    NVSG_ASSERT( n > 1 && "createTriFan(): n has to be at least 2." );
+    const void    * buffer;       // only compared, not held
+    unsigned int    offset;
+    unsigned int    stride;
+    unsigned int    count;
+    unsigned int    type;
+    unsigned int    sampleHash;   // hash over the bytes of evenly spaced sample positions
+};
+
+//! The bounds attached to a generated drawable, with the position data they were calculated for.
+// The drawable is not held, so the table doesn't keep any mesh alive. A drawable created later at the address of a
+// destroyed one only gets its bounds if its position data matches the stamp as well.
+struct BoundsEntry
+{
+    GeneratedBounds   bounds;
+    PositionStamp     positions;
+    unsigned int      serial;     // of the attach, to match the entry with its place in generatedBoundsOrder
+};
 
-    // create pointer to return
-    DrawableSharedPtr drawablePtr;
+typedef std::map<const void *, BoundsEntry> BoundsMap;
+typedef std::deque<std::pair<const void *, unsigned int> > BoundsOrder;
 
-    // setup vertices and faces for n triangles
-    vector<Vec3f> vertices;
-    vector<unsigned int> indices;
-    
-    vertices.reserve( n + 2 );
-    indices.reserve( n + 2 );
+//! The bounds of the generated drawables, see getGeneratedBounds
+BoundsMap generatedBounds;
+BoundsOrder generatedBoundsOrder;         // the attaches, oldest first
+unsigned int generatedBoundsSerial = 0;
+QMutex generatedBoundsMutex;
 
-    vertices.push_back( Vec3f( 0.0f, 0.0f, elevation ) );
-    vertices.push_back( Vec3f( radius, 0.0f, 0.0f ) );
+//! The number of attaches remembered in generatedBoundsOrder, the entries of older ones are dropped
+const size_t generatedBoundsLimit = 65536;
 
-    indices.push_back(0);
-    indices.push_back(1);
+//! The number of positions sampled into PositionStamp::sampleHash
+const unsigned int positionSampleCount = 16;
 
-    // n triangles ( i from 1 to n ! )
-    for( unsigned int i = 1; i <= n; ++i )
+//! Helper function to get the stamp of the position data of \a drawable, returns false if it has none
+bool getPositionStamp( const DrawableSharedPtr &drawable, PositionStamp &stamp )
+{
+    if ( !isPtrTo<Primitive>( drawable ) )
     {
-        float phi = PI * ((float)i/(float)n);
-        float x = radius * cos(phi);
-        float y = radius * sin(phi);
-        vertices.push_back( Vec3f(x, y, 0.f) );
-        indices.push_back( i + 1 );
+        return( false );
     }
-
-    // Calculate normals
-    vector<Vec3f> normals;
-    normals.resize(vertices.size());
-    for( size_t i = 0; i < normals.size(); ++i )
+    PrimitiveReadLock primitive( sharedPtr_cast<Primitive>( drawable ) );
+    if ( !primitive->getVertexAttributeSet() )
     {
-        normals[i] = Vec3f( 0.0f, 0.0f, 0.0f );
+        return( false );
     }
 
-    for( unsigned int i = 0; i < n; ++i )
+    VertexAttributeSetReadLock vas( primitive->getVertexAttributeSet() );
+    stamp.count = vas->getNumberOfVertexData( VertexAttributeSet::NVSG_POSITION );
+    if ( stamp.count == 0 )
     {
-        // calculate face normal for face i
-        Vec3f fn = calculateFaceNormal( vertices.at(0), vertices.at(i+1), vertices.at(i+2) );
-        // accumulate in vertex normals
-        normals.at(0)   += fn;
-        normals.at(i+1) += fn;
-        normals.at(i+2) += fn;
+        return( false );
     }
-
-    for( size_t i = 0; i < normals.size(); ++i )
+    BufferSharedPtr buffer = vas->getVertexBuffer( VertexAttributeSet::NVSG_POSITION );
+    stamp.buffer = buffer.get();
+    stamp.offset = vas->getOffsetOfVertexData( VertexAttributeSet::NVSG_POSITION );
+    stamp.stride = vas->getStrideOfVertexData( VertexAttributeSet::NVSG_POSITION );
+    stamp.type = vas->getTypeOfVertexData( VertexAttributeSet::NVSG_POSITION );
+
+    // FNV-1a over the samples, the first and the last position included
+    size_t bytes = vas->getSizeOfVertexData( VertexAttributeSet::NVSG_POSITION ) * getTypeSize( stamp.type );
+    unsigned int samples = std::min( stamp.count, positionSampleCount );
+    Buffer::DataReadLock lock( buffer );
+    const unsigned char *data = lock.getPtr<unsigned char>() + stamp.offset;
+    stamp.sampleHash = 2166136261u;
+    for ( unsigned int i = 0; i < samples; ++i )
     {
-        normals[i].normalize();
+        size_t index = ( 1 < samples ) ? size_t( i ) * ( stamp.count - 1 ) / ( samples - 1 ) : 0;
+        const unsigned char *sample = data + index * stamp.stride;
+        for ( size_t j = 0; j < bytes; ++j )
+        {
+            stamp.sampleHash = ( stamp.sampleHash ^ sample[j] ) * 16777619u;
+        }
     }
+    return( true );
+}
 
+//! Helper function to check if the position stamps \a a and \a b describe the same data
+bool isSamePositionData( const PositionStamp &a, const PositionStamp &b )
+{
+    return(    a.buffer == b.buffer && a.offset == b.offset && a.stride == b.stride
+            && a.count == b.count && a.type == b.type && a.sampleHash == b.sampleHash );
+}
 
-    // Create a VertexAttributeSet with vertices and normals
-    VertexAttributeSetSharedPtr vasPtr = VertexAttributeSet::create();
+//! Helper function to erase the entry of \a key if it still is the one of the attach \a serial, called with generatedBoundsMutex locked
+void eraseGeneratedBounds( const void *key, unsigned int serial )
+{
+    BoundsMap::iterator it = generatedBounds.find( key );
+    if ( ( it != generatedBounds.end() ) && ( it->second.serial == serial ) )
     {
-        VertexAttributeSetWriteLock vas(vasPtr);
-        vas->setVertices( &vertices[0], n + 2 );
-        vas->setNormals( &normals[0], n + 2 );
+        generatedBounds.erase( it );
     }
+}
 
+//! Helper function to drop the entries of the attaches beyond generatedBoundsLimit, called with generatedBoundsMutex locked.
+// The entries of destroyed drawables can't be told from the others without holding the drawables, so they age out.
+void trimGeneratedBounds()
+{
+    while ( generatedBoundsLimit < generatedBoundsOrder.size() )
     {
-        // Create a PrimitiveSet
-        IndexSetSharedPtr indexSet( IndexSet::create() );
-        IndexSetWriteLock(indexSet)->setData( &indices[0], checked_cast<unsigned int>(indices.size()) );
-
-        PrimitiveSharedPtr primitivePtr = Primitive::create();
-        {
-            PrimitiveWriteLock primitive(primitivePtr);
-            primitive->setPrimitiveType( PRIMITIVE_TRIANGLE_FAN );
-            primitive->setVertexAttributeSet( vasPtr );
-            primitive->setIndexSet( indexSet );
-        }
-
-        drawablePtr = primitivePtr;
+        eraseGeneratedBounds( generatedBoundsOrder.front().first, generatedBoundsOrder.front().second );
+        generatedBoundsOrder.pop_front();
     }
-
-    return drawablePtr;
 }
 
-// ===========================================================================
-
-DrawableSharedPtr createTriStrip( unsigned int rows, unsigned int columns, float width, float height )
+//! Helper function to get the box spanned by the corners \a a and \a b, given in any order
+Box3f makeBox( const Vec3f &a, const Vec3f &b )
 {
-    NVSG_ASSERT( rows >= 1 && columns >= 1 && "createTriStrip(): rows and columns both have to be at least 1." );
-
-    // create pointer to return
-    DrawableSharedPtr drawablePtr;
-
-    // Setup vertices, normals and indices
-    vector<Vec3f> vertices;
-    vector<Vec3f> normals;
-    vector<unsigned int> indices;
-    std::vector< IndexList > indexlist;
+    return( Box3f( Vec3f( std::min( a[0], b[0] ), std::min( a[1], b[1] ), std::min( a[2], b[2] ) )
+                 , Vec3f( std::max( a[0], b[0] ), std::max( a[1], b[1] ), std::max( a[2], b[2] ) ) ) );
+}
 
-    unsigned int size_v = ( rows + 1 ) * ( columns + 1 );
-    vertices.reserve( size_v );
-    normals.reserve( size_v );
-    indices.reserve( size_v );
-    
-    for( unsigned int i = 0; i <= rows; ++i )
+//! Helper function to get the box around the \a count corner points \a points of a generated shape
+Box3f makeBox( const Vec3f *points, unsigned int count )
+{
+    NVSG_ASSERT( 0 < count );
+    Vec3f lower( points[0] );
+    Vec3f upper( points[0] );
+    for ( unsigned int i = 1; i < count; ++i )
     {
-        for( unsigned int j = 0; j <= columns; ++j )
+        for ( unsigned int j = 0; j < 3; ++j )
         {
-            vertices.push_back( Vec3f( j * width, i * height, 0.0f ) );
-            normals.push_back( Vec3f( 0.0f, 0.0f, 1.0f ) );
+            lower[j] = std::min( lower[j], points[i][j] );
+            upper[j] = std::max( upper[j], points[i][j] );
         }
     }
+    return( Box3f( lower, upper ) );
+}
 
-    for( unsigned int i = 0; i < rows; ++i )
+//! Helper function to attach the bounds \a box and \a sphere to the generated drawable \a drawable
+DrawableSharedPtr attachBounds( const DrawableSharedPtr &drawable, const Box3f &box, const Sphere3f &sphere )
+{
+    BoundsEntry entry;
+    entry.bounds.box = box;
+    entry.bounds.sphere = sphere;
+    if ( !getPositionStamp( drawable, entry.positions ) )
     {
-        for( unsigned int j = 0; j <= columns; ++j )
-        {
-            indices.push_back( i * ( columns + 1 ) + j + columns + 1 );
-            indices.push_back( i * ( columns + 1 ) + j );
-        }
+        return( drawable );
     }
 
-    // Create a VertexAttributeSet with vertices and normals
-    VertexAttributeSetSharedPtr vasPtr = VertexAttributeSet::create();
-    {
-        VertexAttributeSetWriteLock vas( vasPtr );
-        vas->setVertices( &vertices[0], size_v );
-        vas->setNormals( &normals[0], size_v );
-    }
+    QMutexLocker lock( &generatedBoundsMutex );
+    entry.serial = ++generatedBoundsSerial;
+    generatedBounds[drawable.get()] = entry;
+    generatedBoundsOrder.push_back( std::make_pair( drawable.get(), entry.serial ) );
+    trimGeneratedBounds();
+    return( drawable );
+}
 
-    {
-        // Create a PrimitiveSet
-        IndexSetSharedPtr indexSet( IndexSet::create() );
-        IndexSetWriteLock(indexSet)->setData( &indices[0], checked_cast<unsigned int>(indices.size()) );
-
-        PrimitiveSharedPtr primitivePtr = Primitive::create();
-        {
-            PrimitiveWriteLock primitive(primitivePtr);
-            primitive->setPrimitiveType( PRIMITIVE_TRIANGLE_STRIP );
-            primitive->setVertexAttributeSet( vasPtr );
-            primitive->setIndexSet( indexSet );
-        }
-
-        drawablePtr = primitivePtr;
-    }
-
-    /*
-    FaceAttributeSharedPtr faceHdl = FaceAttribute::create();
-    {
-      FaceAttributeWriteLock(faceHdl)->setTwoSidedLighting( true );
-      FaceAttributeWriteLock(faceHdl)->setCullMode( false, false );
-    }
-    */
-
-    return drawablePtr;
-}
-
-// ===========================================================================
-
-GeoNodeSharedPtr createTriPatches4( const std::vector<std::string> & searchPaths, unsigned int m, unsigned int n, const Vec3f & size, const Vec2f & offset )
+//! Helper function to attach the box \a box and the sphere around it to the generated drawable \a drawable
+DrawableSharedPtr attachBounds( const DrawableSharedPtr &drawable, const Box3f &box )
 {
-    // Create a StateSet with a Material and a CgFx first
-    StateSetSharedPtr stateSet = createPatchesStateSet( "phongTessPatch10V.fx", searchPaths );
-    if ( ! stateSet )
-    {
-        return( GeoNodeSharedPtr() );
-    }
-
-    // Set up the tri patch:
-    //  9
-    //  7 8
-    //  4 5 6
-    //  0 1 2 3
-    //
-    Vec3f verts[10] =
-    {
-        Vec3f(size[0]*0.0f/4.0f, size[1]*0.0f/4.0f, size[2]*0.0f/4.0f), // 0
-        Vec3f(size[0]*1.0f/4.0f, size[1]*0.0f/4.0f, size[2]*1.0f/4.0f), // 1
-        Vec3f(size[0]*2.0f/4.0f, size[1]*0.0f/4.0f, size[2]*1.0f/4.0f), // 2
-        Vec3f(size[0]*3.0f/4.0f, size[1]*0.0f/4.0f, size[2]*0.0f/4.0f), // 3
-        Vec3f(size[0]*0.0f/4.0f, size[1]*1.0f/4.0f, size[2]*1.0f/4.0f), // 4
-        Vec3f(size[0]*1.0f/4.0f, size[1]*1.0f/4.0f, size[2]*2.0f/4.0f), // 5
-        Vec3f(size[0]*2.0f/4.0f, size[1]*1.0f/4.0f, size[2]*1.0f/4.0f), // 6
-        Vec3f(size[0]*0.0f/4.0f, size[1]*2.0f/4.0f, size[2]*1.0f/4.0f), // 7
-        Vec3f(size[0]*1.0f/4.0f, size[1]*2.0f/4.0f, size[2]*1.0f/4.0f), // 8
-        Vec3f(size[0]*0.0f/4.0f, size[1]*3.0f/4.0f, size[2]*0.0f/4.0f)  // 9
-    };
-
-    std::vector<Vec3f> vertices;
-
-    float x = 0.0f;
-    float y = 0.0f;
-    float z = 0.0f;
-
-    for( unsigned int i = 0; i < m; ++i )
-    {
-        for( unsigned int j = 0; j < n; ++j )
-        {
-            for( unsigned int k = 0; k < 10; ++k )
-            {
-                vertices.push_back( verts[k] + Vec3f(x, y, z) );
-            }
-            x += offset[0];
-        }
-        y += offset[1];
-        x = 0.0f;
-    }
-
-    // Create a VertexAttributeSet
-    VertexAttributeSetSharedPtr vas = VertexAttributeSet::create();
-    VertexAttributeSetWriteLock( vas )->setVertices( &vertices[0], checked_cast<unsigned int>(vertices.size()) );
-
-    // Create a TriPatches4
-    TriPatches4SharedPtr triPatches = TriPatches4::create();
-    TriPatches4WriteLock( triPatches )->setVertexAttributeSet( vas );
-
-    // Create a GeoNode and add the geometry
-    GeoNodeSharedPtr geoNode = GeoNode::create();
-    GeoNodeWriteLock( geoNode )->addDrawable( stateSet, triPatches );
-
-    return geoNode;
+    Vec3f lower( box.getLower() );
+    Vec3f upper( box.getUpper() );
+    return( attachBounds( drawable, box, Sphere3f( 0.5f * ( lower + upper ), 0.5f * length( upper - lower ) ) ) );
 }
 
-// ===========================================================================
-
-GeoNodeSharedPtr createQuadPatches4x4( const std::vector<std::string> & searchPaths, unsigned int n, unsigned int m, const Vec2f & offset )
+//! The expanded attributes of a polyhedron with flat faces
+struct PolyhedronTables
 {
-    // Create a StateSet with a Material and a CgFx
-    StateSetSharedPtr stateSet = createPatchesStateSet( "phongTessPatch16V.fx", searchPaths );
-    if ( ! stateSet )
-    {
-        return( GeoNodeSharedPtr() );
-    }
-
-    const float r = std::min( offset[0], offset[1] )/2.0f * 0.75f;
-    const float dy = r;  // distance between rows of vertices
-
-    // For a cylinder, we need four quad patches, each extruding an approximation
-    // of a quarter of a circle
-
-    // For a bezier curve to approximate a quarter of a circle, we need to use a
-    // cubic bezier curve with inner points at a distance x of r*4(sqrt(2)-1)/3 from
-    // the end points in the tangent direction at the end points:
-    //
-    //   0--d--1
-    //   |      \
-    //   r       2
-    //   |       |
-    //   *       3
-    //
-    
-    // Distance of the boundary control points to the corner control points
-    const float d = r * 4.0f * (sqrt(2.0f)-1.0f)/3.0f;
-
-    // A zero for nice alignment
-    const float o = 0.0f;
-    
-    // First construct the bezier curves to be extruded
-    Vec3f bezierCurves[16];
-    bezierCurves[ 0] = Vec3f( o, o, r ); //
-    bezierCurves[ 1] = Vec3f( d, o, r ); //
-    bezierCurves[ 2] = Vec3f( r, o, d ); //
-    bezierCurves[ 3] = Vec3f( r, o, o ); //        |
-    bezierCurves[ 4] = Vec3f( r, o, o ); //        |
-    bezierCurves[ 5] = Vec3f( r, o,-d ); //      9 786
-    bezierCurves[ 6] = Vec3f( d, o,-r ); //     A  |  5
-    bezierCurves[ 7] = Vec3f( o, o,-r ); //  --BC-----34--x
-    bezierCurves[ 8] = Vec3f( o, o,-r ); //     D  |  2
-    bezierCurves[ 9] = Vec3f(-d, o,-r ); //      E F0 1
-    bezierCurves[10] = Vec3f(-r, o,-d ); //        |
-    bezierCurves[11] = Vec3f(-r, o, o ); //        z
-    bezierCurves[12] = Vec3f(-r, o, o ); //
-    bezierCurves[13] = Vec3f(-r, o, d ); //
-    bezierCurves[14] = Vec3f(-d, o, r ); //
-    bezierCurves[15] = Vec3f( o, o, r ); //
-
-    // Extrude the curves to form the patches
-    //            y  C D E F
-    // one patch: |  8 9 A B
-    //            |  4 5 6 7
-    //            O  0 1 2 3
-    vector< Vec3f > verts;
-    for( unsigned int i = 0; i < 4; ++i )
-    {
-        // patch i
-        for( unsigned int j = 0; j < 4; ++j )
-        {
-            // row j
-            for( unsigned int k = 0; k < 4; ++k )
-            {
-                // column k
-                verts.push_back( bezierCurves[i*4+k] + Vec3f( o, dy*j, o ));
-            }
-        }
-    }
-
-    // Generate n x m cylinders
-    vector< Vec3f > vertices;
-    for( unsigned int i = 0; i < n; ++i )
+    std::vector<Vec3f>        vertices;
+    std::vector<Vec3f>        normals;
+    std::vector<Vec2f>        texcoords;    // empty if the polyhedron has no texture coordinates
+    std::vector<unsigned int> indices;
+    Box3f                     box;
+    Sphere3f                  sphere;
+};
+
+//! Helper function to add the triangle a, b, c with its face normal to \a tables
+void addFlatTriangle( PolyhedronTables &tables, const Vec3f &a, const Vec3f &b, const Vec3f &c )
+{
+    Vec3f fn = calculateFaceNormal( a, b, c );
+    for ( unsigned int i = 0; i < 3; ++i )
     {
-        for( unsigned int j = 0; j < m; ++j )
-        {
-            float x = i * offset[0];
-            float z = j * offset[1];
-            for( unsigned int k = 0; k < verts.size(); ++k )
-            {
-                vertices.push_back( verts.at( k ) + Vec3f( x, o, z ) );
-            }
-        }
+        tables.indices.push_back( checked_cast<unsigned int>( tables.vertices.size() ) );
+        tables.vertices.push_back( i == 0 ? a : ( i == 1 ? b : c ) );
+        tables.normals.push_back( fn );
     }
-
-    // Create a VertexAttributeSet
-    VertexAttributeSetSharedPtr vas = VertexAttributeSet::create();
-    VertexAttributeSetWriteLock( vas )->setVertices( &vertices[0], checked_cast<unsigned int>( vertices.size() ) );
-
-    // Create a PrimitiveSet
-    QuadPatches4x4SharedPtr patches = QuadPatches4x4::create();
-    QuadPatches4x4WriteLock( patches )->setVertexAttributeSet( vas );
-
-    // Create a GeoNode and add the geometry
-    GeoNodeSharedPtr geoNode = GeoNode::create();
-    GeoNodeWriteLock( geoNode )->addDrawable( stateSet, patches );
-
-    return geoNode;
 }
 
-// ===========================================================================
-
-DrawableSharedPtr createCube()
+//! Helper function to setup the tables of createCube
+PolyhedronTables setupCubeTables()
 {
     // Right handed model coordinates.
     // Vertex numbering and coordinate setup match the 3-bit pattern: (z << 2) | (y << 1) | x
@@ -766,78 +524,34 @@ DrawableSharedPtr createCube()
         Vec2f(0.0f, 1.0f)
     };
 
-    Vec3f v[36];
-    Vec3f n[36];
-    Vec2f tc[36];
-    vector<unsigned int> indices;
-    
-    Vec3f v0, v1, v2, fn;
-
-    for ( int kf = 0, kv = 0; kf < 12; kf++, kv += 3 )
+    PolyhedronTables tables;
+    for ( int kf = 0; kf < 12; kf++ )
     {
-        v0 = vertices[faces[kf][0]];
-        v1 = vertices[faces[kf][1]];
-        v2 = vertices[faces[kf][2]];
-        fn = calculateFaceNormal( v0, v1, v2 );
-
-        indices.push_back(kv);
-        indices.push_back(kv+1);
-        indices.push_back(kv+2);
-
-        v[kv]    = v0;
-        v[kv+1]  = v1;
-        v[kv+2]  = v2;
-
-        n[kv]    = fn;
-        n[kv+1]  = fn;
-        n[kv+2]  = fn;
+        addFlatTriangle( tables, vertices[faces[kf][0]], vertices[faces[kf][1]], vertices[faces[kf][2]] );
 
         // Assign texture coordinates
         if (kf & 1)
         { // odd faces
-            tc[kv]    = texcoords[2];
-            tc[kv+1]  = texcoords[3];
-            tc[kv+2]  = texcoords[0];
+            tables.texcoords.push_back( texcoords[2] );
+            tables.texcoords.push_back( texcoords[3] );
+            tables.texcoords.push_back( texcoords[0] );
         }
         else
         { // Even faces
-            tc[kv]    = texcoords[0];
-            tc[kv+1]  = texcoords[1];
-            tc[kv+2]  = texcoords[2];
+            tables.texcoords.push_back( texcoords[0] );
+            tables.texcoords.push_back( texcoords[1] );
+            tables.texcoords.push_back( texcoords[2] );
         }
     }
 
-    // Create a VertexAttributeSet with vertices, normals and texture coordinates
-    VertexAttributeSetSharedPtr vasPtr = VertexAttributeSet::create();
-    {
-        VertexAttributeSetWriteLock vas( vasPtr );
-        vas->setVertices( v, 36 );
-        vas->setNormals( n, 36 );
-        vas->setTexCoords( 0, tc, 36 );
-    }
-    
-    // Create a PrimitiveSet
-    IndexSetSharedPtr indexSet( IndexSet::create() );
-    IndexSetWriteLock(indexSet)->setData( &indices[0], checked_cast<unsigned int>(indices.size()) );
-
-    PrimitiveSharedPtr primitivePtr = Primitive::create();
-    {
-        PrimitiveWriteLock primitive(primitivePtr);
-        primitive->setPrimitiveType( PRIMITIVE_TRIANGLES );
-        primitive->setVertexAttributeSet( vasPtr );
-        primitive->setIndexSet( indexSet );
-    }
-    
-    return primitivePtr;
+    tables.box = makeBox( vertices, 8 );
+    tables.sphere = Sphere3f( Vec3f( 0.0f, 0.0f, 0.0f ), sqrtf( 3.0f ) );
+    return( tables );
 }
 
-// ===========================================================================
-
-DrawableSharedPtr createTetrahedron()
+//! Helper function to setup the tables of createTetrahedron
+PolyhedronTables setupTetrahedronTables()
 {
-    // create pointer to return
-    DrawableSharedPtr drawablePtr;
-    
     // Setup vertices
     static const Vec3f vertices[4] =
     {
@@ -865,85 +579,27 @@ DrawableSharedPtr createTetrahedron()
         Vec2f(0.0f, 1.0f)
     };
 
-    // Calculate normals
-    Vec3f v[12];
-    Vec3f n[12];
-    Vec2f tc[12];
-
-    Vec3f v0, v1, v2, fn;
-
-    vector<unsigned int> indices;
-
-    for ( int kf = 0, kv = 0; kf < 4; kf++, kv += 3 )
-    {
-        v0 = vertices[faces[kf][0]];
-        v1 = vertices[faces[kf][1]];
-        v2 = vertices[faces[kf][2]];
-
-        fn = calculateFaceNormal( v0, v1, v2 );
-
-        indices.push_back(kv);
-        indices.push_back(kv+1);
-        indices.push_back(kv+2);
-
-        v[kv]    = v0;
-        v[kv+1]  = v1;
-        v[kv+2]  = v2;
-
-        n[kv]    = fn;
-        n[kv+1]  = fn;
-        n[kv+2]  = fn;
-    }
-
-    // Assign texture coordinates
-    tc[0]  = texcoords[0];
-    tc[1]  = texcoords[1];
-    tc[2]  = texcoords[2];
-    tc[3]  = texcoords[0];
-    tc[4]  = texcoords[3];
-    tc[5]  = texcoords[1];
-    tc[6]  = texcoords[0];
-    tc[7]  = texcoords[2];
-    tc[8]  = texcoords[3];
-    tc[9]  = texcoords[1];
-    tc[10] = texcoords[3];
-    tc[11] = texcoords[2];
+    // The texture coordinates of the 12 face corners
+    static const unsigned int tc[12] = { 0, 1, 2, 0, 3, 1, 0, 2, 3, 1, 3, 2 };
 
-
-    // Create a VertexAttributeSet with vertices, normals and texture coordinates
-    VertexAttributeSetSharedPtr vasPtr = VertexAttributeSet::create();
+    PolyhedronTables tables;
+    for ( int kf = 0; kf < 4; kf++ )
     {
-        VertexAttributeSetWriteLock vas( vasPtr );
-        vas->setVertices( v, 12 );
-        vas->setNormals( n, 12 );
-        vas->setTexCoords( 0, tc, 12 );
+        addFlatTriangle( tables, vertices[faces[kf][0]], vertices[faces[kf][1]], vertices[faces[kf][2]] );
     }
-
+    for ( int i = 0; i < 12; i++ )
     {
-        IndexSetSharedPtr indexSet( IndexSet::create() );
-        IndexSetWriteLock(indexSet)->setData( &indices[0], checked_cast<unsigned int>(indices.size()) );
-
-        PrimitiveSharedPtr primitivePtr = Primitive::create();
-        {
-            PrimitiveWriteLock primitive(primitivePtr);
-            primitive->setPrimitiveType( PRIMITIVE_TRIANGLES );
-            primitive->setVertexAttributeSet( vasPtr );
-            primitive->setIndexSet( indexSet );
-        }
-
-        drawablePtr = primitivePtr;
+        tables.texcoords.push_back( texcoords[tc[i]] );
     }
 
-    return drawablePtr;
+    tables.box = makeBox( vertices, 4 );
+    tables.sphere = Sphere3f( Vec3f( 0.0f, 0.0f, 0.0f ), sqrtf( 3.0f ) );
+    return( tables );
 }
 
-// ===========================================================================
-
-DrawableSharedPtr createOctahedron()
+//! Helper function to setup the tables of createOctahedron
+PolyhedronTables setupOctahedronTables()
 {
-    // create pointer to return
-    DrawableSharedPtr drawablePtr;
-    
     // Setup vertices
     static const Vec3f vertices[6] =
     {
@@ -978,146 +634,27 @@ DrawableSharedPtr createOctahedron()
         Vec2f(0.5f, 0.5f)   //4
     };
 
-    // Calculate normals
-    Vec3f v[24];
-    Vec3f n[24];
-    Vec2f tc[24];
-
-    Vec3f v0, v1, v2, fn;
-
-    vector<unsigned int> indices;
-
-    for ( int kf = 0, kv = 0; kf < 8; kf++, kv += 3 )
-    {
-        v0 = vertices[faces[kf][0]];
-        v1 = vertices[faces[kf][1]];
-        v2 = vertices[faces[kf][2]];
-
-        fn = calculateFaceNormal( v0, v1, v2 );
-
-        indices.push_back(kv);
-        indices.push_back(kv+1);
-        indices.push_back(kv+2);
-
-        v[kv]    = v0;
-        v[kv+1]  = v1;
-        v[kv+2]  = v2;
-
-        n[kv]    = fn;
-        n[kv+1]  = fn;
-        n[kv+2]  = fn;
-    }
-
-
-    // Assign texture coordinates
-    tc[0]  = texcoords[2];
-    tc[1]  = texcoords[4];
-    tc[2]  = texcoords[1];
-    tc[3]  = texcoords[2];
-    tc[4]  = texcoords[1];
-    tc[5]  = texcoords[4];
-    tc[6]  = texcoords[2];
-    tc[7]  = texcoords[4];
-    tc[8]  = texcoords[3];
-    tc[9]  = texcoords[2];
-    tc[10] = texcoords[3];
-    tc[11] = texcoords[4];
-    tc[12] = texcoords[0];
-    tc[13] = texcoords[1];
-    tc[14] = texcoords[4];
-    tc[15] = texcoords[0];
-    tc[16] = texcoords[4];
-    tc[17] = texcoords[1];
-    tc[18] = texcoords[0];
-    tc[19] = texcoords[3];
-    tc[20] = texcoords[4];
-    tc[21] = texcoords[0];
-    tc[22] = texcoords[4];
-    tc[23] = texcoords[3];
+    // The texture coordinates of the 24 face corners
+    static const unsigned int tc[24] = { 2, 4, 1, 2, 1, 4, 2, 4, 3, 2, 3, 4, 0, 1, 4, 0, 4, 1, 0, 3, 4, 0, 4, 3 };
 
-
-    // Create a VertexAttributeSet with vertices, normals and texture coordinates
-    VertexAttributeSetSharedPtr vasPtr = VertexAttributeSet::create();
+    PolyhedronTables tables;
+    for ( int kf = 0; kf < 8; kf++ )
     {
-        VertexAttributeSetWriteLock vas( vasPtr );
-        vas->setVertices( v, 24 );
-        vas->setNormals( n, 24 );
-        vas->setTexCoords( 0, tc, 24 );
+        addFlatTriangle( tables, vertices[faces[kf][0]], vertices[faces[kf][1]], vertices[faces[kf][2]] );
     }
-
+    for ( int i = 0; i < 24; i++ )
     {
-        // Create a PrimitiveSet
-        IndexSetSharedPtr indexSet( IndexSet::create() );
-        IndexSetWriteLock(indexSet)->setData( &indices[0], checked_cast<unsigned int>(indices.size()) );
+        tables.texcoords.push_back( texcoords[tc[i]] );
+    }
 
-        PrimitiveSharedPtr primitivePtr = Primitive::create();
-        {
-            PrimitiveWriteLock primitive(primitivePtr);
-            primitive->setPrimitiveType( PRIMITIVE_TRIANGLES );
-            primitive->setVertexAttributeSet( vasPtr );
-            primitive->setIndexSet( indexSet );
-        }
-
-        drawablePtr = primitivePtr;
-    }
-
-    return drawablePtr;
+    tables.box = makeBox( vertices, 6 );
+    tables.sphere = Sphere3f( Vec3f( 0.0f, 0.0f, 0.0f ), 1.0f );
+    return( tables );
 }
 
-// ===========================================================================
-
-DrawableSharedPtr createDodecahedron()
+//! Helper function to setup the tables of createDodecahedron
+PolyhedronTables setupDodecahedronTables()
 {
-    // create pointer to return
-    DrawableSharedPtr drawablePtr;
-    
-    //USE ICOSAHEDRON VERTICES AND FACES TO SETUP DODECAHEDRON
-    //--------------------------------------------------------
-    static const float x = 0.525731112119133606f;
-    static const float z = 0.850650808352039932f;
-
-    static const Vec3f icoVertices[12] =
-    {
-        Vec3f(   -x , 0.0f ,    z ),
-        Vec3f(    x , 0.0f ,    z ),
-        Vec3f(   -x , 0.0f ,   -z ),
-        Vec3f(    x , 0.0f ,   -z ),
-        Vec3f( 0.0f ,    z ,    x ),
-        Vec3f( 0.0f ,    z ,   -x ),
-        Vec3f( 0.0f ,   -z ,    x ),
-        Vec3f( 0.0f ,   -z ,   -x ),
-        Vec3f(    z ,    x , 0.0f ),
-        Vec3f(   -z ,    x , 0.0f ),
-        Vec3f(    z ,   -x , 0.0f ),
-        Vec3f(   -z ,   -x , 0.0f )
-    };
-
-    static const Face3 icoFaces[20] =
-    {
-        { 0,  1,  4}, //  0
-        { 0,  4,  9}, //  1
-        { 0,  9, 11}, //  2
-        { 0,  6,  1}, //  3
-        { 0, 11,  6}, //  4
-        { 1,  6, 10}, //  5
-        { 1, 10,  8}, //  6
-        { 1,  8,  4}, //  7
-        { 2,  3,  7}, //  8
-        { 2,  5,  3}, //  9
-        { 2,  9,  5}, // 10
-        { 2, 11,  9}, // 11
-        { 2,  7, 11}, // 12
-        { 3,  5,  8}, // 13
-        { 3,  8, 10}, // 14
-        { 3, 10,  7}, // 15
-        { 4,  5,  9}, // 16
-        { 4,  8,  5}, // 17
-        { 6,  7, 10}, // 18
-        { 6, 11,  7}  // 19
-    };
-
-    //--------------------------------------------------------
-
     // Setup indices of dodecahedron
     static const int idxDode[12][5] =
     {
@@ -1137,29 +674,18 @@ DrawableSharedPtr createDodecahedron()
 
     // Calculate vertices
     Vec3f vertices[20];
-    Vec3f v;
 
     // The 20 vertices of the dodecahedron are the centers of the 20 icosahedron triangle faces
     // pushed out to unit sphere radius by normalization
     for ( int i = 0; i < 20; i++ )
     {
-        v = icoVertices[icoFaces[i][0]] +  icoVertices[icoFaces[i][1]] +  icoVertices[icoFaces[i][2]];
+        Vec3f v = icosahedronVertices[icosahedronFaces[i][0]] +  icosahedronVertices[icosahedronFaces[i][1]] +  icosahedronVertices[icosahedronFaces[i][2]];
         v.normalize();
         vertices[i] = v;
     }
 
-    // Setup vertices, normals and faces
-    vector<Vec3f> vv;
-    vector<Vec3f> vn;
-
-    vv.reserve( 72 );
-    vn.reserve( 72 );
-
-    vector<unsigned int> indices;
-    vector<Face3> faces;
-    indices.reserve( 180 );
-    faces.reserve( 60 );
-    
+    // Each pentagon is a fan of five triangles around its center point
+    PolyhedronTables tables;
     for( unsigned int i = 0 ; i < 12; ++i )
     {
         Vec3f v( 0.0f, 0.0f, 0.0f );
@@ -1169,282 +695,382 @@ DrawableSharedPtr createDodecahedron()
         }
         v /= 5.0f;
 
+        unsigned int k = checked_cast<unsigned int>( tables.vertices.size() );
+
         // center point of face
-        vv.push_back(v);
-        vv.push_back(vertices[idxDode[i][0]]);
-        vv.push_back(vertices[idxDode[i][1]]);
-        vv.push_back(vertices[idxDode[i][2]]);
-        vv.push_back(vertices[idxDode[i][3]]);
-        vv.push_back(vertices[idxDode[i][4]]);
+        tables.vertices.push_back(v);
+        for( unsigned int j = 0 ; j < 5; ++j )
+        {
+            tables.vertices.push_back( vertices[idxDode[i][j]] );
+        }
 
         v.normalize();
-        for( unsigned int j=0 ; j<6; ++j )
+        tables.normals.insert( tables.normals.end(), 6, v );
+
+        for( unsigned int j = 0 ; j < 5; ++j )
         {
-            vn.push_back(v);
+            tables.indices.push_back( k );
+            tables.indices.push_back( k + 1 + j );
+            tables.indices.push_back( k + 1 + ( j + 1 ) % 5 );
         }
+    }
 
-        unsigned int k = i * 6;
-
-        indices.push_back(k);
-        indices.push_back(k+1);
-        indices.push_back(k+2);
+    tables.box = makeBox( vertices, 20 );
+    tables.sphere = Sphere3f( Vec3f( 0.0f, 0.0f, 0.0f ), 1.0f );
+    return( tables );
+}
 
-        indices.push_back(k);
-        indices.push_back(k+2);
-        indices.push_back(k+3);
+//! Helper function to setup the tables of createIcosahedron
+PolyhedronTables setupIcosahedronTables()
+{
+    PolyhedronTables tables;
+    for( unsigned int i = 0 ; i < 20; ++i )
+    {
+        addFlatTriangle( tables, icosahedronVertices[icosahedronFaces[i][0]], icosahedronVertices[icosahedronFaces[i][1]], icosahedronVertices[icosahedronFaces[i][2]] );
+    }
 
-        indices.push_back(k);
-        indices.push_back(k+3);
-        indices.push_back(k+4);
+    tables.box = makeBox( icosahedronVertices, 12 );
+    tables.sphere = Sphere3f( Vec3f( 0.0f, 0.0f, 0.0f ), 1.0f );
+    return( tables );
+}
 
-        indices.push_back(k);
-        indices.push_back(k+4);
-        indices.push_back(k+5);
+//! The polyhedra tables, set up once before main and never modified, so they are safe to read from any thread
+const PolyhedronTables polyhedronTables[POLYHEDRON_COUNT] =
+{
+    setupCubeTables(),
+    setupTetrahedronTables(),
+    setupOctahedronTables(),
+    setupDodecahedronTables(),
+    setupIcosahedronTables()
+};
+
+//! Helper function to create a drawable in the layout \a format from the precomputed \a tables
+DrawableSharedPtr createPolyhedron( const PolyhedronTables &tables, unsigned int format )
+{
+    const unsigned int size_v = checked_cast<unsigned int>( tables.vertices.size() );
+    MeshVertices mesh( format, size_v );
+    VertexStream< Vec3f > vertices( mesh, VertexAttributeSet::NVSG_POSITION );
+    VertexStream< Vec3f > normals( mesh, VertexAttributeSet::NVSG_NORMAL );
+    MeshIndices indices( format, size_v, checked_cast<unsigned int>( tables.indices.size() ) );
+    if ( !tables.texcoords.empty() )
+    {
+        mesh.addAttribute( VertexAttributeSet::NVSG_TEXCOORD0, 2 );
+    }
 
-        indices.push_back(k);
-        indices.push_back(k+5);
-        indices.push_back(k+1);
+    vertices.writeRow( 0, &tables.vertices[0], size_v );
+    normals.writeRow( 0, &tables.normals[0], size_v );
+    if ( !tables.texcoords.empty() )
+    {
+        mesh.writeRow( VertexAttributeSet::NVSG_TEXCOORD0, 0, &tables.texcoords[0][0], size_v );
+    }
+    for ( unsigned int i = 0; i < indices.size(); ++i )
+    {
+        indices[i] = tables.indices[i];
     }
 
-    // Create a VertexAttributeSet with vertices and normals
-    VertexAttributeSetSharedPtr vasPtr = VertexAttributeSet::create();
+    // Create a VertexAttributeSet with vertices, normals and texture coordinates
+    VertexAttributeSetSharedPtr vasPtr = mesh.createVertexAttributeSet();
+
+    // Create a PrimitiveSet
+    IndexSetSharedPtr indexSet( indices.createIndexSet( false ) );
+
+    PrimitiveSharedPtr primitivePtr = Primitive::create();
     {
-        VertexAttributeSetWriteLock vas( vasPtr );
-        vas->setVertices( &vv[0], 72 );
-        vas->setNormals( &vn[0], 72 );
+        PrimitiveWriteLock primitive(primitivePtr);
+        primitive->setPrimitiveType( PRIMITIVE_TRIANGLES );
+        primitive->setVertexAttributeSet( vasPtr );
+        primitive->setIndexSet( indexSet );
     }
 
+    return( attachBounds( primitivePtr, tables.box, tables.sphere ) );
+}
+
+//! The shared polyhedra, per polyhedron and mesh format, see getSharedPolyhedron
+typedef std::map< std::pair<unsigned int, unsigned int>, DrawableSharedPtr > SharedPolyhedronMap;
+SharedPolyhedronMap sharedPolyhedra;
+QMutex sharedPolyhedraMutex;
+
+//! Helper function to setup the vertices, normals, texccords and indices of the cells [columnBegin, columnEnd) x [rowBegin, rowEnd)
+//of a tessellated plane with \a subdiv subdivisions and a transformation-matrix transf, starting at vertex \a offset and index \a indexOffset,
+//as triangle list or as triangle strips of setupGridStrips
+void setupTessellatedPlane( unsigned int subdiv, const Mat44f &transf,
+                            unsigned int columnBegin, unsigned int columnEnd, unsigned int rowBegin, unsigned int rowEnd,
+                            unsigned int offset, unsigned int indexOffset,
+                            VertexStream< Vec3f > &vertices, VertexStream< Vec3f > &normals,
+                            VertexStream< Vec2f > &texcoords, MeshIndices &indices, bool strips )
+{
+    NVSG_ASSERT( columnBegin < columnEnd && columnEnd <= subdiv + 1 && rowBegin < rowEnd && rowEnd <= subdiv + 1 );
+
+    float step = 2.0f/(float)(subdiv + 1);
+    unsigned int row = columnEnd - columnBegin + 1;
+
+    // This is expensive do it once outside the loops!
+    // The plane is flat, so it's the same normal for all vertices.
+    Vec3f normal(0.0f, 0.0f, 1.0f); // Initialize to some valid normal in case the transf matrix cannot be inverted.
+    Mat44f transfIT;
+    if ( invert( transf, transfIT ) )
     {
-        // Create a PrimitiveSet
-        IndexSetSharedPtr indexSet( IndexSet::create() );
-        IndexSetWriteLock(indexSet)->setData( &indices[0], checked_cast<unsigned int>(indices.size()) );
+        transfIT = ~transfIT;
+        normal = Vec3f(Vec4f( 0.0f, 0.0f, 1.0f, 0.0f) * transfIT);
+        normal.normalize();
+    }
 
-        PrimitiveSharedPtr primitivePtr = Primitive::create();
+    // Calculate the positions from the grid coordinates, not by accumulating the step,
+    // so the border vertices of neighboring parts of a plane are identical.
+    unsigned int k = offset;
+    for ( unsigned int sY = rowBegin; sY <= rowEnd; sY++ )
+    {
+        float y = -1.0f + (float)sY * step;
+        for ( unsigned int sX = columnBegin; sX <= columnEnd; sX++ )
         {
-            PrimitiveWriteLock primitive(primitivePtr);
-            primitive->setPrimitiveType( PRIMITIVE_TRIANGLES );
-            primitive->setVertexAttributeSet( vasPtr );
-            primitive->setIndexSet( indexSet );
+            float x = -1.0f + (float)sX * step;
+            vertices[k] = Vec3f(Vec4f( x, y, 0.0f, 1.0f ) * transf );
+            normals[k] = normal;
+            texcoords[k] = Vec2f( x * 0.5f + 0.5f, y * 0.5f + 0.5f );
+            ++k;
         }
+    }
 
-        drawablePtr = primitivePtr;
+    if ( strips )
+    {
+        setupGridStrips( columnEnd - columnBegin, rowEnd - rowBegin, offset, indices, indexOffset );
+        return;
     }
 
-    return drawablePtr;
-}
+    k = indexOffset;
+    for ( unsigned int sY = 0; sY < rowEnd - rowBegin; sY++ )
+    {
+        for ( unsigned int sX = 0; sX < columnEnd - columnBegin; sX++ )
+        {
+            indices[k++] = offset + sX + sY * row;
+            indices[k++] = offset + sX + 1 + sY * row;
+            indices[k++] = offset + sX + 1 + (sY+1) * row;
 
-// ===========================================================================
+            indices[k++] = offset + sX + 1 + (sY+1) * row;
+            indices[k++] = offset + sX + (sY+1) * row;
+            indices[k++] = offset + sX + sY * row;
+        }
+    }
+}
 
-DrawableSharedPtr createIcosahedron()
+//! Helper function to create the cells [columnBegin, columnEnd) x [rowBegin, rowEnd) of a tessellated plane in the layout \a format
+DrawableSharedPtr createTessellatedPlanePart( unsigned int subdiv, const Mat44f &transf,
+                                              unsigned int columnBegin, unsigned int columnEnd, unsigned int rowBegin, unsigned int rowEnd,
+                                              unsigned int format )
 {
-    // create pointer to return
-    DrawableSharedPtr drawablePtr;
-    
-    static const float x = 0.525731112119133606f;
-    static const float z = 0.850650808352039932f;
+    // Setup vertices, normals, texture coordinates and indices
+    const unsigned int size_v = ( columnEnd - columnBegin + 1 ) * ( rowEnd - rowBegin + 1 );
+    MeshVertices mesh( format, size_v );
+    VertexStream< Vec3f > vertices( mesh, VertexAttributeSet::NVSG_POSITION );
+    VertexStream< Vec3f > normals( mesh, VertexAttributeSet::NVSG_NORMAL );
+    VertexStream< Vec2f > texcoords( mesh, VertexAttributeSet::NVSG_TEXCOORD0 );
+    const bool strips = useTriangleStrips( format );
+    MeshIndices indices( format, size_v, strips ? getGridStripIndexCount( columnEnd - columnBegin, rowEnd - rowBegin )
+                                                : 6 * ( columnEnd - columnBegin ) * ( rowEnd - rowBegin ) );
+
+    setupTessellatedPlane( subdiv, transf, columnBegin, columnEnd, rowBegin, rowEnd, 0, 0, vertices, normals, texcoords, indices, strips );
 
-    // Setup vertices
-    static const Vec3f vertices[12] =
-    {
-        Vec3f(   -x , 0.0f ,    z ),
-        Vec3f(    x , 0.0f ,    z ),
-        Vec3f(   -x , 0.0f ,   -z ),
-        Vec3f(    x , 0.0f ,   -z ),
-        Vec3f( 0.0f ,    z ,    x ),
-        Vec3f( 0.0f ,    z ,   -x ),
-        Vec3f( 0.0f ,   -z ,    x ),
-        Vec3f( 0.0f ,   -z ,   -x ),
-        Vec3f(    z ,    x , 0.0f ),
-        Vec3f(   -z ,    x , 0.0f ),
-        Vec3f(    z ,   -x , 0.0f ),
-        Vec3f(   -z ,   -x , 0.0f )
-    };
+    // Create a VertexAttributeSet with vertices, normals and texture coordinates
+    VertexAttributeSetSharedPtr vasPtr = mesh.createVertexAttributeSet();
 
-    // Setup faces
-    static const Face3 faces[20] =
-    {
-        { 0,  1,  4}, //  0
-        { 0,  4,  9}, //  1
-        { 0,  9, 11}, //  2
-        { 0,  6,  1}, //  3
-        { 0, 11,  6}, //  4
-        { 1,  6, 10}, //  5
-        { 1, 10,  8}, //  6
-        { 1,  8,  4}, //  7
-        { 2,  3,  7}, //  8
-        { 2,  5,  3}, //  9
-        { 2,  9,  5}, // 10
-        { 2, 11,  9}, // 11
-        { 2,  7, 11}, // 12
-        { 3,  5,  8}, // 13
-        { 3,  8, 10}, // 14
-        { 3, 10,  7}, // 15
-        { 4,  5,  9}, // 16
-        { 4,  8,  5}, // 17
-        { 6,  7, 10}, // 18
-        { 6, 11,  7}  // 19
-    };
+    // Create a PrimitiveSet
+    IndexSetSharedPtr indexSet( indices.createIndexSet( strips ) );
+
+    PrimitiveSharedPtr primitivePtr = Primitive::create();
+    {
+        PrimitiveWriteLock primitive(primitivePtr);
+        primitive->setPrimitiveType( strips ? PRIMITIVE_TRIANGLE_STRIP : PRIMITIVE_TRIANGLES );
+        primitive->setVertexAttributeSet( vasPtr );
+        primitive->setIndexSet( indexSet );
+    }
 
-    vector<Vec3f> vv;
-    vector<Vec3f> vn;
+    // The part is flat, so the transformed corners span its box
+    float step = 2.0f/(float)(subdiv + 1);
+    Vec3f corners[4];
+    for ( unsigned int i = 0; i < 4; ++i )
+    {
+        float x = -1.0f + (float)( ( i & 1 ) ? columnEnd : columnBegin ) * step;
+        float y = -1.0f + (float)( ( i & 2 ) ? rowEnd : rowBegin ) * step;
+        corners[i] = Vec3f( Vec4f( x, y, 0.0f, 1.0f ) * transf );
+    }
 
-    vv.reserve(60);
-    vn.reserve(60);
+    return( attachBounds( primitivePtr, makeBox( corners, 4 ) ) );
+}
 
-    unsigned int j=0;
+//! Helper function to create the tiles [columnBegin, columnEnd) x [rowBegin, rowEnd) of a tile set with \a n columns.
+//With \a verticesPerTile == 4 the tiles are the quads of createQuadSet, with 3 they are the triangles of createTriSet.
+//The quads stay PRIMITIVE_QUADS with MESH_FORMAT_TRIANGLE_STRIPS, a strip per quad would take five indices instead of four.
+DrawableSharedPtr createTileSet( unsigned int verticesPerTile, unsigned int n,
+                                 unsigned int columnBegin, unsigned int columnEnd, unsigned int rowBegin, unsigned int rowEnd,
+                                 float size, float gap, unsigned int format )
+{
+    NVSG_ASSERT( ( verticesPerTile == 3 ) || ( verticesPerTile == 4 ) );
 
-    vector<unsigned int> indices;
-    vector<Face3> facesIco;
-    indices.reserve( 60 );
-    facesIco.reserve( 20 );
+    // setup vertices, normals and indices for the tiles
+    const unsigned int columns = columnEnd - columnBegin;
+    const unsigned int size_v = verticesPerTile * ( rowEnd - rowBegin ) * columns;
+    MeshVertices mesh( format, size_v );
+    VertexStream<Vec3f> vertices( mesh, VertexAttributeSet::NVSG_POSITION );
+    VertexStream<Vec3f> normals( mesh, VertexAttributeSet::NVSG_NORMAL );
+    MeshIndices indices( format, size_v, size_v );
 
-    for( unsigned int i = 0 ; i < 20; ++i )
+    // m tiles in y-direction
+    for( unsigned int i = rowBegin; i < rowEnd; ++i )
     {
-        Vec3f a = vertices[faces[i][0]];
-        Vec3f b = vertices[faces[i][1]];
-        Vec3f c = vertices[faces[i][2]];
-        vv.push_back(a);
-        vv.push_back(b);
-        vv.push_back(c);
+        // lower-left corner of the current tile
+        float dy = (float)i * ( size + gap );
+
+        // n tiles in x-direction
+        for( unsigned int j = columnBegin; j < columnEnd; ++j )
+        {
+            float dx = (float)j * ( size + gap );
+
+            // add the vertices, the triangle leaves out the upper right one of the quad
+            unsigned int first_index = ( ( i - rowBegin ) * columns + j - columnBegin ) * verticesPerTile;
+            Vec3f a = Vec3f( dx       , dy       ,              0.0f );
+            Vec3f b = Vec3f( dx + size, dy       , (float)j/(float)n );
+            Vec3f c = Vec3f( dx + size, dy + size, (float)j/(float)n );
+            Vec3f d = Vec3f( dx       , dy + size,              0.0f );
+            vertices[first_index    ] = a;
+            vertices[first_index + 1] = b;
+            if ( verticesPerTile == 4 )
+            {
+                vertices[first_index + 2] = c;
+                vertices[first_index + 3] = d;
+            }
+            else
+            {
+                vertices[first_index + 2] = d;
+            }
 
-        Vec3f n = calculateFaceNormal( a, b, c );
-        vn.push_back(n);
-        vn.push_back(n);
-        vn.push_back(n);
+            Vec3f fn = calculateFaceNormal( a, b, d );
 
-        indices.push_back(j++);
-        indices.push_back(j++);
-        indices.push_back(j++);
+            // Setup normals and indices
+            for( unsigned int k = 0; k < verticesPerTile; ++k )
+            {
+                normals[first_index + k] = fn;
+                indices[first_index + k] = first_index + k;
+            }
+        }
     }
 
     // Create a VertexAttributeSet with vertices and normals
-    VertexAttributeSetSharedPtr vasPtr = VertexAttributeSet::create();
+    VertexAttributeSetSharedPtr vasPtr = mesh.createVertexAttributeSet();
+
+    // Create a PrimitiveSet
+    IndexSetSharedPtr indexSet( indices.createIndexSet( false ) );
+
+    PrimitiveSharedPtr primitivePtr = Primitive::create();
     {
-        VertexAttributeSetWriteLock vas( vasPtr );
-        vas->setVertices( &vv[0], 60 );
-        vas->setNormals( &vn[0], 60 );
+        PrimitiveWriteLock primitive(primitivePtr);
+        primitive->setPrimitiveType( ( verticesPerTile == 4 ) ? PRIMITIVE_QUADS : PRIMITIVE_TRIANGLES );
+        primitive->setVertexAttributeSet( vasPtr );
+        primitive->setIndexSet( indexSet );
     }
 
-    {
-        // Create a PrimitiveSet
-        IndexSetSharedPtr indexSet( IndexSet::create() );
-        IndexSetWriteLock(indexSet)->setData( &indices[0], checked_cast<unsigned int>(indices.size()) );
+    // The right edge of the last column is raised the most
+    Vec3f lower( (float)columnBegin * ( size + gap ), (float)rowBegin * ( size + gap ), 0.0f );
+    Vec3f upper( (float)( columnEnd - 1 ) * ( size + gap ) + size, (float)( rowEnd - 1 ) * ( size + gap ) + size, (float)( columnEnd - 1 )/(float)n );
+    return( attachBounds( primitivePtr, makeBox( lower, upper ) ) );
+}
 
-        PrimitiveSharedPtr primitivePtr = Primitive::create();
+//! Helper function to get a block of at most \a maxCells cells of a \a columns x \a rows grid, as square as possible
+void getChunkSize( unsigned int maxCells, unsigned int columns, unsigned int rows, unsigned int &chunkColumns, unsigned int &chunkRows )
+{
+    NVSG_ASSERT( 0 < maxCells );
+    unsigned int side = std::max( 1u, (unsigned int)sqrtf( (float)maxCells ) );
+    chunkColumns = std::min( columns, side );
+    chunkRows = std::min( rows, std::max( 1u, maxCells / chunkColumns ) );
+}
+
+//! Helper function to create the tile set of createQuadSet or createTriSet in blocks of at most \a maxVertices vertices
+GroupSharedPtr createTileSetChunked( unsigned int verticesPerTile, unsigned int m, unsigned int n, const StateSetSharedPtr &stateSet,
+                                     unsigned int maxVertices, float size, float gap )
+{
+    NVSG_ASSERT( verticesPerTile <= maxVertices && "createTileSetChunked(): maxVertices is too small for a single tile." );
+
+    unsigned int chunkColumns, chunkRows;
+    getChunkSize( std::max( 1u, maxVertices / verticesPerTile ), n, m, chunkColumns, chunkRows );
+    const unsigned int format = getMeshFormat();
+
+    GroupSharedPtr groupPtr = Group::create();
+    GroupWriteLock group( groupPtr );
+    for ( unsigned int i = 0; i < m; i += chunkRows )
+    {
+        for ( unsigned int j = 0; j < n; j += chunkColumns )
         {
-            PrimitiveWriteLock primitive(primitivePtr);
-            primitive->setPrimitiveType( PRIMITIVE_TRIANGLES );
-            primitive->setVertexAttributeSet( vasPtr );
-            primitive->setIndexSet( indexSet );
+            DrawableSharedPtr chunk = createTileSet( verticesPerTile, n, j, std::min( n, j + chunkColumns ), i, std::min( m, i + chunkRows ), size, gap, format );
+            group->addChild( createGeoNode( chunk, stateSet ) );
         }
-
-        drawablePtr = primitivePtr;
     }
-
-    return drawablePtr;
+    return( groupPtr );
+}
 }
 
 // ===========================================================================
 
-DrawableSharedPtr createSphere( unsigned int m, unsigned int n, float radius )
+DrawableSharedPtr createQuadSet( unsigned int m, unsigned int n, const float size, const float gap )
 {
-    NVSG_ASSERT( m >= 3 && n >= 3 && "createSphere(): m and n both have to be at least 3." );
+    NVSG_ASSERT( m >= 1 && n >= 1 && "createQuadSet(): m and n both have to be at least 1." );
 
-    // create pointer to return
-    DrawableSharedPtr drawablePtr;
+    return( createTileSet( 4, n, 0, n, 0, m, size, gap, getMeshFormat() ) );
+}
 
-    // setup vertices, normals, indices/faces and texture coordinates
-    vector< Vec3f > vertices;
-    vector< Vec3f > tangents;
-    vector< Vec3f > binormals;
-    vector< Vec3f > normals;
-    vector< Vec2f > texcoords;
-    vector<unsigned int> indices;
-    vector< Face3 > faces;
+// ===========================================================================
 
-    const int size_v = ( m + 1 ) * n;
-    vertices.reserve( size_v );
-    tangents.reserve( size_v );
-    binormals.reserve( size_v );
-    normals.reserve( size_v );
-    texcoords.reserve( size_v );
-    indices.reserve( 6 * m * ( n - 1 ) );
-    faces.reserve( 2 * m * ( n - 1 ) );
+GroupSharedPtr createQuadSetChunked( unsigned int m, unsigned int n, const StateSetSharedPtr &stateSet, unsigned int maxVertices, const float size, const float gap )
+{
+    NVSG_ASSERT( m >= 1 && n >= 1 && "createQuadSetChunked(): m and n both have to be at least 1." );
 
-    float phi_step = 2.0f * PI / (float) m;
-    float theta_step = PI / (float) (n - 1);
+    return( createTileSetChunked( 4, m, n, stateSet, maxVertices, size, gap ) );
+}
 
-    // Latitudinal rings.
-    // Starting at the south pole going upwards.
-    for( unsigned int latitude = 0 ; latitude < n ; latitude++ ) // theta angle
-    {
-        float theta = (float) latitude * theta_step;
-        float sinTheta = sinf( theta );
-        float cosTheta = cosf( theta );
-        float texv = (float) latitude / (float) (n - 1); // Range [0.0f, 1.0f]
+// ===========================================================================
 
-        // Generate vertices along the latitudinal rings.
-        // On each latitude there are m + 1 vertices,
-        // the last one and the first one are on identical positions but have different texture coordinates.
-        for( unsigned int longitude = 0 ; longitude <= m ; longitude++ ) // phi angle
-        {
-            float phi = (float) longitude * phi_step;
-            float sinPhi = sinf( phi );
-            float cosPhi = cosf( phi );
-            float texu = (float) longitude / (float) m; // Range [0.0f, 1.0f]
+DrawableSharedPtr createQuadStrip( unsigned int n, float height, float radius )
+{
+    NVSG_ASSERT( n >= 1 && "createQuadStrip(): n has to be at least 1." );
 
-            // Unit sphere coordinates are the normals.
-            Vec3f v = Vec3f( cosPhi * sinTheta,
-                             -cosTheta,                 // -y to start at the south pole.
-                             -sinPhi * sinTheta );
+    // create pointer to return
+    DrawableSharedPtr drawablePtr;
 
-            vertices.push_back( v * radius );
-            texcoords.push_back( Vec2f( texu , texv ) );
-            normals.push_back( v );
-            tangents.push_back( Vec3f( -sinPhi, 0.0f, -cosPhi ) );
-            binormals.push_back( Vec3f( cosTheta * cosPhi, sinTheta, cosTheta * -sinPhi ) );
-        }
-    }
-    
-    // We have generated m + 1 vertices per latitude.
-    const unsigned int columns = m + 1;
+    // setup vertices, normals and indices
+    const unsigned int format = getMeshFormat();
+    const unsigned int size_v = 2*(n+1);
+    MeshVertices mesh( format, size_v );
+    VertexStream<Vec3f> vertices( mesh, VertexAttributeSet::NVSG_POSITION );
+    VertexStream<Vec3f> normals( mesh, VertexAttributeSet::NVSG_NORMAL );
+    MeshIndices indices( format, size_v, size_v );
 
-    // Calculate indices
-    for( unsigned int latitude = 0 ; latitude < n - 1 ; latitude++ )
+    // for n quads, we need 2*(n+1) vertices, so run to including n
+    for( unsigned int i = 0; i <= n; ++i )
     {
-        for( unsigned int longitude = 0 ; longitude < m ; longitude++ )
-        {
-            indices.push_back(  latitude      * columns + longitude     );  // lower left
-            indices.push_back(  latitude      * columns + longitude + 1 );  // lower right
-            indices.push_back( (latitude + 1) * columns + longitude + 1 );  // upper right
+        float phi = PI * ( 1.0f - (float)i/(float)n );
+        float x = cos(phi);
+        float z = sin(phi);
+        Vec3f v( x, 0.0f, z );
 
-            indices.push_back( (latitude + 1) * columns + longitude + 1 );  // upper right
-            indices.push_back( (latitude + 1) * columns + longitude     );  // upper left
-            indices.push_back(  latitude      * columns + longitude     );  // lower left
-        }
-    }
+        normals[i * 2] = v;
+        normals[i * 2 + 1] = v;
+        vertices[i * 2] = v * radius + Vec3f( 0.0f, height, 0.0f );
+        vertices[i * 2 + 1] = v * radius;
 
-    // Create a VertexAttributeSet with vertices, normals and texcoords
-    VertexAttributeSetSharedPtr vasPtr = VertexAttributeSet::create();
-    {
-        VertexAttributeSetWriteLock vas( vasPtr );
+        indices[i * 2] = i * 2;
+        indices[i * 2 + 1] = i * 2 + 1;
 
-        vas->setVertices( &vertices[0], size_v );
-        vas->setNormals( &normals[0], size_v );
-        vas->setTexCoords( 0, &texcoords[0], size_v );
-        vas->setTexCoords( VertexAttributeSet::NVSG_TANGENT  - VertexAttributeSet::NVSG_TEXCOORD0, &tangents[0], size_v );
-        vas->setTexCoords( VertexAttributeSet::NVSG_BINORMAL - VertexAttributeSet::NVSG_TEXCOORD0, &binormals[0], size_v );
     }
 
+    // Create a VertexAttributeSet with vertices and normals
+    VertexAttributeSetSharedPtr vasPtr = mesh.createVertexAttributeSet();
+
     {
         // Create a PrimitiveSet
-        IndexSetSharedPtr indexSet( IndexSet::create() );
-        IndexSetWriteLock(indexSet)->setData( &indices[0], checked_cast<unsigned int>(indices.size()) );
+        IndexSetSharedPtr indexSet( indices.createIndexSet( false ) );
 
         PrimitiveSharedPtr primitivePtr = Primitive::create();
         {
             PrimitiveWriteLock primitive(primitivePtr);
-            primitive->setPrimitiveType( PRIMITIVE_TRIANGLES );
+            primitive->setPrimitiveType( PRIMITIVE_QUAD_STRIP );
             primitive->setVertexAttributeSet( vasPtr );
             primitive->setIndexSet( indexSet );
         }
@@ -1452,685 +1078,2717 @@ DrawableSharedPtr createSphere( unsigned int m, unsigned int n, float radius )
         drawablePtr = primitivePtr;
     }
 
-    return drawablePtr;
+    // The half circle runs from -x over +z to +x
+    return( attachBounds( drawablePtr, makeBox( Vec3f( -radius, 0.0f, 0.0f ), Vec3f( radius, height, radius ) ) ) );
 }
 
-DrawableSharedPtr createCylinder( float r, float h, unsigned int hdivs, unsigned int thdivs, bool bOuter, float thstart /*= 0.0f*/, float thend /*= 2.0f*nvmath::PI*/ )
+// ===========================================================================
+
+DrawableSharedPtr createTriSet( unsigned int m, unsigned int n, const float size, const float gap )
 {
-    vector< Vec3f > vertices;
-    vector< Vec3f > normals;
-    vector< Vec2f > texcoords;
-    vector<unsigned int> indices;
+    NVSG_ASSERT( m >= 1 && n >= 1 && "createTriSet(): m and n both have to be at least 1." );
 
-    unsigned int size_v = (hdivs+1)*thdivs + 2*thdivs + 2;
+    return( createTileSet( 3, n, 0, n, 0, m, size, gap, getMeshFormat() ) );
+}
 
-    // ---Vertex order---
-    // 1) 1                 bottom center vert
-    // 2) thdivs            bottom rim
-    // 3) thdivs*(hdivs+1)  all height division circles including bottom and top rim
-    // 4) 1                 top center point
-    // 5) thdivs            top rim
+// ===========================================================================
 
-    float th_step = (thend - thstart) / (float) thdivs;
-    float h_step = h / (float) hdivs;
+GroupSharedPtr createTriSetChunked( unsigned int m, unsigned int n, const StateSetSharedPtr &stateSet, unsigned int maxVertices, const float size, const float gap )
+{
+    NVSG_ASSERT( m >= 1 && n >= 1 && "createTriSetChunked(): m and n both have to be at least 1." );
 
-    //-------------------------------
-    // Generate the vertices/normals
-    //-------------------------------
+    return( createTileSetChunked( 3, m, n, stateSet, maxVertices, size, gap ) );
+}
 
-    vertices.push_back( Vec3f( 0.0f, -h/2.0f, 0.0f ) );
-    normals.push_back( Vec3f( 0.0f, bOuter ? -1.0f : 1.0f, 0.0f) );
-    texcoords.push_back( Vec2f(0.5f, 0.5f) );
+// ===========================================================================
 
-    for(unsigned int ith = 0; ith < thdivs; ith++)
-    {
-        float curTh = thstart + ith*th_step;
-        vertices.push_back( Vec3f( r*cosf(curTh), -h/2.0f, r*sinf(curTh) ) );
-        normals.push_back( Vec3f( 0.0f, bOuter ? -1.0f : 1.0f, 0.0f) );
-        texcoords.push_back( Vec2f( 0.5f*cos(curTh) + 0.5f, 0.5f*sin(curTh) + 0.5f) );
-    }
+DrawableSharedPtr createTriFan( unsigned int n, const float radius, const float elevation )
+{
+    NVSG_ASSERT( n > 1 && "createTriFan(): n has to be at least 2." );
 
-    for(unsigned int ih = 0; ih < hdivs+1; ih++)
-    {
-        float curH = -h/2.0f + ih*h_step;
+    // create pointer to return
+    DrawableSharedPtr drawablePtr;
 
-        for(unsigned int ith = 0; ith < thdivs; ith++)
-        {
-            float curTh = thstart + ith*th_step;
+    // setup vertices and faces for n triangles
+    const unsigned int format = getMeshFormat();
+    MeshVertices mesh( format, n + 2 );
+    VertexStream<Vec3f> vertices( mesh, VertexAttributeSet::NVSG_POSITION );
+    VertexStream<Vec3f> normals( mesh, VertexAttributeSet::NVSG_NORMAL );
+    MeshIndices indices( format, n + 2, n + 2 );
+
+    // The rim points are needed for the face normals, which are summed up per vertex before they are written
+    vector<Vec3f> points;
+    points.reserve( n + 2 );
+    points.push_back( Vec3f( 0.0f, 0.0f, elevation ) );
+    points.push_back( Vec3f( radius, 0.0f, 0.0f ) );
 
-            vertices.push_back( Vec3f( r*cosf(curTh), curH, r*sinf(curTh)) );
-            normals.push_back( Vec3f( (bOuter ? 1.0f : -1.0f)*cosf(curTh), 0.0f, (bOuter ? 1.0f : -1.0f)*sinf(curTh)) );
-            texcoords.push_back( Vec2f( curTh/(thend - thstart), curH/h ) );
-        }
+    // n triangles ( i from 1 to n ! )
+    for( unsigned int i = 1; i <= n; ++i )
+    {
+        float phi = PI * ((float)i/(float)n);
+        float x = radius * cos(phi);
+        float y = radius * sin(phi);
+        points.push_back( Vec3f(x, y, 0.f) );
     }
 
-    vertices.push_back( Vec3f( 0.0f, h/2.0f, 0.0f ) );
-    normals.push_back( Vec3f( 0.0f, bOuter ? 1.0f : -1.0f, 0.0f) );
-    texcoords.push_back( Vec2f(0.5f, 0.5f) );
+    // Calculate normals
+    vector<Vec3f> sums( points.size(), Vec3f( 0.0f, 0.0f, 0.0f ) );
+    for( unsigned int i = 0; i < n; ++i )
+    {
+        // calculate face normal for face i
+        Vec3f fn = calculateFaceNormal( points[0], points[i+1], points[i+2] );
+        // accumulate in vertex normals
+        sums[0]   += fn;
+        sums[i+1] += fn;
+        sums[i+2] += fn;
+    }
 
-    for(unsigned int ith = 0; ith < thdivs; ith++)
+    for( unsigned int i = 0; i < n + 2; ++i )
     {
-        float curTh = thstart + ith*th_step;
-        vertices.push_back( Vec3f( r*cosf(curTh), h/2.0f, r*sinf(curTh) ) );
-        normals.push_back( Vec3f( 0.0f, bOuter ? 1.0f : -1.0f, 0.0f ) );
-        texcoords.push_back( Vec2f( 0.5f*cos(curTh) + 0.5f, 0.5f*sin(curTh) + 0.5f) );
+        sums[i].normalize();
+        vertices[i] = points[i];
+        normals[i] = sums[i];
+        indices[i] = i;
     }
 
+    // Create a VertexAttributeSet with vertices and normals
+    VertexAttributeSetSharedPtr vasPtr = mesh.createVertexAttributeSet();
+
+    {
+        // Create a PrimitiveSet
+        IndexSetSharedPtr indexSet( indices.createIndexSet( false ) );
+
+        PrimitiveSharedPtr primitivePtr = Primitive::create();
+        {
+            PrimitiveWriteLock primitive(primitivePtr);
+            primitive->setPrimitiveType( PRIMITIVE_TRIANGLE_FAN );
+            primitive->setVertexAttributeSet( vasPtr );
+            primitive->setIndexSet( indexSet );
+        }
+
+        drawablePtr = primitivePtr;
+    }
+
+    // The half circle runs from +x over +y to -x, the center is lifted by elevation
+    return( attachBounds( drawablePtr, makeBox( Vec3f( -radius, 0.0f, 0.0f ), Vec3f( radius, radius, elevation ) ) ) );
+}
+
+// ===========================================================================
+
+DrawableSharedPtr createTriStrip( unsigned int rows, unsigned int columns, float width, float height )
+{
+    NVSG_ASSERT( rows >= 1 && columns >= 1 && "createTriStrip(): rows and columns both have to be at least 1." );
+
+    // create pointer to return
+    DrawableSharedPtr drawablePtr;
+
+    // Setup vertices, normals and indices
+    const unsigned int format = getMeshFormat();
+    unsigned int size_v = ( rows + 1 ) * ( columns + 1 );
+    MeshVertices mesh( format, size_v );
+    VertexStream<Vec3f> vertices( mesh, VertexAttributeSet::NVSG_POSITION );
+    VertexStream<Vec3f> normals( mesh, VertexAttributeSet::NVSG_NORMAL );
+    MeshIndices indices( format, size_v, 2 * rows * ( columns + 1 ) );
+
+    unsigned int k = 0;
+    for( unsigned int i = 0; i <= rows; ++i )
+    {
+        for( unsigned int j = 0; j <= columns; ++j )
+        {
+            vertices[k] = Vec3f( j * width, i * height, 0.0f );
+            normals[k] = Vec3f( 0.0f, 0.0f, 1.0f );
+            ++k;
+        }
+    }
+
+    k = 0;
+    for( unsigned int i = 0; i < rows; ++i )
+    {
+        for( unsigned int j = 0; j <= columns; ++j )
+        {
+            indices[k++] = i * ( columns + 1 ) + j + columns + 1;
+            indices[k++] = i * ( columns + 1 ) + j;
+        }
+    }
+
+    // Create a VertexAttributeSet with vertices and normals
+    VertexAttributeSetSharedPtr vasPtr = mesh.createVertexAttributeSet();
+
+    {
+        // Create a PrimitiveSet
+        IndexSetSharedPtr indexSet( indices.createIndexSet( false ) );
+
+        PrimitiveSharedPtr primitivePtr = Primitive::create();
+        {
+            PrimitiveWriteLock primitive(primitivePtr);
+            primitive->setPrimitiveType( PRIMITIVE_TRIANGLE_STRIP );
+            primitive->setVertexAttributeSet( vasPtr );
+            primitive->setIndexSet( indexSet );
+        }
+
+        drawablePtr = primitivePtr;
+    }
+
+    /*
+    FaceAttributeSharedPtr faceHdl = FaceAttribute::create();
+    {
+      FaceAttributeWriteLock(faceHdl)->setTwoSidedLighting( true );
+      FaceAttributeWriteLock(faceHdl)->setCullMode( false, false );
+    }
+    */
+
+    return( attachBounds( drawablePtr, makeBox( Vec3f( 0.0f, 0.0f, 0.0f ), Vec3f( columns * width, rows * height, 0.0f ) ) ) );
+}
+
+// ===========================================================================
+
+GeoNodeSharedPtr createTriPatches4( const std::vector<std::string> & searchPaths, unsigned int m, unsigned int n, const Vec3f & size, const Vec2f & offset )
+{
+    // Create a StateSet with a Material and a CgFx first
+    StateSetSharedPtr stateSet = createPatchesStateSet( "phongTessPatch10V.fx", searchPaths );
+
+    // Set up the tri patch:
+    //  9
+    //  7 8
+    //  4 5 6
+    //  0 1 2 3
+    //
+    Vec3f verts[10] =
+    {
+        Vec3f(size[0]*0.0f/4.0f, size[1]*0.0f/4.0f, size[2]*0.0f/4.0f), // 0
+        Vec3f(size[0]*1.0f/4.0f, size[1]*0.0f/4.0f, size[2]*1.0f/4.0f), // 1
+        Vec3f(size[0]*2.0f/4.0f, size[1]*0.0f/4.0f, size[2]*1.0f/4.0f), // 2
+        Vec3f(size[0]*3.0f/4.0f, size[1]*0.0f/4.0f, size[2]*0.0f/4.0f), // 3
+        Vec3f(size[0]*0.0f/4.0f, size[1]*1.0f/4.0f, size[2]*1.0f/4.0f), // 4
+        Vec3f(size[0]*1.0f/4.0f, size[1]*1.0f/4.0f, size[2]*2.0f/4.0f), // 5
+        Vec3f(size[0]*2.0f/4.0f, size[1]*1.0f/4.0f, size[2]*1.0f/4.0f), // 6
+        Vec3f(size[0]*0.0f/4.0f, size[1]*2.0f/4.0f, size[2]*1.0f/4.0f), // 7
+        Vec3f(size[0]*1.0f/4.0f, size[1]*2.0f/4.0f, size[2]*1.0f/4.0f), // 8
+        Vec3f(size[0]*0.0f/4.0f, size[1]*3.0f/4.0f, size[2]*0.0f/4.0f)  // 9
+    };
+
+    std::vector<Vec3f> vertices;
+
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+
+    for( unsigned int i = 0; i < m; ++i )
+    {
+        for( unsigned int j = 0; j < n; ++j )
+        {
+            for( unsigned int k = 0; k < 10; ++k )
+            {
+                vertices.push_back( verts[k] + Vec3f(x, y, z) );
+            }
+            x += offset[0];
+        }
+        y += offset[1];
+        x = 0.0f;
+    }
+
+    // Create a GeoNode
+    GeoNodeSharedPtr geoNode = GeoNode::create();
+
+    // Without any patch ( m or n is zero ) there is no drawable, leave the GeoNode empty
+    if ( vertices.empty() )
+    {
+        return geoNode;
+    }
+
+    if ( ! stateSet )
+    {
+        // Without the tessellation shader, tessellate the patches on the CPU
+        GeoNodeWriteLock( geoNode )->addDrawable( createPatchesMaterialStateSet(), tessellateTriPatches4( vertices ) );
+        return geoNode;
+    }
+
+    // Create a VertexAttributeSet
+    VertexAttributeSetSharedPtr vas = VertexAttributeSet::create();
+    VertexAttributeSetWriteLock( vas )->setVertices( &vertices[0], checked_cast<unsigned int>(vertices.size()) );
+
+    // Create a TriPatches4
+    TriPatches4SharedPtr triPatches = TriPatches4::create();
+    TriPatches4WriteLock( triPatches )->setVertexAttributeSet( vas );
+
+    // Add the geometry
+    GeoNodeWriteLock( geoNode )->addDrawable( stateSet, triPatches );
+
+    return geoNode;
+}
+
+// ===========================================================================
+
+GeoNodeSharedPtr createQuadPatches4x4( const std::vector<std::string> & searchPaths, unsigned int n, unsigned int m, const Vec2f & offset )
+{
+    // Create a StateSet with a Material and a CgFx
+    StateSetSharedPtr stateSet = createPatchesStateSet( "phongTessPatch16V.fx", searchPaths );
+
+    const float r = std::min( offset[0], offset[1] )/2.0f * 0.75f;
+    const float dy = r;  // distance between rows of vertices
+
+    // For a cylinder, we need four quad patches, each extruding an approximation
+    // of a quarter of a circle
+
+    // For a bezier curve to approximate a quarter of a circle, we need to use a
+    // cubic bezier curve with inner points at a distance x of r*4(sqrt(2)-1)/3 from
+    // the end points in the tangent direction at the end points:
+    //
+    //   0--d--1
+    //   |      \
+    //   r       2
+    //   |       |
+    //   *       3
+    //
+    
+    // Distance of the boundary control points to the corner control points
+    const float d = r * 4.0f * (sqrt(2.0f)-1.0f)/3.0f;
+
+    // A zero for nice alignment
+    const float o = 0.0f;
+    
+    // First construct the bezier curves to be extruded
+    Vec3f bezierCurves[16];
+    bezierCurves[ 0] = Vec3f( o, o, r ); //
+    bezierCurves[ 1] = Vec3f( d, o, r ); //
+    bezierCurves[ 2] = Vec3f( r, o, d ); //
+    bezierCurves[ 3] = Vec3f( r, o, o ); //        |
+    bezierCurves[ 4] = Vec3f( r, o, o ); //        |
+    bezierCurves[ 5] = Vec3f( r, o,-d ); //      9 786
+    bezierCurves[ 6] = Vec3f( d, o,-r ); //     A  |  5
+    bezierCurves[ 7] = Vec3f( o, o,-r ); //  --BC-----34--x
+    bezierCurves[ 8] = Vec3f( o, o,-r ); //     D  |  2
+    bezierCurves[ 9] = Vec3f(-d, o,-r ); //      E F0 1
+    bezierCurves[10] = Vec3f(-r, o,-d ); //        |
+    bezierCurves[11] = Vec3f(-r, o, o ); //        z
+    bezierCurves[12] = Vec3f(-r, o, o ); //
+    bezierCurves[13] = Vec3f(-r, o, d ); //
+    bezierCurves[14] = Vec3f(-d, o, r ); //
+    bezierCurves[15] = Vec3f( o, o, r ); //
+
+    // Extrude the curves to form the patches
+    //            y  C D E F
+    // one patch: |  8 9 A B
+    //            |  4 5 6 7
+    //            O  0 1 2 3
+    vector< Vec3f > verts;
+    for( unsigned int i = 0; i < 4; ++i )
+    {
+        // patch i
+        for( unsigned int j = 0; j < 4; ++j )
+        {
+            // row j
+            for( unsigned int k = 0; k < 4; ++k )
+            {
+                // column k
+                verts.push_back( bezierCurves[i*4+k] + Vec3f( o, dy*j, o ));
+            }
+        }
+    }
+
+    // Generate n x m cylinders
+    vector< Vec3f > vertices;
+    for( unsigned int i = 0; i < n; ++i )
+    {
+        for( unsigned int j = 0; j < m; ++j )
+        {
+            float x = i * offset[0];
+            float z = j * offset[1];
+            for( unsigned int k = 0; k < verts.size(); ++k )
+            {
+                vertices.push_back( verts.at( k ) + Vec3f( x, o, z ) );
+            }
+        }
+    }
+
+    // Create a GeoNode
+    GeoNodeSharedPtr geoNode = GeoNode::create();
+
+    // Without any patch ( m or n is zero ) there is no drawable, leave the GeoNode empty
+    if ( vertices.empty() )
+    {
+        return geoNode;
+    }
+
+    if ( ! stateSet )
+    {
+        // Without the tessellation shader, tessellate the patches on the CPU
+        GeoNodeWriteLock( geoNode )->addDrawable( createPatchesMaterialStateSet(), tessellateQuadPatches4x4( vertices ) );
+        return geoNode;
+    }
+
+    // Create a VertexAttributeSet
+    VertexAttributeSetSharedPtr vas = VertexAttributeSet::create();
+    VertexAttributeSetWriteLock( vas )->setVertices( &vertices[0], checked_cast<unsigned int>( vertices.size() ) );
+
+    // Create a PrimitiveSet
+    QuadPatches4x4SharedPtr patches = QuadPatches4x4::create();
+    QuadPatches4x4WriteLock( patches )->setVertexAttributeSet( vas );
+
+    // Add the geometry
+    GeoNodeWriteLock( geoNode )->addDrawable( stateSet, patches );
+
+    return geoNode;
+}
+
+// ===========================================================================
+
+DrawableSharedPtr createCube()
+{
+    return( createPolyhedron( polyhedronTables[POLYHEDRON_CUBE], getMeshFormat() ) );
+}
+
+// ===========================================================================
+
+DrawableSharedPtr createTetrahedron()
+{
+    return( createPolyhedron( polyhedronTables[POLYHEDRON_TETRAHEDRON], getMeshFormat() ) );
+}
+
+// ===========================================================================
+
+DrawableSharedPtr createOctahedron()
+{
+    return( createPolyhedron( polyhedronTables[POLYHEDRON_OCTAHEDRON], getMeshFormat() ) );
+}
+
+// ===========================================================================
+
+DrawableSharedPtr createDodecahedron()
+{
+    return( createPolyhedron( polyhedronTables[POLYHEDRON_DODECAHEDRON], getMeshFormat() ) );
+}
+
+// ===========================================================================
+
+DrawableSharedPtr createIcosahedron()
+{
+    return( createPolyhedron( polyhedronTables[POLYHEDRON_ICOSAHEDRON], getMeshFormat() ) );
+}
+
+// ===========================================================================
+
+DrawableSharedPtr getSharedPolyhedron( Polyhedron polyhedron )
+{
+    NVSG_ASSERT( polyhedron < POLYHEDRON_COUNT );
+
+    const unsigned int format = getMeshFormat();
+    QMutexLocker lock( &sharedPolyhedraMutex );
+    DrawableSharedPtr &drawable = sharedPolyhedra[std::make_pair( (unsigned int)polyhedron, format )];
+    if ( !drawable )
+    {
+        drawable = createPolyhedron( polyhedronTables[polyhedron], format );
+    }
+    return( drawable );
+}
+
+// ===========================================================================
+
+void releaseSharedPolyhedra()
+{
+    QMutexLocker lock( &sharedPolyhedraMutex );
+    sharedPolyhedra.clear();
+}
+
+// ===========================================================================
+
+DrawableSharedPtr createIcoSphere( unsigned int level, float radius )
+{
+    NVSG_ASSERT( level <= 12 && "createIcoSphere(): level has to be at most 12." );
+
+    // create pointer to return
+    DrawableSharedPtr drawablePtr;
+
+    // Each subdivision splits every triangle into four, the shared edges give 10 * 4^level + 2 vertices.
+    const unsigned int size_v = 10 * ( 1 << ( 2 * level ) ) + 2;
+    const unsigned int size_f = 20 * ( 1 << ( 2 * level ) );
+
+    // On the unit sphere the points are the normals.
+    vector< Vec3f > normals;
+    vector<unsigned int> indices;
+    normals.reserve( size_v );
+    indices.reserve( 3 * size_f );
+
+    normals.assign( icosahedronVertices, icosahedronVertices + 12 );
+    for ( unsigned int i = 0; i < 20; ++i )
+    {
+        indices.push_back( icosahedronFaces[i][0] );
+        indices.push_back( icosahedronFaces[i][1] );
+        indices.push_back( icosahedronFaces[i][2] );
+    }
+
+    for ( unsigned int l = 0; l < level; ++l )
+    {
+        //       c
+        //      / \
+        //    ca---bc
+        //    / \ / \
+        //   a---ab---b
+        map< pair<unsigned int, unsigned int>, unsigned int > midpoints;
+        vector<unsigned int> subdivided;
+        subdivided.reserve( 4 * indices.size() );
+
+        for ( size_t i = 0; i < indices.size(); i += 3 )
+        {
+            unsigned int a = indices[i];
+            unsigned int b = indices[i+1];
+            unsigned int c = indices[i+2];
+
+            unsigned int ab = getMidpoint( a, b, midpoints, normals );
+            unsigned int bc = getMidpoint( b, c, midpoints, normals );
+            unsigned int ca = getMidpoint( c, a, midpoints, normals );
+
+            subdivided.push_back( a );  subdivided.push_back( ab ); subdivided.push_back( ca );
+            subdivided.push_back( b );  subdivided.push_back( bc ); subdivided.push_back( ab );
+            subdivided.push_back( c );  subdivided.push_back( ca ); subdivided.push_back( bc );
+            subdivided.push_back( ab ); subdivided.push_back( bc ); subdivided.push_back( ca );
+        }
+
+        indices.swap( subdivided );
+    }
+    NVSG_ASSERT( normals.size() == size_v && indices.size() == 3 * size_f );
+
+    // Write the final vertices and indices of the subdivided sphere
+    const unsigned int format = getMeshFormat();
+    MeshVertices mesh( format, size_v );
+    VertexStream< Vec3f > vertexStream( mesh, VertexAttributeSet::NVSG_POSITION );
+    VertexStream< Vec3f > normalStream( mesh, VertexAttributeSet::NVSG_NORMAL );
+    MeshIndices indexStream( format, size_v, 3 * size_f );
+    for ( unsigned int i = 0; i < size_v; ++i )
+    {
+        vertexStream[i] = normals[i] * radius;
+    }
+    normalStream.writeRow( 0, &normals[0], size_v );
+    for ( unsigned int i = 0; i < 3 * size_f; ++i )
+    {
+        indexStream[i] = indices[i];
+    }
+
+    // Create a VertexAttributeSet with vertices and normals
+    VertexAttributeSetSharedPtr vasPtr = mesh.createVertexAttributeSet();
+
+    {
+        // Create a PrimitiveSet
+        IndexSetSharedPtr indexSet( indexStream.createIndexSet( false ) );
+
+        PrimitiveSharedPtr primitivePtr = Primitive::create();
+        {
+            PrimitiveWriteLock primitive(primitivePtr);
+            primitive->setPrimitiveType( PRIMITIVE_TRIANGLES );
+            primitive->setVertexAttributeSet( vasPtr );
+            primitive->setIndexSet( indexSet );
+        }
+
+        drawablePtr = primitivePtr;
+    }
+
+    // From level 1 on, the edge midpoints reach the axes
+    const float extent = level ? radius : icoZ * radius;
+    return( attachBounds( drawablePtr, makeBox( Vec3f( -extent, -extent, -extent ), Vec3f( extent, extent, extent ) )
+                        , Sphere3f( Vec3f( 0.0f, 0.0f, 0.0f ), fabsf( radius ) ) ) );
+}
+
+// ===========================================================================
+
+DrawableSharedPtr createSphere( unsigned int m, unsigned int n, float radius )
+{
+    NVSG_ASSERT( m >= 3 && n >= 3 && "createSphere(): m and n both have to be at least 3." );
+
+    // create pointer to return
+    DrawableSharedPtr drawablePtr;
+
+    // setup vertices, normals, indices and texture coordinates
+    const unsigned int size_v = ( m + 1 ) * n;
+    const unsigned int format = getMeshFormat();
+    MeshVertices mesh( format, size_v );
+    VertexStream< Vec3f > vertices( mesh, VertexAttributeSet::NVSG_POSITION );
+    VertexStream< Vec3f > tangents( mesh, VertexAttributeSet::NVSG_TANGENT );
+    VertexStream< Vec3f > binormals( mesh, VertexAttributeSet::NVSG_BINORMAL );
+    VertexStream< Vec3f > normals( mesh, VertexAttributeSet::NVSG_NORMAL );
+    VertexStream< Vec2f > texcoords( mesh, VertexAttributeSet::NVSG_TEXCOORD0 );
+    const bool strips = useTriangleStrips( format );
+    MeshIndices indices( format, size_v, strips ? getGridStripIndexCount( m, n - 1 ) : 6 * m * ( n - 1 ) );
+
+    float phi_step = 2.0f * PI / (float) m;
+    float theta_step = PI / (float) (n - 1);
+
+    // The longitudinal sines and cosines are the same on every ring, calculate them only once.
+    // On each latitude there are m + 1 vertices,
+    // the last one and the first one are on identical positions but have different texture coordinates.
+    RingTable &ring = getRingTableScratch();
+    computeRingTable( m + 1, 0.0f, phi_step, 1.0f / ( 2.0f * PI ), ring );
+
+    // Latitudinal rings.
+    // Starting at the south pole going upwards.
+    for( unsigned int latitude = 0 ; latitude < n ; latitude++ ) // theta angle
+    {
+        float theta = (float) latitude * theta_step;
+        float sinTheta = sinf( theta );
+        float cosTheta = cosf( theta );
+        float texv = (float) latitude / (float) (n - 1); // Range [0.0f, 1.0f]
+
+        unsigned int first = latitude * ( m + 1 );
+
+        // Unit sphere coordinates are the normals: ( cosPhi * sinTheta, -cosTheta, -sinPhi * sinTheta ), -y to start at the south pole.
+        writeRingRow( ring, sinTheta, 0.0f, -cosTheta, 0.0f, -sinTheta, normals, first );
+        writeRingRow( ring, radius * sinTheta, 0.0f, -radius * cosTheta, 0.0f, -radius * sinTheta, vertices, first );
+        // ( -sinPhi, 0.0f, -cosPhi )
+        writeRingRow( ring, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, tangents, first );
+        // ( cosTheta * cosPhi, sinTheta, cosTheta * -sinPhi )
+        writeRingRow( ring, cosTheta, 0.0f, sinTheta, 0.0f, -cosTheta, binormals, first );
+        writeRingTexCoords( ring, texv, texcoords, first );
+    }
+    
+    // We have generated m + 1 vertices per latitude.
+    const unsigned int columns = m + 1;
+
+    // Calculate indices
+    unsigned int k = 0;
+    for( unsigned int latitude = 0 ; latitude < n - 1 && !strips ; latitude++ )
+    {
+        for( unsigned int longitude = 0 ; longitude < m ; longitude++ )
+        {
+            indices[k++] =  latitude      * columns + longitude;        // lower left
+            indices[k++] =  latitude      * columns + longitude + 1;    // lower right
+            indices[k++] = (latitude + 1) * columns + longitude + 1;    // upper right
+
+            indices[k++] = (latitude + 1) * columns + longitude + 1;    // upper right
+            indices[k++] = (latitude + 1) * columns + longitude;        // upper left
+            indices[k++] =  latitude      * columns + longitude;        // lower left
+        }
+    }
+    if ( strips )
+    {
+        setupGridStrips( m, n - 1, 0, indices, 0 );
+    }
+
+    // Create a VertexAttributeSet with vertices, normals and texcoords
+    VertexAttributeSetSharedPtr vasPtr = mesh.createVertexAttributeSet();
+
+    {
+        // Create a PrimitiveSet
+        IndexSetSharedPtr indexSet( indices.createIndexSet( strips ) );
+
+        PrimitiveSharedPtr primitivePtr = Primitive::create();
+        {
+            PrimitiveWriteLock primitive(primitivePtr);
+            primitive->setPrimitiveType( strips ? PRIMITIVE_TRIANGLE_STRIP : PRIMITIVE_TRIANGLES );
+            primitive->setVertexAttributeSet( vasPtr );
+            primitive->setIndexSet( indexSet );
+        }
+
+        drawablePtr = primitivePtr;
+    }
+
+    return( attachBounds( drawablePtr, makeBox( Vec3f( -radius, -radius, -radius ), Vec3f( radius, radius, radius ) )
+                        , Sphere3f( Vec3f( 0.0f, 0.0f, 0.0f ), fabsf( radius ) ) ) );
+}
+
+DrawableSharedPtr createCylinder( float r, float h, unsigned int hdivs, unsigned int thdivs, bool bOuter, float thstart /*= 0.0f*/, float thend /*= 2.0f*nvmath::PI*/ )
+{
+    unsigned int size_v = (hdivs+1)*thdivs + 2*thdivs + 2;
+
+    // ---Vertex order---
+    // 1) 1                 bottom center vert
+    // 2) thdivs            bottom rim
+    // 3) thdivs*(hdivs+1)  all height division circles including bottom and top rim
+    // 4) 1                 top center point
+    // 5) thdivs            top rim
+
+    float th_step = (thend - thstart) / (float) thdivs;
+    float h_step = h / (float) hdivs;
+
+    const unsigned int format = getMeshFormat();
+    MeshVertices mesh( format, size_v );
+    VertexStream< Vec3f > vertices( mesh, VertexAttributeSet::NVSG_POSITION );
+    VertexStream< Vec3f > normals( mesh, VertexAttributeSet::NVSG_NORMAL );
+    VertexStream< Vec2f > texcoords( mesh, VertexAttributeSet::NVSG_TEXCOORD0 );
+    MeshIndices indices( format, size_v, 3 * thdivs + 6 * hdivs * thdivs + 3 * thdivs );
+
+    // The sines and cosines around the axis are the same for every circle, calculate them only once.
+    RingTable &ring = getRingTableScratch();
+    computeRingTable( thdivs, thstart, th_step, 1.0f / (thend - thstart), ring );
+
+    const float side = bOuter ? 1.0f : -1.0f;
+
+    //-------------------------------
+    // Generate the vertices/normals
+    //-------------------------------
+
+    unsigned int bottomCenter = 0;
+    unsigned int topCenter = 1 + thdivs + (hdivs+1)*thdivs;
+
+    for ( unsigned int cap = 0; cap < 2; cap++ )
+    {
+        unsigned int center = cap ? topCenter : bottomCenter;
+        float capH = cap ? h/2.0f : -h/2.0f;
+        Vec3f capNormal( 0.0f, cap ? side : -side, 0.0f );
+
+        vertices[center] = Vec3f( 0.0f, capH, 0.0f );
+        normals[center] = capNormal;
+        texcoords[center] = Vec2f( 0.5f, 0.5f );
+
+        // the rim
+        writeRingRow( ring, r, 0.0f, capH, 0.0f, r, vertices, center + 1 );
+        for ( unsigned int ith = 0; ith < thdivs; ith++ )
+        {
+            normals[center + 1 + ith] = capNormal;
+            texcoords[center + 1 + ith] = Vec2f( 0.5f*ring.cosines[ith] + 0.5f, 0.5f*ring.sines[ith] + 0.5f );
+        }
+    }
+
+    for(unsigned int ih = 0; ih < hdivs+1; ih++)
+    {
+        float curH = -h/2.0f + ih*h_step;
+        unsigned int first = 1 + thdivs + ih * thdivs;
+
+        writeRingRow( ring, r, 0.0f, curH, 0.0f, r, vertices, first );
+        writeRingRow( ring, side, 0.0f, 0.0f, 0.0f, side, normals, first );
+        writeRingTexCoords( ring, curH/h, texcoords, first );
+    }
+
+    //-------------------------------
+    // Generate the indices
+    //-------------------------------
+
+    int curvcount = 0;
+    unsigned int k = 0;
+
+    for(unsigned int ith = 0; ith < thdivs; ith++)
+    {
+        indices[k++] = curvcount;
+        indices[k++] = curvcount+1 + ith;
+        indices[k++] = curvcount+2 + (ith < thdivs-1 ? ith : -1);
+    }
+
+
+
+    curvcount += 1 + thdivs;
+
+    for(unsigned int ih = 0; ih < hdivs; ih++)
+    {
+        for(unsigned int ith = 0; ith < thdivs; ith++)
+        {
+            indices[k++] = curvcount+ith;
+            indices[k++] = curvcount+ith+thdivs;
+            indices[k++] = curvcount+(ith < thdivs-1 ? ith+1 : 0);
+
+            indices[k++] = curvcount+ith+thdivs;
+            indices[k++] = curvcount+(ith < thdivs-1 ? ith+1 : 0) + thdivs;
+            indices[k++] = curvcount+(ith < thdivs-1 ? ith+1 : 0);
+        }
+
+        curvcount += thdivs;
+    }
+
+    curvcount += thdivs;
+
+
+    for(unsigned int ith = 0; ith < thdivs; ith++)
+    {
+        indices[k++] = curvcount;
+        indices[k++] = curvcount+2 + (ith < thdivs-1 ? ith : -1);
+        indices[k++] = curvcount+1 + ith;
+    }
+
+
+
+    //-------------------------------
+    // Register the primitive
+    //-------------------------------
+
+    VertexAttributeSetSharedPtr vasPtr = mesh.createVertexAttributeSet();
+
+    IndexSetSharedPtr indexSet( indices.createIndexSet( false ) );
+
+    PrimitiveSharedPtr primitivePtr = Primitive::create();
+    {
+        PrimitiveWriteLock primitive(primitivePtr);
+        primitive->setPrimitiveType( PRIMITIVE_TRIANGLES );
+        primitive->setVertexAttributeSet( vasPtr );
+        primitive->setIndexSet( indexSet );
+    }
+
+    DrawableSharedPtr drawablePtr = primitivePtr;
+
+    return( attachBounds( drawablePtr, makeBox( Vec3f( -r, -h/2.0f, -r ), Vec3f( r, h/2.0f, r ) )
+                        , Sphere3f( Vec3f( 0.0f, 0.0f, 0.0f ), sqrtf( r*r + h*h/4.0f ) ) ) );
+}
+
+// ===========================================================================
+
+DrawableSharedPtr createTorus( unsigned int m, unsigned int n, float innerRadius , float outerRadius )
+{
+    // The torus is a ring with radius outerRadius rotated around the y-axis along the circle with innerRadius.
+    
+    /*           y
+       ___       |       ___
+     /     \           /     \
+    |       |    |    |       |
+    |       |         |       |
+     \ ___ /     |     \ ___ /
+                          <--->
+                          outerRadius
+                 <------->
+                 innerRadius
+    */
+
+    NVSG_ASSERT( m >= 3 && n >= 3 && "createTorus(): m and n both have to be at least 3." );
+
+    // create pointer to return
+    DrawableSharedPtr drawablePtr;
+
+    unsigned int size_v = ( m + 1 ) * ( n + 1 );
+
+    const unsigned int format = getMeshFormat();
+    MeshVertices mesh( format, size_v );
+    VertexStream< Vec3f > vertices( mesh, VertexAttributeSet::NVSG_POSITION );
+    VertexStream< Vec3f > tangents( mesh, VertexAttributeSet::NVSG_TANGENT );
+    VertexStream< Vec3f > binormals( mesh, VertexAttributeSet::NVSG_BINORMAL );
+    VertexStream< Vec3f > normals( mesh, VertexAttributeSet::NVSG_NORMAL );
+    VertexStream< Vec2f > texcoords( mesh, VertexAttributeSet::NVSG_TEXCOORD0 );
+    const bool strips = useTriangleStrips( format );
+    MeshIndices indices( format, size_v, strips ? getGridStripIndexCount( m, n ) : 4 * m * n );
+
+    float mf = (float) m;
+    float nf = (float) n;
+
+    float phi_step   = 2.0f * PI / mf;
+    float theta_step = 2.0f * PI / nf;
+
+    // The longitudinal sines and cosines are the same on every ring, calculate them only once.
+    RingTable &ring = getRingTableScratch();
+    computeRingTable( m + 1, 0.0f, phi_step, 1.0f / ( 2.0f * PI ), ring );
+
+    // Setup vertices and normals
+    // Generate the Torus exactly like the sphere with rings around the origin along the latitudes.
+    for ( unsigned int latitude = 0; latitude <= n; latitude++ ) // theta angle
+    {
+        float theta = (float) latitude * theta_step;
+        float sinTheta = sinf(theta);
+        float cosTheta = cosf(theta);
+
+        float radius = innerRadius + outerRadius * cosTheta;
+
+        unsigned int first = latitude * ( m + 1 );
+
+        // ( radius * cosPhi, outerRadius * sinTheta, radius * -sinPhi )
+        writeRingRow( ring, radius, 0.0f, outerRadius * sinTheta, 0.0f, -radius, vertices, first );
+        // ( -sinPhi, 0.0f, -cosPhi )
+        writeRingRow( ring, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, tangents, first );
+        // ( cosPhi * -sinTheta, cosTheta, sinPhi * sinTheta )
+        writeRingRow( ring, -sinTheta, 0.0f, cosTheta, 0.0f, sinTheta, binormals, first );
+        // ( cosPhi * cosTheta, sinTheta, -sinPhi * cosTheta )
+        writeRingRow( ring, cosTheta, 0.0f, sinTheta, 0.0f, -cosTheta, normals, first );
+        writeRingTexCoords( ring, (float) latitude / nf, texcoords, first );
+    }
+
+    const unsigned int columns = m + 1;
+
+    // Setup indices
+    unsigned int k = 0;
+    for( unsigned int latitude = 0 ; latitude < n && !strips ; latitude++ )
+    {
+        for( unsigned int longitude = 0 ; longitude < m ; longitude++ )
+        {
+            indices[k++] =  latitude      * columns + longitude;        // lower left
+            indices[k++] =  latitude      * columns + longitude + 1;    // lower right
+            indices[k++] = (latitude + 1) * columns + longitude + 1;    // upper right
+            indices[k++] = (latitude + 1) * columns + longitude;        // upper left
+        }
+    }
+    if ( strips )
+    {
+        setupGridStrips( m, n, 0, indices, 0 );
+    }
+    
+    // Create a VertexAttributeSet with vertices, normals and texture coordinates
+    VertexAttributeSetSharedPtr vasPtr = mesh.createVertexAttributeSet();
+    
+    {
+        // Create a PrimitiveSet
+        IndexSetSharedPtr indexSet( indices.createIndexSet( strips ) );
+
+        PrimitiveSharedPtr primitivePtr = Primitive::create();
+        {
+            PrimitiveWriteLock primitive(primitivePtr);
+            primitive->setPrimitiveType( strips ? PRIMITIVE_TRIANGLE_STRIP : PRIMITIVE_QUADS );
+            primitive->setVertexAttributeSet( vasPtr );
+            primitive->setIndexSet( indexSet );
+        }
+
+        drawablePtr = primitivePtr;
+    }
+
+    const float extent = innerRadius + fabsf( outerRadius );
+    return( attachBounds( drawablePtr, makeBox( Vec3f( -extent, -outerRadius, -extent ), Vec3f( extent, outerRadius, extent ) )
+                        , Sphere3f( Vec3f( 0.0f, 0.0f, 0.0f ), extent ) ) );
+}
+
+// ===========================================================================
+
+DrawableSharedPtr createTessellatedPlane( unsigned int subdiv, const Mat44f &transf )
+{
+    return( createTessellatedPlanePart( subdiv, transf, 0, subdiv + 1, 0, subdiv + 1, getMeshFormat() ) );
+}
+
+// ===========================================================================
+
+GroupSharedPtr createTessellatedPlaneChunked( unsigned int subdiv, const StateSetSharedPtr &stateSet, unsigned int maxVertices, const Mat44f &transf )
+{
+    NVSG_ASSERT( 4 <= maxVertices && "createTessellatedPlaneChunked(): maxVertices is too small for a single cell." );
+
+    // A block of c x r cells has ( c + 1 ) * ( r + 1 ) vertices
+    const unsigned int cells = subdiv + 1;
+    unsigned int side = std::max( 2u, (unsigned int)sqrtf( (float)maxVertices ) );
+    unsigned int chunkColumns = std::min( cells, side - 1 );
+    unsigned int chunkRows = std::min( cells, std::max( 1u, maxVertices / ( chunkColumns + 1 ) - 1 ) );
+    const unsigned int format = getMeshFormat();
+
+    GroupSharedPtr groupPtr = Group::create();
+    GroupWriteLock group( groupPtr );
+    for ( unsigned int sY = 0; sY < cells; sY += chunkRows )
+    {
+        for ( unsigned int sX = 0; sX < cells; sX += chunkColumns )
+        {
+            DrawableSharedPtr chunk = createTessellatedPlanePart( subdiv, transf, sX, std::min( cells, sX + chunkColumns ), sY, std::min( cells, sY + chunkRows ), format );
+            group->addChild( createGeoNode( chunk, stateSet ) );
+        }
+    }
+    return( groupPtr );
+}
+
+// ===========================================================================
+
+DrawableSharedPtr createPlane( float x0, float y0,
+                               float width, float height,
+                               float wext, float hext)
+{
+    MeshVertices mesh( getMeshFormat(), 6 );
+    VertexStream< Vec3f > vertices( mesh, VertexAttributeSet::NVSG_POSITION );
+    VertexStream< Vec3f > normals( mesh, VertexAttributeSet::NVSG_NORMAL );
+    VertexStream< Vec2f > texcoords0( mesh, VertexAttributeSet::NVSG_TEXCOORD0 );
+    VertexStream< Vec2f > texcoords1( mesh, VertexAttributeSet::NVSG_TEXCOORD1 );
+
+    // The two triangles as corners of the unit square, scaled to the plane and to the texture extent
+    const float corners[6][2] =
+    {
+        { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f },
+        { 1.0f, 1.0f }, { 0.0f, 1.0f }, { 0.0f, 0.0f }
+    };
+
+    for ( unsigned int i = 0; i < 6; ++i )
+    {
+        vertices[i] = Vec3f( x0 + corners[i][0] * width, y0 + corners[i][1] * height, 0.0f );
+        normals[i] = Vec3f( 0.0f, 0.0f, 1.0f );
+        texcoords0[i] = Vec2f( corners[i][0] * wext, corners[i][1] * hext );
+        texcoords1[i] = Vec2f( corners[i][0] * wext, corners[i][1] * hext );
+    }
+
+
     //-------------------------------
-    // Generate the indices
+    // Register the primitive
     //-------------------------------
 
-    int curvcount = 0;
+    VertexAttributeSetSharedPtr vasPtr = mesh.createVertexAttributeSet();
+
+    PrimitiveSharedPtr primitivePtr = Primitive::create();
+    {
+        PrimitiveWriteLock primitive(primitivePtr);
+        primitive->setPrimitiveType( PRIMITIVE_TRIANGLES );
+        primitive->setVertexAttributeSet( vasPtr );
+    }
+
+    DrawableSharedPtr drawablePtr = primitivePtr;
+
+    return( attachBounds( drawablePtr, makeBox( Vec3f( x0, y0, 0.0f ), Vec3f( x0 + width, y0 + height, 0.0f ) ) ) );
+}
+
+// ===========================================================================
+
+DrawableSharedPtr createTessellatedBox( unsigned int subdiv )
+{
+    // create pointer to return
+    DrawableSharedPtr drawablePtr;
+    
+    // Setup vertices, normals, texture coordinates and indices
+    const unsigned int planeVertices = ( subdiv + 2 ) * ( subdiv + 2 );
+    const unsigned int planeIndices = 6 * ( subdiv + 1 ) * ( subdiv + 1 );
+    const unsigned int format = getMeshFormat();
+    MeshVertices mesh( format, 6 * planeVertices );
+    VertexStream< Vec3f > vertices( mesh, VertexAttributeSet::NVSG_POSITION );
+    VertexStream< Vec3f > normals( mesh, VertexAttributeSet::NVSG_NORMAL );
+    VertexStream< Vec2f > texcoords( mesh, VertexAttributeSet::NVSG_TEXCOORD0 );
+    MeshIndices indices( format, 6 * planeVertices, 6 * planeIndices );
+
+    // Setup transformations for 6 box sides
+    Mat44f transf[6];
+    transf[0] = Mat44f( 1.0f,  0.0f,  0.0f,  0.0f,
+                        0.0f,  1.0f,  0.0f,  0.0f,
+                        0.0f,  0.0f,  1.0f,  0.0f,
+                        0.0f,  0.0f,  1.0f,  1.0f ); // front
+
+    transf[1] = Mat44f(-1.0f,  0.0f,  0.0f,  0.0f,
+                       0.0f,  1.0f,  0.0f,  0.0f,
+                       0.0f,  0.0f, -1.0f,  0.0f,
+                       0.0f,  0.0f, -1.0f,  1.0f ); // back, 180 degrees around y-axis
+
+    transf[2] = Mat44f( 0.0f,  0.0f,  1.0f,  0.0f,
+                        0.0f,  1.0f,  0.0f,  0.0f,
+                        -1.0f,  0.0f,  0.0f,  0.0f,
+                        -1.0f,  0.0f,  0.0f,  1.0f ); // left, -90 degrees around y-axis
+
+    transf[3] = Mat44f( 0.0f,  0.0f, -1.0f,  0.0f,
+                        0.0f,  1.0f,  0.0f,  0.0f,
+                        1.0f,  0.0f,  0.0f,  0.0f,
+                        1.0f,  0.0f,  0.0f,  1.0f ); // right, 90 degrees around y-axis
+
+    transf[4] = Mat44f( 1.0f,  0.0f,  0.0f,  0.0f,
+                        0.0f,  0.0f,  1.0f,  1.0f,
+                        0.0f, -1.0f,  0.0f,  0.0f,
+                        0.0f, -1.0f,  0.0f,  1.0f ); // bottom, 90 degrees around x-axis
+
+    transf[5] = Mat44f( 1.0f,  0.0f,  0.0f,  0.0f,
+                        0.0f,  0.0f, -1.0f,  1.0f,
+                        0.0f,  1.0f,  0.0f,  0.0f,
+                        0.0f,  1.0f,  0.0f,  1.0f ); // top, -90 degrees around x-axis
+    
+    for ( unsigned int i=0; i<6; i++ )
+    {
+        setupTessellatedPlane( subdiv, transf[i], 0, subdiv + 1, 0, subdiv + 1, i * planeVertices, i * planeIndices, vertices, normals, texcoords, indices, false );
+    }
+
+    // Create a VertexAttributeSet with vertices, normals and texture coordinates
+    VertexAttributeSetSharedPtr vasPtr = mesh.createVertexAttributeSet();
+
+    {
+        // Create a PrimitiveSet
+        IndexSetSharedPtr indexSet( indices.createIndexSet( false ) );
+
+        PrimitiveSharedPtr primitivePtr = Primitive::create();
+        {
+            PrimitiveWriteLock primitive(primitivePtr);
+            primitive->setPrimitiveType( PRIMITIVE_TRIANGLES );
+            primitive->setVertexAttributeSet( vasPtr );
+            primitive->setIndexSet( indexSet );
+        }
+
+        drawablePtr = primitivePtr;
+    }
+
+    return( attachBounds( drawablePtr, makeBox( Vec3f( -1.0f, -1.0f, -1.0f ), Vec3f( 1.0f, 1.0f, 1.0f ) ) ) );
+}
+
+// ===========================================================================
+
+LODParameters::LODParameters()
+    : levels( 4 )
+    , reduction( 0.5f )
+    , pixelError( 1.0f )
+    , viewportHeight( 1024.0f )
+    , fieldOfView( 0.25f * PI )
+{
+}
+
+namespace
+{
+//! One level of a LOD chain, the drawable and its geometric error in object space
+struct LODLevel
+{
+    DrawableSharedPtr drawable;
+    float             error;
+};
+
+//! Helper function to get the tessellation parameter \a count of the LOD level \a level, but at least \a minimum
+unsigned int getLODCount( unsigned int count, unsigned int minimum, unsigned int level, const LODParameters &parameters )
+{
+    float reduced = (float)count * powf( parameters.reduction, (float)level );
+    return( std::max( minimum, (unsigned int)( reduced + 0.5f ) ) );
+}
+
+//! Helper function to get the maximal distance between a circular arc of \a angle radians and its chord
+float getChordError( float radius, float angle )
+{
+    return( radius * ( 1.0f - cosf( 0.5f * angle ) ) );
+}
+
+//! Helper function to create the LOD node of the levels \a levels, finest first, each in a GeoNode with the StateSet \a stateSet
+// The switch to level i happens at the distance where the error of level i is projected onto parameters.pixelError pixels,
+// measured from \a center and extended by \a radius for levels whose error may be anywhere within that radius around it.
+LODSharedPtr createLODNode( const vector<LODLevel> &levels, const StateSetSharedPtr &stateSet, const LODParameters &parameters,
+                            const Vec3f &center = Vec3f( 0.0f, 0.0f, 0.0f ), float radius = 0.0f )
+{
+    NVSG_ASSERT( !levels.empty() );
+
+    // distance from the eye at which one object space unit covers one pixel
+    float pixelsPerUnit = parameters.viewportHeight / ( 2.0f * tanf( 0.5f * parameters.fieldOfView ) );
+
+    vector<float> ranges;
+    for ( size_t i = 1; i < levels.size(); ++i )
+    {
+        ranges.push_back( levels[i].error * pixelsPerUnit / parameters.pixelError + radius );
+    }
+
+    LODSharedPtr lodPtr = LOD::create();
+    {
+        LODWriteLock lod( lodPtr );
+        for ( size_t i = 0; i < levels.size(); ++i )
+        {
+            lod->addChild( createGeoNode( levels[i].drawable, stateSet ) );
+        }
+        if ( !ranges.empty() )
+        {
+            lod->setRanges( &ranges[0], checked_cast<unsigned int>( ranges.size() ) );
+        }
+        lod->setCenter( center );
+    }
+    return( lodPtr );
+}
+
+//! Helper function to append the LOD level \a drawable with the geometric error \a error
+void addLODLevel( vector<LODLevel> &levels, const DrawableSharedPtr &drawable, float error )
+{
+    LODLevel level;
+    level.drawable = drawable;
+    level.error = error;
+    levels.push_back( level );
+}
+}
+
+LODSharedPtr createSphereLOD( unsigned int m, unsigned int n, const StateSetSharedPtr &stateSet, float radius, const LODParameters &parameters )
+{
+    NVSG_ASSERT( 1 <= parameters.levels && 0.0f < parameters.reduction && parameters.reduction < 1.0f );
+
+    vector<LODLevel> levels;
+    vector<unsigned int> previousCounts;
+    for ( unsigned int i = 0; i < parameters.levels; ++i )
+    {
+        vector<unsigned int> counts( 2 );
+        counts[0] = getLODCount( m, 3, i, parameters );
+        counts[1] = getLODCount( n, 3, i, parameters );
+        if ( counts == previousCounts )
+        {
+            break;
+        }
+
+        // m segments around the full circle, n - 1 segments from pole to pole
+        float error = std::max( getChordError( radius, 2.0f * PI / (float)counts[0] ),
+                                getChordError( radius, PI / (float)( counts[1] - 1 ) ) );
+        previousCounts = counts;
+        addLODLevel( levels, createSphere( counts[0], counts[1], radius ), error );
+    }
+    return( createLODNode( levels, stateSet, parameters ) );
+}
+
+// ===========================================================================
+
+LODSharedPtr createCylinderLOD( float r, float h, unsigned int hdivs, unsigned int thdivs, const StateSetSharedPtr &stateSet,
+                                bool bOuter, float thstart, float thend, const LODParameters &parameters )
+{
+    NVSG_ASSERT( 1 <= parameters.levels && 0.0f < parameters.reduction && parameters.reduction < 1.0f );
+
+    vector<LODLevel> levels;
+    vector<unsigned int> previousCounts;
+    for ( unsigned int i = 0; i < parameters.levels; ++i )
+    {
+        vector<unsigned int> counts( 2 );
+        counts[0] = getLODCount( hdivs, 1, i, parameters );
+        counts[1] = getLODCount( thdivs, 3, i, parameters );
+        if ( counts == previousCounts )
+        {
+            break;
+        }
+
+        // the height divisions don't change the shape, only the number of vertices to light
+        float error = getChordError( r, ( thend - thstart ) / (float)counts[1] );
+        previousCounts = counts;
+        addLODLevel( levels, createCylinder( r, h, counts[0], counts[1], bOuter, thstart, thend ), error );
+    }
+    return( createLODNode( levels, stateSet, parameters ) );
+}
+
+// ===========================================================================
+
+LODSharedPtr createTorusLOD( unsigned int m, unsigned int n, const StateSetSharedPtr &stateSet, float innerRadius, float outerRadius,
+                             const LODParameters &parameters )
+{
+    NVSG_ASSERT( 1 <= parameters.levels && 0.0f < parameters.reduction && parameters.reduction < 1.0f );
+
+    vector<LODLevel> levels;
+    vector<unsigned int> previousCounts;
+    for ( unsigned int i = 0; i < parameters.levels; ++i )
+    {
+        vector<unsigned int> counts( 2 );
+        counts[0] = getLODCount( m, 3, i, parameters );
+        counts[1] = getLODCount( n, 3, i, parameters );
+        if ( counts == previousCounts )
+        {
+            break;
+        }
+
+        // the errors of the ring around the y-axis and of the tube add up on the outer equator, wherever the signs
+        // of the radii put it
+        float error = getChordError( fabsf( innerRadius ) + fabsf( outerRadius ), 2.0f * PI / (float)counts[0] )
+                    + getChordError( fabsf( outerRadius ), 2.0f * PI / (float)counts[1] );
+        previousCounts = counts;
+        addLODLevel( levels, createTorus( counts[0], counts[1], innerRadius, outerRadius ), error );
+    }
+    return( createLODNode( levels, stateSet, parameters ) );
+}
+
+// ===========================================================================
+
+LODSharedPtr createTessellatedBoxLOD( unsigned int subdiv, const StateSetSharedPtr &stateSet, const LODParameters &parameters )
+{
+    NVSG_ASSERT( 1 <= parameters.levels && 0.0f < parameters.reduction && parameters.reduction < 1.0f );
+
+    vector<LODLevel> levels;
+    vector<unsigned int> previousCounts;
+    for ( unsigned int i = 0; i < parameters.levels; ++i )
+    {
+        // subdiv + 1 cells per side, at least one
+        vector<unsigned int> counts( 1, getLODCount( subdiv + 1, 1, i, parameters ) );
+        if ( counts == previousCounts )
+        {
+            break;
+        }
+
+        // The box is flat at every tessellation, use the cell size as the error of the per vertex shading instead
+        float error = 2.0f / (float)counts[0];
+        previousCounts = counts;
+        addLODLevel( levels, createTessellatedBox( counts[0] - 1 ), error );
+    }
+    return( createLODNode( levels, stateSet, parameters ) );
+}
+
+// ===========================================================================
+
+TerrainParameters::TerrainParameters()
+    : chunks( 8 )
+    , heightScale( 1.0f )
+    , skirtDepth( 0.0f )
+{
+}
+
+namespace
+{
+//! The heights and normals of a terrain, sampled on its full resolution grid
+struct TerrainGrid
+{
+    unsigned int  size;             //!< number of samples along each side
+    Vec2f         extent;           //!< size of the terrain along x and z
+    vector<float> heights;
+    vector<Vec3f> normals;
+};
+
+//! The first component of a height image, for sampleHeightImage
+struct HeightImage
+{
+    unsigned int  width;
+    unsigned int  height;
+    vector<float> values;
+};
+
+//! Helper function to interpolate the \a values of a \a width x \a height grid bilinearly at ( \a x, \a y ), clamped to the grid
+template <typename T>
+T sampleBilinear( const vector<T> &values, unsigned int width, unsigned int height, float x, float y )
+{
+    unsigned int x0 = std::min( (unsigned int)std::max( x, 0.0f ), width - 1 );
+    unsigned int y0 = std::min( (unsigned int)std::max( y, 0.0f ), height - 1 );
+    unsigned int x1 = std::min( x0 + 1, width - 1 );
+    unsigned int y1 = std::min( y0 + 1, height - 1 );
+    float fx = std::min( std::max( x - (float)x0, 0.0f ), 1.0f );
+    float fy = std::min( std::max( y - (float)y0, 0.0f ), 1.0f );
+
+    return( ( 1.0f - fy ) * ( ( 1.0f - fx ) * values[y0 * width + x0] + fx * values[y0 * width + x1] )
+          + fy * ( ( 1.0f - fx ) * values[y1 * width + x0] + fx * values[y1 * width + x1] ) );
+}
+
+//! Helper function to copy every \a components th value of \a pixels, scaled by \a scale, to \a values
+template <typename T>
+void readHeightComponent( const T *pixels, unsigned int components, float scale, vector<float> &values )
+{
+    for ( size_t i = 0; i < values.size(); ++i )
+    {
+        values[i] = scale * (float)pixels[i * components];
+    }
+}
+
+//! Helper function to read the first component of the first image of \a textureHost into \a heightImage
+bool readHeightImage( const TextureHostSharedPtr &textureHostPtr, HeightImage &heightImage )
+{
+    TextureHostReadLock textureHost( textureHostPtr );
+    if ( textureHost->getNumberOfImages() == 0 )
+    {
+        return( false );
+    }
+
+    unsigned int components = 0;
+    switch( textureHost->getFormat( 0, 0 ) )
+    {
+    case Image::IMG_LUMINANCE:
+        components = 1;
+        break;
+    case Image::IMG_LUMINANCE_ALPHA:
+        components = 2;
+        break;
+    case Image::IMG_RGB:
+    case Image::IMG_BGR:
+        components = 3;
+        break;
+    case Image::IMG_RGBA:
+    case Image::IMG_BGRA:
+        components = 4;
+        break;
+    default:
+        return( false );
+    }
+
+    heightImage.width = textureHost->getWidth( 0, 0 );
+    heightImage.height = textureHost->getHeight( 0, 0 );
+    if ( ( heightImage.width == 0 ) || ( heightImage.height == 0 ) )
+    {
+        return( false );
+    }
+    heightImage.values.resize( heightImage.width * heightImage.height );
+
+    Buffer::DataReadLock buffer( textureHost->getPixels( 0, 0 ) );
+    switch( textureHost->getType() )
+    {
+    case Image::IMG_UNSIGNED_BYTE:
+        readHeightComponent( buffer.getPtr<unsigned char>(), components, 1.0f / 255.0f, heightImage.values );
+        return( true );
+    case Image::IMG_UNSIGNED_SHORT:
+        readHeightComponent( buffer.getPtr<unsigned short>(), components, 1.0f / 65535.0f, heightImage.values );
+        return( true );
+    case Image::IMG_FLOAT32:
+        readHeightComponent( buffer.getPtr<float>(), components, 1.0f, heightImage.values );
+        return( true );
+    default:
+        return( false );
+    }
+}
+
+//! Helper function to use a HeightImage as TerrainHeightFunction
+float sampleHeightImage( float u, float v, void *userData )
+{
+    const HeightImage *heightImage = static_cast<const HeightImage *>( userData );
+    return( sampleBilinear( heightImage->values, heightImage->width, heightImage->height
+                          , u * (float)( heightImage->width - 1 ), v * (float)( heightImage->height - 1 ) ) );
+}
+
+//! Helper function to sample the heights of \a heightFunction on the grid of \a grid and derive the normals from them
+void setupTerrainGrid( TerrainHeightFunction heightFunction, void *userData, float heightScale, TerrainGrid &grid )
+{
+    const unsigned int size = grid.size;
+    const float step = 1.0f / (float)( size - 1 );
+    grid.heights.resize( size * size );
+    for ( unsigned int j = 0; j < size; ++j )
+    {
+        for ( unsigned int i = 0; i < size; ++i )
+        {
+            grid.heights[j * size + i] = heightScale * heightFunction( (float)i * step, (float)j * step, userData );
+        }
+    }
+
+    // central differences inside, one-sided differences on the border; v runs along -z
+    const float dx = grid.extent[0] * step;
+    const float dz = grid.extent[1] * step;
+    grid.normals.resize( size * size );
+    for ( unsigned int j = 0; j < size; ++j )
+    {
+        unsigned int j0 = ( 0 < j ) ? j - 1 : j;
+        unsigned int j1 = std::min( j + 1, size - 1 );
+        for ( unsigned int i = 0; i < size; ++i )
+        {
+            unsigned int i0 = ( 0 < i ) ? i - 1 : i;
+            unsigned int i1 = std::min( i + 1, size - 1 );
+            float dhdx = ( grid.heights[j * size + i1] - grid.heights[j * size + i0] ) / ( (float)( i1 - i0 ) * dx );
+            float dhdv = ( grid.heights[j1 * size + i] - grid.heights[j0 * size + i] ) / ( (float)( j1 - j0 ) * dz );
+            Vec3f normal( -dhdx, 1.0f, dhdv );
+            normal.normalize();
+            grid.normals[j * size + i] = normal;
+        }
+    }
+}
+
+//! Helper function to get the grid position of vertex ( \a i, \a j ) of the chunk ( \a chunkColumn, \a chunkRow ) at \a resolution cells per side
+// The grid coordinates are computed from integers, so the border vertices of neighboring chunks are identical.
+void getTerrainGridPosition( unsigned int chunkResolution, unsigned int chunkColumn, unsigned int chunkRow, unsigned int resolution,
+                             unsigned int i, unsigned int j, float &x, float &y )
+{
+    x = (float)( chunkColumn * chunkResolution ) + (float)( i * chunkResolution ) / (float)resolution;
+    y = (float)( chunkRow * chunkResolution ) + (float)( j * chunkResolution ) / (float)resolution;
+}
+
+//! Helper function to get the largest height difference between the full resolution grid and the chunk ( \a chunkColumn, \a chunkRow )
+// tessellated with \a resolution cells per side, evaluated at the full resolution samples
+float getTerrainChunkError( const TerrainGrid &grid, unsigned int chunkResolution, unsigned int chunkColumn, unsigned int chunkRow,
+                            unsigned int resolution )
+{
+    const unsigned int row = resolution + 1;
+    vector<float> heights( row * row );
+    for ( unsigned int j = 0; j < row; ++j )
+    {
+        for ( unsigned int i = 0; i < row; ++i )
+        {
+            float x, y;
+            getTerrainGridPosition( chunkResolution, chunkColumn, chunkRow, resolution, i, j, x, y );
+            heights[j * row + i] = sampleBilinear( grid.heights, grid.size, grid.size, x, y );
+        }
+    }
+
+    // the cells are split along the diagonal from ( 0, 0 ) to ( 1, 1 ), as done by createTerrainChunk
+    const float cells = (float)chunkResolution / (float)resolution;
+    float error = 0.0f;
+    for ( unsigned int j = 0; j <= chunkResolution; ++j )
+    {
+        for ( unsigned int i = 0; i <= chunkResolution; ++i )
+        {
+            float s = (float)i / cells;
+            float t = (float)j / cells;
+            unsigned int ci = std::min( (unsigned int)s, resolution - 1 );
+            unsigned int cj = std::min( (unsigned int)t, resolution - 1 );
+            s -= (float)ci;
+            t -= (float)cj;
+
+            float h00 = heights[cj * row + ci];
+            float h10 = heights[cj * row + ci + 1];
+            float h01 = heights[( cj + 1 ) * row + ci];
+            float h11 = heights[( cj + 1 ) * row + ci + 1];
+            float h = ( t <= s ) ? h00 + s * ( h10 - h00 ) + t * ( h11 - h10 )
+                                 : h00 + t * ( h01 - h00 ) + s * ( h11 - h01 );
+
+            unsigned int k = ( chunkRow * chunkResolution + j ) * grid.size + chunkColumn * chunkResolution + i;
+            error = std::max( error, fabsf( h - grid.heights[k] ) );
+        }
+    }
+    return( error );
+}
+
+//! Helper function to create the chunk ( \a chunkColumn, \a chunkRow ) with \a resolution cells per side
+// and skirts of depth \a skirtDepth along its borders, or none if \a skirtDepth is 0, in the layout \a format
+DrawableSharedPtr createTerrainChunk( const TerrainGrid &grid, unsigned int chunkResolution, unsigned int chunkColumn, unsigned int chunkRow,
+                                      unsigned int resolution, float skirtDepth, unsigned int format )
+{
+    const unsigned int row = resolution + 1;
+    const unsigned int skirtVertices = ( 0.0f < skirtDepth ) ? 4 * resolution : 0;
+    MeshVertices mesh( format, row * row + skirtVertices );
+    VertexStream< Vec3f > vertices( mesh, VertexAttributeSet::NVSG_POSITION );
+    VertexStream< Vec3f > normals( mesh, VertexAttributeSet::NVSG_NORMAL );
+    VertexStream< Vec2f > texcoords( mesh, VertexAttributeSet::NVSG_TEXCOORD0 );
+    MeshIndices indices( format, row * row + skirtVertices, 6 * resolution * resolution + 6 * skirtVertices );
+
+    const float step = 1.0f / (float)( grid.size - 1 );
+    Vec3f lower( FLT_MAX, FLT_MAX, FLT_MAX );
+    Vec3f upper( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+    unsigned int k = 0;
+    for ( unsigned int j = 0; j < row; ++j )
+    {
+        for ( unsigned int i = 0; i < row; ++i )
+        {
+            float x, y;
+            getTerrainGridPosition( chunkResolution, chunkColumn, chunkRow, resolution, i, j, x, y );
+            float u = x * step;
+            float v = y * step;
+            Vec3f position( ( u - 0.5f ) * grid.extent[0], sampleBilinear( grid.heights, grid.size, grid.size, x, y )
+                          , ( 0.5f - v ) * grid.extent[1] );
+            Vec3f normal = sampleBilinear( grid.normals, grid.size, grid.size, x, y );
+            normal.normalize();
+            vertices[k] = position;
+            normals[k] = normal;
+            texcoords[k] = Vec2f( u, v );
+            for ( unsigned int c = 0; c < 3; ++c )
+            {
+                lower[c] = std::min( lower[c], position[c] );
+                upper[c] = std::max( upper[c], position[c] );
+            }
+            ++k;
+        }
+    }
+
+    // v runs along -z, so this winding faces up
+    k = 0;
+    for ( unsigned int j = 0; j < resolution; ++j )
+    {
+        for ( unsigned int i = 0; i < resolution; ++i )
+        {
+            indices[k++] = i + j * row;
+            indices[k++] = i + 1 + j * row;
+            indices[k++] = i + 1 + ( j + 1 ) * row;
+
+            indices[k++] = i + 1 + ( j + 1 ) * row;
+            indices[k++] = i + ( j + 1 ) * row;
+            indices[k++] = i + j * row;
+        }
+    }
+
+    if ( skirtVertices )
+    {
+        // Walk around the border counterclockwise in grid coordinates, which keeps the skirts facing outwards
+        vector<unsigned int> border;
+        border.reserve( skirtVertices );
+        for ( unsigned int i = 0; i < resolution; ++i )
+        {
+            border.push_back( i );
+        }
+        for ( unsigned int j = 0; j < resolution; ++j )
+        {
+            border.push_back( resolution + j * row );
+        }
+        for ( unsigned int i = resolution; 0 < i; --i )
+        {
+            border.push_back( i + resolution * row );
+        }
+        for ( unsigned int j = resolution; 0 < j; --j )
+        {
+            border.push_back( j * row );
+        }
+
+        // The skirt vertices keep the normals of the border, so they are shaded like the surface they extend
+        const unsigned int skirtOffset = row * row;
+        for ( unsigned int n = 0; n < skirtVertices; ++n )
+        {
+            mesh.copyVertex( skirtOffset + n, border[n] );
+            Vec3f position = vertices[border[n]];
+            position[1] -= skirtDepth;
+            vertices[skirtOffset + n] = position;
+            lower[1] = std::min( lower[1], position[1] );
+        }
+        for ( unsigned int n = 0; n < skirtVertices; ++n )
+        {
+            unsigned int next = ( n + 1 ) % skirtVertices;
+            indices[k++] = border[n];
+            indices[k++] = skirtOffset + n;
+            indices[k++] = skirtOffset + next;
+
+            indices[k++] = skirtOffset + next;
+            indices[k++] = border[next];
+            indices[k++] = border[n];
+        }
+    }
+
+    // Create a VertexAttributeSet with vertices, normals and texture coordinates
+    VertexAttributeSetSharedPtr vasPtr = mesh.createVertexAttributeSet();
+
+    // Create a PrimitiveSet
+    IndexSetSharedPtr indexSet( indices.createIndexSet( false ) );
+
+    PrimitiveSharedPtr primitivePtr = Primitive::create();
+    {
+        PrimitiveWriteLock primitive(primitivePtr);
+        primitive->setPrimitiveType( PRIMITIVE_TRIANGLES );
+        primitive->setVertexAttributeSet( vasPtr );
+        primitive->setIndexSet( indexSet );
+    }
+
+    return( attachBounds( primitivePtr, Box3f( lower, upper ) ) );
+}
 
+//! Helper function to add the chunks of the quadrant \a span x \a span at ( \a column, \a row ) to \a group, one Group per quadrant
+void addTerrainQuadrants( const GroupSharedPtr &groupPtr, const vector<LODSharedPtr> &chunks, unsigned int chunkCount,
+                          unsigned int column, unsigned int row, unsigned int span )
+{
+    GroupWriteLock group( groupPtr );
+    if ( span == 1 )
+    {
+        group->addChild( chunks[row * chunkCount + column] );
+        return;
+    }
 
-    for(unsigned int ith = 0; ith < thdivs; ith++)
+    unsigned int half = span / 2;
+    for ( unsigned int i = 0; i < 4; ++i )
+    {
+        unsigned int c = column + ( i & 1 ) * half;
+        unsigned int r = row + ( i >> 1 ) * half;
+        if ( half == 1 )
+        {
+            group->addChild( chunks[r * chunkCount + c] );
+        }
+        else
+        {
+            GroupSharedPtr quadrant = Group::create();
+            addTerrainQuadrants( quadrant, chunks, chunkCount, c, r, half );
+            group->addChild( quadrant );
+        }
+    }
+}
+}
+
+GroupSharedPtr createTerrain( TerrainHeightFunction heightFunction, void *userData, const Vec2f &size, unsigned int chunkResolution,
+                              const StateSetSharedPtr &stateSet, const TerrainParameters &parameters )
+{
+    NVSG_ASSERT( heightFunction && 1 <= chunkResolution );
+    NVSG_ASSERT( 1 <= parameters.lod.levels && 0.0f < parameters.lod.reduction && parameters.lod.reduction < 1.0f );
+
+    unsigned int chunkCount = 1;
+    while ( chunkCount < parameters.chunks )
+    {
+        chunkCount <<= 1;
+    }
+
+    TerrainGrid grid;
+    grid.size = chunkCount * chunkResolution + 1;
+    grid.extent = size;
+    setupTerrainGrid( heightFunction, userData, parameters.heightScale, grid );
+
+    // The same resolutions for all chunks, stopping when a level would not reduce the tessellation any further
+    vector<unsigned int> resolutions;
+    for ( unsigned int i = 0; i < parameters.lod.levels; ++i )
+    {
+        unsigned int resolution = getLODCount( chunkResolution, 1, i, parameters.lod );
+        if ( !resolutions.empty() && ( resolution == resolutions.back() ) )
+        {
+            break;
+        }
+        resolutions.push_back( resolution );
+    }
+
+    // First measure the errors of all chunks, the skirts have to cover the cracks to the neighbors as well
+    vector<float> errors( chunkCount * chunkCount * resolutions.size() );
+    vector<float> maxErrors( chunkCount * chunkCount, 0.0f );
+    for ( unsigned int r = 0; r < chunkCount; ++r )
+    {
+        for ( unsigned int c = 0; c < chunkCount; ++c )
+        {
+            for ( size_t l = 0; l < resolutions.size(); ++l )
+            {
+                float error = getTerrainChunkError( grid, chunkResolution, c, r, resolutions[l] );
+                errors[( r * chunkCount + c ) * resolutions.size() + l] = error;
+                maxErrors[r * chunkCount + c] = std::max( maxErrors[r * chunkCount + c], error );
+            }
+        }
+    }
+
+    const Vec2f chunkSize( size[0] / (float)chunkCount, size[1] / (float)chunkCount );
+    const float chunkRadius = 0.5f * length( chunkSize );
+    const unsigned int format = getMeshFormat();
+    vector<LODSharedPtr> chunks( chunkCount * chunkCount );
+    for ( unsigned int r = 0; r < chunkCount; ++r )
+    {
+        for ( unsigned int c = 0; c < chunkCount; ++c )
+        {
+            float skirtDepth = parameters.skirtDepth;
+            if ( skirtDepth <= 0.0f )
+            {
+                skirtDepth = maxErrors[r * chunkCount + c];
+                skirtDepth = std::max( skirtDepth, ( 0 < c ) ? maxErrors[r * chunkCount + c - 1] : 0.0f );
+                skirtDepth = std::max( skirtDepth, ( c + 1 < chunkCount ) ? maxErrors[r * chunkCount + c + 1] : 0.0f );
+                skirtDepth = std::max( skirtDepth, ( 0 < r ) ? maxErrors[( r - 1 ) * chunkCount + c] : 0.0f );
+                skirtDepth = std::max( skirtDepth, ( r + 1 < chunkCount ) ? maxErrors[( r + 1 ) * chunkCount + c] : 0.0f );
+            }
+
+            vector<LODLevel> levels;
+            for ( size_t l = 0; l < resolutions.size(); ++l )
+            {
+                addLODLevel( levels, createTerrainChunk( grid, chunkResolution, c, r, resolutions[l], skirtDepth, format )
+                           , errors[( r * chunkCount + c ) * resolutions.size() + l] );
+            }
+
+            // The switch distances are measured from the center of the chunk, but the error may be anywhere on it
+            float x = ( (float)c + 0.5f ) * chunkSize[0] - 0.5f * size[0];
+            float z = 0.5f * size[1] - ( (float)r + 0.5f ) * chunkSize[1];
+            float y = sampleBilinear( grid.heights, grid.size, grid.size, ( (float)c + 0.5f ) * (float)chunkResolution
+                                    , ( (float)r + 0.5f ) * (float)chunkResolution );
+            chunks[r * chunkCount + c] = createLODNode( levels, stateSet, parameters.lod, Vec3f( x, y, z ), chunkRadius );
+        }
+    }
+
+    GroupSharedPtr terrain = Group::create();
+    addTerrainQuadrants( terrain, chunks, chunkCount, 0, 0, chunkCount );
+    return( terrain );
+}
+
+// ===========================================================================
+
+GroupSharedPtr createTerrain( const TextureHostSharedPtr &heightImage, const Vec2f &size, unsigned int chunkResolution,
+                              const StateSetSharedPtr &stateSet, const TerrainParameters &parameters )
+{
+    HeightImage image;
+    if ( !heightImage || !readHeightImage( heightImage, image ) )
+    {
+        return( GroupSharedPtr() );
+    }
+    return( createTerrain( &sampleHeightImage, &image, size, chunkResolution, stateSet, parameters ) );
+}
+
+// ===========================================================================
+
+namespace
+{
+//! Helper function to write the float vertex attribute \a layout.attrib of \a src as \a layout to \a dst with the stride \a dstStride
+void convertAttribute( const VertexAttributeSetReadLock &src, const AttributeLayout &layout, char *dst, unsigned int dstStride )
+{
+    unsigned int count = src->getNumberOfVertexData( layout.attrib );
+    unsigned int srcSize = src->getSizeOfVertexData( layout.attrib );
+    unsigned int srcStride = src->getStrideOfVertexData( layout.attrib );
+
+    Buffer::DataReadLock lock( src->getVertexBuffer( layout.attrib ) );
+    const char *data = lock.getPtr<char>() + src->getOffsetOfVertexData( layout.attrib );
+
+    for ( unsigned int i = 0; i < count; ++i, data += srcStride, dst += dstStride )
+    {
+        encodeAttribute( layout, srcSize, reinterpret_cast<const float *>( data ), dst );
+    }
+}
+
+//! Helper function to create a VertexAttributeSet with the float attributes of \a vasPtr in the layout \a format
+VertexAttributeSetSharedPtr convertVertexAttributeSet( const VertexAttributeSetSharedPtr &vasPtr, unsigned int format )
+{
+    VertexAttributeSetReadLock src( vasPtr );
+
+    vector<AttributeLayout> layouts;
+    unsigned int count = 0;
+    unsigned int stride = 0;
+    for ( unsigned int i = 0; i < VertexAttributeSet::NVSG_VERTEX_ATTRIB_COUNT; ++i )
+    {
+        if ( src->getNumberOfVertexData( i ) )
+        {
+            if ( src->getTypeOfVertexData( i ) != NVSG_FLOAT )
+            {
+                // already converted
+                return( vasPtr );
+            }
+            NVSG_ASSERT( !count || ( count == src->getNumberOfVertexData( i ) ) );
+            count = src->getNumberOfVertexData( i );
+            layouts.push_back( getAttributeLayout( i, src->getSizeOfVertexData( i ), format ) );
+            stride += layouts.back().bytes;
+        }
+    }
+
+    if ( layouts.empty() )
+    {
+        return( vasPtr );
+    }
+
+    VertexAttributeSetSharedPtr dstPtr = VertexAttributeSet::create();
+    VertexAttributeSetWriteLock dst( dstPtr );
+
+    if ( format & MESH_FORMAT_INTERLEAVED )
+    {
+        BufferArray<char> data( count * stride );
+        unsigned int offset = 0;
+        for ( size_t i = 0; i < layouts.size(); ++i )
+        {
+            convertAttribute( src, layouts[i], &data[offset], stride );
+            offset += layouts[i].bytes;
+        }
+
+        BufferSharedPtr buffer = data.unmap();
+        offset = 0;
+        for ( size_t i = 0; i < layouts.size(); ++i )
+        {
+            dst->setVertexData( layouts[i].attrib, layouts[i].size, layouts[i].type, buffer, offset, stride, count );
+            dst->setNormalizeEnabled( layouts[i].attrib, layouts[i].normalized );
+            offset += layouts[i].bytes;
+        }
+    }
+    else
+    {
+        for ( size_t i = 0; i < layouts.size(); ++i )
+        {
+            BufferArray<char> data( count * layouts[i].bytes );
+            convertAttribute( src, layouts[i], &data[0], layouts[i].bytes );
+            dst->setVertexData( layouts[i].attrib, layouts[i].size, layouts[i].type, data.unmap(), 0, layouts[i].bytes, count );
+            dst->setNormalizeEnabled( layouts[i].attrib, layouts[i].normalized );
+        }
+    }
+
+    return( dstPtr );
+}
+
+//! Helper function to create an IndexSet with 16-bit indices from \a indexSetPtr, if all indices fit
+IndexSetSharedPtr convertIndexSet( const IndexSetSharedPtr &indexSetPtr )
+{
+    IndexSetReadLock src( indexSetPtr );
+    if ( src->getIndexDataType() != NVSG_UNSIGNED_INT )
+    {
+        return( indexSetPtr );
+    }
+
+    unsigned int count = src->getNumberOfIndices();
+    unsigned int restart = src->getPrimitiveRestartIndex();
+    Buffer::DataReadLock lock( src->getBuffer() );
+    const unsigned int *data = lock.getPtr<unsigned int>();
+
+    // 0xffff is kept free to be used as primitive restart index, the restart index of the 32-bit indices maps to it
+    for ( unsigned int i = 0; i < count; ++i )
+    {
+        if ( ( data[i] != restart ) && ( 0xffff <= data[i] ) )
+        {
+            return( indexSetPtr );
+        }
+    }
+
+    BufferArray<unsigned short> indices( count );
+    for ( unsigned int i = 0; i < count; ++i )
+    {
+        indices[i] = ( data[i] == restart ) ? 0xffff : (unsigned short)data[i];
+    }
+
+    IndexSetSharedPtr indexSet( IndexSet::create() );
+    {
+        IndexSetWriteLock dst( indexSet );
+        dst->setData( indices.unmap(), count, NVSG_UNSIGNED_SHORT );
+        dst->setPrimitiveRestartIndex( 0xffff );
+    }
+    return( indexSet );
+}
+}
+
+void setMeshFormat( unsigned int format )
+{
+    QMutexLocker lock( &meshFormatMutex );
+    meshFormat = format;
+}
+
+unsigned int getMeshFormat()
+{
+    if ( scopedMeshFormat.hasLocalData() && scopedMeshFormat.localData() )
+    {
+        return( *scopedMeshFormat.localData() );
+    }
+    QMutexLocker lock( &meshFormatMutex );
+    return( meshFormat );
+}
+
+ScopedMeshFormat::ScopedMeshFormat( unsigned int format )
+    : m_scoped( scopedMeshFormat.hasLocalData() && scopedMeshFormat.localData() )
+    , m_previous( m_scoped ? *scopedMeshFormat.localData() : 0 )
+{
+    // the thread storage owns and deletes its values
+    scopedMeshFormat.setLocalData( new unsigned int( format ) );
+}
+
+ScopedMeshFormat::~ScopedMeshFormat()
+{
+    scopedMeshFormat.setLocalData( m_scoped ? new unsigned int( m_previous ) : 0 );
+}
+
+DrawableSharedPtr convertMeshFormat( const DrawableSharedPtr &drawable, unsigned int format )
+{
+    if ( drawable && isPtrTo<Primitive>( drawable ) )
+    {
+        PrimitiveWriteLock primitive( sharedPtr_cast<Primitive>( drawable ) );
+
+        if (    primitive->getVertexAttributeSet()
+             && ( format & ( MESH_FORMAT_INTERLEAVED | MESH_FORMAT_OCTAHEDRAL_NORMALS | MESH_FORMAT_HALF_TEXCOORDS ) ) )
+        {
+            primitive->setVertexAttributeSet( convertVertexAttributeSet( primitive->getVertexAttributeSet(), format ) );
+        }
+
+        if ( primitive->getIndexSet() && ( format & MESH_FORMAT_SHORT_INDICES ) )
+        {
+            primitive->setIndexSet( convertIndexSet( primitive->getIndexSet() ) );
+        }
+    }
+
+    return( drawable );
+}
+
+// ===========================================================================
+
+bool getGeneratedBounds( const DrawableSharedPtr &drawable, GeneratedBounds &bounds )
+{
+    if ( !drawable )
+    {
+        return( false );
+    }
+
+    BoundsEntry entry;
+    {
+        QMutexLocker lock( &generatedBoundsMutex );
+        BoundsMap::const_iterator it = generatedBounds.find( drawable.get() );
+        if ( it == generatedBounds.end() )
+        {
+            return( false );
+        }
+        entry = it->second;
+    }
+
+    PositionStamp positions;
+    if ( !getPositionStamp( drawable, positions ) || !isSamePositionData( positions, entry.positions ) )
+    {
+        // the vertices changed, the bounds are of no further use
+        QMutexLocker lock( &generatedBoundsMutex );
+        eraseGeneratedBounds( drawable.get(), entry.serial );
+        return( false );
+    }
+    bounds = entry.bounds;
+    return( true );
+}
+
+// ===========================================================================
+
+DrawableSharedPtr setGeneratedBounds( const DrawableSharedPtr &drawable, const Box3f &box )
+{
+    return( attachBounds( drawable, box ) );
+}
+
+// ===========================================================================
+
+void releaseGeneratedBounds()
+{
+    QMutexLocker lock( &generatedBoundsMutex );
+    generatedBounds.clear();
+    generatedBoundsOrder.clear();
+}
+
+// ===========================================================================
+
+float getMaximumScale( const Mat44f &matrix )
+{
+    // the Frobenius norm of the upper 3x3 part bounds its largest singular value, shear included
+    float sum = 0.0f;
+    for ( unsigned int i = 0; i < 3; ++i )
+    {
+        for ( unsigned int j = 0; j < 3; ++j )
+        {
+            sum += matrix[i][j] * matrix[i][j];
+        }
+    }
+    return( sqrtf( sum ) );
+}
+
+// ===========================================================================
+
+namespace
+{
+//! Helper function to grow \a sphere to also enclose \a other
+void mergeSphere( Sphere3f &sphere, bool &valid, const Sphere3f &other )
+{
+    if ( !valid )
+    {
+        sphere = other;
+        valid = true;
+        return;
+    }
+
+    Vec3f d = other.getCenter() - sphere.getCenter();
+    float distance = length( d );
+    if ( distance + other.getRadius() <= sphere.getRadius() )
+    {
+        return;
+    }
+    if ( distance + sphere.getRadius() <= other.getRadius() )
+    {
+        sphere = other;
+        return;
+    }
+
+    float radius = 0.5f * ( distance + sphere.getRadius() + other.getRadius() );
+    sphere = Sphere3f( sphere.getCenter() + d * ( ( radius - sphere.getRadius() ) / distance ), radius );
+}
+
+//! Helper function to grow \a sphere by the generated bounds below \a node, transformed by \a matrix
+bool mergeGeneratedBounds( const NodeSharedPtr &node, const Mat44f &matrix, Sphere3f &sphere, bool &valid )
+{
+    if ( isPtrTo<GeoNode>( node ) )
     {
-        indices.push_back( curvcount );
-        indices.push_back( curvcount+1 + ith );
-        indices.push_back( curvcount+2 + (ith < thdivs-1 ? ith : -1) );
+        float scale = getMaximumScale( matrix );
+
+        GeoNodeReadLock geoNode( sharedPtr_cast<GeoNode>( node ) );
+        for ( GeoNode::StateSetConstIterator gnssci = geoNode->beginStateSets() ; gnssci != geoNode->endStateSets() ; ++gnssci )
+        {
+            for ( GeoNode::DrawableConstIterator gndci = geoNode->beginDrawables( gnssci ) ; gndci != geoNode->endDrawables( gnssci ) ; ++gndci )
+            {
+                GeneratedBounds bounds;
+                if ( !getGeneratedBounds( *gndci, bounds ) )
+                {
+                    return( false );
+                }
+                Vec3f center( Vec4f( bounds.sphere.getCenter(), 1.0f ) * matrix );
+                mergeSphere( sphere, valid, Sphere3f( center, scale * bounds.sphere.getRadius() ) );
+            }
+        }
+        return( true );
+    }
+
+    if ( isPtrTo<Group>( node ) )
+    {
+        Mat44f childMatrix( matrix );
+        if ( isPtrTo<Transform>( node ) )
+        {
+            childMatrix = TransformReadLock( sharedPtr_cast<Transform>( node ) )->getTrafo().getMatrix() * matrix;
+        }
+
+        GroupReadLock group( sharedPtr_cast<Group>( node ) );
+        for ( Group::ChildrenConstIterator gcci = group->beginChildren() ; gcci != group->endChildren() ; ++gcci )
+        {
+            if ( !mergeGeneratedBounds( *gcci, childMatrix, sphere, valid ) )
+            {
+                return( false );
+            }
+        }
+        return( true );
+    }
+
+    return( false );
+}
+}
+
+bool getGeneratedBoundingSphere( const NodeSharedPtr &node, Sphere3f &sphere )
+{
+    const Mat44f identity( 1.0f, 0.0f, 0.0f, 0.0f,
+                           0.0f, 1.0f, 0.0f, 0.0f,
+                           0.0f, 0.0f, 1.0f, 0.0f,
+                           0.0f, 0.0f, 0.0f, 1.0f );
+
+    bool valid = false;
+    Sphere3f result;
+    if ( !node || !mergeGeneratedBounds( node, identity, result, valid ) || !valid )
+    {
+        return( false );
     }
+    sphere = result;
+    return( true );
+}
+
+// ===========================================================================
+
+StateSetSharedPtr createDefaultMaterial( const Vec3f &diffuseColor )
+{
+    // Create a Material
+    MaterialSharedPtr materialPtr = Material::create();
+    StateSetSharedPtr statePtr = StateSet::create();
+    MaterialWriteLock mw( materialPtr );
+    mw->setDiffuseColor( diffuseColor );
+
+    // Create a StateSet
+    StateSetWriteLock ssw( statePtr );
+    ssw->addAttribute( materialPtr );
+
+    return statePtr;
+}
+
+// ===========================================================================
+
+StateSetSharedPtr createDefinedMaterial( const Vec3f &ambientColor,
+                                         const Vec3f &diffuseColor,
+                                         const Vec3f &specularColor,
+                                         const float specularExponent,
+                                         const Vec3f &emissiveColor,
+                                         const float opacity,
+                                         const float reflectivity,
+                                         const float indexOfRefraction )
+{
+    // Create a Material
+    MaterialSharedPtr materialPtr = createMaterialAttribute( ambientColor,
+                                                             diffuseColor,
+                                                             specularColor,
+                                                             specularExponent,
+                                                             emissiveColor,
+                                                             opacity,
+                                                             reflectivity,
+                                                             indexOfRefraction );
 
+    // Create a StateSet
+    StateSetSharedPtr statePtr = StateSet::create();
+    StateSetWriteLock( statePtr )->addAttribute( materialPtr );
 
+    return statePtr;
+}
 
-    curvcount += 1 + thdivs;
+// ===========================================================================
 
-    for(unsigned int ih = 0; ih < hdivs; ih++)
+MaterialSharedPtr createMaterialAttribute( const Vec3f &ambientColor,
+                                           const Vec3f &diffuseColor,
+                                           const Vec3f &specularColor,
+                                           const float specularExponent,
+                                           const Vec3f &emissiveColor,
+                                           const float opacity,
+                                           const float reflectivity,
+                                           const float indexOfRefraction )
+{
+    // Create a Material
+    MaterialSharedPtr materialPtr = Material::create();
     {
-        for(unsigned int ith = 0; ith < thdivs; ith++)
-        {
-            indices.push_back( curvcount+ith );
-            indices.push_back( curvcount+ith+thdivs );
-            indices.push_back( curvcount+(ith < thdivs-1 ? ith+1 : 0) );
+        MaterialWriteLock mw( materialPtr );
+        mw->setAmbientColor( ambientColor );
+        mw->setDiffuseColor( diffuseColor );
+        mw->setSpecularColor( specularColor );
+        mw->setSpecularExponent( specularExponent );
+        mw->setEmissiveColor( emissiveColor );
+        mw->setOpacity( opacity );
+        mw->setReflectivity( reflectivity );
+        mw->setIndexOfRefraction( indexOfRefraction );
+    }
+    return materialPtr;
+}
 
-            indices.push_back( curvcount+ith+thdivs );
-            indices.push_back( curvcount+(ith < thdivs-1 ? ith+1 : 0) + thdivs );
-            indices.push_back( curvcount+(ith < thdivs-1 ? ith+1 : 0) );
-        }
+// ===========================================================================
 
-        curvcount += thdivs;
-    }
+namespace
+{
+//! The bit patterns of the parameters of a shared material, the first entry tells the generator apart
+typedef std::vector<unsigned int> MaterialKey;
 
-    curvcount += thdivs;
+typedef std::map<MaterialKey, StateSetSharedPtr> SharedMaterialMap;
+SharedMaterialMap sharedMaterials;
+QMutex sharedMaterialsMutex;
 
+//! Helper function to append the bit pattern of \a value to \a key, so equal means identical and NaNs don't break the ordering
+void appendMaterialKey( MaterialKey &key, float value )
+{
+    unsigned int bits;
+    memcpy( &bits, &value, sizeof(bits) );
+    key.push_back( bits );
+}
 
-    for(unsigned int ith = 0; ith < thdivs; ith++)
+//! Helper function to append the bit patterns of \a value to \a key
+void appendMaterialKey( MaterialKey &key, const Vec3f &value )
+{
+    for ( unsigned int i = 0; i < 3; ++i )
     {
-        indices.push_back( curvcount );
-        indices.push_back( curvcount+2 + (ith < thdivs-1 ? ith : -1) );
-        indices.push_back( curvcount+1 + ith );
+        appendMaterialKey( key, value[i] );
     }
+}
 
-
-
-    //-------------------------------
-    // Register the primitive
-    //-------------------------------
-
-    VertexAttributeSetSharedPtr vasPtr = VertexAttributeSet::create();
+//! Helper function to collect the StateSets below \a node into \a stateSets, visiting shared subtrees once
+void collectStateSets( const NodeSharedPtr &node, std::set<const void *> &visited, std::set<const void *> &stateSets )
+{
+    if ( !node || !visited.insert( node.get() ).second )
     {
-        VertexAttributeSetWriteLock vas( vasPtr );
-
-        vas->setVertices( &vertices[0], size_v );
-        vas->setNormals( &normals[0], size_v );
-        vas->setTexCoords( 0, &texcoords[0], size_v );
+        return;
     }
 
-    IndexSetSharedPtr indexSet( IndexSet::create() );
-    IndexSetWriteLock(indexSet)->setData( &indices[0], checked_cast<unsigned int>(indices.size()) );
-
-    PrimitiveSharedPtr primitivePtr = Primitive::create();
+    if ( isPtrTo<GeoNode>( node ) )
     {
-        PrimitiveWriteLock primitive(primitivePtr);
-        primitive->setPrimitiveType( PRIMITIVE_TRIANGLES );
-        primitive->setVertexAttributeSet( vasPtr );
-        primitive->setIndexSet( indexSet );
+        GeoNodeReadLock geoNode( sharedPtr_cast<GeoNode>( node ) );
+        for ( GeoNode::StateSetConstIterator gnssci = geoNode->beginStateSets() ; gnssci != geoNode->endStateSets() ; ++gnssci )
+        {
+            stateSets.insert( (*gnssci).get() );
+        }
+    }
+    else if ( isPtrTo<Group>( node ) )
+    {
+        GroupReadLock group( sharedPtr_cast<Group>( node ) );
+        for ( Group::ChildrenConstIterator gcci = group->beginChildren() ; gcci != group->endChildren() ; ++gcci )
+        {
+            collectStateSets( *gcci, visited, stateSets );
+        }
     }
+}
+}
 
-    DrawableSharedPtr drawablePtr = primitivePtr;
+StateSetSharedPtr getSharedDefaultMaterial( const Vec3f &diffuseColor )
+{
+    MaterialKey key( 1, 0 );
+    appendMaterialKey( key, diffuseColor );
 
-    return drawablePtr;
+    QMutexLocker lock( &sharedMaterialsMutex );
+    StateSetSharedPtr &stateSet = sharedMaterials[key];
+    if ( !stateSet )
+    {
+        stateSet = createDefaultMaterial( diffuseColor );
+    }
+    return( stateSet );
 }
 
 // ===========================================================================
 
-DrawableSharedPtr createTorus( unsigned int m, unsigned int n, float innerRadius , float outerRadius )
+StateSetSharedPtr getSharedDefinedMaterial( const Vec3f &ambientColor,
+                                            const Vec3f &diffuseColor,
+                                            const Vec3f &specularColor,
+                                            const float specularExponent,
+                                            const Vec3f &emissiveColor,
+                                            const float opacity,
+                                            const float reflectivity,
+                                            const float indexOfRefraction )
 {
-    // The torus is a ring with radius outerRadius rotated around the y-axis along the circle with innerRadius.
-    
-    /*           y
-       ___       |       ___
-     /     \           /     \
-    |       |    |    |       |
-    |       |         |       |
-     \ ___ /     |     \ ___ /
-                          <--->
-                          outerRadius
-                 <------->
-                 innerRadius
-    */
+    MaterialKey key( 1, 1 );
+    appendMaterialKey( key, ambientColor );
+    appendMaterialKey( key, diffuseColor );
+    appendMaterialKey( key, specularColor );
+    appendMaterialKey( key, specularExponent );
+    appendMaterialKey( key, emissiveColor );
+    appendMaterialKey( key, opacity );
+    appendMaterialKey( key, reflectivity );
+    appendMaterialKey( key, indexOfRefraction );
+
+    QMutexLocker lock( &sharedMaterialsMutex );
+    StateSetSharedPtr &stateSet = sharedMaterials[key];
+    if ( !stateSet )
+    {
+        stateSet = createDefinedMaterial( ambientColor, diffuseColor, specularColor, specularExponent,
+                                          emissiveColor, opacity, reflectivity, indexOfRefraction );
+    }
+    return( stateSet );
+}
 
-    NVSG_ASSERT( m >= 3 && n >= 3 && "createTorus(): m and n both have to be at least 3." );
+// ===========================================================================
 
-    // create pointer to return
-    DrawableSharedPtr drawablePtr;
+unsigned int getSharedMaterialCount()
+{
+    QMutexLocker lock( &sharedMaterialsMutex );
+    return( checked_cast<unsigned int>( sharedMaterials.size() ) );
+}
 
-    vector< Vec3f > vertices;
-    vector< Vec3f > tangents;
-    vector< Vec3f > binormals;
-    vector< Vec3f > normals;
-    vector< Vec2f > texcoords;
-    vector<unsigned int> indices;
-    vector< Face4 > faces;
+// ===========================================================================
 
-    unsigned int size_v = ( m + 1 ) * ( n + 1 );
+void releaseSharedMaterials()
+{
+    QMutexLocker lock( &sharedMaterialsMutex );
+    sharedMaterials.clear();
+}
 
-    vertices.reserve( size_v );
-    tangents.reserve( size_v );
-    binormals.reserve( size_v );
-    normals.reserve( size_v );
-    texcoords.reserve( size_v );
-    indices.reserve( 4 * m * n );
-    faces.reserve( m * n );
+// ===========================================================================
 
-    float mf = (float) m;
-    float nf = (float) n;
+unsigned int getUniqueStateSetCount( const NodeSharedPtr &node )
+{
+    std::set<const void *> visited;
+    std::set<const void *> stateSets;
+    collectStateSets( node, visited, stateSets );
+    return( checked_cast<unsigned int>( stateSets.size() ) );
+}
 
-    float phi_step   = 2.0f * PI / mf;
-    float theta_step = 2.0f * PI / nf;
+// ===========================================================================
 
-    // Setup vertices and normals
-    // Generate the Torus exactly like the sphere with rings around the origin along the latitudes.
-    for ( unsigned int latitude = 0; latitude <= n; latitude++ ) // theta angle
+namespace
+{
+//! A TextureHost loaded by createTextureFromFile, valid as long as the file keeps its modification time
+struct TextureCacheEntry
+{
+    TextureHostSharedPtr textureHost;
+    unsigned int         modified;
+    size_t               bytes;
+};
+
+//! The loaded textures by canonical file path, see createTextureFromFile
+typedef std::map<std::string, TextureCacheEntry> TextureCacheMap;
+TextureCacheMap textureCache;
+TextureCacheStatistics textureCacheStatistics;
+std::set<std::string> textureCachePlugInPaths;
+QMutex textureCacheMutex;
+
+//! Helper function to add \a path to the plug-in search path, once per path
+void addTexturePlugInSearchPath( const std::string &path )
+{
+    if ( textureCachePlugInPaths.insert( path ).second )
     {
-        float theta = (float) latitude * theta_step;
-        float sinTheta = sinf(theta);
-        float cosTheta = cosf(theta);
-
-        float radius = innerRadius + outerRadius * cosTheta;
-
-        for ( unsigned int longitude = 0; longitude <= m; longitude++ ) // phi angle
-        {
-            float phi = (float) longitude * phi_step;
-            float sinPhi = sinf(phi);
-            float cosPhi = cosf(phi);
-
-            vertices.push_back( Vec3f( radius      *  cosPhi,
-                                       outerRadius *  sinTheta,
-                                       radius      * -sinPhi ) );
-
-            tangents.push_back( Vec3f( -sinPhi, 0.0f, -cosPhi ) );
-
-            binormals.push_back( Vec3f( cosPhi * -sinTheta,
-                                        cosTheta,
-                                        sinPhi * sinTheta ) );
-
-            normals.push_back( Vec3f( cosPhi * cosTheta,
-                                      sinTheta,
-                                      -sinPhi * cosTheta ) );
-
-            texcoords.push_back( Vec2f( (float) longitude / mf , (float) latitude / nf ) );
-        }
+        nvutil::addPlugInSearchPath( path );
     }
+}
 
-    const unsigned int columns = m + 1;
-
-    // Setup indices
-    for( unsigned int latitude = 0 ; latitude < n ; latitude++ )
+//! Helper function to find \a fileName as given or in one of \a searchPaths, in the order TextureHost::createFromFile looks
+bool resolveTextureFile( const std::string &fileName, const std::vector<std::string> &searchPaths, QFileInfo &fileInfo )
+{
+    fileInfo = QFileInfo( QString::fromLocal8Bit( fileName.c_str() ) );
+    if ( fileInfo.isFile() )
     {
-        for( unsigned int longitude = 0 ; longitude < m ; longitude++ )
-        {
-            indices.push_back(  latitude      * columns + longitude     );  // lower left
-            indices.push_back(  latitude      * columns + longitude + 1 );  // lower right
-            indices.push_back( (latitude + 1) * columns + longitude + 1 );  // upper right
-            indices.push_back( (latitude + 1) * columns + longitude     );  // upper left
-        }
+        return( true );
     }
-    
-    // Create a VertexAttributeSet with vertices, normals and texture coordinates
-    VertexAttributeSetSharedPtr vasPtr = VertexAttributeSet::create();
+    for ( size_t i = 0; i < searchPaths.size(); ++i )
     {
-        VertexAttributeSetWriteLock vas( vasPtr );
-        vas->setVertices( &vertices[0], size_v );
-        vas->setNormals( &normals[0], size_v );
-        vas->setTexCoords( 0, &texcoords[0], size_v );
-        vas->setTexCoords( VertexAttributeSet::NVSG_TANGENT  - VertexAttributeSet::NVSG_TEXCOORD0, &tangents[0], size_v );
-        vas->setTexCoords( VertexAttributeSet::NVSG_BINORMAL - VertexAttributeSet::NVSG_TEXCOORD0, &binormals[0], size_v );
+        fileInfo = QFileInfo( QDir( QString::fromLocal8Bit( searchPaths[i].c_str() ) ), QString::fromLocal8Bit( fileName.c_str() ) );
+        if ( fileInfo.isFile() )
+        {
+            return( true );
+        }
     }
-    
-    {
-        // Create a PrimitiveSet
-        IndexSetSharedPtr indexSet( IndexSet::create() );
-        IndexSetWriteLock(indexSet)->setData( &indices[0], checked_cast<unsigned int>(indices.size()) );
+    return( false );
+}
 
-        PrimitiveSharedPtr primitivePtr = Primitive::create();
+//! Helper function to get the size in bytes of the top level pixels of all images of \a textureHost
+size_t getTextureHostDataSize( const TextureHostSharedPtr &textureHostPtr )
+{
+    size_t bytes = 0;
+    TextureHostReadLock textureHost( textureHostPtr );
+    for ( unsigned int i = 0; i < textureHost->getNumberOfImages(); ++i )
+    {
+        BufferSharedPtr pixels = textureHost->getPixels( i, 0 );
+        if ( pixels )
         {
-            PrimitiveWriteLock primitive(primitivePtr);
-            primitive->setPrimitiveType( PRIMITIVE_QUADS );
-            primitive->setVertexAttributeSet( vasPtr );
-            primitive->setIndexSet( indexSet );
+            bytes += BufferReadLock( pixels )->getSize();
         }
-
-        drawablePtr = primitivePtr;
     }
-
-    return drawablePtr;
+    return( bytes );
 }
 
-// ===========================================================================
-
-DrawableSharedPtr createTessellatedPlane( unsigned int subdiv, const Mat44f &transf )
+//! A texture file decoded by decodeTextureFile
+struct DecodedTexture
 {
-    // create pointer to return
-    DrawableSharedPtr drawablePtr;
-    
-    // Setup vertices, normals, faces and texture coordinates (and indices for primitive creation mode)
-    vector< Vec3f > vertices;
-    vector< Vec3f > normals;
-    vector< Vec2f > texcoords;
-    vector<unsigned int> indices;
-    vector< Face3 > faces;
+    DecodedTexture() : bytes( 0 ) {}
 
-    const int size_v =  ( subdiv + 2 ) * ( subdiv + 2 );
-    vertices.reserve( size_v );
-    normals.reserve( size_v );
-    texcoords.reserve( size_v );
-    indices.reserve( size_v );
-    faces.reserve( 2 * ( subdiv + 1 ) * ( subdiv + 1 ) );
-
-    // Setup tessellated plane
-    setupTessellatedPlane( subdiv, transf, faces, vertices, normals, texcoords, indices);
+    TextureHostSharedPtr textureHost;
+    size_t               bytes;
+};
 
-    // Create a VertexAttributeSet with vertices, normals and texture coordinates
-    VertexAttributeSetSharedPtr vasPtr = VertexAttributeSet::create();
+/*! Helper function to load the image file \a path, runs on the worker threads of createTexturesFromFiles.
+    Unless \a reentrant is set, it holds the PlugInLock of the texture loader of its extension meanwhile, the one
+    loadTextureHost holds as well. */
+DecodedTexture decodeTextureFile( std::string path, std::vector<std::string> searchPaths, bool reentrant )
+{
+    DecodedTexture decoded;
     {
-        VertexAttributeSetWriteLock vas( vasPtr );
-        vas->setVertices( &vertices[0], size_v );
-        vas->setNormals( &normals[0], size_v );
-        vas->setTexCoords( 0, &texcoords[0], size_v );
+        PlugInLock loader( path, UPITID_TEXTURE_LOADER, searchPaths, !reentrant );
+        decoded.textureHost = TextureHost::createFromFile( path, searchPaths, TextureHost::F_SCALE_FILTER_BOX );
     }
-
+    if ( decoded.textureHost )
     {
-        // Create a PrimitiveSet
-        IndexSetSharedPtr indexSet( IndexSet::create() );
-        IndexSetWriteLock(indexSet)->setData( &indices[0], checked_cast<unsigned int>(indices.size()) );
-
-        PrimitiveSharedPtr primitivePtr = Primitive::create();
-        {
-            PrimitiveWriteLock primitive(primitivePtr);
-            primitive->setPrimitiveType( PRIMITIVE_TRIANGLES );
-            primitive->setVertexAttributeSet( vasPtr );
-            primitive->setIndexSet( indexSet );
-        }
+        TextureHostWriteLock( decoded.textureHost )->setTextureTarget( determineTextureTarget( decoded.textureHost ) );
+        decoded.bytes = getTextureHostDataSize( decoded.textureHost );
+    }
+    return( decoded );
+}
 
-        drawablePtr = primitivePtr;
+//! Helper function to put \a decoded into the cache, replacing an outdated entry, call it with textureCacheMutex locked
+void insertTextureCacheEntry( const std::string &path, unsigned int modified, const DecodedTexture &decoded )
+{
+    TextureCacheMap::iterator it = textureCache.find( path );
+    if ( it != textureCache.end() )
+    {
+        // the file changed, the scenes using the old TextureHost keep it alive
+        textureCacheStatistics.bytes -= it->second.bytes;
+        textureCache.erase( it );
     }
 
-    return drawablePtr;
+    TextureCacheEntry entry;
+    entry.textureHost = decoded.textureHost;
+    entry.modified = modified;
+    entry.bytes = decoded.bytes;
+    textureCache[path] = entry;
+    textureCacheStatistics.bytes += entry.bytes;
+    textureCacheStatistics.entries = checked_cast<unsigned int>( textureCache.size() );
 }
 
-// ===========================================================================
-
-DrawableSharedPtr createPlane( float x0, float y0,
-                               float width, float height,
-                               float wext, float hext)
+//! Helper function to add the plug-in search paths of the TextureHost loaders, call it with textureCacheMutex locked
+void addTexturePlugInSearchPaths( const std::vector<std::string> &searchPaths )
 {
-    vector< Vec3f > vertices;
-    vector< Vec3f > normals;
-    vector< Vec2f > texcoords;
-
-    vertices.push_back( Vec3f(x0, y0, 0.0f) );
-    normals.push_back( Vec3f(0.0f, 0.0f, 1.0f) );
-    texcoords.push_back( Vec2f(0.0f, 0.0f) );
+#if defined(_WIN32)
+    addTexturePlugInSearchPath(std::string("C:\\Program Files\\NVIDIA Corporation\\SceniX 7.2\\bin\\x86\\win\\crt90\\debug"));
+#endif
+    for ( size_t i = 0; i < searchPaths.size(); ++i )
+    {
+        addTexturePlugInSearchPath( searchPaths[i] );
+    }
+}
 
-    vertices.push_back( Vec3f(x0 + width, y0, 0.0f) );
-    normals.push_back( Vec3f(0.0f, 0.0f, 1.0f) );
-    texcoords.push_back( Vec2f(wext, 0.0f) );
+//! Helper function to create a StateSet binding \a textureHost to unit 0, sampling its mip chain if \a mipmaps is set
+StateSetSharedPtr createTextureStateSet( const TextureHostSharedPtr &textureHost, bool mipmaps = false )
+{
+    TextureAttributeSharedPtr texAttPtr( TextureAttribute::create() );
+    {
+        TextureAttributeWriteLock texAtt( texAttPtr );
+        TextureAttributeItemSharedPtr texAttItemPtr( TextureAttributeItem::create() );
+        TextureAttributeItemWriteLock texAttItem( texAttItemPtr );
+        texAttItem->setTexture( textureHost );
+        texAttItem->setMagFilterMode( TFM_MAG_NEAREST );
+        texAttItem->setMinFilterMode( mipmaps ? TFM_MIN_NEAREST_MIPMAP_LINEAR : TFM_MIN_NEAREST );
+        texAtt->bindTextureAttributeItem( texAttItemPtr, 0 );
+    }
 
-    vertices.push_back( Vec3f(x0 + width, y0 + height, 0.0f) );
-    normals.push_back( Vec3f(0.0f, 0.0f, 1.0f) );
-    texcoords.push_back( Vec2f(wext, hext) );
+    // Create a StateSet holding the texture
+    StateSetSharedPtr stateSetPtr = StateSet::create();
+    {
+        StateSetWriteLock stateSet( stateSetPtr );
+        stateSet->addAttribute( texAttPtr );
+    }
+    return stateSetPtr;
+}
 
-    /////
+/*! Helper function to estimate the image bytes of the texture file \a path before decoding it, as 8-bit RGBA from the
+    size in its header. Files Qt can't read the header of count with four times their size \a fileSize. */
+size_t estimateTextureDecodeBytes( const std::string &path, size_t fileSize )
+{
+    QSize size = QImageReader( QString::fromLocal8Bit( path.c_str() ) ).size();
+    if ( size.isValid() )
+    {
+        return( 4 * size_t( size.width() ) * size_t( size.height() ) );
+    }
+    return( 4 * fileSize );
+}
 
-    vertices.push_back( Vec3f(x0 + width, y0 + height, 0.0f) );
-    normals.push_back( Vec3f(0.0f, 0.0f, 1.0f) );
-    texcoords.push_back( Vec2f(wext, hext) );
+//! Helper function to get the bytes held by the decodes \a first to \a last, the estimated size for the ones still running
+size_t getTextureDecodeBytes( const std::vector< QFuture<DecodedTexture> > &futures, const std::vector<size_t> &estimatedBytes
+                            , size_t first, size_t last )
+{
+    size_t bytes = 0;
+    for ( size_t i = first; i < last; ++i )
+    {
+        bytes += futures[i].isFinished() ? futures[i].result().bytes : estimatedBytes[i];
+    }
+    return( bytes );
+}
+}
 
-    vertices.push_back( Vec3f(x0, y0 + height, 0.0f) );
-    normals.push_back( Vec3f(0.0f, 0.0f, 1.0f) );
-    texcoords.push_back( Vec2f(0.0f, hext) );
+TextureCacheStatistics::TextureCacheStatistics()
+    : hits( 0 )
+    , misses( 0 )
+    , entries( 0 )
+    , bytes( 0 )
+    , savedBytes( 0 )
+{
+}
 
-    vertices.push_back( Vec3f(x0, y0, 0.0f) );
-    normals.push_back( Vec3f(0.0f, 0.0f, 1.0f) );
-    texcoords.push_back( Vec2f(0.0f, 0.0f) );
+StateSetSharedPtr createTextureFromFile(std::string &fileName, std::vector<std::string> &searchPaths)
+{
+    TextureHostSharedPtr tisp;
+    std::string path;
+    unsigned int modified = 0;
+    {
+        QMutexLocker lock( &textureCacheMutex );
+        addTexturePlugInSearchPaths( searchPaths );
 
+        QFileInfo fileInfo;
+        if ( resolveTextureFile( fileName, searchPaths, fileInfo ) )
+        {
+            path = QDir::toNativeSeparators( fileInfo.canonicalFilePath() ).toLocal8Bit().constData();
+            modified = fileInfo.lastModified().toTime_t();
 
-    //-------------------------------
-    // Register the primitive
-    //-------------------------------
+            TextureCacheMap::iterator it = textureCache.find( path );
+            if ( ( it != textureCache.end() ) && ( it->second.modified == modified ) )
+            {
+                tisp = it->second.textureHost;
+                textureCacheStatistics.hits++;
+                textureCacheStatistics.savedBytes += it->second.bytes;
+            }
+        }
+    }
 
-    VertexAttributeSetSharedPtr vasPtr = VertexAttributeSet::create();
+    if ( !tisp && !path.empty() )
     {
-        VertexAttributeSetWriteLock vas( vasPtr );
+        // decode without holding the lock, so other threads keep getting their cached textures meanwhile
+        DecodedTexture decoded = decodeTextureFile( path, searchPaths, false );
 
-        vas->setVertices( &vertices[0], 6 );
-        vas->setNormals( &normals[0], 6 );
-        vas->setTexCoords( 0, &texcoords[0], 6 );
-        vas->setTexCoords( 1, &texcoords[0], 6 );
+        QMutexLocker lock( &textureCacheMutex );
+        textureCacheStatistics.misses++;
+        TextureCacheMap::iterator it = textureCache.find( path );
+        if ( ( it != textureCache.end() ) && ( it->second.modified == modified ) )
+        {
+            // another thread decoded the same file meanwhile, share its TextureHost
+            tisp = it->second.textureHost;
+        }
+        else if ( decoded.textureHost )
+        {
+            tisp = decoded.textureHost;
+            insertTextureCacheEntry( path, modified, decoded );
+        }
     }
 
-    PrimitiveSharedPtr primitivePtr = Primitive::create();
+    if ( !tisp && path.empty() )
     {
-        PrimitiveWriteLock primitive(primitivePtr);
-        primitive->setPrimitiveType( PRIMITIVE_TRIANGLES );
-        primitive->setVertexAttributeSet( vasPtr );
+        // not found in the search paths, leave it to the plug-ins as before
+        tisp = decodeTextureFile( fileName, searchPaths, false ).textureHost;
     }
-
-    DrawableSharedPtr drawablePtr = primitivePtr;
-
-    return drawablePtr;
+    if ( !tisp )
+    {
+        return( StateSetSharedPtr() );
+    }
+    return( createTextureStateSet( tisp ) );
 }
 
-// ===========================================================================
-
-DrawableSharedPtr createTessellatedBox( unsigned int subdiv )
-{
-    // create pointer to return
-    DrawableSharedPtr drawablePtr;
-    
-    // Setup vertices, normals, faces and texture coordinates
-    vector< Vec3f > vertices;
-    vector< Vec3f > normals;
-    vector< Vec2f > texcoords;
-    vector<unsigned int> indices;
-    vector< Face3 > faces;
-
-    const int size_v = 6 * ( subdiv + 2 ) * ( subdiv + 2 );
-    vertices.reserve( size_v );
-    normals.reserve( size_v );
-    texcoords.reserve( size_v );
-    indices.reserve( size_v );
-    faces.reserve( 6 * 2 * ( ( subdiv + 1 ) * ( subdiv + 1 ) ) );
+// ===========================================================================
 
-    // Setup transformations for 6 box sides
-    Mat44f transf[6];
-    transf[0] = Mat44f( 1.0f,  0.0f,  0.0f,  0.0f,
-                        0.0f,  1.0f,  0.0f,  0.0f,
-                        0.0f,  0.0f,  1.0f,  0.0f,
-                        0.0f,  0.0f,  1.0f,  1.0f ); // front
+TextureDecodeParameters::TextureDecodeParameters()
+    : maxBytesInFlight( 256 * 1024 * 1024 )
+    , maxThreads( 0 )
+    , reentrantLoaders( false )
+{
+}
 
-    transf[1] = Mat44f(-1.0f,  0.0f,  0.0f,  0.0f,
-                       0.0f,  1.0f,  0.0f,  0.0f,
-                       0.0f,  0.0f, -1.0f,  0.0f,
-                       0.0f,  0.0f, -1.0f,  1.0f ); // back, 180 degrees around y-axis
+std::vector<StateSetSharedPtr> createTexturesFromFiles( const std::vector<std::string> &fileNames, const std::vector<std::string> &searchPaths
+                                                      , const TextureDecodeParameters &parameters )
+{
+    std::vector<TextureHostSharedPtr> textureHosts( fileNames.size() );
+
+    // The files to decode, each one once even if it's listed several times
+    std::vector<std::string> paths;
+    std::vector<unsigned int> modified;
+    std::vector<size_t> estimatedBytes;
+    std::vector<size_t> decodeIndex( fileNames.size(), ~size_t(0) );
+    std::vector<size_t> unresolved;
+    {
+        QMutexLocker lock( &textureCacheMutex );
+        addTexturePlugInSearchPaths( searchPaths );
 
-    transf[2] = Mat44f( 0.0f,  0.0f,  1.0f,  0.0f,
-                        0.0f,  1.0f,  0.0f,  0.0f,
-                        -1.0f,  0.0f,  0.0f,  0.0f,
-                        -1.0f,  0.0f,  0.0f,  1.0f ); // left, -90 degrees around y-axis
+        std::map<std::string, size_t> pathIndex;
+        for ( size_t i = 0; i < fileNames.size(); ++i )
+        {
+            QFileInfo fileInfo;
+            if ( !resolveTextureFile( fileNames[i], searchPaths, fileInfo ) )
+            {
+                unresolved.push_back( i );
+                continue;
+            }
 
-    transf[3] = Mat44f( 0.0f,  0.0f, -1.0f,  0.0f,
-                        0.0f,  1.0f,  0.0f,  0.0f,
-                        1.0f,  0.0f,  0.0f,  0.0f,
-                        1.0f,  0.0f,  0.0f,  1.0f ); // right, 90 degrees around y-axis
+            std::string path( QDir::toNativeSeparators( fileInfo.canonicalFilePath() ).toLocal8Bit().constData() );
+            unsigned int fileModified = fileInfo.lastModified().toTime_t();
+            TextureCacheMap::const_iterator it = textureCache.find( path );
+            if ( ( it != textureCache.end() ) && ( it->second.modified == fileModified ) )
+            {
+                textureHosts[i] = it->second.textureHost;
+                textureCacheStatistics.hits++;
+                textureCacheStatistics.savedBytes += it->second.bytes;
+                continue;
+            }
 
-    transf[4] = Mat44f( 1.0f,  0.0f,  0.0f,  0.0f,
-                        0.0f,  0.0f,  1.0f,  1.0f,
-                        0.0f, -1.0f,  0.0f,  0.0f,
-                        0.0f, -1.0f,  0.0f,  1.0f ); // bottom, 90 degrees around x-axis
+            std::pair<std::map<std::string, size_t>::iterator, bool> inserted = pathIndex.insert( std::make_pair( path, paths.size() ) );
+            if ( inserted.second )
+            {
+                paths.push_back( path );
+                modified.push_back( fileModified );
+                estimatedBytes.push_back( checked_cast<size_t>( fileInfo.size() ) );
+            }
+            decodeIndex[i] = inserted.first->second;
+        }
+    }
 
-    transf[5] = Mat44f( 1.0f,  0.0f,  0.0f,  0.0f,
-                        0.0f,  0.0f, -1.0f,  1.0f,
-                        0.0f,  1.0f,  0.0f,  0.0f,
-                        0.0f,  1.0f,  0.0f,  1.0f ); // top, -90 degrees around x-axis
-    
-    for ( unsigned int i=0; i<6; i++ )
+    // read the image sizes outside of the lock
+    for ( size_t i = 0; i < paths.size(); ++i )
     {
-        setupTessellatedPlane( subdiv, transf[i], faces, vertices, normals, texcoords, indices);
+        estimatedBytes[i] = estimateTextureDecodeBytes( paths[i], estimatedBytes[i] );
     }
 
-    // Create a VertexAttributeSet with vertices, normals and texture coordinates
-    VertexAttributeSetSharedPtr vasPtr = VertexAttributeSet::create();
+    // Decode ahead of the texture handed back next, as far as the thread count and the memory budget allow, but
+    // always at least that texture. The textures go into the cache in the order of the files.
+    const size_t window = parameters.maxThreads ? parameters.maxThreads : checked_cast<size_t>( std::max( 1, QThread::idealThreadCount() ) );
+    std::vector< QFuture<DecodedTexture> > futures( paths.size() );
+    std::vector<TextureHostSharedPtr> decodedHosts( paths.size() );
+    size_t started = 0;
+    for ( size_t i = 0; i < paths.size(); ++i )
     {
-        VertexAttributeSetWriteLock vas( vasPtr );
-        vas->setVertices( &vertices[0], size_v );
-        vas->setNormals( &normals[0], size_v );
-        vas->setTexCoords( 0, &texcoords[0], size_v );
+        while (   ( started < paths.size() ) && ( started < i + window )
+               && (   ( started == i )
+                   || ( getTextureDecodeBytes( futures, estimatedBytes, i, started ) + estimatedBytes[started] <= parameters.maxBytesInFlight ) ) )
+        {
+            futures[started] = QtConcurrent::run( &decodeTextureFile, paths[started], searchPaths, parameters.reentrantLoaders );
+            ++started;
+        }
+
+        DecodedTexture decoded = futures[i].result();
+        futures[i] = QFuture<DecodedTexture>();
+        decodedHosts[i] = decoded.textureHost;
+
+        QMutexLocker lock( &textureCacheMutex );
+        textureCacheStatistics.misses++;
+        if ( decoded.textureHost )
+        {
+            insertTextureCacheEntry( paths[i], modified[i], decoded );
+        }
     }
 
+    for ( size_t i = 0; i < fileNames.size(); ++i )
     {
-        // Create a PrimitiveSet
-        IndexSetSharedPtr indexSet( IndexSet::create() );
-        IndexSetWriteLock(indexSet)->setData( &indices[0], checked_cast<unsigned int>(indices.size()) );
-
-        PrimitiveSharedPtr primitivePtr = Primitive::create();
+        if ( decodeIndex[i] != ~size_t(0) )
         {
-            PrimitiveWriteLock primitive(primitivePtr);
-            primitive->setPrimitiveType( PRIMITIVE_TRIANGLES );
-            primitive->setVertexAttributeSet( vasPtr );
-            primitive->setIndexSet( indexSet );
+            textureHosts[i] = decodedHosts[decodeIndex[i]];
         }
+    }
 
-        drawablePtr = primitivePtr;
+    // not found in the search paths, leave them to the plug-ins as createTextureFromFile does
+    for ( size_t i = 0; i < unresolved.size(); ++i )
+    {
+        textureHosts[unresolved[i]] = decodeTextureFile( fileNames[unresolved[i]], searchPaths, parameters.reentrantLoaders ).textureHost;
     }
 
-    return drawablePtr;
+    std::vector<StateSetSharedPtr> stateSets( fileNames.size() );
+    for ( size_t i = 0; i < fileNames.size(); ++i )
+    {
+        if ( textureHosts[i] )
+        {
+            stateSets[i] = createTextureStateSet( textureHosts[i] );
+        }
+    }
+    return( stateSets );
 }
 
 // ===========================================================================
 
-StateSetSharedPtr createDefaultMaterial( const Vec3f &diffuseColor )
+TextureCacheStatistics getTextureCacheStatistics()
 {
-    // Create a Material
-    MaterialSharedPtr materialPtr = Material::create();
-    StateSetSharedPtr statePtr = StateSet::create();
-    MaterialWriteLock mw( materialPtr );
-    mw->setDiffuseColor( diffuseColor );
-
-    // Create a StateSet
-    StateSetWriteLock ssw( statePtr );
-    ssw->addAttribute( materialPtr );
-
-    return statePtr;
+    QMutexLocker lock( &textureCacheMutex );
+    return( textureCacheStatistics );
 }
 
 // ===========================================================================
 
-StateSetSharedPtr createDefinedMaterial( const Vec3f &ambientColor,
-                                         const Vec3f &diffuseColor,
-                                         const Vec3f &specularColor,
-                                         const float specularExponent,
-                                         const Vec3f &emissiveColor,
-                                         const float opacity,
-                                         const float reflectivity,
-                                         const float indexOfRefraction )
+void releaseTextureCache()
 {
-    // Create a Material
-    MaterialSharedPtr materialPtr = createMaterialAttribute( ambientColor,
-                                                             diffuseColor,
-                                                             specularColor,
-                                                             specularExponent,
-                                                             emissiveColor,
-                                                             opacity,
-                                                             reflectivity,
-                                                             indexOfRefraction );
-
-    // Create a StateSet
-    StateSetSharedPtr statePtr = StateSet::create();
-    StateSetWriteLock( statePtr )->addAttribute( materialPtr );
-
-    return statePtr;
+    QMutexLocker lock( &textureCacheMutex );
+    textureCache.clear();
+    textureCacheStatistics.entries = 0;
+    textureCacheStatistics.bytes = 0;
 }
 
 // ===========================================================================
 
-MaterialSharedPtr createMaterialAttribute( const Vec3f &ambientColor,
-                                           const Vec3f &diffuseColor,
-                                           const Vec3f &specularColor,
-                                           const float specularExponent,
-                                           const Vec3f &emissiveColor,
-                                           const float opacity,
-                                           const float reflectivity,
-                                           const float indexOfRefraction )
+ProceduralTextureParameters::ProceduralTextureParameters()
+    : mipmaps( false )
+    , multithreaded( true )
+    , preserveHostCopy( true )
 {
-    // Create a Material
-    MaterialSharedPtr materialPtr = Material::create();
-    {
-        MaterialWriteLock mw( materialPtr );
-        mw->setAmbientColor( ambientColor );
-        mw->setDiffuseColor( diffuseColor );
-        mw->setSpecularColor( specularColor );
-        mw->setSpecularExponent( specularExponent );
-        mw->setEmissiveColor( emissiveColor );
-        mw->setOpacity( opacity );
-        mw->setReflectivity( reflectivity );
-        mw->setIndexOfRefraction( indexOfRefraction );
-    }
-    return materialPtr;
 }
 
-// ===========================================================================
-
-StateSetSharedPtr createTextureFromFile(std::string &fileName, std::vector<std::string> &searchPaths)
+namespace
 {
-    nvutil::addPlugInSearchPath(std::string("C:\\Program Files\\NVIDIA Corporation\\SceniX 7.2\\bin\\x86\\win\\crt90\\debug"));
-    nvutil::addPlugInSearchPath(searchPaths[0]);
-    nvutil::addPlugInSearchPath(searchPaths[1]);
-
-    std::vector<std::string> pluginSearchPaths = nvutil::getPlugInSearchPath();
+//! Fills the 8-bit RGBA texels of row \a row of a procedural image of \a width x \a height texels
+typedef void (*TexelRowFunction)( unsigned int row, unsigned int width, unsigned int height, unsigned char *texels );
 
-    TextureHostSharedPtr tisp = TextureHost::createFromFile(fileName, searchPaths,
-                                                                TextureHost::F_SCALE_FILTER_BOX);
-
-    {
-        TextureHostWriteLock tihwl(tisp);
-        tihwl->setTextureTarget(determineTextureTarget(tisp));
-    }
+//! The rows [begin, end) of an image, either filled by a TexelRowFunction or reduced from the next larger mipmap
+struct TextureRowJob
+{
+    TexelRowFunction     function;      // 0 to reduce from src
+    const unsigned char *src;
+    unsigned int         srcWidth;
+    unsigned int         srcHeight;
+    unsigned char       *dst;
+    unsigned int         width;
+    unsigned int         height;
+    unsigned int         begin;
+    unsigned int         end;
+};
+
+//! Helper function to convert \a value in [0,1] to 8 bits
+unsigned char toFixed8( float value )
+{
+    return( (unsigned char)( clamp( value, 0.0f, 1.0f ) * 255.0f + 0.5f ) );
+}
 
-    TextureAttributeSharedPtr texAttPtr( TextureAttribute::create() );
+//! Helper function to fill a row of the colored checker pattern of createTexture
+void checkerTexelRow( unsigned int row, unsigned int width, unsigned int height, unsigned char *texels )
+{
+    for ( unsigned int j = 0; j < width; ++j, texels += 4 )
     {
-        TextureAttributeWriteLock texAtt( texAttPtr );
-        TextureAttributeItemSharedPtr texAttItemPtr( TextureAttributeItem::create() );
-        TextureAttributeItemWriteLock texAttItem( texAttItemPtr );
-        texAttItem->setTexture( tisp );
-        texAttItem->setMagFilterMode( TFM_MAG_NEAREST );
-        texAttItem->setMinFilterMode( TFM_MIN_NEAREST );
-        texAtt->bindTextureAttributeItem( texAttItemPtr, 0 );
+        unsigned int c = row ^ j;
+        texels[0] = ( c & 1 ) ? 255 : 0;
+        texels[1] = ( c & 2 ) ? 255 : 0;
+        texels[2] = ( c & 4 ) ? 255 : 0;
+        texels[3] = 255;
     }
+}
 
-    // Create a StateSet and attach material and shader
-    StateSetSharedPtr stateSetPtr = StateSet::create();
+//! Helper function to fill a row of the radial grey and alpha falloff of createAlphaTexture
+void alphaTexelRow( unsigned int row, unsigned int width, unsigned int height, unsigned char *texels )
+{
+    float dx = ( (float)row - (float)(height-1)/2.0f ) / ( (float)(height-1)/2.0f );
+    for ( unsigned int j = 0; j < width; ++j, texels += 4 )
     {
-        StateSetWriteLock stateSet( stateSetPtr );
-        stateSet->addAttribute( texAttPtr );
+        float dy = ( (float)j - (float)(width-1)/2.0f ) / ( (float)(width-1)/2.0f );
+        unsigned char val = toFixed8( max( 0.0f, 1.0f - ( dx*dx + dy*dy ) ) );
+        texels[0] = texels[1] = texels[2] = texels[3] = val;
     }
-    return stateSetPtr;
 }
 
-// ===========================================================================
-
-StateSetSharedPtr createTexture()
+//! Helper function to fill the rows of \a job, reducing 2x2 texels of the larger image to one, clamped at odd sizes
+void runTextureRowJob( const TextureRowJob &job )
 {
-    vector<Vec4f> tex;
-    tex.resize(64);
-
-    // Create pattern
-    for( unsigned int i = 0; i < 8; ++i )
+    for ( unsigned int y = job.begin; y < job.end; ++y )
     {
-        for( unsigned int j = 0; j < 8; ++j )
+        unsigned char *dst = job.dst + 4 * y * job.width;
+        if ( job.function )
         {
-            unsigned int pos = i * 8 + j;
-            Vec4f col(float(( i ^ j ) & 1), float((( i ^ j ) & 2) / 2), float(((i  ^ j ) & 4) / 4), 1.0f);
-            tex.at(pos) = col;
+            job.function( y, job.width, job.height, dst );
+            continue;
+        }
+
+        const unsigned char *row0 = job.src + 4 * std::min( 2 * y, job.srcHeight - 1 ) * job.srcWidth;
+        const unsigned char *row1 = job.src + 4 * std::min( 2 * y + 1, job.srcHeight - 1 ) * job.srcWidth;
+        for ( unsigned int x = 0; x < job.width; ++x, dst += 4 )
+        {
+            unsigned int x0 = 4 * std::min( 2 * x, job.srcWidth - 1 );
+            unsigned int x1 = 4 * std::min( 2 * x + 1, job.srcWidth - 1 );
+            for ( unsigned int c = 0; c < 4; ++c )
+            {
+                dst[c] = (unsigned char)( ( row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2 ) / 4 );
+            }
         }
     }
+}
 
-    TextureHostSharedPtr tisp = TextureHost::create();
+//! Helper function to run \a jobs on the global QThreadPool, or on the calling thread
+void runTextureRowJobs( vector<TextureRowJob> &jobs, bool multithreaded )
+{
+    if ( multithreaded && ( 1 < jobs.size() ) )
     {
-        TextureHostWriteLock tiw( tisp );
-        tiw->setCreationFlags( TextureHost::F_PRESERVE_IMAGE_DATA_AFTER_UPLOAD );
-        unsigned int index = tiw->addImage( 8, 8, 1, Image::IMG_RGBA, Image::IMG_FLOAT32 );
-        NVSG_ASSERT( index != -1 );
-        tiw->setImageData( index, (const void *) &tex[0] );
-
-        tiw->setTextureTarget( NVSG_TEXTURE_2D );
-        tiw->setTextureGPUFormat(TextureHost::TGF_FIXED8);
+        QtConcurrent::blockingMap( jobs, &runTextureRowJob );
     }
-
-    TextureAttributeSharedPtr texAttPtr( TextureAttribute::create() );
+    else
     {
-        TextureAttributeWriteLock texAtt( texAttPtr );
-        TextureAttributeItemSharedPtr texAttItemPtr( TextureAttributeItem::create() );
-        TextureAttributeItemWriteLock texAttItem( texAttItemPtr );
-        texAttItem->setTexture( tisp );
-        texAttItem->setMagFilterMode( TFM_MAG_NEAREST );
-        texAttItem->setMinFilterMode( TFM_MIN_NEAREST );
-        texAtt->bindTextureAttributeItem( texAttItemPtr, 0 );
+        for ( size_t i = 0; i < jobs.size(); ++i )
+        {
+            runTextureRowJob( jobs[i] );
+        }
     }
+}
 
-    // Create a StateSet and attach material and shader
-    StateSetSharedPtr stateSetPtr = StateSet::create();
+//! Helper function to split the rows of the image \a dst into jobs of about 64k texels each
+void setupTextureRowJobs( TexelRowFunction function, const unsigned char *src, unsigned int srcWidth, unsigned int srcHeight,
+                          unsigned char *dst, unsigned int width, unsigned int height, vector<TextureRowJob> &jobs )
+{
+    unsigned int rows = std::max( 1u, 65536 / width );
+    jobs.clear();
+    for ( unsigned int begin = 0; begin < height; begin += rows )
     {
-        StateSetWriteLock stateSet( stateSetPtr );
-        stateSet->addAttribute( texAttPtr );
+        TextureRowJob job;
+        job.function = function;
+        job.src = src;
+        job.srcWidth = srcWidth;
+        job.srcHeight = srcHeight;
+        job.dst = dst;
+        job.width = width;
+        job.height = height;
+        job.begin = begin;
+        job.end = std::min( begin + rows, height );
+        jobs.push_back( job );
     }
-
-    return stateSetPtr;
 }
 
-// ===========================================================================
-
-StateSetSharedPtr createAlphaTexture( unsigned int n /* =64 */ )
+//! Helper function to create a 2D TextureHost of \a width x \a height 8-bit RGBA texels filled by \a function
+// The mipmaps are reduced level by level, each level distributed over the cores by rows.
+TextureHostSharedPtr createProceduralTextureHost( unsigned int width, unsigned int height, TexelRowFunction function,
+                                                  const ProceduralTextureParameters &parameters )
 {
-    vector<Vec4f> tex;
-    tex.resize(n*n);
-    
-    // Create pattern
-    for( unsigned int i = 0; i < n; ++i )
+    vector< vector<unsigned char> > levels( 1, vector<unsigned char>( 4 * width * height ) );
+    vector<TextureRowJob> jobs;
+    setupTextureRowJobs( function, 0, 0, 0, &levels[0][0], width, height, jobs );
+    runTextureRowJobs( jobs, parameters.multithreaded );
+
+    unsigned int w = width;
+    unsigned int h = height;
+    while ( parameters.mipmaps && ( ( 1 < w ) || ( 1 < h ) ) )
     {
-        for( unsigned int j = 0; j < n; ++j )
-        {
-            float dx = ( (float)i - (float)(n-1)/2.0f ) / ( (float)(n-1)/2.0f );
-            float dy = ( (float)j - (float)(n-1)/2.0f ) / ( (float)(n-1)/2.0f );
-
-            float val = max(0.0f, 1.0f - (dx*dx+dy*dy));
+        unsigned int mw = std::max( 1u, w / 2 );
+        unsigned int mh = std::max( 1u, h / 2 );
+        levels.push_back( vector<unsigned char>( 4 * mw * mh ) );
+        setupTextureRowJobs( 0, &levels[levels.size() - 2][0], w, h, &levels.back()[0], mw, mh, jobs );
+        runTextureRowJobs( jobs, parameters.multithreaded );
+        w = mw;
+        h = mh;
+    }
 
-            unsigned int pos = i * n + j;
-            Vec4f col( val, val, val, val );
-            tex.at(pos) = col;
-        }
+    vector<const void *> mipmaps;
+    for ( size_t i = 1; i < levels.size(); ++i )
+    {
+        mipmaps.push_back( &levels[i][0] );
     }
 
     TextureHostSharedPtr tisp = TextureHost::create();
     {
         TextureHostWriteLock tiw( tisp );
-        tiw->setCreationFlags( TextureHost::F_PRESERVE_IMAGE_DATA_AFTER_UPLOAD );
-        unsigned int index = tiw->addImage( n, n, 1, Image::IMG_RGBA, Image::IMG_FLOAT32 );
+        tiw->setCreationFlags( parameters.preserveHostCopy ? TextureHost::F_PRESERVE_IMAGE_DATA_AFTER_UPLOAD : 0 );
+        unsigned int index = tiw->addImage( width, height, 1, Image::IMG_RGBA, Image::IMG_UNSIGNED_BYTE );
         NVSG_ASSERT( index != -1 );
-        tiw->setImageData( index, (const void *) &tex[0] );
+        tiw->setImageData( index, (const void *) &levels[0][0], mipmaps );
         tiw->setTextureTarget( NVSG_TEXTURE_2D );
         tiw->setTextureGPUFormat(TextureHost::TGF_FIXED8);
     }
+    return( tisp );
+}
+}
 
-    TextureAttributeSharedPtr texAttPtr( TextureAttribute::create() );
-    {
-        TextureAttributeWriteLock texAtt( texAttPtr );
-        TextureAttributeItemSharedPtr texAttItemPtr( TextureAttributeItem::create() );
-        TextureAttributeItemWriteLock texAttItem( texAttItemPtr );
-        texAttItem->setTexture( tisp );
-        texAttItem->setMagFilterMode( TFM_MAG_NEAREST );
-        texAttItem->setMinFilterMode( TFM_MIN_NEAREST );
-        texAtt->bindTextureAttributeItem( texAttItemPtr, 0 );
-    }
+StateSetSharedPtr createTexture( const ProceduralTextureParameters &parameters )
+{
+    TextureHostSharedPtr tisp = createProceduralTextureHost( 8, 8, &checkerTexelRow, parameters );
+    return( createTextureStateSet( tisp, parameters.mipmaps ) );
+}
 
-    // Create a StateSet and attach material and shader
-    StateSetSharedPtr stateSetPtr = StateSet::create();
-    {
-        StateSetWriteLock stateSet( stateSetPtr );
-        stateSet->addAttribute( texAttPtr );
-    }
+// ===========================================================================
 
-    return stateSetPtr;
+StateSetSharedPtr createAlphaTexture( unsigned int n /* =64 */, const ProceduralTextureParameters &parameters )
+{
+    TextureHostSharedPtr tisp = createProceduralTextureHost( n, n, &alphaTexelRow, parameters );
+    return( createTextureStateSet( tisp, parameters.mipmaps ) );
 }
 
 // ===========================================================================
@@ -2203,6 +3861,150 @@ TransformSharedPtr imitateRaster( unsigned int width, unsigned int height )
 
 // ===========================================================================
 
+StressSceneParameters::StressSceneParameters()
+    : countX( 10 )
+    , countY( 10 )
+    , countZ( 10 )
+    , spacing( 3.0f )
+    , drawables( 4 )
+    , materials( 8 )
+    , randomRotation( false )
+    , minScale( 1.0f )
+    , maxScale( 1.0f )
+    , seed( 1 )
+{
+}
+
+namespace
+{
+//! Small xorshift generator, so the stress scenes are the same on every platform for the same seed
+class StressRandom
+{
+public:
+    explicit StressRandom( unsigned int seed )
+        : m_state( seed ? seed : 0x9e3779b9 )
+    {
+    }
+
+    unsigned int next()
+    {
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 17;
+        m_state ^= m_state << 5;
+        return( m_state );
+    }
+
+    //! Returns a float in [0, 1)
+    float nextFloat()
+    {
+        return( (float)( next() >> 8 ) * ( 1.0f / 16777216.0f ) );
+    }
+
+private:
+    unsigned int m_state;
+};
+
+//! Helper function to create the stress scene drawable \a index, cycling through the generators with increasing tessellation
+DrawableSharedPtr createStressDrawable( unsigned int index )
+{
+    unsigned int detail = 1 + index / 6;
+    switch( index % 6 )
+    {
+    case 0:
+        return( getSharedPolyhedron( POLYHEDRON_CUBE ) );
+    case 1:
+        return( createSphere( 16 * detail, 8 * detail, 0.75f ) );
+    case 2:
+        return( createTorus( 16 * detail, 8 * detail, 0.6f, 0.3f ) );
+    case 3:
+        return( createCylinder( 0.6f, 1.5f, detail, 16 * detail ) );
+    case 4:
+        return( createIcoSphere( std::min( detail, 6u ), 0.75f ) );
+    default:
+        return( createTessellatedBox( 2 * detail ) );
+    }
+}
+}
+
+GroupSharedPtr createStressScene( const StressSceneParameters &parameters )
+{
+    NVSG_ASSERT( 1 <= parameters.drawables && 1 <= parameters.materials && parameters.minScale <= parameters.maxScale );
+
+    StressRandom random( parameters.seed );
+
+    // The shared GeoNodes, one per combination of drawable and material
+    vector<DrawableSharedPtr> drawables( parameters.drawables );
+    for ( unsigned int i = 0; i < parameters.drawables; ++i )
+    {
+        drawables[i] = createStressDrawable( i );
+    }
+
+    vector<StateSetSharedPtr> materials( parameters.materials );
+    for ( unsigned int i = 0; i < parameters.materials; ++i )
+    {
+        Vec3f color( random.nextFloat(), random.nextFloat(), random.nextFloat() );
+        materials[i] = getSharedDefaultMaterial( 0.2f * Vec3f( 1.0f, 1.0f, 1.0f ) + 0.8f * color );
+    }
+
+    vector<GeoNodeSharedPtr> geoNodes( parameters.drawables * parameters.materials );
+    for ( unsigned int i = 0; i < parameters.drawables; ++i )
+    {
+        for ( unsigned int j = 0; j < parameters.materials; ++j )
+        {
+            geoNodes[i * parameters.materials + j] = createGeoNode( drawables[i], materials[j] );
+        }
+    }
+
+    // One Group per x and per x/y column holding the transforms along z,
+    // so the bounding volumes form a hierarchy instead of a million siblings below the root.
+    Vec3f origin = -0.5f * parameters.spacing * Vec3f( (float)parameters.countX - 1.0f, (float)parameters.countY - 1.0f, (float)parameters.countZ - 1.0f );
+
+    GroupSharedPtr rootPtr = Group::create();
+    GroupWriteLock root( rootPtr );
+    root->setName( "Stress Scene" );
+    for ( unsigned int x = 0; x < parameters.countX; ++x )
+    {
+        GroupSharedPtr slicePtr = Group::create();
+        GroupWriteLock slice( slicePtr );
+        for ( unsigned int y = 0; y < parameters.countY; ++y )
+        {
+            GroupSharedPtr columnPtr = Group::create();
+            GroupWriteLock column( columnPtr );
+            for ( unsigned int z = 0; z < parameters.countZ; ++z )
+            {
+                const GeoNodeSharedPtr &geoNode = geoNodes[random.next() % geoNodes.size()];
+                Vec3f translation = origin + parameters.spacing * Vec3f( (float)x, (float)y, (float)z );
+
+                Quatf orientation( Vec3f( 0.0f, 1.0f, 0.0f ), 0.0f );
+                if ( parameters.randomRotation )
+                {
+                    // uniformly distributed rotation, K. Shoemake, Graphics Gems III
+                    float u1 = random.nextFloat();
+                    float u2 = 2.0f * PI * random.nextFloat();
+                    float u3 = 2.0f * PI * random.nextFloat();
+                    float s1 = sqrtf( 1.0f - u1 );
+                    float s2 = sqrtf( u1 );
+                    orientation = Quatf( s1 * sinf( u2 ), s1 * cosf( u2 ), s2 * sinf( u3 ), s2 * cosf( u3 ) );
+                }
+
+                float scale = parameters.minScale;
+                if ( parameters.minScale < parameters.maxScale )
+                {
+                    scale += ( parameters.maxScale - parameters.minScale ) * random.nextFloat();
+                }
+
+                column->addChild( createTransform( geoNode, translation, orientation, Vec3f( scale, scale, scale ) ) );
+            }
+            slice->addChild( columnPtr );
+        }
+        root->addChild( slicePtr );
+    }
+
+    return( rootPtr );
+}
+
+// ===========================================================================
+
 void setCameraPOV(float x, float y, float z, ViewStateSharedPtr viewState)
 {
 
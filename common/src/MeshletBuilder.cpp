@@ -0,0 +1,297 @@
+#include "MeshletBuilder.h"
+
+#include <nvsg/Buffer.h>
+#include <nvsg/IndexSet.h>
+#include <nvsg/Primitive.h>
+#include <nvsg/VertexAttributeSet.h>
+#include <nvutil/Tools.h>
+
+#include <algorithm>
+
+#include <float.h>
+#include <math.h>
+
+#include "nvutil/DbgNew.h" // this must be the last include
+
+using namespace nvmath;
+using namespace nvsg;
+using namespace std;
+
+namespace nvutil
+{
+namespace
+{
+//! Helper function to read the positions of \a vas
+bool getPositions( const VertexAttributeSetSharedPtr &vasPtr, std::vector<Vec3f> &positions )
+{
+    VertexAttributeSetReadLock vas( vasPtr );
+    if (   ( vas->getNumberOfVertexData( VertexAttributeSet::NVSG_POSITION ) == 0 )
+        || ( vas->getTypeOfVertexData( VertexAttributeSet::NVSG_POSITION ) != NVSG_FLOAT )
+        || ( vas->getSizeOfVertexData( VertexAttributeSet::NVSG_POSITION ) != 3 ) )
+    {
+        return( false );
+    }
+
+    unsigned int count = vas->getNumberOfVertexData( VertexAttributeSet::NVSG_POSITION );
+    unsigned int stride = vas->getStrideOfVertexData( VertexAttributeSet::NVSG_POSITION );
+    Buffer::DataReadLock lock( vas->getVertexBuffer( VertexAttributeSet::NVSG_POSITION ) );
+    const char *data = lock.getPtr<char>() + vas->getOffsetOfVertexData( VertexAttributeSet::NVSG_POSITION );
+
+    positions.resize( count );
+    for ( unsigned int i = 0; i < count; ++i )
+    {
+        positions[i] = *reinterpret_cast<const Vec3f *>( data + i * stride );
+    }
+    return( true );
+}
+
+//! Helper function to read the indices of \a indexSet as unsigned int
+bool getIndices( const IndexSetSharedPtr &indexSetPtr, std::vector<unsigned int> &indices )
+{
+    IndexSetReadLock indexSet( indexSetPtr );
+    unsigned int count = indexSet->getNumberOfIndices();
+    Buffer::DataReadLock lock( indexSet->getBuffer() );
+
+    indices.resize( count );
+    switch( indexSet->getIndexDataType() )
+    {
+    case NVSG_UNSIGNED_INT:
+        std::copy( lock.getPtr<unsigned int>(), lock.getPtr<unsigned int>() + count, indices.begin() );
+        return( true );
+    case NVSG_UNSIGNED_SHORT:
+        std::copy( lock.getPtr<unsigned short>(), lock.getPtr<unsigned short>() + count, indices.begin() );
+        return( true );
+    case NVSG_UNSIGNED_BYTE:
+        std::copy( lock.getPtr<unsigned char>(), lock.getPtr<unsigned char>() + count, indices.begin() );
+        return( true );
+    default:
+        return( false );
+    }
+}
+
+//! Helper function to finish \a meshlet: its bounding sphere and the cone around the normals of its triangles
+void setupMeshletBounds( const std::vector<Vec3f> &positions, const MeshletSet &meshlets, Meshlet &meshlet )
+{
+    const unsigned int *vertices = &meshlets.vertexIndices[meshlet.vertexOffset];
+
+    // The sphere around the center of the box is not minimal, but good enough for culling
+    Vec3f lower( positions[vertices[0]] );
+    Vec3f upper( positions[vertices[0]] );
+    for ( unsigned int i = 1; i < meshlet.vertexCount; ++i )
+    {
+        const Vec3f &p = positions[vertices[i]];
+        for ( unsigned int j = 0; j < 3; ++j )
+        {
+            lower[j] = std::min( lower[j], p[j] );
+            upper[j] = std::max( upper[j], p[j] );
+        }
+    }
+    Vec3f center = 0.5f * ( lower + upper );
+    float radius = 0.0f;
+    for ( unsigned int i = 0; i < meshlet.vertexCount; ++i )
+    {
+        radius = std::max( radius, length( positions[vertices[i]] - center ) );
+    }
+    meshlet.sphere = Sphere3f( center, radius );
+
+    // The cone axis is the average of the face normals, the cutoff the sine of its widest angle to them
+    std::vector<Vec3f> normals;
+    normals.reserve( meshlet.triangleCount );
+    Vec3f axis( 0.0f, 0.0f, 0.0f );
+    const unsigned char *local = &meshlets.localIndices[3 * meshlet.triangleOffset];
+    for ( unsigned int i = 0; i < meshlet.triangleCount; ++i, local += 3 )
+    {
+        const Vec3f &a = positions[vertices[local[0]]];
+        Vec3f n = ( positions[vertices[local[1]]] - a ) ^ ( positions[vertices[local[2]]] - a );
+        float l = length( n );
+        if ( FLT_EPSILON < l )
+        {
+            normals.push_back( n / l );
+            axis += normals.back();
+        }
+    }
+
+    meshlet.coneAxis = Vec3f( 0.0f, 0.0f, 0.0f );
+    meshlet.coneCutoff = 1.0f;
+    float axisLength = length( axis );
+    if ( normals.empty() || ( axisLength <= FLT_EPSILON ) )
+    {
+        return;
+    }
+    axis /= axisLength;
+
+    float minDot = 1.0f;
+    for ( size_t i = 0; i < normals.size(); ++i )
+    {
+        minDot = std::min( minDot, normals[i] * axis );
+    }
+
+    // Normals spread over a half space or more can't be culled as a whole
+    if ( 0.0f < minDot )
+    {
+        meshlet.coneAxis = axis;
+        meshlet.coneCutoff = sqrtf( 1.0f - minDot * minDot );
+    }
+}
+}
+
+MeshletParameters::MeshletParameters()
+    : maxVertices( 64 )
+    , maxTriangles( 124 )
+{
+}
+
+// ===========================================================================
+
+bool buildMeshlets( const PrimitiveSharedPtr &primitivePtr, MeshletSet &meshlets, const MeshletParameters &parameters )
+{
+    NVSG_ASSERT( 3 <= parameters.maxVertices && parameters.maxVertices <= 256 && 1 <= parameters.maxTriangles );
+
+    meshlets.meshlets.clear();
+    meshlets.vertexIndices.clear();
+    meshlets.localIndices.clear();
+
+    std::vector<Vec3f> positions;
+    std::vector<unsigned int> indices;
+    {
+        PrimitiveReadLock primitive( primitivePtr );
+        if (   ( primitive->getPrimitiveType() != PRIMITIVE_TRIANGLES )
+            || !primitive->getVertexAttributeSet()
+            || !getPositions( primitive->getVertexAttributeSet(), positions ) )
+        {
+            return( false );
+        }
+
+        if ( primitive->getIndexSet() )
+        {
+            if ( !getIndices( primitive->getIndexSet(), indices ) )
+            {
+                return( false );
+            }
+            // an index outside of the positions, like a primitive restart index, can't be put into a meshlet
+            if ( !indices.empty() && ( positions.size() <= *std::max_element( indices.begin(), indices.end() ) ) )
+            {
+                return( false );
+            }
+        }
+        else
+        {
+            indices.resize( positions.size() );
+            for ( size_t i = 0; i < indices.size(); ++i )
+            {
+                indices[i] = checked_cast<unsigned int>( i );
+            }
+        }
+    }
+
+    // The local index of each vertex in the current meshlet, valid if its stamp is the meshlet number
+    std::vector<unsigned int> localIndex( positions.size() );
+    std::vector<unsigned int> stamp( positions.size(), ~0u );
+
+    const unsigned int maxVertices = std::min( parameters.maxVertices, 256u );
+    Meshlet meshlet;
+    meshlet.vertexOffset = 0;
+    meshlet.vertexCount = 0;
+    meshlet.triangleOffset = 0;
+    meshlet.triangleCount = 0;
+
+    for ( size_t t = 0; t + 3 <= indices.size(); t += 3 )
+    {
+        unsigned int current = checked_cast<unsigned int>( meshlets.meshlets.size() );
+        unsigned int newVertices = 0;
+        for ( unsigned int k = 0; k < 3; ++k )
+        {
+            // count repeated vertices of a degenerated triangle only once
+            unsigned int index = indices[t + k];
+            if (   ( stamp[index] != current )
+                && ( ( k == 0 ) || ( index != indices[t] ) )
+                && ( ( k < 2 ) || ( index != indices[t + 1] ) ) )
+            {
+                ++newVertices;
+            }
+        }
+
+        // Start a new meshlet if this triangle doesn't fit
+        if ( ( maxVertices < meshlet.vertexCount + newVertices ) || ( parameters.maxTriangles <= meshlet.triangleCount ) )
+        {
+            setupMeshletBounds( positions, meshlets, meshlet );
+            meshlets.meshlets.push_back( meshlet );
+            ++current;
+
+            meshlet.vertexOffset = checked_cast<unsigned int>( meshlets.vertexIndices.size() );
+            meshlet.vertexCount = 0;
+            meshlet.triangleOffset = checked_cast<unsigned int>( meshlets.localIndices.size() / 3 );
+            meshlet.triangleCount = 0;
+        }
+
+        for ( unsigned int k = 0; k < 3; ++k )
+        {
+            unsigned int index = indices[t + k];
+            if ( stamp[index] != current )
+            {
+                stamp[index] = current;
+                localIndex[index] = meshlet.vertexCount++;
+                meshlets.vertexIndices.push_back( index );
+            }
+            meshlets.localIndices.push_back( checked_cast<unsigned char>( localIndex[index] ) );
+        }
+        ++meshlet.triangleCount;
+    }
+
+    if ( meshlet.triangleCount )
+    {
+        setupMeshletBounds( positions, meshlets, meshlet );
+        meshlets.meshlets.push_back( meshlet );
+    }
+    return( true );
+}
+
+// ===========================================================================
+
+unsigned int cullMeshlets( const MeshletSet &meshlets, const Vec3f &cameraPosition
+                         , const std::vector<Vec4f> &planes, std::vector<unsigned int> &visible )
+{
+    visible.clear();
+    for ( size_t i = 0; i < meshlets.meshlets.size(); ++i )
+    {
+        const Meshlet &meshlet = meshlets.meshlets[i];
+        const Vec3f &center = meshlet.sphere.getCenter();
+        const float radius = meshlet.sphere.getRadius();
+
+        // All triangles face away if the view direction to every point of the sphere is within the backside of the cone
+        Vec3f view = center - cameraPosition;
+        if ( meshlet.coneCutoff * length( view ) + radius <= view * meshlet.coneAxis )
+        {
+            continue;
+        }
+
+        bool inside = true;
+        for ( size_t j = 0; inside && j < planes.size(); ++j )
+        {
+            inside = ( -radius <= planes[j][0] * center[0] + planes[j][1] * center[1] + planes[j][2] * center[2] + planes[j][3] );
+        }
+        if ( inside )
+        {
+            visible.push_back( checked_cast<unsigned int>( i ) );
+        }
+    }
+    return( checked_cast<unsigned int>( visible.size() ) );
+}
+
+// ===========================================================================
+
+void getMeshletIndices( const MeshletSet &meshlets, const std::vector<unsigned int> &visible, std::vector<unsigned int> &indices )
+{
+    for ( size_t i = 0; i < visible.size(); ++i )
+    {
+        const Meshlet &meshlet = meshlets.meshlets[visible[i]];
+        const unsigned int *vertices = &meshlets.vertexIndices[meshlet.vertexOffset];
+        const unsigned char *local = &meshlets.localIndices[3 * meshlet.triangleOffset];
+        for ( unsigned int j = 0; j < 3 * meshlet.triangleCount; ++j )
+        {
+            indices.push_back( vertices[local[j]] );
+        }
+    }
+}
+
+} // namespace nvutil
@@ -0,0 +1,123 @@
+#include "ParametricKernel.h"
+
+#include <math.h>
+
+#if defined(_M_X64) || ( defined(_M_IX86_FP) && ( _M_IX86_FP >= 1 ) ) || defined(__SSE__)
+#define NVUTIL_RING_KERNEL_SSE
+#include <xmmintrin.h>
+#endif
+
+#include "nvutil/DbgNew.h" // this must be the last include
+
+using namespace nvmath;
+
+namespace nvutil
+{
+namespace
+{
+// The SSE path stores whole Vec3f/Vec2f rows as packed floats
+typedef char Vec3fIsPacked[ ( sizeof(Vec3f) == 3 * sizeof(float) ) ? 1 : -1 ];
+typedef char Vec2fIsPacked[ ( sizeof(Vec2f) == 2 * sizeof(float) ) ? 1 : -1 ];
+}
+
+void computeRingTable( unsigned int count, float start, float step, float paramScale, RingTable &table )
+{
+    table.cosines.resize( count );
+    table.sines.resize( count );
+    table.params.resize( count );
+
+    for ( unsigned int i = 0; i < count; ++i )
+    {
+        float angle = start + (float) i * step;
+        table.cosines[i] = cosf( angle );
+        table.sines[i]   = sinf( angle );
+        table.params[i]  = angle * paramScale;
+    }
+}
+
+void evaluateRingRow( const RingTable &ring, float a, float b, float c, float d, float e, Vec3f *out )
+{
+    const unsigned int count = (unsigned int) ring.cosines.size();
+    const float *cosines = count ? &ring.cosines[0] : 0;
+    const float *sines   = count ? &ring.sines[0] : 0;
+    float *dst = reinterpret_cast<float *>( out );
+
+    unsigned int i = 0;
+#if defined(NVUTIL_RING_KERNEL_SSE)
+    const __m128 va = _mm_set1_ps( a );
+    const __m128 vb = _mm_set1_ps( b );
+    const __m128 vc = _mm_set1_ps( c );
+    const __m128 vd = _mm_set1_ps( d );
+    const __m128 ve = _mm_set1_ps( e );
+
+    // Four ring entries per iteration, written as three packed xyz|xyz|xyz|xyz registers
+    for ( ; i + 4 <= count; i += 4 )
+    {
+        __m128 cs = _mm_loadu_ps( cosines + i );
+        __m128 sn = _mm_loadu_ps( sines + i );
+
+        __m128 x = _mm_add_ps( _mm_mul_ps( cs, va ), _mm_mul_ps( sn, vb ) );
+        __m128 z = _mm_add_ps( _mm_mul_ps( cs, vd ), _mm_mul_ps( sn, ve ) );
+
+        __m128 xyLo = _mm_unpacklo_ps( x, vc );                                 // x0 y  x1 y
+        __m128 xyHi = _mm_unpackhi_ps( x, vc );                                 // x2 y  x3 y
+
+        __m128 zx   = _mm_shuffle_ps( z, xyLo, _MM_SHUFFLE( 2, 2, 0, 0 ) );    // z0 z0 x1 x1
+        __m128 out0 = _mm_shuffle_ps( xyLo, zx, _MM_SHUFFLE( 2, 0, 1, 0 ) );   // x0 y  z0 x1
+
+        __m128 yz   = _mm_shuffle_ps( xyLo, z, _MM_SHUFFLE( 1, 1, 3, 3 ) );    // y  y  z1 z1
+        __m128 out1 = _mm_shuffle_ps( yz, xyHi, _MM_SHUFFLE( 1, 0, 2, 0 ) );   // y  z1 x2 y
+
+        __m128 zx2  = _mm_shuffle_ps( z, xyHi, _MM_SHUFFLE( 2, 2, 2, 2 ) );    // z2 z2 x3 x3
+        __m128 yz3  = _mm_shuffle_ps( xyHi, z, _MM_SHUFFLE( 3, 3, 3, 3 ) );    // y  y  z3 z3
+        __m128 out2 = _mm_shuffle_ps( zx2, yz3, _MM_SHUFFLE( 2, 0, 2, 0 ) );   // z2 x3 y  z3
+
+        _mm_storeu_ps( dst + 3 * i    , out0 );
+        _mm_storeu_ps( dst + 3 * i + 4, out1 );
+        _mm_storeu_ps( dst + 3 * i + 8, out2 );
+    }
+#endif
+
+    // Scalar fallback and remainder
+    for ( ; i < count; ++i )
+    {
+        dst[3 * i    ] = a * cosines[i] + b * sines[i];
+        dst[3 * i + 1] = c;
+        dst[3 * i + 2] = d * cosines[i] + e * sines[i];
+    }
+}
+
+void evaluateRingTexCoords( const RingTable &ring, float v, Vec2f *out )
+{
+    const unsigned int count = (unsigned int) ring.params.size();
+    const float *params = count ? &ring.params[0] : 0;
+    float *dst = reinterpret_cast<float *>( out );
+
+    unsigned int i = 0;
+#if defined(NVUTIL_RING_KERNEL_SSE)
+    const __m128 vv = _mm_set1_ps( v );
+    for ( ; i + 4 <= count; i += 4 )
+    {
+        __m128 u = _mm_loadu_ps( params + i );
+        _mm_storeu_ps( dst + 2 * i    , _mm_unpacklo_ps( u, vv ) );   // u0 v u1 v
+        _mm_storeu_ps( dst + 2 * i + 4, _mm_unpackhi_ps( u, vv ) );   // u2 v u3 v
+    }
+#endif
+
+    for ( ; i < count; ++i )
+    {
+        dst[2 * i    ] = params[i];
+        dst[2 * i + 1] = v;
+    }
+}
+
+bool isRingKernelVectorized()
+{
+#if defined(NVUTIL_RING_KERNEL_SSE)
+    return true;
+#else
+    return false;
+#endif
+}
+
+} // namespace nvutil
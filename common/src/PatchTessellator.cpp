@@ -0,0 +1,557 @@
+#include "PatchTessellator.h"
+#include "BufferArray.h"
+#include "MeshGenerator.h"
+
+#include <nvsg/Buffer.h>
+#include <nvsg/Primitive.h>
+#include <nvsg/QuadPatches4x4.h>
+#include <nvsg/TriPatches4.h>
+#include <nvsg/VertexAttributeSet.h>
+#include <nvutil/Tools.h>
+
+#include <QtCore/QtConcurrentMap>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include <float.h>
+#include <math.h>
+
+#if defined(_M_X64) || ( defined(_M_IX86_FP) && ( _M_IX86_FP >= 1 ) ) || defined(__SSE__)
+#define NVUTIL_PATCH_SSE
+#include <xmmintrin.h>
+#endif
+
+#include "nvutil/DbgNew.h" // this must be the last include
+
+using namespace nvmath;
+using namespace nvsg;
+using namespace std;
+
+namespace nvutil
+{
+namespace
+{
+//! The sampling of one patch at a given level, shared by all patches with that level.
+// The basis values are stored per control point, each with paddedCount samples, so four samples are evaluated at once.
+struct PatchBasis
+{
+    unsigned int                sampleCount;
+    unsigned int                paddedCount;    // sampleCount rounded up to a multiple of 4
+    std::vector<float>          weights;        // controlPoints x paddedCount
+    std::vector<float>          du;             // derivative of the weights in u
+    std::vector<float>          dv;             // derivative of the weights in v
+    std::vector<unsigned int>   triangles;      // relative to the first sample of the patch
+};
+
+typedef std::map<unsigned int, PatchBasis> PatchBasisMap;
+
+//! A range of patches evaluated by one thread
+struct PatchJob
+{
+    const Vec3f        *controlPoints;      // of all patches
+    unsigned int        controlPointCount;  // per patch, 10 or 16
+    const PatchBasis  **bases;              // per patch
+    const unsigned int *vertexOffsets;      // per patch
+    const unsigned int *indexOffsets;       // per patch
+    unsigned int        begin;
+    unsigned int        end;
+    VertexStream<Vec3f> *vertices;
+    VertexStream<Vec3f> *normals;
+    MeshIndices        *indices;
+    Vec3f               lower;              // bounding box of the vertices of the job
+    Vec3f               upper;
+};
+
+//! Helper function to get the \a n-th power of \a x, with 0^0 == 1
+float power( float x, unsigned int n )
+{
+    float p = 1.0f;
+    for ( unsigned int i = 0; i < n; ++i )
+    {
+        p *= x;
+    }
+    return( p );
+}
+
+//! Helper function to get the cubic Bernstein polynomial \a i and its derivative at \a t
+void bernstein( unsigned int i, float t, float &b, float &db )
+{
+    static const float binomial[4] = { 1.0f, 3.0f, 3.0f, 1.0f };
+    float s = 1.0f - t;
+    b = binomial[i] * power( t, i ) * power( s, 3 - i );
+    db = binomial[i] * ( ( i ? i * power( t, i - 1 ) * power( s, 3 - i ) : 0.0f )
+                       - ( ( i < 3 ) ? ( 3 - i ) * power( t, i ) * power( s, 2 - i ) : 0.0f ) );
+}
+
+//! Helper function to allocate the per control point arrays of \a basis
+void resizeBasis( PatchBasis &basis, unsigned int controlPointCount, unsigned int sampleCount )
+{
+    basis.sampleCount = sampleCount;
+    basis.paddedCount = ( sampleCount + 3 ) & ~3u;
+    basis.weights.assign( controlPointCount * basis.paddedCount, 0.0f );
+    basis.du.assign( controlPointCount * basis.paddedCount, 0.0f );
+    basis.dv.assign( controlPointCount * basis.paddedCount, 0.0f );
+}
+
+//! Helper function to sample a bicubic patch on a grid of ( level + 1 ) x ( level + 1 ) points, u running fastest
+void setupQuadBasis( unsigned int level, PatchBasis &basis )
+{
+    const unsigned int row = level + 1;
+    resizeBasis( basis, 16, row * row );
+
+    for ( unsigned int b = 0; b <= level; ++b )
+    {
+        float v = (float) b / (float) level;
+        for ( unsigned int a = 0; a <= level; ++a )
+        {
+            float u = (float) a / (float) level;
+            unsigned int s = b * row + a;
+            for ( unsigned int j = 0; j < 4; ++j )
+            {
+                float bv, dbv;
+                bernstein( j, v, bv, dbv );
+                for ( unsigned int i = 0; i < 4; ++i )
+                {
+                    float bu, dbu;
+                    bernstein( i, u, bu, dbu );
+                    unsigned int c = ( j * 4 + i ) * basis.paddedCount + s;
+                    basis.weights[c] = bu * bv;
+                    basis.du[c] = dbu * bv;
+                    basis.dv[c] = bu * dbv;
+                }
+            }
+        }
+    }
+
+    basis.triangles.reserve( 6 * level * level );
+    for ( unsigned int b = 0; b < level; ++b )
+    {
+        for ( unsigned int a = 0; a < level; ++a )
+        {
+            unsigned int s = b * row + a;
+            basis.triangles.push_back( s );
+            basis.triangles.push_back( s + 1 );
+            basis.triangles.push_back( s + row + 1 );
+            basis.triangles.push_back( s + row + 1 );
+            basis.triangles.push_back( s + row );
+            basis.triangles.push_back( s );
+        }
+    }
+}
+
+//! Helper function to sample a cubic Bezier triangle on the ( level + 1 ) * ( level + 2 ) / 2 points of a triangular grid.
+// Control point i + rowStart[j] has the weight 6/(i!j!k!) u^i v^j w^k, with k = 3 - i - j and w = 1 - u - v.
+void setupTriBasis( unsigned int level, PatchBasis &basis )
+{
+    static const unsigned int rowStart[4] = { 0, 4, 7, 9 };
+    static const float factorial[4] = { 1.0f, 1.0f, 2.0f, 6.0f };
+
+    resizeBasis( basis, 10, ( level + 1 ) * ( level + 2 ) / 2 );
+
+    unsigned int s = 0;
+    for ( unsigned int b = 0; b <= level; ++b )
+    {
+        float v = (float) b / (float) level;
+        for ( unsigned int a = 0; a <= level - b; ++a, ++s )
+        {
+            float u = (float) a / (float) level;
+            float w = std::max( 0.0f, 1.0f - u - v );
+            for ( unsigned int j = 0; j < 4; ++j )
+            {
+                for ( unsigned int i = 0; i + j < 4; ++i )
+                {
+                    unsigned int k = 3 - i - j;
+                    float coefficient = 6.0f / ( factorial[i] * factorial[j] * factorial[k] );
+                    float pu = power( u, i );
+                    float pv = power( v, j );
+                    float pw = power( w, k );
+                    // d/du and d/dv of w^k are -k w^(k-1)
+                    float dw = k ? k * power( w, k - 1 ) : 0.0f;
+                    unsigned int c = ( rowStart[j] + i ) * basis.paddedCount + s;
+                    basis.weights[c] = coefficient * pu * pv * pw;
+                    basis.du[c] = coefficient * pv * ( ( i ? i * power( u, i - 1 ) : 0.0f ) * pw - pu * dw );
+                    basis.dv[c] = coefficient * pu * ( ( j ? j * power( v, j - 1 ) : 0.0f ) * pw - pv * dw );
+                }
+            }
+        }
+    }
+
+    basis.triangles.reserve( 3 * level * level );
+    unsigned int rowBegin = 0;
+    for ( unsigned int b = 0; b < level; ++b )
+    {
+        unsigned int nextRowBegin = rowBegin + level + 1 - b;
+        for ( unsigned int a = 0; a < level - b; ++a )
+        {
+            basis.triangles.push_back( rowBegin + a );
+            basis.triangles.push_back( rowBegin + a + 1 );
+            basis.triangles.push_back( nextRowBegin + a );
+            if ( a + 1 < level - b )
+            {
+                basis.triangles.push_back( rowBegin + a + 1 );
+                basis.triangles.push_back( nextRowBegin + a + 1 );
+                basis.triangles.push_back( nextRowBegin + a );
+            }
+        }
+        rowBegin = nextRowBegin;
+    }
+}
+
+//! Helper function to get the length of the second difference of \a p0, \a p1, \a p2
+float getSecondDifference( const Vec3f &p0, const Vec3f &p1, const Vec3f &p2 )
+{
+    return( length( p0 - 2.0f * p1 + p2 ) );
+}
+
+//! Helper function to get the level needed for a patch with the maximal second difference \a d of its control points.
+// The second derivative of a cubic is bounded by 6 d, so a segment of length 1/L deviates at most 6 d / ( 8 L^2 ).
+unsigned int getPatchLevel( float d, const PatchTessellationParameters &parameters )
+{
+    unsigned int maxLevel = std::min( 64u, std::max( 1u, parameters.maxLevel ) );
+    unsigned int minLevel = std::min( maxLevel, std::max( 1u, parameters.minLevel ) );
+    if ( parameters.tolerance <= 0.0f )
+    {
+        return( maxLevel );
+    }
+    float level = ceilf( sqrtf( 0.75f * d / parameters.tolerance ) );
+    return( ( level < (float) maxLevel ) ? std::max( minLevel, (unsigned int) level ) : maxLevel );
+}
+
+//! Helper function to get the level of the bicubic patch with control points \a p
+unsigned int getQuadPatchLevel( const Vec3f *p, const PatchTessellationParameters &parameters )
+{
+    float d = 0.0f;
+    for ( unsigned int j = 0; j < 4; ++j )
+    {
+        for ( unsigned int i = 0; i < 2; ++i )
+        {
+            d = std::max( d, getSecondDifference( p[j*4+i], p[j*4+i+1], p[j*4+i+2] ) );
+            d = std::max( d, getSecondDifference( p[i*4+j], p[(i+1)*4+j], p[(i+2)*4+j] ) );
+        }
+    }
+    return( getPatchLevel( d, parameters ) );
+}
+
+//! Helper function to get the level of the Bezier triangle with control points \a p, looking along all three edge directions
+unsigned int getTriPatchLevel( const Vec3f *p, const PatchTessellationParameters &parameters )
+{
+    static const unsigned int rowStart[4] = { 0, 4, 7, 9 };
+
+    float d = 0.0f;
+    for ( unsigned int j = 0; j < 2; ++j )
+    {
+        for ( unsigned int i = 0; i + j < 2; ++i )
+        {
+            d = std::max( d, getSecondDifference( p[rowStart[j]+i], p[rowStart[j]+i+1], p[rowStart[j]+i+2] ) );
+            d = std::max( d, getSecondDifference( p[rowStart[i]+j], p[rowStart[i+1]+j], p[rowStart[i+2]+j] ) );
+            d = std::max( d, getSecondDifference( p[rowStart[j]+i+2], p[rowStart[j+1]+i+1], p[rowStart[j+2]+i] ) );
+        }
+    }
+    return( getPatchLevel( d, parameters ) );
+}
+
+//! Helper function to accumulate position, du and dv of the samples of one patch into \a scratch, nine rows of paddedCount floats
+void evaluatePatch( const PatchBasis &basis, const Vec3f *p, unsigned int controlPointCount, float *scratch )
+{
+    const unsigned int count = basis.paddedCount;
+    std::fill( scratch, scratch + 9 * count, 0.0f );
+
+    for ( unsigned int c = 0; c < controlPointCount; ++c )
+    {
+        const float *weights = &basis.weights[c * count];
+        const float *du = &basis.du[c * count];
+        const float *dv = &basis.dv[c * count];
+#if defined(NVUTIL_PATCH_SSE)
+        const __m128 px = _mm_set1_ps( p[c][0] );
+        const __m128 py = _mm_set1_ps( p[c][1] );
+        const __m128 pz = _mm_set1_ps( p[c][2] );
+        for ( unsigned int s = 0; s < count; s += 4 )
+        {
+            __m128 w = _mm_loadu_ps( weights + s );
+            __m128 u = _mm_loadu_ps( du + s );
+            __m128 v = _mm_loadu_ps( dv + s );
+            float *dst = scratch + s;
+            _mm_storeu_ps( dst + 0 * count, _mm_add_ps( _mm_loadu_ps( dst + 0 * count ), _mm_mul_ps( w, px ) ) );
+            _mm_storeu_ps( dst + 1 * count, _mm_add_ps( _mm_loadu_ps( dst + 1 * count ), _mm_mul_ps( w, py ) ) );
+            _mm_storeu_ps( dst + 2 * count, _mm_add_ps( _mm_loadu_ps( dst + 2 * count ), _mm_mul_ps( w, pz ) ) );
+            _mm_storeu_ps( dst + 3 * count, _mm_add_ps( _mm_loadu_ps( dst + 3 * count ), _mm_mul_ps( u, px ) ) );
+            _mm_storeu_ps( dst + 4 * count, _mm_add_ps( _mm_loadu_ps( dst + 4 * count ), _mm_mul_ps( u, py ) ) );
+            _mm_storeu_ps( dst + 5 * count, _mm_add_ps( _mm_loadu_ps( dst + 5 * count ), _mm_mul_ps( u, pz ) ) );
+            _mm_storeu_ps( dst + 6 * count, _mm_add_ps( _mm_loadu_ps( dst + 6 * count ), _mm_mul_ps( v, px ) ) );
+            _mm_storeu_ps( dst + 7 * count, _mm_add_ps( _mm_loadu_ps( dst + 7 * count ), _mm_mul_ps( v, py ) ) );
+            _mm_storeu_ps( dst + 8 * count, _mm_add_ps( _mm_loadu_ps( dst + 8 * count ), _mm_mul_ps( v, pz ) ) );
+        }
+#else
+        for ( unsigned int s = 0; s < count; ++s )
+        {
+            for ( unsigned int k = 0; k < 3; ++k )
+            {
+                scratch[k * count + s]       += weights[s] * p[c][k];
+                scratch[( 3 + k ) * count + s] += du[s] * p[c][k];
+                scratch[( 6 + k ) * count + s] += dv[s] * p[c][k];
+            }
+        }
+#endif
+    }
+}
+
+//! Helper function to evaluate the patches of \a job into the output buffers. Called from the worker threads.
+// Packed float streams are written in place, other layouts are encoded from a float row of the patch.
+void evaluatePatchJob( PatchJob &job )
+{
+    std::vector<float> scratch;
+    std::vector<Vec3f> vertexRow;
+    std::vector<Vec3f> normalRow;
+    job.lower = Vec3f( FLT_MAX, FLT_MAX, FLT_MAX );
+    job.upper = Vec3f( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+    for ( unsigned int patch = job.begin; patch < job.end; ++patch )
+    {
+        const PatchBasis &basis = *job.bases[patch];
+        const unsigned int count = basis.paddedCount;
+        scratch.resize( 9 * count );
+        evaluatePatch( basis, job.controlPoints + patch * job.controlPointCount, job.controlPointCount, &scratch[0] );
+
+        const unsigned int vertexOffset = job.vertexOffsets[patch];
+        Vec3f *vertices = job.vertices->getPackedValues( vertexOffset );
+        const bool encodeVertices = !vertices;
+        if ( encodeVertices )
+        {
+            vertexRow.resize( basis.sampleCount );
+            vertices = &vertexRow[0];
+        }
+        Vec3f *normals = job.normals->getPackedValues( vertexOffset );
+        const bool encodeNormals = !normals;
+        if ( encodeNormals )
+        {
+            normalRow.resize( basis.sampleCount );
+            normals = &normalRow[0];
+        }
+
+        const float *s = &scratch[0];
+        for ( unsigned int i = 0; i < basis.sampleCount; ++i )
+        {
+            vertices[i] = Vec3f( s[i], s[count + i], s[2 * count + i] );
+            for ( unsigned int k = 0; k < 3; ++k )
+            {
+                job.lower[k] = std::min( job.lower[k], vertices[i][k] );
+                job.upper[k] = std::max( job.upper[k], vertices[i][k] );
+            }
+            Vec3f du( s[3 * count + i], s[4 * count + i], s[5 * count + i] );
+            Vec3f dv( s[6 * count + i], s[7 * count + i], s[8 * count + i] );
+            normals[i] = du ^ dv;
+            // degenerated corners (collapsed edges) keep a zero normal instead of NaNs
+            if ( FLT_EPSILON < length( normals[i] ) )
+            {
+                normals[i].normalize();
+            }
+        }
+        if ( encodeVertices )
+        {
+            job.vertices->writeRow( vertexOffset, vertices, basis.sampleCount );
+        }
+        if ( encodeNormals )
+        {
+            job.normals->writeRow( vertexOffset, normals, basis.sampleCount );
+        }
+
+        const unsigned int indexOffset = job.indexOffsets[patch];
+        for ( unsigned int i = 0; i < basis.triangles.size(); ++i )
+        {
+            job.indices->set( indexOffset + i, vertexOffset + basis.triangles[i] );
+        }
+    }
+}
+
+//! Helper function to tessellate all patches in \a controlPoints, \a controlPointCount per patch
+PrimitiveSharedPtr tessellatePatches( const std::vector<Vec3f> &controlPoints, unsigned int controlPointCount
+                                    , const PatchTessellationParameters &parameters )
+{
+    const unsigned int patchCount = checked_cast<unsigned int>( controlPoints.size() / controlPointCount );
+    if ( patchCount == 0 )
+    {
+        return( PrimitiveSharedPtr() );
+    }
+
+    // Choose the level of each patch and set up the basis of each level used
+    PatchBasisMap basisMap;
+    std::vector<const PatchBasis *> bases( patchCount );
+    std::vector<unsigned int> vertexOffsets( patchCount );
+    std::vector<unsigned int> indexOffsets( patchCount );
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    for ( unsigned int patch = 0; patch < patchCount; ++patch )
+    {
+        const Vec3f *p = &controlPoints[patch * controlPointCount];
+        unsigned int level = ( controlPointCount == 16 ) ? getQuadPatchLevel( p, parameters ) : getTriPatchLevel( p, parameters );
+
+        PatchBasisMap::iterator it = basisMap.find( level );
+        if ( it == basisMap.end() )
+        {
+            it = basisMap.insert( std::make_pair( level, PatchBasis() ) ).first;
+            if ( controlPointCount == 16 )
+            {
+                setupQuadBasis( level, it->second );
+            }
+            else
+            {
+                setupTriBasis( level, it->second );
+            }
+        }
+
+        bases[patch] = &it->second;
+        vertexOffsets[patch] = checked_cast<unsigned int>( vertexCount );
+        indexOffsets[patch] = checked_cast<unsigned int>( indexCount );
+        vertexCount += it->second.sampleCount;
+        indexCount += it->second.triangles.size();
+    }
+
+    // Write the vertices and indices in the requested layout right away
+    const unsigned int format = getMeshFormat();
+    MeshVertices mesh( format, checked_cast<unsigned int>( vertexCount ) );
+    VertexStream<Vec3f> vertices( mesh, VertexAttributeSet::NVSG_POSITION );
+    VertexStream<Vec3f> normals( mesh, VertexAttributeSet::NVSG_NORMAL );
+    MeshIndices indices( format, checked_cast<unsigned int>( vertexCount ), checked_cast<unsigned int>( indexCount ) );
+
+    // The first access allocates the buffers, do it here instead of in the worker threads
+    vertices.getPackedValues( 0 );
+
+    // Cut the patches into ranges of about the same number of vertices
+    const unsigned int verticesPerJob = 16384;
+    std::vector<PatchJob> jobs;
+    PatchJob job;
+    job.controlPoints = &controlPoints[0];
+    job.controlPointCount = controlPointCount;
+    job.bases = &bases[0];
+    job.vertexOffsets = &vertexOffsets[0];
+    job.indexOffsets = &indexOffsets[0];
+    job.vertices = &vertices;
+    job.normals = &normals;
+    job.indices = &indices;
+    job.begin = 0;
+    for ( unsigned int patch = 1; patch <= patchCount; ++patch )
+    {
+        size_t end = ( patch < patchCount ) ? vertexOffsets[patch] : vertexCount;
+        if ( ( patch == patchCount ) || ( verticesPerJob <= end - vertexOffsets[job.begin] ) )
+        {
+            job.end = patch;
+            jobs.push_back( job );
+            job.begin = patch;
+        }
+    }
+
+    if ( parameters.multithreaded && ( 1 < jobs.size() ) )
+    {
+        QtConcurrent::blockingMap( jobs, &evaluatePatchJob );
+    }
+    else
+    {
+        for ( size_t i = 0; i < jobs.size(); ++i )
+        {
+            evaluatePatchJob( jobs[i] );
+        }
+    }
+
+    Vec3f lower( jobs[0].lower );
+    Vec3f upper( jobs[0].upper );
+    for ( size_t i = 1; i < jobs.size(); ++i )
+    {
+        for ( unsigned int k = 0; k < 3; ++k )
+        {
+            lower[k] = std::min( lower[k], jobs[i].lower[k] );
+            upper[k] = std::max( upper[k], jobs[i].upper[k] );
+        }
+    }
+
+    PrimitiveSharedPtr primitivePtr = Primitive::create();
+    {
+        PrimitiveWriteLock primitive( primitivePtr );
+        primitive->setPrimitiveType( PRIMITIVE_TRIANGLES );
+        primitive->setVertexAttributeSet( mesh.createVertexAttributeSet() );
+        primitive->setIndexSet( indices.createIndexSet( false ) );
+    }
+    setGeneratedBounds( primitivePtr, Box3f( lower, upper ) );
+    return( primitivePtr );
+}
+
+//! Helper function to get the control points of the non-indexed patches \a patches
+bool getControlPoints( const PrimitiveSharedPtr &patches, std::vector<Vec3f> &controlPoints )
+{
+    PrimitiveReadLock primitive( patches );
+    if ( primitive->getIndexSet() || !primitive->getVertexAttributeSet() )
+    {
+        return( false );
+    }
+
+    VertexAttributeSetReadLock vas( primitive->getVertexAttributeSet() );
+    if (   ( vas->getTypeOfVertexData( VertexAttributeSet::NVSG_POSITION ) != NVSG_FLOAT )
+        || ( vas->getSizeOfVertexData( VertexAttributeSet::NVSG_POSITION ) != 3 ) )
+    {
+        return( false );
+    }
+
+    unsigned int count = vas->getNumberOfVertexData( VertexAttributeSet::NVSG_POSITION );
+    unsigned int stride = vas->getStrideOfVertexData( VertexAttributeSet::NVSG_POSITION );
+    Buffer::DataReadLock lock( vas->getVertexBuffer( VertexAttributeSet::NVSG_POSITION ) );
+    const char *data = lock.getPtr<char>() + vas->getOffsetOfVertexData( VertexAttributeSet::NVSG_POSITION );
+
+    controlPoints.resize( count );
+    for ( unsigned int i = 0; i < count; ++i )
+    {
+        controlPoints[i] = *reinterpret_cast<const Vec3f *>( data + i * stride );
+    }
+    return( true );
+}
+} // namespace
+
+PatchTessellationParameters::PatchTessellationParameters()
+    : minLevel( 1 )
+    , maxLevel( 32 )
+    , tolerance( 0.01f )
+    , multithreaded( true )
+{
+}
+
+// ===========================================================================
+
+PrimitiveSharedPtr tessellateTriPatches4( const std::vector<Vec3f> &controlPoints, const PatchTessellationParameters &parameters )
+{
+    return( tessellatePatches( controlPoints, 10, parameters ) );
+}
+
+// ===========================================================================
+
+PrimitiveSharedPtr tessellateQuadPatches4x4( const std::vector<Vec3f> &controlPoints, const PatchTessellationParameters &parameters )
+{
+    return( tessellatePatches( controlPoints, 16, parameters ) );
+}
+
+// ===========================================================================
+
+PrimitiveSharedPtr tessellateTriPatches4( const TriPatches4SharedPtr &triPatches, const PatchTessellationParameters &parameters )
+{
+    std::vector<Vec3f> controlPoints;
+    return( getControlPoints( triPatches, controlPoints ) ? tessellatePatches( controlPoints, 10, parameters ) : PrimitiveSharedPtr() );
+}
+
+// ===========================================================================
+
+PrimitiveSharedPtr tessellateQuadPatches4x4( const QuadPatches4x4SharedPtr &quadPatches, const PatchTessellationParameters &parameters )
+{
+    std::vector<Vec3f> controlPoints;
+    return( getControlPoints( quadPatches, controlPoints ) ? tessellatePatches( controlPoints, 16, parameters ) : PrimitiveSharedPtr() );
+}
+
+// ===========================================================================
+
+bool isPatchTessellatorVectorized()
+{
+#if defined(NVUTIL_PATCH_SSE)
+    return( true );
+#else
+    return( false );
+#endif
+}
+
+} // namespace nvutil
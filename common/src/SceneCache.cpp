@@ -0,0 +1,326 @@
+#include "SceneCache.h"
+#include "SceneFunctions.h"
+
+#include <nvsg/PlugInterface.h>
+#include <nvsg/PlugInterfaceID.h>
+#include <nvsg/ViewState.h>
+#include <nvtraverser/CombineTraverser.h>
+#include <nvtraverser/EliminateTraverser.h>
+#include <nvtraverser/UnifyTraverser.h>
+#include <nvutil/Timer.h>
+#include <nvutil/Tools.h>
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutex>
+
+#include <set>
+#include <sstream>
+
+#include <ctype.h>
+#include <float.h>
+#include <string.h>
+
+#include "nvutil/DbgNew.h" // this must be the last include
+
+using namespace nvsg;
+using namespace nvtraverser;
+using namespace std;
+
+namespace nvutil
+{
+namespace
+{
+//! Bump this whenever the content of the cache files changes, old files are ignored then
+const unsigned int sceneCacheVersion = 1;
+
+SceneCacheParameters sceneCacheParameters;
+SceneCacheStatistics sceneCacheStatistics;
+QMutex sceneCacheMutex;
+
+//! Helper function to convert \a path to a std::string in the native format
+std::string toNativePath( const QString &path )
+{
+    return( std::string( QDir::toNativeSeparators( path ).toLocal8Bit().constData() ) );
+}
+
+//! Helper function to check if \a c ends a file name inside a scene file, e.g. a blank, a quote or a path separator
+bool isFileNameDelimiter( char c )
+{
+    return( ( (unsigned char)c <= ' ' ) || ( strchr( "\"'/\\<>=,;()", c ) != 0 ) );
+}
+
+/*! Helper function to add the words of \a data that are one of \a names to \a found. \a word holds the start of the
+    last word of the previous part of the file and gets the end of this part. Names are compared in lower case. */
+void findFileNames( const QByteArray &data, QByteArray &word, const std::set<QByteArray> &names, std::set<QByteArray> &found )
+{
+    for ( int i = 0; i < data.size(); ++i )
+    {
+        if ( isFileNameDelimiter( data[i] ) )
+        {
+            if ( !word.isEmpty() && ( names.find( word ) != names.end() ) )
+            {
+                found.insert( word );
+            }
+            word.clear();
+        }
+        else if ( word.size() < 256 )
+        {
+            word.append( (char)tolower( (unsigned char)data[i] ) );
+        }
+    }
+}
+
+//! Helper function to add the name, size and modification time of \a fileInfo to \a hash
+void addFileStamp( QCryptographicHash &hash, const QFileInfo &fileInfo )
+{
+    std::ostringstream stamp;
+    stamp << " " << fileInfo.fileName().toLocal8Bit().constData() << " " << fileInfo.size() << " " << fileInfo.lastModified().toTime_t();
+    hash.addData( stamp.str().c_str(), checked_cast<int>( stamp.str().size() ) );
+}
+
+//! Helper function to add the stamps of the plug-ins next to the executable to \a hash, so an updated loader misses
+void addPlugInStamps( QCryptographicHash &hash )
+{
+    std::string modulePath, dir;
+    GetModulePath( modulePath );
+    GetDirFromPath( modulePath, dir );
+
+    std::set<QString> directories;
+    directories.insert( QFileInfo( QString::fromLocal8Bit( modulePath.c_str() ) ).absoluteFilePath() );
+    directories.insert( QFileInfo( QString::fromLocal8Bit( dir.c_str() ) ).absoluteFilePath() );
+    for ( std::set<QString>::const_iterator it = directories.begin(); it != directories.end(); ++it )
+    {
+        QFileInfoList plugIns = QDir( *it ).entryInfoList( QStringList( "*.nxm" ), QDir::Files, QDir::Name );
+        for ( int i = 0; i < plugIns.size(); ++i )
+        {
+            addFileStamp( hash, plugIns[i] );
+        }
+    }
+}
+}
+
+SceneCacheParameters::SceneCacheParameters()
+    : optimize( false )
+    , ignoreNames( true )
+    , identityToGroup( true )
+    , combineFlags( CombineTraverser::CT_ALL_TARGETS_MASK )
+    , eliminateFlags( EliminateTraverser::ET_ALL_TARGETS_MASK )
+    , unifyFlags( UnifyTraverser::UT_ALL_TARGETS_MASK )
+    , epsilon( FLT_EPSILON )
+{
+}
+
+SceneCacheStatistics::SceneCacheStatistics()
+    : hits( 0 )
+    , misses( 0 )
+    , stores( 0 )
+    , failures( 0 )
+    , hashSeconds( 0.0 )
+    , loadSeconds( 0.0 )
+    , storeSeconds( 0.0 )
+{
+}
+
+// ===========================================================================
+
+void setSceneCacheParameters( const SceneCacheParameters &parameters )
+{
+    QMutexLocker lock( &sceneCacheMutex );
+    sceneCacheParameters = parameters;
+}
+
+SceneCacheParameters getSceneCacheParameters()
+{
+    QMutexLocker lock( &sceneCacheMutex );
+    return( sceneCacheParameters );
+}
+
+// ===========================================================================
+
+std::string getSceneCacheFile( const std::string &filename, const SceneCacheParameters &parameters )
+{
+    // an NBF file loads as fast as its cache file, and the optimizer would strip the named empty Groups some NBF
+    // files carry, like the placeholders of a paged skeleton
+    if ( parameters.directory.empty() || ( QFileInfo( QString::fromLocal8Bit( filename.c_str() ) ).suffix().toLower() == "nbf" ) )
+    {
+        return( std::string() );
+    }
+
+    QFile file( QString::fromLocal8Bit( filename.c_str() ) );
+    if ( !file.open( QIODevice::ReadOnly ) )
+    {
+        return( std::string() );
+    }
+
+    Timer timer;
+    timer.start();
+
+    // the files next to the source are its dependencies if they have its base name, like the .mtl of an .obj,
+    // or the source names them, like the textures or the mtllib of an .obj
+    QFileInfo sourceInfo( file );
+    QFileInfoList siblings = sourceInfo.dir().entryInfoList( QDir::Files, QDir::Name );
+    const bool cacheBeside = ( QDir( QString::fromLocal8Bit( parameters.directory.c_str() ) ).absolutePath() == sourceInfo.absolutePath() );
+    std::set<QByteArray> siblingNames;
+    for ( int i = 0; i < siblings.size(); ++i )
+    {
+        siblingNames.insert( siblings[i].fileName().toLower().toLocal8Bit() );
+    }
+
+    QCryptographicHash hash( QCryptographicHash::Sha1 );
+    std::set<QByteArray> referenced;
+    QByteArray word;
+    while ( !file.atEnd() )
+    {
+        QByteArray data = file.read( 1024 * 1024 );
+        hash.addData( data );
+        findFileNames( data, word, siblingNames, referenced );
+    }
+    findFileNames( QByteArray( 1, ' ' ), word, siblingNames, referenced );
+
+    for ( int i = 0; i < siblings.size(); ++i )
+    {
+        if (   ( siblings[i].absoluteFilePath() != sourceInfo.absoluteFilePath() )
+            && !( cacheBeside && ( siblings[i].suffix().toLower() == "nbf" ) )
+            && (   ( siblings[i].completeBaseName() == sourceInfo.completeBaseName() )
+                || ( referenced.find( siblings[i].fileName().toLower().toLocal8Bit() ) != referenced.end() ) ) )
+        {
+            addFileStamp( hash, siblings[i] );
+        }
+    }
+    addPlugInStamps( hash );
+
+    // the same content can be a different scene for another loader or other optimizer settings
+    std::ostringstream settings;
+    settings << sceneCacheVersion << " " << sourceInfo.suffix().toLower().toLocal8Bit().constData();
+    if ( parameters.optimize )
+    {
+        settings << " " << parameters.ignoreNames << " " << parameters.identityToGroup << " " << parameters.combineFlags
+                 << " " << parameters.eliminateFlags << " " << parameters.unifyFlags << " " << parameters.epsilon;
+    }
+    hash.addData( settings.str().c_str(), checked_cast<int>( settings.str().size() ) );
+
+    QString name = QString::fromLatin1( hash.result().toHex() ) + ".nbf";
+    std::string cacheFile = toNativePath( QDir( QString::fromLocal8Bit( parameters.directory.c_str() ) ).filePath( name ) );
+
+    QMutexLocker lock( &sceneCacheMutex );
+    sceneCacheStatistics.hashSeconds += timer.getTime();
+    return( cacheFile );
+}
+
+// ===========================================================================
+
+nvsg::ViewStateSharedPtr loadCachedScene( const std::string &cacheFile, const std::vector<std::string> &searchPaths )
+{
+    ViewStateSharedPtr viewState;
+    if ( cacheFile.empty() )
+    {
+        return( viewState );
+    }
+    if ( !QFileInfo( QString::fromLocal8Bit( cacheFile.c_str() ) ).isFile() )
+    {
+        QMutexLocker lock( &sceneCacheMutex );
+        ++sceneCacheStatistics.misses;
+        return( viewState );
+    }
+
+    Timer timer;
+    timer.start();
+    PlugInLock loader( cacheFile, UPITID_SCENE_LOADER, searchPaths );
+    if ( loader.get() )
+    {
+        try
+        {
+            SceneSharedPtr scene = reinterpret_cast<nvsg::SceneLoader *>( loader.get() )->load( cacheFile, searchPaths, viewState );
+            if ( scene )
+            {
+                if ( !viewState )
+                {
+                    viewState = ViewState::create();
+                }
+                ViewStateWriteLock( viewState )->setScene( scene );
+            }
+            else
+            {
+                viewState.reset();
+            }
+        }
+        catch(...) // a damaged cache file is just a miss
+        {
+            viewState.reset();
+        }
+    }
+
+    QMutexLocker lock( &sceneCacheMutex );
+    if ( viewState )
+    {
+        ++sceneCacheStatistics.hits;
+        sceneCacheStatistics.loadSeconds += timer.getTime();
+    }
+    else
+    {
+        ++sceneCacheStatistics.misses;
+        ++sceneCacheStatistics.failures;
+    }
+    return( viewState );
+}
+
+// ===========================================================================
+
+bool storeCachedScene( const std::string &cacheFile, const nvsg::ViewStateSharedPtr &viewState
+                     , const SceneCacheParameters &parameters )
+{
+    if ( cacheFile.empty() || !viewState )
+    {
+        return( false );
+    }
+
+    Timer timer;
+    timer.start();
+    if ( parameters.optimize )
+    {
+        optimizeScene( ViewStateReadLock( viewState )->getScene(), parameters.ignoreNames, parameters.identityToGroup
+                     , parameters.combineFlags, parameters.eliminateFlags, parameters.unifyFlags, parameters.epsilon );
+    }
+
+    // write to a temporary file with the same extension and rename it, another load might read or write the cache file meanwhile
+    QString target = QString::fromLocal8Bit( cacheFile.c_str() );
+    QFileInfo targetInfo( target );
+    QString temporary = targetInfo.dir().filePath( targetInfo.completeBaseName() + "."
+                                                 + QString::number( reinterpret_cast<quintptr>( viewState.get() ), 16 ) + ".nbf" );
+    bool stored = QDir().mkpath( targetInfo.absolutePath() ) && saveScene( toNativePath( temporary ), viewState );
+    if ( stored )
+    {
+        QFile::remove( target );
+        stored = QFile::rename( temporary, target );
+    }
+    if ( !stored )
+    {
+        QFile::remove( temporary );
+    }
+
+    QMutexLocker lock( &sceneCacheMutex );
+    sceneCacheStatistics.storeSeconds += timer.getTime();
+    if ( stored )
+    {
+        ++sceneCacheStatistics.stores;
+    }
+    else
+    {
+        ++sceneCacheStatistics.failures;
+    }
+    return( stored );
+}
+
+// ===========================================================================
+
+SceneCacheStatistics getSceneCacheStatistics()
+{
+    QMutexLocker lock( &sceneCacheMutex );
+    return( sceneCacheStatistics );
+}
+
+} // namespace nvutil
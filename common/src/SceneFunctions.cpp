@@ -10,11 +10,14 @@
 // BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES
 
 #include <SceneFunctions.h>
+#include <SceneCache.h>
+#include <MeshGenerator.h>
 
 #include <nvutil/PlugIn.h>
 #include <nvsg/PlugInterface.h>
 #include <nvsg/PlugInterfaceID.h>
 #include <nvutil/Tools.h>
+#include <nvutil/Timer.h>
 #include <nvsg/ErrorHandling.h>
 
 #include <nvui/RendererOptions.h>
@@ -39,6 +42,11 @@
 // picking
 #include <nvtraverser/RayIntersectTraverser.h>
 
+// asynchronous loading
+#include <QtCore/QFuture>
+#include <QtCore/QMutex>
+#include <QtCore/QtConcurrentRun>
+
 #include <nvutil/DbgNew.h>
 
 using namespace std;
@@ -52,16 +60,130 @@ using namespace nvtraverser;
 namespace nvutil
 {
 
-nvsg::ViewStateSharedPtr loadScene( const std::string & filename, const std::vector<std::string> &searchPaths, PlugInCallback *callback )
+namespace
 {
-    ViewStateSharedPtr viewState;
+// one entry of the plug-in registry, the interface found for an extension and interface type
+struct PlugInRegistryEntry
+{
+    SmartPtr<PlugIn>          reference;    // releases plugIn when the entry is probed again or erased
+    PlugIn                   *plugIn;
+    std::vector<std::string>  searchPaths;  // the additional search paths of all probes so far, used again by a rescan
+};
+
+typedef std::pair<std::string, unsigned int> PlugInRegistryKey;
+typedef std::map< PlugInRegistryKey, PlugInRegistryEntry > PlugInRegistry;
+
+// the process-wide plug-in registry, see PlugInLock
+QMutex                    plugInRegistryMutex;
+PlugInRegistry            plugInRegistry;
+std::map< PlugInRegistryKey, QMutex * > plugInMutexes;  // the lock per extension and type, never deleted, a PlugInLock may hold it
+std::vector<std::string>  plugInBaseSearchPaths;    // current directory and directory of the executable, empty until the first lookup
+PlugInRegistryStatistics  plugInRegistryStatistics;
+
+// collect the directories always searched for plug-ins, called with plugInRegistryMutex locked
+void setupPlugInBaseSearchPaths()
+{
+    string modulePath, dir;
+    plugInBaseSearchPaths.clear();
+
+    GetCurrentDir(dir);
+    plugInBaseSearchPaths.push_back(dir);
 
+    GetModulePath(modulePath);
+    if ( find( plugInBaseSearchPaths.begin(), plugInBaseSearchPaths.end(), modulePath ) == plugInBaseSearchPaths.end() )
+    {
+        plugInBaseSearchPaths.push_back(modulePath);
+    }
+    GetDirFromPath(modulePath, dir);
+    if ( !dir.empty() && find( plugInBaseSearchPaths.begin(), plugInBaseSearchPaths.end(), dir ) == plugInBaseSearchPaths.end() )
+    {
+        plugInBaseSearchPaths.push_back(dir);
+    }
+}
+
+// search the plug-in for ext and pitType through the file system, called with plugInRegistryMutex locked
+PlugIn * probePlugInInterface( const std::string & ext, unsigned int pitType, const std::vector<std::string> &searchPaths )
+{
+    vector<string> paths = searchPaths;
+    for ( size_t i = 0; i < plugInBaseSearchPaths.size(); ++i )
+    {
+        if ( find( paths.begin(), paths.end(), plugInBaseSearchPaths[i] ) == paths.end() )
+        {
+            paths.push_back( plugInBaseSearchPaths[i] );
+        }
+    }
+
+    Timer timer;
+    timer.start();
+    PlugIn * plug = 0;
+    if ( !getInterface( paths, UPIID( ext.c_str(), UPITID( pitType, UPITID_VERSION ) ), plug ) )
+    {
+        plug = 0;
+        ++plugInRegistryStatistics.failures;
+    }
+    plugInRegistryStatistics.probeSeconds += timer.getTime();
+    ++plugInRegistryStatistics.probes;
+    return( plug );
+}
+
+// search the plug-in of entry again in searchPaths, releasing the one it had, called with plugInRegistryMutex locked
+void probePlugInRegistryEntry( const PlugInRegistryKey &key, PlugInRegistryEntry &entry, const std::vector<std::string> &searchPaths )
+{
+    entry.plugIn = probePlugInInterface( key.first, key.second, searchPaths );
+    entry.reference = SmartPtr<PlugIn>( entry.plugIn );
+}
+
+// get the registry entry of key, probing it if it's new or a miss not searched in searchPaths yet, called with plugInRegistryMutex locked
+PlugInRegistryEntry & lookupPlugInRegistryEntry( const PlugInRegistryKey &key, const std::vector<std::string> &searchPaths )
+{
+    ++plugInRegistryStatistics.lookups;
+
+    PlugInRegistry::iterator it = plugInRegistry.find( key );
+    if ( it != plugInRegistry.end() )
+    {
+        if ( !it->second.plugIn )
+        {
+            // a miss is searched for again only in the paths it hasn't been searched in yet, or by a rescan
+            vector<string> newPaths;
+            for ( size_t i = 0; i < searchPaths.size(); ++i )
+            {
+                if (   ( find( it->second.searchPaths.begin(), it->second.searchPaths.end(), searchPaths[i] ) == it->second.searchPaths.end() )
+                    && ( find( newPaths.begin(), newPaths.end(), searchPaths[i] ) == newPaths.end() ) )
+                {
+                    newPaths.push_back( searchPaths[i] );
+                }
+            }
+            if ( !newPaths.empty() )
+            {
+                it->second.searchPaths.insert( it->second.searchPaths.end(), newPaths.begin(), newPaths.end() );
+                probePlugInRegistryEntry( it->first, it->second, newPaths );
+            }
+        }
+        return( it->second );
+    }
+
+    if ( plugInBaseSearchPaths.empty() )
+    {
+        setupPlugInBaseSearchPaths();
+    }
+
+    // remember misses as well, so an unknown extension isn't searched for in the same paths again
+    PlugInRegistryEntry &entry = plugInRegistry[key];
+    entry.searchPaths = searchPaths;
+    probePlugInRegistryEntry( key, entry, searchPaths );
+    plugInRegistryStatistics.entries = checked_cast<unsigned int>( plugInRegistry.size() );
+    return( entry );
+}
+
+// collect the search paths for the loader plug-in and the resources of the scene file
+void setupLoadSearchPaths( const std::string & filename, const std::vector<std::string> &searchPaths, std::vector<std::string> &localSearchPaths )
+{
     // appropriate search paths for the
     // loader dll and the sample file.
     string modulePath;
     string curDir;
     string dir;
-    vector<string> localSearchPaths = searchPaths;
+    localSearchPaths = searchPaths;
 
     nvutil::GetCurrentDir(curDir);
     localSearchPaths.push_back(curDir);
@@ -88,64 +210,245 @@ nvsg::ViewStateSharedPtr loadScene( const std::string & filename, const std::vec
         localSearchPaths.push_back(nvsgsdk + "media/effects");
         localSearchPaths.push_back(nvsgsdk + "media/textures");
     }
+}
 
-    // receive the unique scene loader plug interface ID from the file extension
-    string ext;
-    GetFileExtFromPath( filename, ext );
-    UPIID piid = nvutil::UPIID( ext.c_str(), nvutil::UPITID( UPITID_SCENE_LOADER, UPITID_VERSION ) );
+// load filename with the scene loader locked by loaderLock, a null pointer if the loader fails
+ViewStateSharedPtr loadWithSceneLoader( const PlugInLock &loaderLock, const std::string & filename
+                                      , const std::vector<std::string> &localSearchPaths, PlugInCallback *callback )
+{
+    nvsg::SceneLoader *loader = reinterpret_cast<nvsg::SceneLoader*>( loaderLock.get() );
+    ViewStateSharedPtr viewState;
+    loader->setCallback( callback );
+
+    SceneSharedPtr scene;
+    scene = loader->load( filename, localSearchPaths, viewState );
+    if ( !scene )
+    {
+        viewState.reset();
+    }
+    else
+    {
+        // create a new viewstate if necessary
+        if ( !viewState )
+        {
+            viewState = ViewState::create();
+        }
+        ViewStateWriteLock( viewState )->setScene( scene );
+    }
 
-    nvutil::PlugIn * plug;
-    if ( nvutil::getInterface(localSearchPaths, piid, plug) )
+    loader->setCallback( NULL );
+    return viewState;
+}
+
+// the fraction of a load done when entering a stage, the loaders don't report anything while reading the file
+float getSceneLoadProgress( SceneLoad::Stage stage )
+{
+    switch( stage )
     {
-        SmartPtr<nvsg::SceneLoader> loader( reinterpret_cast<nvsg::SceneLoader*>(plug) );
-        loader->setCallback( callback );
+    case SceneLoad::STAGE_QUEUED:
+        return( 0.0f );
+    case SceneLoad::STAGE_FINDING_LOADER:
+        return( 0.05f );
+    case SceneLoad::STAGE_LOADING:
+        return( 0.1f );
+    default:
+        return( 1.0f );
+    }
+}
+}
 
-        SceneSharedPtr scene;
-        scene = loader->load( filename, localSearchPaths, viewState );
-        if ( !scene )
+// the state shared by a SceneLoad and its worker thread
+struct SceneLoad::Data
+{
+    std::string               filename;
+    std::vector<std::string>  searchPaths;
+    SceneLoadCallback        *callback;
+
+    mutable QMutex            mutex;
+    Stage                     stage;
+    bool                      canceled;
+    ViewStateSharedPtr        viewState;
+    QFuture<void>             future;
+};
+
+namespace
+{
+// enter stage, or the canceled stage if the load was canceled before, and tell the callback
+// returns false if the load is over
+bool setSceneLoadStage( SceneLoad::Data *data, SceneLoad::Stage stage, const ViewStateSharedPtr &viewState = ViewStateSharedPtr() )
+{
+    {
+        QMutexLocker lock( &data->mutex );
+        if ( data->canceled )
         {
-            viewState.reset();
+            stage = SceneLoad::STAGE_CANCELED;
         }
-        else
+        else if ( stage == SceneLoad::STAGE_FINISHED )
         {
-            // create a new viewstate if necessary
-            if ( !viewState )
+            data->viewState = viewState;
+        }
+        data->stage = stage;
+    }
+
+    if ( data->callback )
+    {
+        data->callback->onSceneLoadProgress( stage, getSceneLoadProgress( stage ) );
+    }
+    return( ( stage != SceneLoad::STAGE_FINISHED ) && ( stage != SceneLoad::STAGE_FAILED ) && ( stage != SceneLoad::STAGE_CANCELED ) );
+}
+
+// the worker thread of loadSceneAsync
+void runSceneLoad( SceneLoad::Data *data )
+{
+    if ( !setSceneLoadStage( data, SceneLoad::STAGE_FINDING_LOADER ) )
+    {
+        return;
+    }
+
+    vector<string> localSearchPaths;
+    setupLoadSearchPaths( data->filename, data->searchPaths, localSearchPaths );
+
+    // a cached copy of the scene saves running the loader
+    SceneCacheParameters cacheParameters = getSceneCacheParameters();
+    string cacheFile = getSceneCacheFile( data->filename, cacheParameters );
+    ViewStateSharedPtr viewState = loadCachedScene( cacheFile, localSearchPaths );
+    if ( viewState )
+    {
+        setSceneLoadStage( data, SceneLoad::STAGE_FINISHED, viewState );
+        return;
+    }
+
+    try
+    {
+        {
+            // the loader is locked from here to the end of the load, other loads of the same extension wait
+            PlugInLock loader( data->filename, UPITID_SCENE_LOADER, localSearchPaths );
+            if ( !loader.get() )
+            {
+                setSceneLoadStage( data, SceneLoad::STAGE_FAILED );
+                return;
+            }
+
+            if ( !setSceneLoadStage( data, SceneLoad::STAGE_LOADING ) )
             {
-                viewState = ViewState::create();
+                return;
             }
-            ViewStateWriteLock( viewState )->setScene( scene );
+
+            viewState = loadWithSceneLoader( loader, data->filename, localSearchPaths, data->callback );
         }
+        if ( viewState )
+        {
+            storeCachedScene( cacheFile, viewState, cacheParameters );
+        }
+    }
+    catch(const NVSGException& e) // catch unexpected SceniX errors
+    {
+        std::cerr << "SceniX critical error: " << e.getErrorMessage().c_str() << std::endl;
+    }
+    catch(...) // catch all others
+    {
+    }
+    setSceneLoadStage( data, viewState ? SceneLoad::STAGE_FINISHED : SceneLoad::STAGE_FAILED, viewState );
+}
+}
+
+nvsg::ViewStateSharedPtr loadScene( const std::string & filename, const std::vector<std::string> &searchPaths, PlugInCallback *callback )
+{
+    ViewStateSharedPtr viewState;
 
-        loader->setCallback( NULL );
+    vector<string> localSearchPaths;
+    setupLoadSearchPaths( filename, searchPaths, localSearchPaths );
+
+    // a cached copy of the scene saves running the loader
+    SceneCacheParameters cacheParameters = getSceneCacheParameters();
+    string cacheFile = getSceneCacheFile( filename, cacheParameters );
+    viewState = loadCachedScene( cacheFile, localSearchPaths );
+    if ( viewState )
+    {
+        return viewState;
+    }
+
+    {
+        PlugInLock loader( filename, UPITID_SCENE_LOADER, localSearchPaths );
+        if ( loader.get() )
+        {
+            viewState = loadWithSceneLoader( loader, filename, localSearchPaths, callback );
+        }
+    }
+    if ( viewState )
+    {
+        storeCachedScene( cacheFile, viewState, cacheParameters );
     }
 
     return viewState;
 }
 
-bool saveScene( const std::string & filename, const nvsg::ViewStateSharedPtr & viewState, PlugInCallback *callback )
+SceneLoad::SceneLoad( Data *data )
+    : m_data( data )
 {
-    bool result = false;
-    // define a unique plug-interface ID for SceneLoader
-    const UPITID PITID_SCENE_SAVER(UPITID_SCENE_SAVER, UPITID_VERSION);
+}
 
-    string modulePath, dir;
-    vector<string> searchPaths;
-    GetCurrentDir(dir);
-    searchPaths.push_back(dir);
+SceneLoad::~SceneLoad()
+{
+    cancel();
+    wait();
+    delete m_data;
+}
 
-    GetModulePath(modulePath);
-    GetDirFromPath(modulePath, dir);
-    searchPaths.push_back(dir);
+SceneLoad::Stage SceneLoad::getStage() const
+{
+    QMutexLocker lock( &m_data->mutex );
+    return( m_data->stage );
+}
 
-    string ext;
-    GetFileExtFromPath(filename, ext);
-    UPIID piid = UPIID(ext.c_str(), PITID_SCENE_SAVER);
+float SceneLoad::getProgress() const
+{
+    return( getSceneLoadProgress( getStage() ) );
+}
+
+bool SceneLoad::isDone() const
+{
+    Stage stage = getStage();
+    return( ( stage == STAGE_FINISHED ) || ( stage == STAGE_FAILED ) || ( stage == STAGE_CANCELED ) );
+}
+
+void SceneLoad::cancel()
+{
+    QMutexLocker lock( &m_data->mutex );
+    m_data->canceled = true;
+}
 
-    PlugIn * plug;
+void SceneLoad::wait()
+{
+    m_data->future.waitForFinished();
+}
+
+nvsg::ViewStateSharedPtr SceneLoad::getViewState() const
+{
+    QMutexLocker lock( &m_data->mutex );
+    return( m_data->viewState );
+}
 
-    if ( getInterface( searchPaths, piid, plug ) )
+SceneLoad * loadSceneAsync( const std::string & filename, const std::vector<std::string> &searchPaths, SceneLoadCallback *callback )
+{
+    SceneLoad::Data *data = new SceneLoad::Data;
+    data->filename = filename;
+    data->searchPaths = searchPaths;
+    data->callback = callback;
+    data->stage = SceneLoad::STAGE_QUEUED;
+    data->canceled = false;
+    data->future = QtConcurrent::run( &runSceneLoad, data );
+    return( new SceneLoad( data ) );
+}
+
+bool saveScene( const std::string & filename, const nvsg::ViewStateSharedPtr & viewState, PlugInCallback *callback )
+{
+    bool result = false;
+
+    PlugInLock plug( filename, UPITID_SCENE_SAVER );
+    if ( plug.get() )
     {
-        SceneSaver *ss = reinterpret_cast<SceneSaver *>(plug);
+        SceneSaver *ss = reinterpret_cast<SceneSaver *>(plug.get());
         try
         {
             SceneSharedPtr scene( ViewStateReadLock(viewState)->getScene() ); // DAR HACK Change SceneSaver interface later.
@@ -209,7 +512,12 @@ bool setupDefaultViewState( const nvsg::ViewStateSharedPtr & viewState )
                 // Make scene fit into the viewport.
                 if (sceneLock->getRootNode())
                 {
-                    Sphere3f sphere( sceneLock->getBoundingSphere() );
+                    // Generated scenes know their bounds, don't let SceniX scan all vertices for them
+                    Sphere3f sphere;
+                    if ( !getGeneratedBoundingSphere( sceneLock->getRootNode(), sphere ) )
+                    {
+                        sphere = sceneLock->getBoundingSphere();
+                    }
                     if ( isPositive(sphere) )
                     {
                         cameraLock->zoom( sphere, float(nvmath::PI_QUARTER) );
@@ -448,30 +756,16 @@ bool intersectObject( const nvsg::ViewStateSharedPtr &smartViewState, const Smar
 
 bool saveTextureHost( const std::string & filename, const TextureHostSharedPtr & tih )
 {
-    string ext;
-    GetFileExtFromPath(filename, ext);
-
-    // load the saver plug-in  - this should be configured
-    UPIID piid = UPIID(ext.c_str(), UPITID(UPITID_TEXTURE_SAVER, UPITID_VERSION) );
-
-    PlugIn * plug = 0;
-
-    std::string modulePath, dir;
-    std::vector<std::string> searchPaths;
-    GetCurrentDir(dir);
-    searchPaths.push_back(dir);
-
-    GetModulePath(modulePath);
-    GetDirFromPath(modulePath, dir);
-    searchPaths.push_back(dir);
+    // get the saver plug-in from the registry
+    PlugInLock plug( filename, UPITID_TEXTURE_SAVER );
 
     //
     // MMM - TODO - Update me for stereo images
     //
     TextureSaver * ts;
-    if ( getInterface( searchPaths, piid, plug ) )
+    if ( plug.get() )
     {
-        ts = reinterpret_cast<TextureSaver *>(plug);
+        ts = reinterpret_cast<TextureSaver *>(plug.get());
     }
     else
     {
@@ -490,64 +784,117 @@ bool saveTextureHost( const std::string & filename, const TextureHostSharedPtr &
 bool loadTextureHost( const std::string & filename, TextureHostSharedPtr & tih, const std::vector<std::string> &searchPaths )
 {
     tih.reset();
-    // appropriate search paths for the loader dll and the sample file.
-    string modulePath;
-    string curDir;
-    string dir;
-    vector<string> localSearchPaths = searchPaths;
+    // appropriate search paths for the loader dll and the texture file, same as for a scene
+    vector<string> localSearchPaths;
+    setupLoadSearchPaths( filename, searchPaths, localSearchPaths );
 
-    nvutil::GetCurrentDir(curDir);
-    localSearchPaths.push_back(curDir);
+    PlugInLock plug( filename, UPITID_TEXTURE_LOADER, localSearchPaths );
 
-    nvutil::GetModulePath(modulePath);
-    if ( find( localSearchPaths.begin(), localSearchPaths.end(), modulePath ) == localSearchPaths.end() )
+    // TODO - Update me for stereo images
+    TextureLoader * tls;
+    if ( plug.get() )
     {
-        localSearchPaths.push_back(modulePath);
+        tls = reinterpret_cast<TextureLoader *>(plug.get());
     }
-
-    // also add the texture's path, if it's not the current path (-> dir.empty()) and not yet added
-    nvutil::GetDrvAndDirFromPath(filename, dir);
-    if ( !dir.empty() && find( localSearchPaths.begin(), localSearchPaths.end(), dir ) == localSearchPaths.end() )
+    else
     {
-        localSearchPaths.push_back(dir);
+        // signal some kind of error
+        return false;
     }
 
-    // HACK Add SceniX media folders for supplied models add additional resource paths
-    // to make sure that required resources will be found by subsequent loaders.
-    size_t pos = dir.rfind("media");
-    if ( pos != string::npos )
+    std::string foundFile;
+    if ( FindFileFirst( filename, localSearchPaths, foundFile) ) // lookup the file
     {
-        string nvsgsdk( dir.substr(0, pos) );
-        localSearchPaths.push_back(nvsgsdk + "media/effects");
-        localSearchPaths.push_back(nvsgsdk + "media/textures");
+        tih = tls->load( foundFile );
     }
 
-    string ext;
-    GetFileExtFromPath(filename, ext);
+    return tih;
+}
 
-    UPIID piid = UPIID( ext.c_str(), UPITID(UPITID_TEXTURE_LOADER, UPITID_VERSION) );
+PlugInRegistryStatistics::PlugInRegistryStatistics()
+    : lookups( 0 )
+    , probes( 0 )
+    , failures( 0 )
+    , rescans( 0 )
+    , entries( 0 )
+    , probeSeconds( 0.0 )
+{
+}
 
-    PlugIn * plug = 0;
+PlugInLock::PlugInLock( const std::string & filename, unsigned int pitType, const std::vector<std::string> &searchPaths, bool lock )
+    : m_plugIn( 0 )
+    , m_mutex( 0 )
+{
+    string ext;
+    GetFileExtFromPath( filename, ext );
+    PlugInRegistryKey key( ext, pitType );
 
-    // TODO - Update me for stereo images
-    TextureLoader * tls;
-    if ( getInterface( localSearchPaths, piid, plug ) )
     {
-        tls = reinterpret_cast<TextureLoader *>(plug);
+        QMutexLocker registryLock( &plugInRegistryMutex );
+        PlugInRegistryEntry &entry = lookupPlugInRegistryEntry( key, searchPaths );
+        m_reference = entry.reference;
+        m_plugIn = entry.plugIn;
+        if ( lock )
+        {
+            QMutex *&mutex = plugInMutexes[key];
+            if ( !mutex )
+            {
+                mutex = new QMutex;
+            }
+            m_mutex = mutex;
+        }
+    }
+
+    // wait for the other users of the interface without blocking the registry
+    if ( m_mutex )
+    {
+        m_mutex->lock();
     }
-    else
+}
+
+PlugInLock::~PlugInLock()
+{
+    if ( m_mutex )
     {
-        // signal some kind of error
-        return false;
+        m_mutex->unlock();
     }
+}
 
-    std::string foundFile;
-    if ( FindFileFirst( filename, localSearchPaths, foundFile) ) // lookup the file
+PlugIn * PlugInLock::get() const
+{
+    return( m_plugIn );
+}
+
+bool hasPlugInInterface( const std::string & filename, unsigned int pitType, const std::vector<std::string> &searchPaths )
+{
+    return( PlugInLock( filename, pitType, searchPaths, false ).get() != 0 );
+}
+
+void rescanPlugInInterfaces()
+{
+    QMutexLocker lock( &plugInRegistryMutex );
+    ++plugInRegistryStatistics.rescans;
+
+    setupPlugInBaseSearchPaths();
+    for ( PlugInRegistry::iterator it = plugInRegistry.begin(); it != plugInRegistry.end(); ++it )
     {
-        tih = tls->load( foundFile );
+        probePlugInRegistryEntry( it->first, it->second, it->second.searchPaths );
     }
+}
 
-    return tih;
+void releasePlugInInterfaces()
+{
+    // the interfaces are released with their entries, the locks stay for PlugInLocks created later
+    QMutexLocker lock( &plugInRegistryMutex );
+    plugInRegistry.clear();
+    plugInBaseSearchPaths.clear();
+    plugInRegistryStatistics.entries = 0;
+}
+
+PlugInRegistryStatistics getPlugInRegistryStatistics()
+{
+    QMutexLocker lock( &plugInRegistryMutex );
+    return( plugInRegistryStatistics );
 }
 
 } // namespace nvutil
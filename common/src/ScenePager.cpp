@@ -0,0 +1,784 @@
+#include "ScenePager.h"
+#include "BufferArray.h"
+#include "MeshGenerator.h"
+#include "SceneFunctions.h"
+
+#include <nvmath/Matnnt.h>
+#include <nvmath/Spherent.h>
+#include <nvsg/GeoNode.h>
+#include <nvsg/Group.h>
+#include <nvsg/LOD.h>
+#include <nvsg/PerspectiveCamera.h>
+#include <nvsg/PlugInterface.h>
+#include <nvsg/PlugInterfaceID.h>
+#include <nvsg/Scene.h>
+#include <nvsg/Switch.h>
+#include <nvsg/Transform.h>
+#include <nvsg/ViewState.h>
+#include <nvutil/Tools.h>
+
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <set>
+#include <sstream>
+#include <vector>
+
+#include <float.h>
+#include <math.h>
+
+#include "nvutil/DbgNew.h" // this must be the last include
+
+using namespace nvmath;
+using namespace nvsg;
+using namespace std;
+
+namespace nvutil
+{
+namespace
+{
+const char *skeletonFileName = "skeleton.nbf";
+const char *chunkIndexFileName = "chunks.txt";
+const char *sourceTag = "source";           // the first line of the index, followed by the stamp of the source file
+
+//! The owner of the objects that stay in the skeleton, see collectOwners
+const unsigned int skeletonOwner = ~0u;
+
+//! A subtree chosen by planGroup to move into a chunk file, with all its instances
+struct ChunkPlan
+{
+    NodeSharedPtr   node;
+    size_t          bytes;
+    Sphere3f        sphere;     // around all instances, in world space
+    bool            valid;      // false if it shares nodes or drawables with the skeleton or another chunk
+    std::string     name;       // file name of the chunk, and name of its placeholders
+};
+
+//! The chunks of a scene and the Groups holding them
+struct SplitPlan
+{
+    std::vector<ChunkPlan>                  chunks;
+    std::map<const void *, unsigned int>    chunkIndices;   // per chunk root node
+    std::map<const void *, GroupSharedPtr>  parents;        // the Groups with chunk children, each once
+    std::map<const void *, size_t>          dataSizes;      // per node measured
+};
+
+//! Helper function to get the native path of the file \a name in \a directory
+std::string getDirectoryFile( const std::string &directory, const std::string &name )
+{
+    QDir dir( QString::fromLocal8Bit( directory.c_str() ) );
+    return( std::string( QDir::toNativeSeparators( dir.filePath( QString::fromLocal8Bit( name.c_str() ) ) ).toLocal8Bit().constData() ) );
+}
+
+//! Helper function to add the vertex and index bytes of the drawables below \a node, each drawable once
+void collectDataSize( const NodeSharedPtr &node, std::set<const void *> &drawables, size_t &bytes )
+{
+    if ( isPtrTo<GeoNode>( node ) )
+    {
+        GeoNodeReadLock geoNode( sharedPtr_cast<GeoNode>( node ) );
+        for ( GeoNode::StateSetConstIterator gnssci = geoNode->beginStateSets() ; gnssci != geoNode->endStateSets() ; ++gnssci )
+        {
+            for ( GeoNode::DrawableConstIterator gndci = geoNode->beginDrawables( gnssci ) ; gndci != geoNode->endDrawables( gnssci ) ; ++gndci )
+            {
+                if ( drawables.insert( gndci->get() ).second )
+                {
+                    bytes += getDrawableDataSize( *gndci );
+                }
+            }
+        }
+    }
+    else if ( isPtrTo<Group>( node ) )
+    {
+        GroupReadLock group( sharedPtr_cast<Group>( node ) );
+        for ( Group::ChildrenConstIterator gcci = group->beginChildren() ; gcci != group->endChildren() ; ++gcci )
+        {
+            collectDataSize( *gcci, drawables, bytes );
+        }
+    }
+}
+
+//! Helper function to get the vertex and index bytes of the drawables below \a node
+size_t getDataSize( const NodeSharedPtr &node )
+{
+    std::set<const void *> drawables;
+    size_t bytes = 0;
+    collectDataSize( node, drawables, bytes );
+    return( bytes );
+}
+
+//! Helper function to get the vertex and index bytes below \a node, measuring each node once for all its instances
+size_t getPlannedDataSize( const NodeSharedPtr &node, SplitPlan &plan )
+{
+    std::map<const void *, size_t>::const_iterator it = plan.dataSizes.find( node.get() );
+    if ( it == plan.dataSizes.end() )
+    {
+        it = plan.dataSizes.insert( std::make_pair( (const void *)node.get(), getDataSize( node ) ) ).first;
+    }
+    return( it->second );
+}
+
+//! Helper function to get the smallest sphere around the spheres \a a and \a b
+Sphere3f mergeSpheres( const Sphere3f &a, const Sphere3f &b )
+{
+    Vec3f d = b.getCenter() - a.getCenter();
+    float distance = length( d );
+    if ( distance + b.getRadius() <= a.getRadius() )
+    {
+        return( a );
+    }
+    if ( distance + a.getRadius() <= b.getRadius() )
+    {
+        return( b );
+    }
+    float radius = 0.5f * ( distance + a.getRadius() + b.getRadius() );
+    return( Sphere3f( a.getCenter() + d * ( ( radius - a.getRadius() ) / distance ), radius ) );
+}
+
+//! Helper function to get the bounding sphere of \a node, transformed by \a matrix
+Sphere3f getWorldBoundingSphere( const NodeSharedPtr &node, const Mat44f &matrix )
+{
+    Sphere3f sphere;
+    if ( !getGeneratedBoundingSphere( node, sphere ) )
+    {
+        sphere = NodeReadLock( node )->getBoundingSphere();
+    }
+
+    return( Sphere3f( Vec3f( Vec4f( sphere.getCenter(), 1.0f ) * matrix ), getMaximumScale( matrix ) * sphere.getRadius() ) );
+}
+
+//! Helper function to save \a node as the scene of the file \a fileName
+bool saveChunk( const NodeSharedPtr &node, const std::string &fileName )
+{
+    SceneSharedPtr scene = Scene::create();
+    SceneWriteLock( scene )->setRootNode( node );
+    ViewStateSharedPtr viewState = ViewState::create();
+    ViewStateWriteLock( viewState )->setScene( scene );
+    return( saveScene( fileName, viewState ) );
+}
+
+//! Helper function to get the children of \a group, copied so the group can be changed while iterating over them
+void getChildren( const GroupSharedPtr &group, std::vector<NodeSharedPtr> &children )
+{
+    GroupReadLock groupLock( group );
+    for ( Group::ChildrenConstIterator gcci = groupLock->beginChildren() ; gcci != groupLock->endChildren() ; ++gcci )
+    {
+        children.push_back( *gcci );
+    }
+}
+
+//! Helper function to choose the large subtrees below \a group, transformed by \a matrix, as chunks, each node once for all its instances
+void planGroup( const GroupSharedPtr &group, const Mat44f &matrix, const SceneSplitParameters &parameters, SplitPlan &plan )
+{
+    Mat44f childMatrix( matrix );
+    if ( isPtrTo<Transform>( group ) )
+    {
+        childMatrix = TransformReadLock( sharedPtr_cast<Transform>( group ) )->getTrafo().getMatrix() * matrix;
+    }
+
+    std::vector<NodeSharedPtr> children;
+    getChildren( group, children );
+    for ( size_t i = 0; i < children.size(); ++i )
+    {
+        size_t bytes = getPlannedDataSize( children[i], plan );
+        if ( bytes < parameters.minChunkBytes )
+        {
+            continue;
+        }
+
+        // Switches and LODs select their children by index, they keep them
+        if (   ( parameters.maxChunkBytes < bytes ) && isPtrTo<Group>( children[i] )
+            && !isPtrTo<Switch>( children[i] ) && !isPtrTo<LOD>( children[i] ) )
+        {
+            planGroup( sharedPtr_cast<Group>( children[i] ), childMatrix, parameters, plan );
+            continue;
+        }
+
+        Sphere3f sphere = getWorldBoundingSphere( children[i], childMatrix );
+        std::map<const void *, unsigned int>::const_iterator it = plan.chunkIndices.find( children[i].get() );
+        if ( it == plan.chunkIndices.end() )
+        {
+            ChunkPlan chunk;
+            chunk.node = children[i];
+            chunk.bytes = bytes;
+            chunk.sphere = sphere;
+            chunk.valid = true;
+            plan.chunkIndices[children[i].get()] = checked_cast<unsigned int>( plan.chunks.size() );
+            plan.chunks.push_back( chunk );
+        }
+        else
+        {
+            // another instance of a shared subtree, one file for all of them
+            plan.chunks[it->second].sphere = mergeSpheres( plan.chunks[it->second].sphere, sphere );
+        }
+        plan.parents[group.get()] = group;
+    }
+}
+
+//! Helper function to record \a owner for \a object, returns true if it had no owner before. Other owners of it go to \a conflicts
+bool claimObject( const void *object, unsigned int owner, std::map<const void *, unsigned int> &owners, std::set<unsigned int> &conflicts )
+{
+    std::pair<std::map<const void *, unsigned int>::iterator, bool> inserted = owners.insert( std::make_pair( object, owner ) );
+    if ( !inserted.second && ( inserted.first->second != owner ) )
+    {
+        if ( owner != skeletonOwner )
+        {
+            conflicts.insert( owner );
+        }
+        if ( inserted.first->second != skeletonOwner )
+        {
+            conflicts.insert( inserted.first->second );
+        }
+    }
+    return( inserted.second );
+}
+
+/*! Helper function to record \a owner for the nodes and drawables below \a node, the valid chunks of \a plan own their
+    subtrees. The chunks sharing a node or drawable with the skeleton or another chunk go to \a conflicts. */
+void collectOwners( const NodeSharedPtr &node, unsigned int owner, const SplitPlan &plan
+                  , std::map<const void *, unsigned int> &owners, std::set<unsigned int> &conflicts )
+{
+    std::map<const void *, unsigned int>::const_iterator it = plan.chunkIndices.find( node.get() );
+    if ( ( it != plan.chunkIndices.end() ) && plan.chunks[it->second].valid )
+    {
+        owner = it->second;
+    }
+    if ( !claimObject( node.get(), owner, owners, conflicts ) )
+    {
+        return;
+    }
+
+    if ( isPtrTo<GeoNode>( node ) )
+    {
+        GeoNodeReadLock geoNode( sharedPtr_cast<GeoNode>( node ) );
+        for ( GeoNode::StateSetConstIterator gnssci = geoNode->beginStateSets() ; gnssci != geoNode->endStateSets() ; ++gnssci )
+        {
+            for ( GeoNode::DrawableConstIterator gndci = geoNode->beginDrawables( gnssci ) ; gndci != geoNode->endDrawables( gnssci ) ; ++gndci )
+            {
+                claimObject( gndci->get(), owner, owners, conflicts );
+            }
+        }
+    }
+    else if ( isPtrTo<Group>( node ) )
+    {
+        GroupReadLock group( sharedPtr_cast<Group>( node ) );
+        for ( Group::ChildrenConstIterator gcci = group->beginChildren() ; gcci != group->endChildren() ; ++gcci )
+        {
+            collectOwners( *gcci, owner, plan, owners, conflicts );
+        }
+    }
+}
+
+//! Helper function to get the stamp of \a sourceFile written to the index, its size, modification time and path, empty if it's not a file
+std::string getSourceStamp( const std::string &sourceFile )
+{
+    QFileInfo fileInfo( QString::fromLocal8Bit( sourceFile.c_str() ) );
+    if ( sourceFile.empty() || !fileInfo.isFile() )
+    {
+        return( std::string() );
+    }
+    std::ostringstream stamp;
+    stamp << fileInfo.size() << " " << fileInfo.lastModified().toTime_t() << " "
+          << QDir::toNativeSeparators( fileInfo.canonicalFilePath() ).toLocal8Bit().constData();
+    return( stamp.str() );
+}
+
+//! Helper function to delete the chunk files listed in the index of \a directory, before a new split replaces them
+void removeChunkFiles( const std::string &directory )
+{
+    std::ifstream index( getDirectoryFile( directory, chunkIndexFileName ).c_str() );
+    std::string line;
+    while ( std::getline( index, line ) )
+    {
+        std::istringstream fields( line );
+        std::string name;
+        if ( ( fields >> name ) && ( name != sourceTag ) )
+        {
+            QFile::remove( QString::fromLocal8Bit( getDirectoryFile( directory, name ).c_str() ) );
+        }
+    }
+}
+
+//! Helper function to collect the Groups below \a node by name, each Group once
+void collectPlaceholders( const NodeSharedPtr &node, std::set<const void *> &visited, std::map<std::string, std::vector<GroupSharedPtr> > &placeholders )
+{
+    if ( isPtrTo<Group>( node ) && visited.insert( node.get() ).second )
+    {
+        GroupSharedPtr groupPtr = sharedPtr_cast<Group>( node );
+        GroupReadLock group( groupPtr );
+        if ( !group->getName().empty() )
+        {
+            placeholders[group->getName()].push_back( groupPtr );
+        }
+        for ( Group::ChildrenConstIterator gcci = group->beginChildren() ; gcci != group->endChildren() ; ++gcci )
+        {
+            collectPlaceholders( *gcci, visited, placeholders );
+        }
+    }
+}
+
+//! Helper function to load the root node of the chunk file \a fileName, runs on the pager thread
+NodeSharedPtr loadChunk( const std::string &fileName, const std::vector<std::string> &searchPaths )
+{
+    PlugInLock loader( fileName, UPITID_SCENE_LOADER, searchPaths );
+    if ( loader.get() )
+    {
+        try
+        {
+            ViewStateSharedPtr viewState;
+            SceneSharedPtr scene = reinterpret_cast<nvsg::SceneLoader *>( loader.get() )->load( fileName, searchPaths, viewState );
+            if ( scene )
+            {
+                return( SceneReadLock( scene )->getRootNode() );
+            }
+        }
+        catch(...) // a damaged chunk file is just missing
+        {
+        }
+    }
+    return( NodeSharedPtr() );
+}
+}
+
+SceneSplitParameters::SceneSplitParameters()
+    : minChunkBytes( 1024 * 1024 )
+    , maxChunkBytes( 64 * 1024 * 1024 )
+{
+}
+
+// ===========================================================================
+
+unsigned int splitScene( const ViewStateSharedPtr &viewState, const std::string &directory, const std::string &sourceFile
+                        , const SceneSplitParameters &parameters )
+{
+    NVSG_ASSERT( parameters.minChunkBytes <= parameters.maxChunkBytes );
+
+    SceneSharedPtr scene = ViewStateReadLock( viewState )->getScene();
+    NodeSharedPtr root = scene ? SceneReadLock( scene )->getRootNode() : NodeSharedPtr();
+    if ( !root || !QDir().mkpath( QString::fromLocal8Bit( directory.c_str() ) ) )
+    {
+        return( 0 );
+    }
+
+    SplitPlan plan;
+    if ( isPtrTo<Group>( root ) && !isPtrTo<Switch>( root ) && !isPtrTo<LOD>( root ) )
+    {
+        const Mat44f identity( 1.0f, 0.0f, 0.0f, 0.0f,
+                               0.0f, 1.0f, 0.0f, 0.0f,
+                               0.0f, 0.0f, 1.0f, 0.0f,
+                               0.0f, 0.0f, 0.0f, 1.0f );
+        planGroup( sharedPtr_cast<Group>( root ), identity, parameters, plan );
+    }
+
+    // A chunk sharing a node or drawable with the skeleton or another chunk would be resident twice while it's loaded,
+    // it stays in the skeleton. That changes the owners of its subtree, so check again until nothing is shared.
+    for ( ;; )
+    {
+        std::map<const void *, unsigned int> owners;
+        std::set<unsigned int> conflicts;
+        collectOwners( root, skeletonOwner, plan, owners, conflicts );
+        if ( conflicts.empty() )
+        {
+            break;
+        }
+        for ( std::set<unsigned int>::const_iterator it = conflicts.begin(); it != conflicts.end(); ++it )
+        {
+            plan.chunks[*it].valid = false;
+        }
+    }
+
+    // the chunk files of an earlier split of another scene
+    removeChunkFiles( directory );
+    QFile::remove( QString::fromLocal8Bit( getDirectoryFile( directory, chunkIndexFileName ).c_str() ) );
+
+    unsigned int written = 0;
+    for ( size_t i = 0; i < plan.chunks.size(); ++i )
+    {
+        ChunkPlan &chunk = plan.chunks[i];
+        if ( chunk.valid )
+        {
+            std::ostringstream name;
+            name << "chunk" << written << ".nbf";
+            chunk.name = name.str();
+            chunk.valid = saveChunk( chunk.node, getDirectoryFile( directory, chunk.name ) );
+            if ( chunk.valid )
+            {
+                ++written;
+            }
+        }
+    }
+
+    // every Group holding a chunk gets a placeholder for it, all placeholders of a chunk are named after its one file
+    for ( std::map<const void *, GroupSharedPtr>::const_iterator it = plan.parents.begin(); it != plan.parents.end(); ++it )
+    {
+        std::vector<NodeSharedPtr> children;
+        getChildren( it->second, children );
+        std::set<const void *> replaced;
+        for ( size_t i = 0; i < children.size(); ++i )
+        {
+            std::map<const void *, unsigned int>::const_iterator ci = plan.chunkIndices.find( children[i].get() );
+            if ( ( ci != plan.chunkIndices.end() ) && plan.chunks[ci->second].valid && replaced.insert( children[i].get() ).second )
+            {
+                GroupSharedPtr placeholder = Group::create();
+                GroupWriteLock( placeholder )->setName( plan.chunks[ci->second].name );
+
+                GroupWriteLock groupLock( it->second );
+                groupLock->removeChild( children[i] );
+                groupLock->addChild( placeholder );
+            }
+        }
+    }
+
+    // the index is written last, so a complete index means a complete split: the stamp of the source file, then
+    // per chunk its file, bytes, center and radius of the bounding sphere in world space
+    if ( saveScene( getPagedSceneFile( directory ), viewState ) )
+    {
+        std::ofstream index( getDirectoryFile( directory, chunkIndexFileName ).c_str() );
+        index.precision( 9 );
+        index << sourceTag << " " << getSourceStamp( sourceFile ) << std::endl;
+        for ( size_t i = 0; i < plan.chunks.size(); ++i )
+        {
+            if ( plan.chunks[i].valid )
+            {
+                const Vec3f &center = plan.chunks[i].sphere.getCenter();
+                index << plan.chunks[i].name << " " << plan.chunks[i].bytes << " " << center[0] << " " << center[1] << " " << center[2]
+                      << " " << plan.chunks[i].sphere.getRadius() << std::endl;
+            }
+        }
+    }
+    return( written );
+}
+
+// ===========================================================================
+
+std::string getPagedSceneFile( const std::string &directory )
+{
+    return( getDirectoryFile( directory, skeletonFileName ) );
+}
+
+// ===========================================================================
+
+bool isPagedSceneOf( const std::string &directory, const std::string &sourceFile )
+{
+    std::string stamp = getSourceStamp( sourceFile );
+    if ( stamp.empty() || !QFileInfo( QString::fromLocal8Bit( getPagedSceneFile( directory ).c_str() ) ).isFile() )
+    {
+        return( false );
+    }
+
+    std::ifstream index( getDirectoryFile( directory, chunkIndexFileName ).c_str() );
+    std::string line;
+    return( std::getline( index, line ) && ( line == std::string( sourceTag ) + " " + stamp ) );
+}
+
+// ===========================================================================
+
+//! A chunk as seen by the pager
+struct PagedChunk
+{
+    std::string     fileName;
+    size_t          bytes;
+    Sphere3f        sphere;
+    std::vector<GroupSharedPtr> placeholders;   // one per Group holding the chunk, all get the same root
+    NodeSharedPtr   root;           // the chunk below its placeholders while it is resident
+    bool            stalled;        // wanted but not resident, counted as one stall until it's attached or not wanted anymore
+};
+
+// the state shared by a ScenePager and its pager thread
+struct ScenePager::Data : public QThread
+{
+    virtual void run();
+
+    // set up by the constructor
+    ViewStateSharedPtr                  viewState;
+    std::vector<std::string>            searchPaths;
+    std::vector<PagedChunk>             chunks;
+
+    // only used by update
+    size_t                              maxResidentBytes;
+    float                               minScreenSize;
+
+    // shared with the pager thread
+    mutable QMutex                      mutex;
+    QWaitCondition                      condition;
+    bool                                stop;
+    std::deque<unsigned int>            requests;       // the chunks to load, most important first
+    unsigned int                        loading;        // the chunk loaded right now, ~0 if none
+    std::vector< std::pair<unsigned int, NodeSharedPtr> > loaded;   // the chunks loaded but not attached yet
+    std::vector<bool>                   failed;         // the chunks that could not be loaded, they are not requested again
+    Statistics                          statistics;
+};
+
+void ScenePager::Data::run()
+{
+    QMutexLocker lock( &mutex );
+    while ( !stop )
+    {
+        if ( requests.empty() )
+        {
+            condition.wait( &mutex );
+            continue;
+        }
+
+        loading = requests.front();
+        requests.pop_front();
+        std::string fileName = chunks[loading].fileName;
+
+        lock.unlock();
+        NodeSharedPtr root = loadChunk( fileName, searchPaths );
+        lock.relock();
+
+        if ( root )
+        {
+            loaded.push_back( std::make_pair( loading, root ) );
+        }
+        else
+        {
+            failed[loading] = true;
+            ++statistics.failures;
+        }
+        loading = ~0u;
+    }
+}
+
+ScenePager::ScenePager( const ViewStateSharedPtr &viewState, const std::string &directory, size_t maxResidentBytes )
+    : m_data( new Data )
+{
+    m_data->viewState = viewState;
+    m_data->searchPaths.push_back( directory );
+    m_data->maxResidentBytes = maxResidentBytes;
+    m_data->minScreenSize = 8.0f;
+    m_data->stop = false;
+    m_data->loading = ~0u;
+
+    std::map<std::string, std::vector<GroupSharedPtr> > placeholders;
+    SceneSharedPtr scene = ViewStateReadLock( viewState )->getScene();
+    if ( scene )
+    {
+        std::set<const void *> visited;
+        collectPlaceholders( SceneReadLock( scene )->getRootNode(), visited, placeholders );
+    }
+
+    std::ifstream index( getDirectoryFile( directory, chunkIndexFileName ).c_str() );
+    std::string line;
+    while ( std::getline( index, line ) )
+    {
+        std::istringstream fields( line );
+        std::string name;
+        size_t bytes;
+        Vec3f center;
+        float radius;
+        if ( !( fields >> name >> bytes >> center[0] >> center[1] >> center[2] >> radius ) || ( name == sourceTag ) )
+        {
+            continue;
+        }
+
+        std::map<std::string, std::vector<GroupSharedPtr> >::const_iterator it = placeholders.find( name );
+        if ( it != placeholders.end() )
+        {
+            PagedChunk chunk;
+            chunk.fileName = getDirectoryFile( directory, name );
+            chunk.bytes = bytes;
+            chunk.sphere = Sphere3f( center, radius );
+            chunk.placeholders = it->second;
+            chunk.stalled = false;
+            m_data->chunks.push_back( chunk );
+        }
+    }
+    m_data->failed.resize( m_data->chunks.size(), false );
+
+    m_data->statistics.chunks = checked_cast<unsigned int>( m_data->chunks.size() );
+    m_data->statistics.residentChunks = 0;
+    m_data->statistics.residentBytes = 0;
+    m_data->statistics.pageIns = 0;
+    m_data->statistics.evictions = 0;
+    m_data->statistics.stalls = 0;
+    m_data->statistics.failures = 0;
+
+    m_data->start( QThread::LowPriority );
+}
+
+ScenePager::~ScenePager()
+{
+    {
+        QMutexLocker lock( &m_data->mutex );
+        m_data->stop = true;
+        m_data->condition.wakeAll();
+    }
+    m_data->wait();
+    delete m_data;
+}
+
+void ScenePager::setMaximumResidentBytes( size_t maxResidentBytes )
+{
+    m_data->maxResidentBytes = maxResidentBytes;
+}
+
+size_t ScenePager::getMaximumResidentBytes() const
+{
+    return( m_data->maxResidentBytes );
+}
+
+void ScenePager::setMinimumScreenSize( float pixels )
+{
+    m_data->minScreenSize = pixels;
+}
+
+float ScenePager::getMinimumScreenSize() const
+{
+    return( m_data->minScreenSize );
+}
+
+bool ScenePager::update( unsigned int viewportHeight )
+{
+    std::vector<PagedChunk> &chunks = m_data->chunks;
+
+    Vec3f position;
+    float fieldOfView = float( PI_QUARTER );
+    {
+        CameraSharedPtr camera = ViewStateReadLock( m_data->viewState )->getCamera();
+        if ( !camera || chunks.empty() )
+        {
+            return( false );
+        }
+        position = CameraReadLock( camera )->getPosition();
+        if ( isPtrTo<PerspectiveCamera>( camera ) )
+        {
+            fieldOfView = PerspectiveCameraReadLock( sharedPtr_cast<PerspectiveCamera>( camera ) )->getFieldOfView();
+        }
+    }
+
+    // The size of each chunk on the screen, the diameter of its bounding sphere in pixels, largest first
+    const float pixelsPerUnit = float( viewportHeight ) / ( 2.0f * tanf( 0.5f * fieldOfView ) );
+    std::vector< std::pair<float, unsigned int> > screenSizes( chunks.size() );
+    for ( size_t i = 0; i < chunks.size(); ++i )
+    {
+        float distance = length( chunks[i].sphere.getCenter() - position ) - chunks[i].sphere.getRadius();
+        float size = ( distance <= FLT_EPSILON ) ? FLT_MAX : 2.0f * chunks[i].sphere.getRadius() * pixelsPerUnit / distance;
+        screenSizes[i] = std::make_pair( size, checked_cast<unsigned int>( i ) );
+    }
+    std::sort( screenSizes.begin(), screenSizes.end(), std::greater< std::pair<float, unsigned int> >() );
+
+    // The chunks wanted: large enough on the screen, largest first, as far as they fit into the budget
+    std::vector<bool> wanted( chunks.size(), false );
+    size_t wantedBytes = 0;
+    for ( size_t i = 0; i < screenSizes.size() && m_data->minScreenSize <= screenSizes[i].first; ++i )
+    {
+        const PagedChunk &chunk = chunks[screenSizes[i].second];
+        if ( wantedBytes + chunk.bytes <= m_data->maxResidentBytes )
+        {
+            wanted[screenSizes[i].second] = true;
+            wantedBytes += chunk.bytes;
+        }
+    }
+
+    std::vector< std::pair<unsigned int, NodeSharedPtr> > loaded;
+    Statistics statistics;
+    {
+        QMutexLocker lock( &m_data->mutex );
+        loaded.swap( m_data->loaded );
+        statistics = m_data->statistics;
+    }
+
+    // Attach the chunks loaded meanwhile, unless the camera moved away from them
+    bool changed = false;
+    for ( size_t i = 0; i < loaded.size(); ++i )
+    {
+        PagedChunk &chunk = chunks[loaded[i].first];
+        if ( wanted[loaded[i].first] && !chunk.root )
+        {
+            chunk.root = loaded[i].second;
+            for ( size_t j = 0; j < chunk.placeholders.size(); ++j )
+            {
+                GroupWriteLock( chunk.placeholders[j] )->addChild( chunk.root );
+            }
+            statistics.residentBytes += chunk.bytes;
+            ++statistics.residentChunks;
+            ++statistics.pageIns;
+            changed = true;
+        }
+    }
+
+    // Evict chunks not wanted anymore, smallest on the screen first, until the missing ones fit into the budget.
+    // A missing chunk is one stall from the update that first wants it until it's attached, however many updates wait.
+    size_t missingBytes = 0;
+    for ( size_t i = 0; i < chunks.size(); ++i )
+    {
+        if ( wanted[i] && !chunks[i].root )
+        {
+            missingBytes += chunks[i].bytes;
+            if ( !chunks[i].stalled )
+            {
+                chunks[i].stalled = true;
+                ++statistics.stalls;
+            }
+        }
+        else
+        {
+            chunks[i].stalled = false;
+        }
+    }
+    for ( size_t i = screenSizes.size(); 0 < i && m_data->maxResidentBytes < statistics.residentBytes + missingBytes; --i )
+    {
+        PagedChunk &chunk = chunks[screenSizes[i - 1].second];
+        if ( chunk.root && !wanted[screenSizes[i - 1].second] )
+        {
+            for ( size_t j = 0; j < chunk.placeholders.size(); ++j )
+            {
+                GroupWriteLock( chunk.placeholders[j] )->removeChild( chunk.root );
+            }
+            chunk.root.reset();
+            statistics.residentBytes -= chunk.bytes;
+            --statistics.residentChunks;
+            ++statistics.evictions;
+            changed = true;
+        }
+    }
+
+    // Request the missing chunks, most important first, replacing the requests of the last update
+    {
+        QMutexLocker lock( &m_data->mutex );
+        std::set<unsigned int> inFlight;
+        inFlight.insert( m_data->loading );
+        for ( size_t i = 0; i < m_data->loaded.size(); ++i )
+        {
+            inFlight.insert( m_data->loaded[i].first );
+        }
+
+        m_data->requests.clear();
+        for ( size_t i = 0; i < screenSizes.size(); ++i )
+        {
+            unsigned int index = screenSizes[i].second;
+            if ( wanted[index] && !chunks[index].root && !m_data->failed[index] && ( inFlight.find( index ) == inFlight.end() ) )
+            {
+                m_data->requests.push_back( index );
+            }
+        }
+        if ( !m_data->requests.empty() )
+        {
+            m_data->condition.wakeOne();
+        }
+
+        // the pager thread only counts failures
+        statistics.failures = m_data->statistics.failures;
+        m_data->statistics = statistics;
+    }
+    return( changed );
+}
+
+ScenePager::Statistics ScenePager::getStatistics() const
+{
+    QMutexLocker lock( &m_data->mutex );
+    return( m_data->statistics );
+}
+
+} // namespace nvutil
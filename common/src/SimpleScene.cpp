@@ -61,6 +61,7 @@ SimpleScene::SimpleScene()
     //m_drawable = createDodecahedron();
     //m_drawable = createIcosahedron();
 //    m_drawable = createSphere(32,16);
+//    m_drawable = createIcoSphere(3);
 //    m_drawable = createTorus(64,32);
 //    m_drawable = createTessellatedPlane(1);
     //  m_drawable = createTessellatedBox(10);
@@ -160,10 +161,12 @@ SimpleScene::SimpleScene()
     searchPaths.push_back(QDir::toNativeSeparators(appPath).toStdString());
     searchPaths.push_back(QDir::toNativeSeparators(imagePath).toStdString());
 
-    stateSet[0] = createTextureFromFile(std::string("test.png"), searchPaths);
-    stateSet[1] = createTextureFromFile(std::string("test.png"), searchPaths);
-    stateSet[2] = createTextureFromFile(std::string("test.png"), searchPaths);
-    stateSet[3] = createTextureFromFile(std::string("test.png"), searchPaths);
+    std::vector<std::string> textureFiles( 4, std::string("test.png") );
+    std::vector<StateSetSharedPtr> textures = createTexturesFromFiles( textureFiles, searchPaths );
+    for ( int i=0 ; i<4 ; i++ )
+    {
+        stateSet[i] = textures[i];
+    }
 
     // Create four GeoNodes.
     GeoNodeSharedPtr node[4];
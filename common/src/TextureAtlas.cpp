@@ -0,0 +1,708 @@
+#include "TextureAtlas.h"
+#include "BufferArray.h"
+
+#include <nvsg/Buffer.h>
+#include <nvsg/GeoNode.h>
+#include <nvsg/Group.h>
+#include <nvsg/Primitive.h>
+#include <nvsg/Scene.h>
+#include <nvsg/StateSet.h>
+#include <nvsg/TextureAttribute.h>
+#include <nvsg/TextureHost.h>
+#include <nvsg/VertexAttributeSet.h>
+#include <nvtraverser/UnifyTraverser.h>
+#include <nvutil/Tools.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "nvutil/DbgNew.h" // this must be the last include
+
+using namespace nvmath;
+using namespace nvsg;
+using namespace nvtraverser;
+using namespace std;
+
+namespace nvutil
+{
+namespace
+{
+//! The sampling of a texture, filters and environment are kept by its page, the wrap modes by its padding
+struct AtlasSampling
+{
+    TextureMagFilterMode        magFilter;
+    TextureMinFilterMode        minFilter;
+    TextureEnvMode              envMode;
+    TextureWrapMode             wrapS;
+    TextureWrapMode             wrapT;
+};
+
+//! The texture index of a VertexAttributeSet that is used without an atlas texture, see AtlasScene::vasTextures
+const unsigned int noAtlasTexture = ~0u;
+
+//! A texture of the scene and its place in the atlas
+struct AtlasTexture
+{
+    TextureHostSharedPtr        textureHost;
+    AtlasSampling               sampling;
+    unsigned int                width;
+    unsigned int                height;
+    bool                        valid;          // all its uses can be redirected to the atlas
+    unsigned int                page;
+    unsigned int                x;              // lower left texel of the texture inside the padding
+    unsigned int                y;
+};
+
+//! An atlas page being filled shelf by shelf, with the textures of one filter and environment mode
+struct AtlasPage
+{
+    AtlasSampling               sampling;
+    std::vector<unsigned char>  texels;
+    unsigned int                shelfY;
+    unsigned int                shelfHeight;
+    unsigned int                cursorX;
+    TextureAttributeSharedPtr   textureAttribute;
+};
+
+//! A drawable of a GeoNode together with its StateSet
+struct AtlasUse
+{
+    StateSetSharedPtr           stateSet;
+    DrawableSharedPtr           drawable;
+};
+
+//! The packable textures and the StateSets and VertexAttributeSets using them
+struct AtlasScene
+{
+    std::vector<AtlasTexture>                       textures;
+    std::map<const void *, unsigned int>            textureIndices;     // per TextureHost
+    std::map<const void *, unsigned int>            stateSetTextures;   // per StateSet with a packable texture
+    std::map<const void *, StateSetSharedPtr>       stateSets;
+    std::map<const void *, unsigned int>            vasTextures;        // per VertexAttributeSet of the scene, noAtlasTexture if not remapped
+    std::map<const void *, VertexAttributeSetSharedPtr> vas;
+};
+
+//! Helper function to collect the drawables with their StateSets below \a node, visiting shared subtrees once
+void collectUses( const NodeSharedPtr &node, std::set<const void *> &visited, std::vector<AtlasUse> &uses )
+{
+    if ( !node || !visited.insert( node.get() ).second )
+    {
+        return;
+    }
+
+    if ( isPtrTo<GeoNode>( node ) )
+    {
+        GeoNodeReadLock geoNode( sharedPtr_cast<GeoNode>( node ) );
+        for ( GeoNode::StateSetConstIterator gnssci = geoNode->beginStateSets() ; gnssci != geoNode->endStateSets() ; ++gnssci )
+        {
+            for ( GeoNode::DrawableConstIterator gndci = geoNode->beginDrawables( gnssci ) ; gndci != geoNode->endDrawables( gnssci ) ; ++gndci )
+            {
+                AtlasUse use;
+                use.stateSet = *gnssci;
+                use.drawable = *gndci;
+                uses.push_back( use );
+            }
+        }
+    }
+    else if ( isPtrTo<Group>( node ) )
+    {
+        GroupReadLock group( sharedPtr_cast<Group>( node ) );
+        for ( Group::ChildrenConstIterator gcci = group->beginChildren() ; gcci != group->endChildren() ; ++gcci )
+        {
+            collectUses( *gcci, visited, uses );
+        }
+    }
+}
+
+//! Helper function to get the TextureAttribute of \a stateSetPtr, a null pointer if there is none
+TextureAttributeSharedPtr getTextureAttribute( const StateSetSharedPtr &stateSetPtr )
+{
+    StateSetReadLock stateSet( stateSetPtr );
+    StateSet::AttributeConstIterator ssaci = stateSet->findAttribute( OC_TEXTUREATTRIBUTE );
+    return( ( ssaci != stateSet->endAttributes() ) ? sharedPtr_cast<TextureAttribute>( *ssaci ) : TextureAttributeSharedPtr() );
+}
+
+//! Helper function to count the different StateSets with a TextureAttribute and the different TextureAttributes in \a uses
+void countTextures( const std::vector<AtlasUse> &uses, unsigned int &textures, unsigned int &stateSets )
+{
+    std::set<const void *> textureSet;
+    std::set<const void *> stateSetSet;
+    for ( size_t i = 0; i < uses.size(); ++i )
+    {
+        if ( uses[i].stateSet && ( stateSetSet.find( uses[i].stateSet.get() ) == stateSetSet.end() ) )
+        {
+            TextureAttributeSharedPtr textureAttribute = getTextureAttribute( uses[i].stateSet );
+            if ( textureAttribute )
+            {
+                stateSetSet.insert( uses[i].stateSet.get() );
+                textureSet.insert( textureAttribute.get() );
+            }
+        }
+    }
+    textures = checked_cast<unsigned int>( textureSet.size() );
+    stateSets = checked_cast<unsigned int>( stateSetSet.size() );
+}
+
+//! Helper function to get the number of 8-bit components of the texels of \a format, 0 if it can't be packed
+unsigned int getComponentCount( unsigned int format )
+{
+    switch( format )
+    {
+    case Image::IMG_LUMINANCE:
+        return( 1 );
+    case Image::IMG_LUMINANCE_ALPHA:
+        return( 2 );
+    case Image::IMG_RGB:
+    case Image::IMG_BGR:
+        return( 3 );
+    case Image::IMG_RGBA:
+    case Image::IMG_BGRA:
+        return( 4 );
+    default:
+        return( 0 );
+    }
+}
+
+//! Helper function to check if \a minFilter samples a mip chain
+bool isMipmapFilter( TextureMinFilterMode minFilter )
+{
+    return( ( minFilter != TFM_MIN_NEAREST ) && ( minFilter != TFM_MIN_LINEAR ) );
+}
+
+//! Helper function to check if the padding can reproduce the wrap mode \a wrapMode for texture coordinates inside [0,1]
+bool isAtlasWrapMode( TextureWrapMode wrapMode )
+{
+    return( ( wrapMode == TWM_REPEAT ) || ( wrapMode == TWM_CLAMP_TO_EDGE ) );
+}
+
+//! Helper function to check if textures sampled with \a a and \a b can share a page
+bool isSamePageSampling( const AtlasSampling &a, const AtlasSampling &b )
+{
+    return( ( a.magFilter == b.magFilter ) && ( a.minFilter == b.minFilter ) && ( a.envMode == b.envMode ) );
+}
+
+//! Helper function to check if \a a and \a b are the same sampling
+bool isSameSampling( const AtlasSampling &a, const AtlasSampling &b )
+{
+    return( isSamePageSampling( a, b ) && ( a.wrapS == b.wrapS ) && ( a.wrapT == b.wrapT ) );
+}
+
+/*! Helper function to get the TextureHost bound by \a stateSetPtr, if it is the only texture of the StateSet, small
+    enough and its sampling \a sampling can be reproduced by a page with \a mipLevels mip levels */
+TextureHostSharedPtr getPackableTexture( const StateSetSharedPtr &stateSetPtr, const TextureAtlasParameters &parameters
+                                       , unsigned int mipLevels, AtlasSampling &sampling )
+{
+    TextureAttributeSharedPtr textureAttributePtr = getTextureAttribute( stateSetPtr );
+    if ( !textureAttributePtr )
+    {
+        return( TextureHostSharedPtr() );
+    }
+
+    TextureAttributeReadLock textureAttribute( textureAttributePtr );
+    if ( ( textureAttribute->getNumberOfTextureAttributeItems() != 1 ) || !textureAttribute->getTextureAttributeItem( 0 ) )
+    {
+        return( TextureHostSharedPtr() );
+    }
+
+    TextureSharedPtr texture;
+    {
+        TextureAttributeItemReadLock textureAttributeItem( textureAttribute->getTextureAttributeItem( 0 ) );
+        texture = textureAttributeItem->getTexture();
+        sampling.magFilter = textureAttributeItem->getMagFilterMode();
+        sampling.minFilter = textureAttributeItem->getMinFilterMode();
+        sampling.envMode = textureAttributeItem->getEnvMode();
+        sampling.wrapS = textureAttributeItem->getWrapMode( TWCA_S );
+        sampling.wrapT = textureAttributeItem->getWrapMode( TWCA_T );
+    }
+    if ( !texture || !isPtrTo<TextureHost>( texture ) )
+    {
+        return( TextureHostSharedPtr() );
+    }
+
+    // the blend color is a setting of the texture, the pages can't keep it
+    if (   !isAtlasWrapMode( sampling.wrapS ) || !isAtlasWrapMode( sampling.wrapT ) || ( sampling.envMode == TEM_BLEND )
+        || ( isMipmapFilter( sampling.minFilter ) && ( mipLevels == 0 ) ) )
+    {
+        return( TextureHostSharedPtr() );
+    }
+
+    TextureHostSharedPtr textureHostPtr = sharedPtr_cast<TextureHost>( texture );
+    TextureHostReadLock textureHost( textureHostPtr );
+    if (   ( textureHost->getNumberOfImages() != 1 )
+        || ( textureHost->getTextureTarget() != NVSG_TEXTURE_2D )
+        || ( textureHost->getType() != Image::IMG_UNSIGNED_BYTE )
+        || ( getComponentCount( textureHost->getFormat( 0, 0 ) ) == 0 )
+        || ( textureHost->getWidth( 0, 0 ) == 0 ) || ( parameters.maxTextureSize < textureHost->getWidth( 0, 0 ) )
+        || ( textureHost->getHeight( 0, 0 ) == 0 ) || ( parameters.maxTextureSize < textureHost->getHeight( 0, 0 ) )
+        || !textureHost->getPixels( 0, 0 ) )
+    {
+        return( TextureHostSharedPtr() );
+    }
+    return( textureHostPtr );
+}
+
+//! Helper function to check if the texture coordinates 0 of \a vasPtr are two floats inside [0,1], so the texture is not repeated
+bool hasAtlasTexCoords( const VertexAttributeSetSharedPtr &vasPtr )
+{
+    VertexAttributeSetReadLock vas( vasPtr );
+    const unsigned int attrib = VertexAttributeSet::NVSG_TEXCOORD0;
+    if (   ( vas->getNumberOfVertexData( attrib ) == 0 )
+        || ( vas->getTypeOfVertexData( attrib ) != NVSG_FLOAT )
+        || ( vas->getSizeOfVertexData( attrib ) != 2 ) )
+    {
+        return( false );
+    }
+
+    // a little tolerance for the rounding of generated coordinates, the padding covers it
+    const float epsilon = 1.0e-4f;
+    unsigned int count = vas->getNumberOfVertexData( attrib );
+    unsigned int stride = vas->getStrideOfVertexData( attrib );
+    Buffer::DataReadLock lock( vas->getVertexBuffer( attrib ) );
+    const char *data = lock.getPtr<char>() + vas->getOffsetOfVertexData( attrib );
+    for ( unsigned int i = 0; i < count; ++i )
+    {
+        const float *uv = reinterpret_cast<const float *>( data + i * stride );
+        if ( ( uv[0] < -epsilon ) || ( 1.0f + epsilon < uv[0] ) || ( uv[1] < -epsilon ) || ( 1.0f + epsilon < uv[1] ) )
+        {
+            return( false );
+        }
+    }
+    return( true );
+}
+
+/*! Helper function to find the packable textures of \a uses and the StateSets and VertexAttributeSets to redirect to the
+    atlas, the mipmapped textures only if the pages get \a mipLevels levels */
+void setupAtlasScene( const std::vector<AtlasUse> &uses, const TextureAtlasParameters &parameters, unsigned int mipLevels, AtlasScene &scene )
+{
+    std::set<const void *> checkedStateSets;
+    for ( size_t i = 0; i < uses.size(); ++i )
+    {
+        const StateSetSharedPtr &stateSet = uses[i].stateSet;
+        if ( !stateSet || !checkedStateSets.insert( stateSet.get() ).second )
+        {
+            continue;
+        }
+
+        AtlasSampling sampling;
+        TextureHostSharedPtr textureHostPtr = getPackableTexture( stateSet, parameters, mipLevels, sampling );
+        if ( textureHostPtr )
+        {
+            std::map<const void *, unsigned int>::const_iterator it = scene.textureIndices.find( textureHostPtr.get() );
+            if ( it == scene.textureIndices.end() )
+            {
+                AtlasTexture texture;
+                texture.textureHost = textureHostPtr;
+                texture.sampling = sampling;
+                {
+                    TextureHostReadLock textureHost( textureHostPtr );
+                    texture.width = textureHost->getWidth( 0, 0 );
+                    texture.height = textureHost->getHeight( 0, 0 );
+                }
+                texture.valid = true;
+                texture.page = texture.x = texture.y = 0;
+                it = scene.textureIndices.insert( std::make_pair( textureHostPtr.get(), checked_cast<unsigned int>( scene.textures.size() ) ) ).first;
+                scene.textures.push_back( texture );
+            }
+            else if ( !isSameSampling( scene.textures[it->second].sampling, sampling ) )
+            {
+                // one place in one page can't be sampled in two ways
+                scene.textures[it->second].valid = false;
+            }
+            scene.stateSetTextures[stateSet.get()] = it->second;
+            scene.stateSets[stateSet.get()] = stateSet;
+        }
+    }
+
+    // Every use of every VertexAttributeSet is recorded, a texture stays as it is if any of its drawables can't take
+    // the atlas coordinates, or shares its VertexAttributeSet with another texture or a use outside the atlas
+    for ( size_t i = 0; i < uses.size(); ++i )
+    {
+        std::map<const void *, unsigned int>::const_iterator ssti = scene.stateSetTextures.find( uses[i].stateSet.get() );
+        unsigned int textureIndex = ( ssti != scene.stateSetTextures.end() ) ? ssti->second : noAtlasTexture;
+
+        VertexAttributeSetSharedPtr vasPtr;
+        if ( uses[i].drawable && isPtrTo<Primitive>( uses[i].drawable ) )
+        {
+            vasPtr = PrimitiveReadLock( sharedPtr_cast<Primitive>( uses[i].drawable ) )->getVertexAttributeSet();
+        }
+        if ( !vasPtr )
+        {
+            if ( textureIndex != noAtlasTexture )
+            {
+                scene.textures[textureIndex].valid = false;
+            }
+            continue;
+        }
+
+        std::map<const void *, unsigned int>::iterator vti = scene.vasTextures.find( vasPtr.get() );
+        if ( vti == scene.vasTextures.end() )
+        {
+            if ( ( textureIndex != noAtlasTexture ) && !hasAtlasTexCoords( vasPtr ) )
+            {
+                scene.textures[textureIndex].valid = false;
+                textureIndex = noAtlasTexture;
+            }
+            scene.vasTextures[vasPtr.get()] = textureIndex;
+            scene.vas[vasPtr.get()] = vasPtr;
+        }
+        else if ( vti->second != textureIndex )
+        {
+            // the texture coordinates can be moved into one texture only, and not at all if they are used without it
+            if ( textureIndex != noAtlasTexture )
+            {
+                scene.textures[textureIndex].valid = false;
+            }
+            if ( vti->second != noAtlasTexture )
+            {
+                scene.textures[vti->second].valid = false;
+            }
+            vti->second = noAtlasTexture;
+        }
+    }
+}
+
+//! Helper function to round \a value up to a multiple of the power of two \a alignment
+unsigned int alignUp( unsigned int value, unsigned int alignment )
+{
+    return( ( value + alignment - 1 ) & ~( alignment - 1 ) );
+}
+
+//! Helper function to sort the textures by descending height, then width, for the shelf packing
+class TextureHeightGreater
+{
+public:
+    explicit TextureHeightGreater( const std::vector<AtlasTexture> &textures )
+        : m_textures( textures )
+    {
+    }
+
+    bool operator()( unsigned int lhs, unsigned int rhs ) const
+    {
+        const AtlasTexture &l = m_textures[lhs];
+        const AtlasTexture &r = m_textures[rhs];
+        return( ( l.height != r.height ) ? ( r.height < l.height ) : ( r.width < l.width ) );
+    }
+
+private:
+    const std::vector<AtlasTexture> &m_textures;
+};
+
+//! Helper function to place the valid textures on shelves of pages, one set of pages per page sampling, returns the number of pages
+unsigned int packTextures( std::vector<AtlasTexture> &textures, unsigned int pageSize, unsigned int padding, unsigned int alignment
+                         , std::vector<AtlasPage> &pages )
+{
+    std::vector<unsigned int> order;
+    for ( unsigned int i = 0; i < textures.size(); ++i )
+    {
+        if ( textures[i].valid )
+        {
+            order.push_back( i );
+        }
+    }
+    std::sort( order.begin(), order.end(), TextureHeightGreater( textures ) );
+
+    std::vector<size_t> openPages;  // the page being filled per page sampling
+    for ( size_t i = 0; i < order.size(); ++i )
+    {
+        AtlasTexture &texture = textures[order[i]];
+        unsigned int cellWidth = alignUp( texture.width + 2 * padding, alignment );
+        unsigned int cellHeight = alignUp( texture.height + 2 * padding, alignment );
+        if ( ( pageSize < cellWidth ) || ( pageSize < cellHeight ) )
+        {
+            texture.valid = false;
+            continue;
+        }
+
+        size_t open = 0;
+        while ( ( open < openPages.size() ) && !isSamePageSampling( pages[openPages[open]].sampling, texture.sampling ) )
+        {
+            ++open;
+        }
+        if ( ( open < openPages.size() ) && ( pageSize < pages[openPages[open]].cursorX + cellWidth ) )
+        {
+            AtlasPage &page = pages[openPages[open]];
+            page.shelfY += page.shelfHeight;
+            page.shelfHeight = 0;
+            page.cursorX = 0;
+        }
+        if ( ( open == openPages.size() ) || ( pageSize < pages[openPages[open]].shelfY + cellHeight ) )
+        {
+            AtlasPage page;
+            page.sampling = texture.sampling;
+            page.shelfY = 0;
+            page.shelfHeight = 0;
+            page.cursorX = 0;
+            pages.push_back( page );
+            pages.back().texels.resize( 4 * pageSize * pageSize, 0 );
+            if ( open == openPages.size() )
+            {
+                openPages.push_back( pages.size() - 1 );
+            }
+            else
+            {
+                openPages[open] = pages.size() - 1;
+            }
+        }
+
+        AtlasPage &page = pages[openPages[open]];
+        texture.page = checked_cast<unsigned int>( openPages[open] );
+        texture.x = page.cursorX + padding;
+        texture.y = page.shelfY + padding;
+        page.cursorX += cellWidth;
+        page.shelfHeight = std::max( page.shelfHeight, cellHeight );
+    }
+    return( checked_cast<unsigned int>( pages.size() ) );
+}
+
+//! Helper function to get the texel of a row or column of \a size texels that the padding texel \a t repeats with \a wrapMode
+int getPaddingSource( int t, int size, TextureWrapMode wrapMode )
+{
+    if ( wrapMode == TWM_REPEAT )
+    {
+        return( ( ( t % size ) + size ) % size );
+    }
+    return( std::min( std::max( t, 0 ), size - 1 ) );
+}
+
+/*! Helper function to copy \a texture into its page as RGBA, surrounded by \a padding texels that repeat the texture
+    or its border texels, as its wrap modes do */
+void copyTexture( const AtlasTexture &texture, unsigned int padding, unsigned int pageSize, AtlasPage &page )
+{
+    TextureHostReadLock textureHost( texture.textureHost );
+    const unsigned int format = textureHost->getFormat( 0, 0 );
+    const unsigned int components = getComponentCount( format );
+    const bool bgr = ( format == Image::IMG_BGR ) || ( format == Image::IMG_BGRA );
+
+    Buffer::DataReadLock lock( textureHost->getPixels( 0, 0 ) );
+    const unsigned char *src = lock.getPtr<unsigned char>();
+
+    const int w = (int)texture.width;
+    const int h = (int)texture.height;
+    const int p = (int)padding;
+    for ( int ty = -p; ty < h + p; ++ty )
+    {
+        const int sy = getPaddingSource( ty, h, texture.sampling.wrapT );
+        unsigned char *dst = &page.texels[4 * ( ( texture.y + ty ) * pageSize + texture.x - p )];
+        for ( int tx = -p; tx < w + p; ++tx, dst += 4 )
+        {
+            const int sx = getPaddingSource( tx, w, texture.sampling.wrapS );
+            const unsigned char *texel = src + components * ( sy * w + sx );
+            switch( components )
+            {
+            case 1:
+                dst[0] = dst[1] = dst[2] = texel[0];
+                dst[3] = 255;
+                break;
+            case 2:
+                dst[0] = dst[1] = dst[2] = texel[0];
+                dst[3] = texel[1];
+                break;
+            default:
+                dst[0] = texel[bgr ? 2 : 0];
+                dst[1] = texel[1];
+                dst[2] = texel[bgr ? 0 : 2];
+                dst[3] = ( components == 4 ) ? texel[3] : 255;
+                break;
+            }
+        }
+    }
+}
+
+/*! Helper function to create the TextureAttribute of \a page with the filters and environment mode of its textures.
+    If they are mipmapped, the mip chain is reduced by a 2x2 box filter down to level \a mipLevels, the deeper levels
+    would mix neighboring textures. */
+TextureAttributeSharedPtr createPageTextureAttribute( const AtlasPage &page, unsigned int pageSize, unsigned int mipLevels )
+{
+    if ( !isMipmapFilter( page.sampling.minFilter ) )
+    {
+        mipLevels = 0;
+    }
+
+    std::vector< std::vector<unsigned char> > levels;
+    for ( unsigned int size = pageSize / 2; ( levels.size() < mipLevels ) && ( 1 <= size ); size /= 2 )
+    {
+        const std::vector<unsigned char> &upper = levels.empty() ? page.texels : levels.back();
+        std::vector<unsigned char> level( 4 * size * size );
+        for ( unsigned int y = 0; y < size; ++y )
+        {
+            const unsigned char *row0 = &upper[4 * ( 2 * y ) * ( 2 * size )];
+            const unsigned char *row1 = row0 + 4 * ( 2 * size );
+            unsigned char *dst = &level[4 * y * size];
+            for ( unsigned int x = 0; x < 4 * size; ++x )
+            {
+                const unsigned int c = ( x & ~3u ) * 2 + ( x & 3u );
+                dst[x] = (unsigned char)( ( row0[c] + row0[c + 4] + row1[c] + row1[c + 4] + 2 ) / 4 );
+            }
+        }
+        levels.push_back( level );
+    }
+
+    std::vector<const void *> mipmapData;
+    for ( size_t i = 0; i < levels.size(); ++i )
+    {
+        mipmapData.push_back( &levels[i][0] );
+    }
+
+    TextureHostSharedPtr tisp = TextureHost::create();
+    {
+        TextureHostWriteLock tiw( tisp );
+        unsigned int index = tiw->addImage( pageSize, pageSize, 1, Image::IMG_RGBA, Image::IMG_UNSIGNED_BYTE );
+        NVSG_ASSERT( index != -1 );
+        tiw->setImageData( index, (const void *) &page.texels[0], mipmapData );
+        tiw->setTextureTarget( NVSG_TEXTURE_2D );
+        tiw->setTextureGPUFormat( TextureHost::TGF_FIXED8 );
+    }
+
+    TextureAttributeSharedPtr texAttPtr( TextureAttribute::create() );
+    {
+        TextureAttributeWriteLock texAtt( texAttPtr );
+        TextureAttributeItemSharedPtr texAttItemPtr( TextureAttributeItem::create() );
+        TextureAttributeItemWriteLock texAttItem( texAttItemPtr );
+        texAttItem->setTexture( tisp );
+        texAttItem->setMagFilterMode( page.sampling.magFilter );
+        texAttItem->setMinFilterMode( page.sampling.minFilter );
+        texAttItem->setEnvMode( page.sampling.envMode );
+        texAttItem->setWrapMode( TWCA_S, TWM_CLAMP_TO_EDGE );
+        texAttItem->setWrapMode( TWCA_T, TWM_CLAMP_TO_EDGE );
+        texAtt->bindTextureAttributeItem( texAttItemPtr, 0 );
+    }
+    return( texAttPtr );
+}
+
+//! Helper function to map the texture coordinates 0 of \a vasPtr into the place of \a texture in its page
+void remapTexCoords( const VertexAttributeSetSharedPtr &vasPtr, const AtlasTexture &texture, unsigned int pageSize )
+{
+    VertexAttributeSetWriteLock vas( vasPtr );
+    const unsigned int attrib = VertexAttributeSet::NVSG_TEXCOORD0;
+    const unsigned int count = vas->getNumberOfVertexData( attrib );
+    const unsigned int stride = vas->getStrideOfVertexData( attrib );
+
+    const float scale = 1.0f / (float)pageSize;
+    const Vec2f size( (float)texture.width * scale, (float)texture.height * scale );
+    const Vec2f offset( (float)texture.x * scale, (float)texture.y * scale );
+
+    BufferArray<Vec2f> texcoords( count );
+    {
+        Buffer::DataReadLock lock( vas->getVertexBuffer( attrib ) );
+        const char *data = lock.getPtr<char>() + vas->getOffsetOfVertexData( attrib );
+        for ( unsigned int i = 0; i < count; ++i )
+        {
+            const float *uv = reinterpret_cast<const float *>( data + i * stride );
+            texcoords[i] = Vec2f( offset[0] + uv[0] * size[0], offset[1] + uv[1] * size[1] );
+        }
+    }
+    setVertexData( vas, attrib, texcoords );
+}
+}
+
+TextureAtlasParameters::TextureAtlasParameters()
+    : maxTextureSize( 256 )
+    , pageSize( 2048 )
+    , padding( 4 )
+    , mipmaps( true )
+{
+}
+
+TextureAtlasStatistics::TextureAtlasStatistics()
+    : packedTextures( 0 )
+    , pages( 0 )
+    , texturesBefore( 0 )
+    , texturesAfter( 0 )
+    , stateSetsBefore( 0 )
+    , stateSetsAfter( 0 )
+{
+}
+
+// ===========================================================================
+
+bool buildTextureAtlas( const SceneSharedPtr &scene, TextureAtlasStatistics &statistics, const TextureAtlasParameters &parameters )
+{
+    NVSG_ASSERT( parameters.pageSize && !( parameters.pageSize & ( parameters.pageSize - 1 ) ) && "buildTextureAtlas(): pageSize has to be a power of two." );
+
+    statistics = TextureAtlasStatistics();
+
+    NodeSharedPtr root = SceneReadLock( scene )->getRootNode();
+    std::vector<AtlasUse> uses;
+    {
+        std::set<const void *> visited;
+        collectUses( root, visited, uses );
+    }
+    countTextures( uses, statistics.texturesBefore, statistics.stateSetsBefore );
+    statistics.texturesAfter = statistics.texturesBefore;
+    statistics.stateSetsAfter = statistics.stateSetsBefore;
+
+    // the mip levels of a page are limited to the alignment of the textures, see createPageTextureAttribute
+    unsigned int alignment = 1;
+    unsigned int mipLevels = 0;
+    while ( alignment < parameters.padding )
+    {
+        alignment *= 2;
+        ++mipLevels;
+    }
+    if ( !parameters.mipmaps )
+    {
+        mipLevels = 0;
+    }
+
+    AtlasScene atlasScene;
+    setupAtlasScene( uses, parameters, mipLevels, atlasScene );
+
+    std::vector<AtlasPage> pages;
+    statistics.pages = packTextures( atlasScene.textures, parameters.pageSize, parameters.padding, alignment, pages );
+    if ( pages.empty() )
+    {
+        return( false );
+    }
+
+    for ( size_t i = 0; i < atlasScene.textures.size(); ++i )
+    {
+        if ( atlasScene.textures[i].valid )
+        {
+            copyTexture( atlasScene.textures[i], parameters.padding, parameters.pageSize, pages[atlasScene.textures[i].page] );
+            ++statistics.packedTextures;
+        }
+    }
+    for ( size_t i = 0; i < pages.size(); ++i )
+    {
+        pages[i].textureAttribute = createPageTextureAttribute( pages[i], parameters.pageSize, mipLevels );
+        std::vector<unsigned char>().swap( pages[i].texels );
+    }
+
+    for ( std::map<const void *, unsigned int>::const_iterator it = atlasScene.vasTextures.begin(); it != atlasScene.vasTextures.end(); ++it )
+    {
+        if ( ( it->second != noAtlasTexture ) && atlasScene.textures[it->second].valid )
+        {
+            remapTexCoords( atlasScene.vas[it->first], atlasScene.textures[it->second], parameters.pageSize );
+        }
+    }
+
+    // adding the TextureAttribute of the page replaces the one of the texture
+    for ( std::map<const void *, unsigned int>::const_iterator it = atlasScene.stateSetTextures.begin(); it != atlasScene.stateSetTextures.end(); ++it )
+    {
+        const AtlasTexture &texture = atlasScene.textures[it->second];
+        if ( texture.valid )
+        {
+            StateSetWriteLock( atlasScene.stateSets[it->first] )->addAttribute( pages[texture.page].textureAttribute );
+        }
+    }
+
+    // StateSets that differed only in their texture are equivalent now, the rest of the scene is left alone
+    {
+        SmartPtr<UnifyTraverser> ut( new UnifyTraverser );
+        ut->setIgnoreNames( true );
+        ut->setUnifyTargets( UnifyTraverser::UT_STATE_ATTRIBUTE | UnifyTraverser::UT_STATE_SET );
+        ut->apply( scene );
+    }
+
+    uses.clear();
+    {
+        std::set<const void *> visited;
+        collectUses( SceneReadLock( scene )->getRootNode(), visited, uses );
+    }
+    countTextures( uses, statistics.texturesAfter, statistics.stateSetsAfter );
+    return( true );
+}
+
+} // namespace nvutil